@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../include/Math.hpp"
+#include "../include/Options.hpp"
+
+/**
+ * Bench.hpp
+ * Minimal benchmark runner shared by the bench executables.
+ * Every case is timed in several repetitions of enough calls to fill --min-time; the median
+ * repetition is reported, as time per call plus whichever of items/s, GFLOP/s and GB/s apply.
+ * Results go to stdout as a table, or to --out as JSON or CSV for bench/compare.py.
+ */
+namespace bench {
+
+    /**
+     * Keeps the compiler from optimising away a value the benchmark only computes
+     */
+    template <typename T>
+    inline void keep(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "g"(&value) : "memory");
+#else
+        static volatile const void* sink;
+        sink = &value;
+#endif
+    }
+
+    /**
+     * Work done by one call, used to turn time into rates; zero means "not applicable"
+     */
+    struct Work {
+        double items = 0;
+        double flops = 0;
+        double bytes = 0;
+    };
+
+    struct Result {
+        std::string name;
+        std::string type;
+        std::string shape;
+        std::size_t iterations = 0;
+        double ns_per_call = 0;
+        double items_per_second = 0;
+        double gflops = 0;
+        double gbytes_per_second = 0;
+    };
+
+    class Runner {
+    private:
+        std::string suite;
+        std::string filter;
+        std::string format;
+        std::string out_path;
+        double min_time = 0.05;
+        std::size_t repetitions = 5;
+        bool quick = false;
+        std::vector<Result> results;
+
+        static std::string escape(const std::string& str) {
+            std::string res;
+            for (char c : str) {
+                if (c == '"' || c == '\\') res += '\\';
+                res += c;
+            }
+            return res;
+        }
+
+        std::string context_json() const {
+            std::ostringstream os;
+            os << "{\"isa\": \"" << math::simd::kernels<double>().name << "\", \"threads\": " << ThreadPool::Global().Size() + 1
+                << ", \"approximation\": \"" << (math::activation_approximation == math::Approximation::Fast ? "fast" : "exact") << "\"}";
+            return os.str();
+        }
+
+    public:
+        /**
+         * Flags: --filter <substring> --format table|json|csv --out <file> --min-time <seconds> --repetitions N --quick
+         */
+        Runner(std::string suite_name, int argc, char** argv) : suite(std::move(suite_name)) {
+            Options options;
+            options.Parse(argc, argv);
+            options.Expect({ "filter", "format", "out", "min-time", "repetitions", "quick" });
+
+            filter = options.String("filter");
+            format = options.String("format", "table");
+            out_path = options.String("out");
+            min_time = options.Double("min-time", min_time);
+            repetitions = std::max<std::size_t>(options.Number("repetitions", repetitions), 1);
+            quick = options.Flag("quick");
+            if (format != "table" && format != "json" && format != "csv") throw std::invalid_argument("Expected table, json or csv for --format. Received: " + format);
+        }
+
+        /**
+         * @return whether to use the reduced size sweep
+         */
+        bool Quick() const { return quick; }
+
+        /**
+         * Times fn() and records it as name / type / shape
+         */
+        template <typename F>
+        void Run(const std::string& name, const std::string& type, const std::string& shape, const Work& work, F&& fn) {
+            const std::string full = name + "/" + type + "/" + shape;
+            if (!filter.empty() && full.find(filter) == std::string::npos) return;
+
+            using clock = std::chrono::steady_clock;
+            fn();
+
+            // calibrate: double the call count until one repetition takes min_time / repetitions
+            std::size_t iterations = 1;
+            const double target = min_time / static_cast<double>(repetitions);
+            while (true) {
+                const auto start = clock::now();
+                for (std::size_t i = 0; i < iterations; ++i) fn();
+                const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+                if (elapsed >= target || iterations >= (std::size_t(1) << 30)) break;
+                iterations = elapsed <= 0 ? iterations * 16 : std::max(iterations * 2, static_cast<std::size_t>(iterations * target / elapsed * 1.2));
+            }
+
+            std::vector<double> samples(repetitions);
+            for (double& sample : samples) {
+                const auto start = clock::now();
+                for (std::size_t i = 0; i < iterations; ++i) fn();
+                sample = std::chrono::duration<double, std::nano>(clock::now() - start).count() / static_cast<double>(iterations);
+            }
+            std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+            const double ns = samples[samples.size() / 2];
+
+            Result result;
+            result.name = name;
+            result.type = type;
+            result.shape = shape;
+            result.iterations = iterations;
+            result.ns_per_call = ns;
+            result.items_per_second = work.items > 0 ? work.items / ns * 1e9 : 0;
+            result.gflops = work.flops > 0 ? work.flops / ns : 0;
+            result.gbytes_per_second = work.bytes > 0 ? work.bytes / ns : 0;
+            results.push_back(result);
+
+            if (format == "table" || !out_path.empty()) {
+                char line[256];
+                std::snprintf(line, sizeof(line), "%-28s %-7s %-18s %14.1f ns %14.4g items/s %9.3f GFLOP/s %9.3f GB/s",
+                    name.c_str(), type.c_str(), shape.c_str(), ns, result.items_per_second, result.gflops, result.gbytes_per_second);
+                std::cout << line << std::endl;
+            }
+        }
+
+        /**
+         * Writes the collected results in the requested format
+         */
+        void Report() const {
+            if (format == "table") return;
+
+            std::ostringstream os;
+            if (format == "json") {
+                os << "{\n  \"suite\": \"" << escape(suite) << "\",\n  \"context\": " << context_json() << ",\n  \"results\": [\n";
+                for (std::size_t i = 0; i < results.size(); ++i) {
+                    const Result& r = results[i];
+                    os << "    {\"name\": \"" << escape(r.name) << "\", \"type\": \"" << r.type << "\", \"shape\": \"" << r.shape
+                        << "\", \"iterations\": " << r.iterations << ", \"ns_per_call\": " << r.ns_per_call
+                        << ", \"items_per_second\": " << r.items_per_second << ", \"gflops\": " << r.gflops
+                        << ", \"gbytes_per_second\": " << r.gbytes_per_second << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+                }
+                os << "  ]\n}\n";
+            }
+            else {
+                os << "suite,name,type,shape,iterations,ns_per_call,items_per_second,gflops,gbytes_per_second\n";
+                for (const Result& r : results) {
+                    os << suite << "," << r.name << "," << r.type << "," << r.shape << "," << r.iterations << "," << r.ns_per_call
+                        << "," << r.items_per_second << "," << r.gflops << "," << r.gbytes_per_second << "\n";
+                }
+            }
+
+            if (out_path.empty()) {
+                std::cout << os.str();
+                return;
+            }
+            std::ofstream file(out_path);
+            if (!file) throw std::invalid_argument("Cannot create file: " + out_path);
+            file << os.str();
+        }
+    };
+
+}
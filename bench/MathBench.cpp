@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "../include/Math.hpp"
+#include "../include/Random.hpp"
+
+/**
+ * MathBench
+ * Micro benchmarks of every Math.hpp primitive the network is built from, swept over sizes,
+ * in double and float precision, plus the fused optimizer updates and the bulk random number
+ * generators of Random.hpp.
+ *
+ * Usage: math_bench [--filter <substring>] [--format table|json|csv] [--out <file>]
+ *                   [--min-time <seconds>] [--repetitions N] [--quick]
+ * MATH_SIMD, MATH_THREADS and MATH_APPROX apply as usual and are recorded in the JSON context.
+ */
+
+template <typename T>
+static void fill_random(T* data, size_t n, std::mt19937& engine, double min = -1.0, double max = 1.0) {
+	std::uniform_real_distribution<double> dist(min, max);
+	for (size_t i = 0; i < n; ++i) data[i] = static_cast<T>(dist(engine));
+}
+
+template <typename T>
+static const char* type_name() { return sizeof(T) == sizeof(double) ? "double" : "float"; }
+
+static std::string shape(size_t n) { return "n=" + std::to_string(n); }
+static std::string shape(size_t m, size_t n) { return std::to_string(m) + "x" + std::to_string(n); }
+static std::string shape(size_t m, size_t n, size_t k) { return std::to_string(m) + "x" + std::to_string(n) + "x" + std::to_string(k); }
+
+template <typename T>
+static void bench_vector_ops(bench::Runner& runner, const std::vector<size_t>& sizes) {
+	using Vector = std::vector<T>;
+	using math::operator*;
+	const char* type = type_name<T>();
+	const double s = sizeof(T);
+	std::mt19937 engine(1);
+
+	for (size_t n : sizes) {
+		Vector x(n), y(n);
+		math::BasicMatrix<T> a(1, n), b(1, n), c(1, n);
+		fill_random(x.data(), n, engine);
+		fill_random(y.data(), n, engine);
+		fill_random(a.data(), n, engine);
+		fill_random(b.data(), n, engine);
+		const double dn = static_cast<double>(n);
+
+		runner.Run("dot", type, shape(n), { dn, 2 * dn, 2 * dn * s }, [&] {
+			const T r = x * y;
+			bench::keep(r);
+		});
+		runner.Run("dot_wide_acc", type, shape(n), { dn, 2 * dn, 2 * dn * s }, [&] {
+			const double r = math::dot<double>(math::BasicRowView<const T>(x), math::BasicRowView<const T>(y));
+			bench::keep(r);
+		});
+		runner.Run("axpy", type, shape(n), { dn, 2 * dn, 3 * dn * s }, [&] {
+			math::axpy(T(1e-3), math::BasicRowView<const T>(x), math::BasicRowView<T>(y));
+			bench::keep(y);
+		});
+		runner.Run("mul_add", type, shape(n), { dn, 2 * dn, 4 * dn * s }, [&] {
+			math::mul_add<T>(a.flat(), b.flat(), c.flat());
+			bench::keep(c);
+		});
+		runner.Run("add", type, shape(n), { dn, dn, 3 * dn * s }, [&] {
+			c = a + b;
+			bench::keep(c);
+		});
+		runner.Run("sub", type, shape(n), { dn, dn, 3 * dn * s }, [&] {
+			c = a - b;
+			bench::keep(c);
+		});
+		runner.Run("scale", type, shape(n), { dn, dn, 2 * dn * s }, [&] {
+			c = a * 0.5;
+			bench::keep(c);
+		});
+		runner.Run("fused_axpby", type, shape(n), { dn, 3 * dn, 3 * dn * s }, [&] {
+			c = a * 0.5 + b * 0.25;
+			bench::keep(c);
+		});
+	}
+}
+
+template <typename T>
+static void bench_activations(bench::Runner& runner, const std::vector<size_t>& sizes) {
+	const char* type = type_name<T>();
+	const double s = sizeof(T);
+	std::mt19937 engine(2);
+
+	for (math::Approximation approximation : { math::Approximation::Exact, math::Approximation::Fast }) {
+		const math::Approximation previous = math::activation_approximation;
+		math::activation_approximation = approximation;
+		const std::string suffix = approximation == math::Approximation::Fast ? "_fast" : "";
+
+		for (size_t n : sizes) {
+			std::vector<T> in(n), positive(n), out(n), targets(n);
+			fill_random(in.data(), n, engine, -4.0, 4.0);
+			fill_random(positive.data(), n, engine, 0.01, 4.0);
+			for (size_t i = 0; i < n; ++i) targets[i] = static_cast<T>(i % 2);
+			const math::BasicRowView<const T> x(in), p(positive), t(targets);
+			const math::BasicRowView<T> y(out);
+			const double dn = static_cast<double>(n);
+			const bench::Work work{ dn, 0, 2 * dn * s };
+
+			runner.Run("exp" + suffix, type, shape(n), work, [&] { math::exp(x, y); bench::keep(out); });
+			runner.Run("log" + suffix, type, shape(n), work, [&] { math::log(p, y); bench::keep(out); });
+			runner.Run("tanh" + suffix, type, shape(n), work, [&] { math::tanh(x, y); bench::keep(out); });
+			runner.Run("sigmoid" + suffix, type, shape(n), work, [&] { math::sigmoid(x, y); bench::keep(out); });
+			runner.Run("bce_loss" + suffix, type, shape(n), work, [&] {
+				const double loss = math::bce_with_logits_loss<double>(x, t);
+				bench::keep(loss);
+			});
+
+			if (approximation == math::Approximation::Exact) {
+				const math::BasicRowView<const T> outputs(positive);
+				runner.Run("tanh_backward", type, shape(n), { dn, 3 * dn, 3 * dn * s }, [&] { math::tanh_backward(outputs, y); bench::keep(out); });
+				runner.Run("sigmoid_backward", type, shape(n), { dn, 3 * dn, 3 * dn * s }, [&] { math::sigmoid_backward(outputs, y); bench::keep(out); });
+				runner.Run("bce_loss_delta", type, shape(n), { dn, 0, 3 * dn * s }, [&] { math::bce_with_logits_loss_delta(x, t, y); bench::keep(out); });
+			}
+		}
+
+		math::activation_approximation = previous;
+	}
+}
+
+template <typename T>
+static void bench_matrix_ops(bench::Runner& runner, const std::vector<size_t>& squares, const std::vector<size_t>& gemm_sizes) {
+	const char* type = type_name<T>();
+	const double s = sizeof(T);
+	std::mt19937 engine(3);
+
+	for (size_t n : squares) {
+		math::BasicMatrix<T> mtx(n, n), acc(n, n);
+		std::vector<T> vec(n), out(n), delt(n), inpt(n);
+		fill_random(mtx.data(), mtx.size(), engine);
+		fill_random(vec.data(), n, engine);
+		fill_random(delt.data(), n, engine);
+		fill_random(inpt.data(), n, engine);
+		const double area = static_cast<double>(n) * static_cast<double>(n);
+
+		runner.Run("gemv", type, shape(n, n), { area, 2 * area, area * s }, [&] {
+			math::gemv_into(mtx, vec, out);
+			bench::keep(out);
+		});
+		runner.Run("gemv_alloc", type, shape(n, n), { area, 2 * area, area * s }, [&] {
+			const std::vector<T> res = mtx * vec;
+			bench::keep(res);
+		});
+		runner.Run("weights_gradient", type, shape(n, n), { area, area, area * s }, [&] {
+			const math::BasicMatrix<T> grad = math::weights_gradient(delt, inpt);
+			bench::keep(grad);
+		});
+		runner.Run("accumulate_weights_gradient", type, shape(n, n), { area, 2 * area, 2 * area * s }, [&] {
+			math::accumulate_weights_gradient(acc, delt, inpt);
+			bench::keep(acc);
+		});
+		runner.Run("add_to_rows", type, shape(n, n), { area, area, 2 * area * s }, [&] {
+			math::add_to_rows(acc, vec);
+			bench::keep(acc);
+		});
+		runner.Run("column_sums", type, shape(n, n), { area, area, area * s }, [&] {
+			math::column_sums_into(mtx, out);
+			bench::keep(out);
+		});
+	}
+
+	for (size_t n : gemm_sizes) {
+		math::BasicMatrix<T> a(n, n), b(n, n), c(n, n);
+		fill_random(a.data(), a.size(), engine);
+		fill_random(b.data(), b.size(), engine);
+		const double flops = 2.0 * n * n * n;
+		math::gemm_reserve<T>();
+
+		runner.Run("gemm_nn", type, shape(n, n, n), { 0, flops, 3.0 * n * n * s }, [&] {
+			math::gemm(math::Transpose::No, math::Transpose::No, T(1), a, b, T(0), c);
+			bench::keep(c);
+		});
+		runner.Run("gemm_nt", type, shape(n, n, n), { 0, flops, 3.0 * n * n * s }, [&] {
+			math::gemm(math::Transpose::No, math::Transpose::Yes, T(1), a, b, T(0), c);
+			bench::keep(c);
+		});
+		runner.Run("gemm_tn", type, shape(n, n, n), { 0, flops, 3.0 * n * n * s }, [&] {
+			math::gemm(math::Transpose::Yes, math::Transpose::No, T(1), a, b, T(1), c);
+			bench::keep(c);
+		});
+	}
+}
+
+/**
+ * One optimizer update of n weights; bytes count every buffer read and written once, as the kernels do
+ */
+template <typename T>
+static void bench_optimizers(bench::Runner& runner, const std::vector<size_t>& sizes) {
+	const char* type = type_name<T>();
+	const double s = sizeof(T);
+	std::mt19937 engine(4);
+
+	math::simd::UpdateStep<T> step;
+	step.rate = T(1e-4);
+	step.decay = T(1e-4);
+	step.momentum = T(0.9);
+	step.velocity_weight = T(0.9);
+	step.gradient_weight = T(1);
+	step.beta1 = T(0.9);
+	step.beta2 = T(0.999);
+	step.epsilon = T(1e-8);
+
+	for (size_t n : sizes) {
+		std::vector<T> w(n), g(n), m(n, T(0)), v(n, T(0));
+		fill_random(w.data(), n, engine);
+		fill_random(g.data(), n, engine);
+		const double dn = static_cast<double>(n);
+
+		runner.Run("sgd_update", type, shape(n), { dn, 4 * dn, 3 * dn * s }, [&] {
+			math::sgd_update(math::BasicRowView<T>(w), math::BasicRowView<const T>(g), step);
+			bench::keep(w.data());
+		});
+		runner.Run("momentum_update", type, shape(n), { dn, 9 * dn, 5 * dn * s }, [&] {
+			math::momentum_update(math::BasicRowView<T>(w), math::BasicRowView<const T>(g), math::BasicRowView<T>(v), step);
+			bench::keep(w.data());
+		});
+		runner.Run("adam_update", type, shape(n), { dn, 16 * dn, 7 * dn * s }, [&] {
+			math::adam_update(math::BasicRowView<T>(w), math::BasicRowView<const T>(g), math::BasicRowView<T>(m), math::BasicRowView<T>(v), step);
+			bench::keep(w.data());
+		});
+	}
+}
+
+/**
+ * Bulk random numbers (Xavier init) and permutations (minibatch shuffling), against the standard library
+ */
+template <typename T>
+static void bench_random(bench::Runner& runner, const std::vector<size_t>& sizes) {
+	const char* type = type_name<T>();
+	const double s = sizeof(T);
+
+	for (size_t n : sizes) {
+		std::vector<T> x(n);
+		const double dn = static_cast<double>(n);
+
+		runner.Run("uniform_philox", type, shape(n), { dn, 0, dn * s }, [&] {
+			Random::Uniform(x.data(), n, -1.0, 1.0, 0);
+			bench::keep(x.data());
+		});
+		Xoshiro256 xoshiro(1);
+		runner.Run("uniform_xoshiro", type, shape(n), { dn, 0, dn * s }, [&] {
+			for (T& v : x) v = static_cast<T>(-1.0 + 2.0 * xoshiro.Unit());
+			bench::keep(x.data());
+		});
+		std::mt19937 engine(1);
+		runner.Run("uniform_mt19937", type, shape(n), { dn, 0, dn * s }, [&] {
+			fill_random(x.data(), n, engine);
+			bench::keep(x.data());
+		});
+	}
+
+	if (sizeof(T) != sizeof(double)) return;
+	for (size_t n : sizes) {
+		std::vector<uint32_t> order(n);
+		const double dn = static_cast<double>(n);
+		Xoshiro256 xoshiro(2);
+		runner.Run("permutation_xoshiro", "uint32", shape(n), { dn, 0, 2 * dn * sizeof(uint32_t) }, [&] {
+			Random::Permutation(order.data(), n, xoshiro);
+			bench::keep(order.data());
+		});
+		std::mt19937_64 engine(2);
+		runner.Run("permutation_mt19937", "uint32", shape(n), { dn, 0, 2 * dn * sizeof(uint32_t) }, [&] {
+			for (size_t i = 0; i < n; ++i) order[i] = static_cast<uint32_t>(i);
+			std::shuffle(order.begin(), order.end(), engine);
+			bench::keep(order.data());
+		});
+	}
+}
+
+template <typename T>
+static void bench_all(bench::Runner& runner) {
+	const bool quick = runner.Quick();
+	const std::vector<size_t> vectors = quick ? std::vector<size_t>{ 256, 65536 } : std::vector<size_t>{ 16, 256, 4096, 65536, 1048576 };
+	const std::vector<size_t> squares = quick ? std::vector<size_t>{ 64, 512 } : std::vector<size_t>{ 16, 64, 256, 1024 };
+	const std::vector<size_t> gemms = quick ? std::vector<size_t>{ 64, 256 } : std::vector<size_t>{ 16, 64, 256, 512 };
+
+	bench_vector_ops<T>(runner, vectors);
+	bench_activations<T>(runner, vectors);
+	bench_matrix_ops<T>(runner, squares, gemms);
+	bench_optimizers<T>(runner, vectors);
+	bench_random<T>(runner, vectors);
+}
+
+int main(int argc, char** argv) {
+	try {
+		bench::Runner runner("math", argc, argv);
+		Random::Init(1);
+		bench_all<double>(runner);
+		bench_all<float>(runner);
+		runner.Report();
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,134 @@
+#include <cstddef>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Bench.hpp"
+#include "../include/FixedNetwork.hpp"
+#include "../include/Math.hpp"
+#include "../include/Network.hpp"
+#include "../include/Optimizer.hpp"
+#include "../include/Quantize.hpp"
+#include "../include/ThreadPool.hpp"
+#include "../include/Trainer.hpp"
+
+/**
+ * TrainingBench
+ * End-to-end training throughput: one full minibatch step (forward, backward, reduction and
+ * update) per call, for several network sizes, with the synchronous, Hogwild and (where the
+ * topology has one) compile-time sized trainer. train_step_adam is the synchronous step with
+ * Adam in place of SGD, to show what the optimizer state costs. forward_int8 is the forward pass
+ * of the network quantized to int8, next to the forward pass it replaces.
+ * Reported as samples/s and GFLOP/s, counting 6 flops per weight per sample
+ * (2 forward, 2 for the input gradient, 2 for the weight gradient).
+ *
+ * Usage: training_bench [--filter <substring>] [--format table|json|csv] [--out <file>]
+ *                       [--min-time <seconds>] [--repetitions N] [--quick]
+ */
+
+struct Case {
+	nn::Topology topology;
+	size_t batch;
+};
+
+static std::string shape(const Case& c) {
+	return nn::to_string(c.topology) + (c.topology.layers.front().activation == nn::Activation::Relu ? "-relu" : "") + "/b" + std::to_string(c.batch);
+}
+
+template <typename T>
+static void bench_training(bench::Runner& runner, const std::vector<Case>& cases) {
+	const char* type = sizeof(T) == sizeof(double) ? "double" : "float";
+	const size_t workers = ThreadPool::Global().Size() + 1;
+	std::mt19937 engine(4);
+	std::uniform_real_distribution<double> dist(-1.0, 1.0);
+
+	for (const Case& c : cases) {
+		const nn::Topology& topo = c.topology;
+		nn::Network<T> params(topo);
+		params.initialize([&](size_t, T* weights, size_t count, double min, double max) {
+			for (size_t i = 0; i < count; ++i) weights[i] = static_cast<T>(min + (max - min) * (dist(engine) + 1.0) / 2.0);
+		});
+
+		std::vector<T> inputs(c.batch * topo.input), targets(c.batch);
+		for (T& x : inputs) x = static_cast<T>(dist(engine));
+		for (size_t i = 0; i < c.batch; ++i) targets[i] = static_cast<T>(i % 2);
+
+		double weights = 0;
+		for (size_t l = 0; l < topo.depth(); ++l) weights += static_cast<double>(topo.layers[l].units * topo.fan_in(l));
+		const double samples = static_cast<double>(c.batch);
+		const bench::Work work{ samples, 6 * weights * samples, 0 };
+		// a tiny learning rate keeps the weights (and so the timing) steady however many steps run
+		const double learning_rate = 1e-6;
+
+		nn::DataParallelTrainer<T> trainer(topo, c.batch, workers);
+		trainer.load_batch(math::BasicRowView<const T>(inputs), math::BasicRowView<const T>(targets));
+		runner.Run("train_step_sync", type, shape(c), work, [&] {
+			const T loss = trainer.step(params, learning_rate);
+			bench::keep(loss);
+		});
+
+		nn::OptimizerSettings adam;
+		adam.kind = nn::OptimizerKind::Adam;
+		nn::DataParallelTrainer<T> adam_trainer(topo, c.batch, workers, adam);
+		adam_trainer.load_batch(math::BasicRowView<const T>(inputs), math::BasicRowView<const T>(targets));
+		runner.Run("train_step_adam", type, shape(c), work, [&] {
+			const T loss = adam_trainer.step(params, learning_rate);
+			bench::keep(loss);
+		});
+
+		nn::HogwildTrainer<T> hogwild(topo, c.batch, workers);
+		hogwild.load_batch(math::BasicRowView<const T>(inputs), math::BasicRowView<const T>(targets));
+		runner.Run("train_step_hogwild", type, shape(c), work, [&] {
+			const T loss = hogwild.step(params, learning_rate);
+			bench::keep(loss);
+		});
+
+		// compile-time sized kernels, for the topologies they are built for
+		if (std::unique_ptr<nn::FixedTrainer<T>> fixed = nn::make_fixed_trainer<T>(topo, c.batch)) {
+			fixed->load(params);
+			fixed->load_batch(math::BasicRowView<const T>(inputs), math::BasicRowView<const T>(targets));
+			runner.Run("train_step_fixed", type, shape(c), work, [&] {
+				const T loss = fixed->step(learning_rate);
+				bench::keep(loss);
+			});
+		}
+
+		nn::BasicWorkspace<T> ws(topo, c.batch);
+		std::copy(inputs.begin(), inputs.end(), ws.input.data());
+		runner.Run("forward", type, shape(c), { samples, 2 * weights * samples, 0 }, [&] {
+			nn::forward(params, ws);
+			bench::keep(ws.logits());
+		});
+
+		const nn::QuantizedNetwork<T> quantized(params);
+		nn::QuantizedWorkspace quantized_ws(topo, c.batch);
+		runner.Run("forward_int8", type, shape(c), { samples, 2 * weights * samples, 0 }, [&] {
+			quantized.forward(inputs.data(), c.batch, ws.logits().data(), quantized_ws);
+			bench::keep(ws.logits());
+		});
+	}
+}
+
+int main(int argc, char** argv) {
+	try {
+		bench::Runner runner("training", argc, argv);
+		std::vector<Case> cases = { { nn::dense_topology(2, { 4 }, 1), 4 }, { nn::dense_topology(4, { 16 }, 1), 64 }, { nn::dense_topology(16, { 64 }, 1), 256 } };
+		if (!runner.Quick()) {
+			cases.push_back({ nn::dense_topology(128, { 256 }, 1), 512 });
+			cases.push_back({ nn::dense_topology(784, { 512 }, 1), 256 });
+			cases.push_back({ nn::dense_topology(784, { 512, 256 }, 1, nn::Activation::Relu), 256 });
+		}
+
+		bench_training<double>(runner, cases);
+		bench_training<float>(runner, cases);
+		runner.Report();
+	}
+	catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""
+compare.py
+Compares two benchmark runs written by math_bench / training_bench (--format json or csv)
+and flags every case that got slower by more than the threshold.
+
+Usage: compare.py <baseline> <current> [--threshold 0.05] [--all]
+Each side is a result file or a directory of them (e.g. build/bench-results).
+Exits with 1 if any regression was found, so it can gate a CI job.
+"""
+
+import argparse
+import csv
+import json
+import os
+import sys
+
+
+def load_file(path):
+    if path.endswith(".csv"):
+        with open(path, newline="") as f:
+            return [dict(row, ns_per_call=float(row["ns_per_call"])) for row in csv.DictReader(f)]
+
+    with open(path) as f:
+        data = json.load(f)
+    return [dict(row, suite=data["suite"]) for row in data["results"]]
+
+
+def load(path):
+    files = [path]
+    if os.path.isdir(path):
+        files = sorted(os.path.join(path, name) for name in os.listdir(path) if name.endswith((".json", ".csv")))
+        if not files:
+            sys.exit("No result files in " + path)
+
+    results = {}
+    for file in files:
+        for row in load_file(file):
+            results[(row["suite"], row["name"], row["type"], row["shape"])] = row["ns_per_call"]
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Flag benchmark regressions between two runs")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=0.05, help="relative slowdown that counts as a regression (default 0.05)")
+    parser.add_argument("--all", action="store_true", help="list unchanged cases too")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = 0
+    improvements = 0
+    rows = []
+    for key in sorted(baseline.keys() & current.keys()):
+        before, after = baseline[key], current[key]
+        change = after / before - 1 if before > 0 else 0.0
+        if change > args.threshold:
+            status = "REGRESSION"
+            regressions += 1
+        elif change < -args.threshold:
+            status = "improved"
+            improvements += 1
+        else:
+            status = ""
+        if status or args.all:
+            rows.append((status, "/".join(key), before, after, change))
+
+    for status, name, before, after, change in rows:
+        print(f"{status:<10} {name:<70} {before:>14.1f} ns -> {after:>14.1f} ns  {change * 100:+7.1f}%")
+
+    missing = sorted(baseline.keys() - current.keys())
+    added = sorted(current.keys() - baseline.keys())
+    for key in missing:
+        print("missing    " + "/".join(key))
+    for key in added:
+        print("new        " + "/".join(key))
+
+    compared = len(baseline.keys() & current.keys())
+    print(f"\n{compared} compared, {regressions} regressed, {improvements} improved (threshold {args.threshold * 100:.1f}%)")
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+/**
+ * AllocationCounter.hpp
+ * Counts global heap allocations, so hot loops can be checked for being allocation-free.
+ * Replacing the global operator new / delete costs every allocation an atomic increment, so it is
+ * opt-in: define COUNT_ALLOCATIONS in exactly one translation unit before including this header
+ * (the SNN_COUNT_ALLOCATIONS CMake option does that for the program). Without it, Enabled() is
+ * false everywhere and Count() stays 0.
+ */
+class AllocationCounter {
+private:
+    static inline std::atomic<std::size_t> allocations{ 0 };
+    static inline std::atomic<bool> installed{ false };
+
+    AllocationCounter() = delete;
+    ~AllocationCounter() = delete;
+
+public:
+    static void Add() {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static bool Install() {
+        installed.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @return number of heap allocations made since program start
+     */
+    static std::size_t Count() {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return true if some translation unit of this program installed the counting operator new
+     */
+    static bool Enabled() {
+        return installed.load(std::memory_order_relaxed);
+    }
+};
+
+#ifdef COUNT_ALLOCATIONS
+
+namespace allocation_counter_detail {
+
+    // lets every translation unit see whether counting is on, not just this one
+    inline const bool installed = AllocationCounter::Install();
+
+    inline void* allocate(std::size_t size) {
+        AllocationCounter::Add();
+        if (void* p = std::malloc(size ? size : 1)) return p;
+        throw std::bad_alloc();
+    }
+
+    inline void* allocate_aligned(std::size_t size, std::align_val_t align) {
+        AllocationCounter::Add();
+        const std::size_t alignment = static_cast<std::size_t>(align);
+        const std::size_t rounded = (size + alignment - 1) / alignment * alignment;
+#ifdef _WIN32
+        void* p = _aligned_malloc(rounded ? rounded : alignment, alignment);
+#else
+        void* p = std::aligned_alloc(alignment, rounded ? rounded : alignment);
+#endif
+        if (p) return p;
+        throw std::bad_alloc();
+    }
+
+    inline void release_aligned(void* p) noexcept {
+#ifdef _WIN32
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+
+}
+
+void* operator new(std::size_t size) { return allocation_counter_detail::allocate(size); }
+void* operator new[](std::size_t size) { return allocation_counter_detail::allocate(size); }
+void* operator new(std::size_t size, std::align_val_t align) { return allocation_counter_detail::allocate_aligned(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return allocation_counter_detail::allocate_aligned(size, align); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { allocation_counter_detail::release_aligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { allocation_counter_detail::release_aligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { allocation_counter_detail::release_aligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { allocation_counter_detail::release_aligned(p); }
+
+#endif
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "MappedFile.hpp"
+#include "Math.hpp"
+#include "Network.hpp"
+#include "Random.hpp"
+#include "ThreadPool.hpp"
+#include "Trainer.hpp"
+#include "Workspace.hpp"
+
+/**
+ * Autotune.hpp
+ * Measures which kernel settings train a given network fastest on this machine, and remembers the answer.
+ * The settings are the knobs Math.hpp already exposes: the SIMD instruction set, the thread count,
+ * gemm's cache blocking and the operand sizes at which work goes SIMD or parallel. autotune() times
+ * full synchronous training steps for the actual layer shapes and batch, one knob at a time, and
+ * TuningCache keeps the winners in a text file keyed by CPU model and shape, so a later run on the
+ * same kind of host just loads them.
+ */
+namespace nn {
+
+#pragma region settings
+
+    /**
+     * Every machine-dependent choice of the math kernels
+     */
+    struct KernelSettings {
+        math::simd::Isa isa = math::simd::Isa::Scalar;
+        std::size_t threads = 1;
+        math::GemmBlocking blocking;
+        math::ExecutionThresholds thresholds;
+    };
+
+    /**
+     * @return settings in use right now
+     */
+    inline KernelSettings current_kernel_settings() {
+        KernelSettings settings;
+        settings.isa = math::simd::kernels().isa;
+        settings.threads = ThreadPool::Global().Size() + 1;
+        settings.blocking = math::gemm_blocking;
+        settings.thresholds = math::execution_thresholds;
+        return settings;
+    }
+
+    /**
+     * Switches the math kernels to settings. With keep_environment, an instruction set or thread count
+     * set through MATH_SIMD or MATH_THREADS wins over the one in settings.
+     */
+    inline void apply_kernel_settings(const KernelSettings& settings, bool keep_environment = false) {
+        const bool simd_pinned = keep_environment && std::getenv("MATH_SIMD");
+        math::simd::set_isa(simd_pinned ? math::simd::startup_isa() : settings.isa);
+
+        // Configure(0) goes back to MATH_THREADS
+        const bool threads_pinned = keep_environment && std::getenv("MATH_THREADS");
+        if (threads_pinned) ThreadPool::Configure(0);
+        else if (settings.threads != ThreadPool::Global().Size() + 1) ThreadPool::Configure(settings.threads);
+        math::gemm_blocking = settings.blocking;
+        math::execution_thresholds = settings.thresholds;
+    }
+
+    /**
+     * @return settings in a few words, e.g. "avx512, 4 threads, gemm 96x256x2048, simd from 16, parallel from 131072 (gemm 4194304)"
+     */
+    inline std::string describe(const KernelSettings& settings) {
+        std::ostringstream text;
+        text << math::simd::kernels_for<double>(settings.isa).name << ", " << settings.threads << (settings.threads == 1 ? " thread" : " threads")
+             << ", gemm " << settings.blocking.mc << "x" << settings.blocking.kc << "x" << settings.blocking.nc
+             << ", simd from " << settings.thresholds.simd << ", parallel from " << settings.thresholds.parallel
+             << " (gemm " << settings.thresholds.gemm_parallel << ")";
+        return text.str();
+    }
+
+    inline math::simd::Isa parse_isa(const std::string& name) {
+        for (math::simd::Isa isa : { math::simd::Isa::Scalar, math::simd::Isa::SSE2, math::simd::Isa::AVX2, math::simd::Isa::AVX512 }) {
+            if (name == math::simd::kernels_for<double>(isa).name) return isa;
+        }
+        throw std::invalid_argument("Expected scalar, sse2, avx2 or avx512. Received: " + name);
+    }
+
+    /**
+     * @return processor brand string and hardware thread count, e.g. "Intel(R) Xeon(R) Gold 6248 CPU @ 2.50GHz x 8";
+     *         hosts that share it share their tuning
+     */
+    inline std::string cpu_model() {
+        std::string brand;
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned regs[12] = {};
+        if (__get_cpuid_max(0x80000000u, nullptr) >= 0x80000004u) {
+            for (unsigned leaf = 0; leaf < 3; ++leaf) __get_cpuid(0x80000002u + leaf, &regs[4 * leaf], &regs[4 * leaf + 1], &regs[4 * leaf + 2], &regs[4 * leaf + 3]);
+            brand.assign(reinterpret_cast<const char*>(regs), sizeof(regs));
+            brand = brand.c_str();
+        }
+#else
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        for (std::string line; brand.empty() && std::getline(cpuinfo, line);) {
+            if (line.compare(0, 10, "model name") == 0 || line.compare(0, 9, "Processor") == 0) brand = line.substr(line.find(':') + 1);
+        }
+#endif
+        // tabs separate the cache columns, and brand strings come padded with spaces
+        std::replace(brand.begin(), brand.end(), '\t', ' ');
+        const std::size_t first = brand.find_first_not_of(' ');
+        brand = first == std::string::npos ? "unknown CPU" : brand.substr(first, brand.find_last_not_of(' ') - first + 1);
+        return brand + " x" + std::to_string(std::max(1u, std::thread::hardware_concurrency()));
+    }
+
+    /**
+     * @return "double", "float" or "mixed" (float storage with Acc sums)
+     */
+    template <typename T, typename Acc = T>
+    inline const char* precision_name() {
+        if (!std::is_same_v<T, Acc>) return "mixed";
+        return std::is_same_v<T, float> ? "float" : "double";
+    }
+
+    /**
+     * @return what a tuning applies to: precision, topology, activation and batch, e.g. "double 2-512-512-1 tanh b128"
+     */
+    inline std::string tuning_shape(const std::string& precision, const Topology& topo, std::size_t batch) {
+        return precision + " " + to_string(topo) + " " + activation_name(topo.layers.front().activation) + " b" + std::to_string(batch);
+    }
+
+#pragma endregion
+
+#pragma region cache
+
+    /**
+     * Tuned settings per CPU model and shape, in a tab-separated text file with one line per entry:
+     * cpu, shape, isa, threads, mc, kc, nc, simd, parallel, grain, gemm_parallel and the measured time per step in ns.
+     * A missing file is an empty cache; save() rewrites the whole file through a temporary one.
+     */
+    class TuningCache {
+    public:
+        struct Entry {
+            std::string cpu;
+            std::string shape;
+            KernelSettings settings;
+            double step_ns = 0.0;
+        };
+
+    private:
+        std::string path;
+        std::vector<Entry> entries;
+
+    public:
+        explicit TuningCache(const std::string& file_path) : path(file_path) {
+            std::ifstream file(path);
+            std::string line;
+            for (std::size_t number = 1; std::getline(file, line); ++number) {
+                if (line.empty() || line[0] == '#') continue;
+
+                std::vector<std::string> fields;
+                std::istringstream columns(line);
+                for (std::string field; std::getline(columns, field, '\t');) fields.push_back(field);
+                if (fields.size() != 12) throw std::invalid_argument(path + ":" + std::to_string(number) + ": expected 12 tab-separated fields");
+
+                try {
+                    Entry entry;
+                    entry.cpu = fields[0];
+                    entry.shape = fields[1];
+                    entry.settings.isa = parse_isa(fields[2]);
+                    entry.settings.threads = std::stoull(fields[3]);
+                    entry.settings.blocking = math::GemmBlocking{ std::stoull(fields[4]), std::stoull(fields[5]), std::stoull(fields[6]) };
+                    entry.settings.thresholds = math::ExecutionThresholds{ std::stoull(fields[7]), std::stoull(fields[8]), std::stoull(fields[9]), std::stoull(fields[10]) };
+                    entry.step_ns = std::stod(fields[11]);
+                    if (entry.settings.threads == 0 || entry.settings.blocking.mc == 0 || entry.settings.blocking.kc == 0 || entry.settings.blocking.nc == 0) {
+                        throw std::invalid_argument("zero");
+                    }
+                    entries.push_back(entry);
+                } catch (const std::exception&) {
+                    throw std::invalid_argument(path + ":" + std::to_string(number) + ": malformed tuning entry");
+                }
+            }
+        }
+
+        const std::string& file() const { return path; }
+        std::size_t size() const { return entries.size(); }
+
+        /**
+         * @return entry for cpu and shape, or null
+         */
+        const Entry* find(const std::string& cpu, const std::string& shape) const {
+            for (const Entry& entry : entries) {
+                if (entry.cpu == cpu && entry.shape == shape) return &entry;
+            }
+            return nullptr;
+        }
+
+        /**
+         * Adds entry, replacing any for the same cpu and shape
+         */
+        void store(const Entry& entry) {
+            for (Entry& existing : entries) {
+                if (existing.cpu == entry.cpu && existing.shape == entry.shape) {
+                    existing = entry;
+                    return;
+                }
+            }
+            entries.push_back(entry);
+        }
+
+        void save() const {
+            std::ostringstream text;
+            text << "# cpu\tshape\tisa\tthreads\tmc\tkc\tnc\tsimd\tparallel\tgrain\tgemm_parallel\tstep_ns\n";
+            for (const Entry& entry : entries) {
+                const KernelSettings& s = entry.settings;
+                text << entry.cpu << '\t' << entry.shape << '\t' << math::simd::kernels_for<double>(s.isa).name << '\t' << s.threads << '\t'
+                     << s.blocking.mc << '\t' << s.blocking.kc << '\t' << s.blocking.nc << '\t' << s.thresholds.simd << '\t' << s.thresholds.parallel << '\t'
+                     << s.thresholds.grain << '\t' << s.thresholds.gemm_parallel << '\t' << static_cast<std::uint64_t>(entry.step_ns) << '\n';
+            }
+
+            const std::string contents = text.str();
+            const std::string temp = path + ".tmp";
+            AtomicFileWriter writer(path.c_str(), temp.c_str());
+            writer.write(contents.data(), contents.size());
+            writer.commit();
+        }
+    };
+
+    /**
+     * @return tuning cache file: MATH_TUNING_CACHE if set, else snn-tuning.tsv in the working directory
+     */
+    inline std::string default_tuning_cache() {
+        const char* env = std::getenv("MATH_TUNING_CACHE");
+        return env && *env ? env : "snn-tuning.tsv";
+    }
+
+#pragma endregion
+
+#pragma region tuner
+
+    /**
+     * One timed configuration
+     */
+    struct TuningTrial {
+        const char* knob;
+        KernelSettings settings;
+        double step_ns;
+    };
+
+    namespace autotune_detail {
+
+        /**
+         * Fastest mean time of a synchronous training step over repetitions runs of at least min_time seconds each,
+         * with the settings currently applied
+         */
+        template <typename T, typename Acc>
+        inline double time_step(Network<T>& net, const std::vector<T>& inputs, const std::vector<T>& targets, std::size_t batch, double min_time, std::size_t repetitions) {
+            using clock = std::chrono::steady_clock;
+            DataParallelTrainer<T, Acc> trainer(net.topology, batch, ThreadPool::Global().Size() + 1);
+            trainer.load_batch(math::BasicRowView<const T>(inputs), math::BasicRowView<const T>(targets));
+
+            // every trial keeps stepping the same network; near-zero updates leave its weights as they were,
+            // so a late trial isn't timed on different values than an early one
+            constexpr double learning_rate = 1e-6;
+            trainer.step(net, learning_rate);
+
+            double best = 0.0;
+            for (std::size_t r = 0; r < repetitions; ++r) {
+                std::size_t steps = 0;
+                const clock::time_point start = clock::now();
+                clock::duration elapsed{};
+                do {
+                    trainer.step(net, learning_rate);
+                    ++steps;
+                    elapsed = clock::now() - start;
+                } while (elapsed < std::chrono::duration<double>(min_time));
+
+                const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(steps);
+                if (r == 0 || ns < best) best = ns;
+            }
+            return best;
+        }
+
+    }
+
+    /**
+     * Finds the fastest kernel settings for training topo on batches of batch samples, starting from the
+     * current ones and improving one knob at a time, keeping a change only if it is clearly faster: instruction set, thread count, gemm blocking (mc with kc,
+     * then nc), then the SIMD and parallel thresholds. Each candidate is timed on real training steps with
+     * random data. The winner is left applied.
+     * @param trials if not null, receives every timed candidate in order
+     * @return the winning settings and their time per step in ns
+     */
+    template <typename T, typename Acc = T>
+    inline TuningCache::Entry autotune(const Topology& topo, std::size_t batch, double min_time = 0.05, std::size_t repetitions = 3, std::vector<TuningTrial>* trials = nullptr) {
+        topo.validate();
+        if (batch == 0) throw std::invalid_argument("Batch must not be empty");
+        if (!(min_time > 0.0) || repetitions == 0) throw std::invalid_argument("Tuning needs a positive minimum time and repetition count");
+
+        Network<T> net(topo);
+        Xoshiro256 engine(0x5EED);
+        net.initialize([&engine](std::size_t, T* weights, std::size_t count, double min, double max) {
+            for (std::size_t i = 0; i < count; ++i) weights[i] = static_cast<T>(min + (max - min) * engine.Unit());
+        });
+        std::vector<T> inputs(batch * topo.input), targets(batch * topo.output());
+        for (T& x : inputs) x = static_cast<T>(2.0 * engine.Unit() - 1.0);
+        for (std::size_t i = 0; i < targets.size(); ++i) targets[i] = static_cast<T>(i % 2);
+
+        KernelSettings best = current_kernel_settings();
+        double best_ns = 0.0;
+        bool timed = false;
+
+        // a candidate has to beat the incumbent by more than timing noise, so equally fast settings don't flip between runs
+        constexpr double noise = 0.02;
+        const auto trial = [&](const char* knob, const KernelSettings& candidate) {
+            apply_kernel_settings(candidate);
+            const double ns = autotune_detail::time_step<T, Acc>(net, inputs, targets, batch, min_time, repetitions);
+            if (trials) trials->push_back(TuningTrial{ knob, candidate, ns });
+            if (!timed || ns < best_ns * (1.0 - noise)) {
+                best = candidate;
+                best_ns = ns;
+                timed = true;
+            }
+        };
+
+        trial("current", best);
+
+        const math::simd::Isa widest = math::simd::detect_isa();
+        const KernelSettings by_default = best;
+        for (math::simd::Isa isa : { math::simd::Isa::Scalar, math::simd::Isa::SSE2, math::simd::Isa::AVX2, math::simd::Isa::AVX512 }) {
+            if (isa > widest) break;
+            if (isa == by_default.isa) continue;
+            KernelSettings candidate = by_default;
+            candidate.isa = isa;
+            trial("isa", candidate);
+        }
+
+        const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+        const KernelSettings by_isa = best;
+        for (std::size_t threads = 1; threads <= hardware; threads = threads * 2 > hardware && threads < hardware ? hardware : threads * 2) {
+            if (threads == by_isa.threads) continue;
+            KernelSettings candidate = by_isa;
+            candidate.threads = threads;
+            trial("threads", candidate);
+        }
+
+        const KernelSettings by_threads = best;
+        for (std::size_t mc : { 48, 96, 192 }) {
+            for (std::size_t kc : { 128, 256, 512 }) {
+                if (mc == by_threads.blocking.mc && kc == by_threads.blocking.kc) continue;
+                KernelSettings candidate = by_threads;
+                candidate.blocking.mc = mc;
+                candidate.blocking.kc = kc;
+                trial("gemm mc x kc", candidate);
+            }
+        }
+        const KernelSettings by_panel = best;
+        for (std::size_t nc : { 512, 1024, 2048, 4096 }) {
+            if (nc == by_panel.blocking.nc) continue;
+            KernelSettings candidate = by_panel;
+            candidate.blocking.nc = nc;
+            trial("gemm nc", candidate);
+        }
+
+        const KernelSettings by_blocking = best;
+        for (std::size_t simd : { 4, 16, 64 }) {
+            if (simd == by_blocking.thresholds.simd) continue;
+            KernelSettings candidate = by_blocking;
+            candidate.thresholds.simd = simd;
+            trial("simd threshold", candidate);
+        }
+
+        // with a single thread nothing ever runs in parallel, so those thresholds can't matter
+        if (best.threads > 1) {
+            const KernelSettings by_simd = best;
+            for (std::size_t shift : { 14, 17, 20 }) {
+                for (std::size_t gemm_shift : { 18, 22, 26 }) {
+                    if (by_simd.thresholds.parallel == std::size_t(1) << shift && by_simd.thresholds.gemm_parallel == std::size_t(1) << gemm_shift) continue;
+                    KernelSettings candidate = by_simd;
+                    candidate.thresholds.parallel = std::size_t(1) << shift;
+                    candidate.thresholds.gemm_parallel = std::size_t(1) << gemm_shift;
+                    trial("parallel thresholds", candidate);
+                }
+            }
+        }
+
+        apply_kernel_settings(best);
+        return TuningCache::Entry{ cpu_model(), tuning_shape(precision_name<T, Acc>(), topo, batch), best, best_ns };
+    }
+
+#pragma endregion
+
+}
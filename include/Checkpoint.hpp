@@ -0,0 +1,399 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Network.hpp"
+
+/**
+ * Checkpoint.hpp
+ * Versioned binary checkpoint of the network, laid out so a mapped file can be used in place.
+ *
+ * File layout (little endian), version 2:
+ *   128-byte CheckpointHeader: scalar type, input width, layer count, seed, epoch and file size
+ *   one 32-byte CheckpointLayer per layer: units, activation and the offsets of its two blocks
+ *   per layer: weight (units x fan_in), then bias (units)
+ * Every block starts on a 64-byte boundary. Loading is a mmap plus header checks; the weights
+ * are never parsed or copied. Version 1 files (one tanh hidden layer) are still read.
+ */
+namespace nn {
+
+#pragma region format
+
+    struct CheckpointHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t scalar_bytes;
+        std::uint64_t input;
+        std::uint64_t layer_count;
+        std::uint64_t seed;
+        std::uint64_t epoch;
+        std::uint64_t file_size;
+        std::uint8_t reserved[72];
+    };
+    static_assert(sizeof(CheckpointHeader) == 128, "CheckpointHeader must stay 128 bytes");
+
+    struct CheckpointLayer {
+        std::uint64_t units;
+        std::uint32_t activation;
+        std::uint32_t reserved;
+        std::uint64_t weight_offset;
+        std::uint64_t bias_offset;
+    };
+    static_assert(sizeof(CheckpointLayer) == 32, "CheckpointLayer must stay 32 bytes");
+
+    /**
+     * Header of version 1, which stored exactly one tanh hidden layer
+     */
+    struct CheckpointHeaderV1 {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t scalar_bytes;
+        std::uint64_t input;
+        std::uint64_t hidden;
+        std::uint64_t output;
+        std::uint64_t seed;
+        std::uint64_t epoch;
+        std::uint64_t offsets[4];
+        std::uint64_t file_size;
+        std::uint8_t reserved[32];
+    };
+    static_assert(sizeof(CheckpointHeaderV1) == 128, "CheckpointHeaderV1 must stay 128 bytes");
+
+    constexpr char CHECKPOINT_MAGIC[8] = { 'S', 'N', 'N', 'C', 'K', 'P', 'T', '\0' };
+    constexpr std::uint32_t CHECKPOINT_VERSION = 2;
+    constexpr std::size_t CHECKPOINT_ALIGNMENT = 64;
+
+    inline std::uint64_t checkpoint_align(std::uint64_t offset) {
+        return (offset + CHECKPOINT_ALIGNMENT - 1) / CHECKPOINT_ALIGNMENT * CHECKPOINT_ALIGNMENT;
+    }
+
+    /**
+     * @return whether a rows x cols block of T fits in bytes; checked by division, so forged sizes can't overflow
+     */
+    template <typename T>
+    inline bool checkpoint_block_fits(std::uint64_t rows, std::uint64_t cols, std::uint64_t bytes) {
+        return rows == 0 || cols <= bytes / sizeof(T) / rows;
+    }
+
+    /**
+     * @return table entry of layer l of a checkpoint of the given topology, with its block offsets laid out
+     */
+    template <typename T>
+    inline CheckpointLayer checkpoint_layer(const Topology& topo, std::size_t l) {
+        std::uint64_t offset = sizeof(CheckpointHeader) + topo.depth() * sizeof(CheckpointLayer);
+        CheckpointLayer entry{};
+        for (std::size_t i = 0; i <= l; ++i) {
+            entry.units = topo.layers[i].units;
+            entry.activation = static_cast<std::uint32_t>(topo.layers[i].activation);
+            entry.weight_offset = checkpoint_align(offset);
+            entry.bias_offset = checkpoint_align(entry.weight_offset + entry.units * topo.fan_in(i) * sizeof(T));
+            offset = entry.bias_offset + entry.units * sizeof(T);
+        }
+        return entry;
+    }
+
+    /**
+     * @return header of a checkpoint of the given topology
+     */
+    template <typename T>
+    inline CheckpointHeader checkpoint_header(const Topology& topo, std::uint64_t seed, std::uint64_t epoch) {
+        CheckpointHeader header{};
+        std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+        header.version = CHECKPOINT_VERSION;
+        header.scalar_bytes = sizeof(T);
+        header.input = topo.input;
+        header.layer_count = topo.depth();
+        header.seed = seed;
+        header.epoch = epoch;
+
+        const CheckpointLayer last = checkpoint_layer<T>(topo, topo.depth() - 1);
+        header.file_size = last.bias_offset + last.units * sizeof(T);
+        return header;
+    }
+
+    /**
+     * @return bytes per scalar stored in a checkpoint file, so callers can pick the matching T
+     */
+    inline std::uint32_t checkpoint_scalar_bytes(const std::string& path) {
+        const MappedFile file(path);
+        CheckpointHeader header;
+        if (file.size() < sizeof(header)) throw std::invalid_argument("Not a checkpoint file: " + path);
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) throw std::invalid_argument("Not a checkpoint file: " + path);
+        return header.scalar_bytes;
+    }
+
+#pragma endregion
+#pragma region io
+
+    /**
+     * Writes net to path (through path_tmp, so an existing checkpoint is replaced atomically).
+     * Allocation-free, so it can run next to an allocation-checked training loop.
+     */
+    template <typename T>
+    inline void write_checkpoint(const char* path, const char* path_tmp, const Network<T>& net, std::uint64_t seed, std::uint64_t epoch) {
+        const Topology& topo = net.topology;
+        const CheckpointHeader header = checkpoint_header<T>(topo, seed, epoch);
+        static const unsigned char zeros[CHECKPOINT_ALIGNMENT] = {};
+
+        AtomicFileWriter file(path, path_tmp);
+        file.write(&header, sizeof(header));
+        for (std::size_t l = 0; l < topo.depth(); ++l) {
+            const CheckpointLayer entry = checkpoint_layer<T>(topo, l);
+            file.write(&entry, sizeof(entry));
+        }
+
+        std::uint64_t position = sizeof(header) + topo.depth() * sizeof(CheckpointLayer);
+        for (std::size_t l = 0; l < topo.depth(); ++l) {
+            const CheckpointLayer entry = checkpoint_layer<T>(topo, l);
+            const Layer<T>& layer = net.layers[l];
+            file.write(zeros, static_cast<std::size_t>(entry.weight_offset - position));
+            file.write(layer.weight.data(), layer.weight.size() * sizeof(T));
+            position = entry.weight_offset + layer.weight.size() * sizeof(T);
+            file.write(zeros, static_cast<std::size_t>(entry.bias_offset - position));
+            file.write(layer.bias.data(), layer.bias.size() * sizeof(T));
+            position = entry.bias_offset + layer.bias.size() * sizeof(T);
+        }
+        file.commit();
+    }
+
+    /**
+     * Writes checkpoints from a background thread, so the training loop never waits on the disk.
+     * Double-buffered: submit() copies the weights into whichever snapshot isn't being written and
+     * returns. If a newer snapshot arrives before the older pending one was picked up, the newer one wins.
+     */
+    template <typename T>
+    class CheckpointWriter {
+    private:
+        static constexpr std::size_t NONE = 2;
+
+        std::string path;
+        std::string path_tmp;
+        std::uint64_t seed = 0;
+
+        Network<T> snapshots[2];
+        std::uint64_t epochs[2] = { 0, 0 };
+        std::size_t pending = NONE;
+        std::size_t busy = NONE;
+        std::uint64_t written_epoch = 0;
+        std::size_t written_count = 0;
+        std::string error;
+        bool stopping = false;
+
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable idle;
+        std::thread worker;
+
+        void loop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                wake.wait(lock, [this] { return stopping || pending != NONE; });
+                if (pending == NONE) return;
+
+                busy = pending;
+                pending = NONE;
+                lock.unlock();
+
+                std::string failure;
+                try {
+                    write_checkpoint(path.c_str(), path_tmp.c_str(), snapshots[busy], seed, epochs[busy]);
+                }
+                catch (const std::exception& e) {
+                    failure = e.what();
+                }
+
+                lock.lock();
+                if (failure.empty()) {
+                    written_epoch = epochs[busy];
+                    ++written_count;
+                }
+                else if (error.empty()) error = "Cannot write checkpoint " + path + ": " + failure;
+                busy = NONE;
+                idle.notify_all();
+            }
+        }
+
+    public:
+        CheckpointWriter(const std::string& file_path, const Topology& topo, std::uint64_t run_seed)
+            : path(file_path), path_tmp(file_path + ".tmp"), seed(run_seed), snapshots{ Network<T>(topo), Network<T>(topo) } {
+            worker = std::thread([this] { loop(); });
+        }
+
+        ~CheckpointWriter() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            worker.join();
+        }
+
+        CheckpointWriter(const CheckpointWriter&) = delete;
+        CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+        /**
+         * Snapshots net as of epoch for writing in the background. Never waits for disk I/O.
+         */
+        void submit(const Network<T>& net, std::uint64_t epoch) {
+            if (net.topology != snapshots[0].topology) throw std::invalid_argument("Network and checkpoint disagree on the topology");
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                const std::size_t slot = busy == 0 ? 1 : 0;
+                Network<T>& snapshot = snapshots[slot];
+                for (std::size_t l = 0; l < net.depth(); ++l) {
+                    std::copy(net.layers[l].weight.begin(), net.layers[l].weight.end(), snapshot.layers[l].weight.begin());
+                    std::copy(net.layers[l].bias.begin(), net.layers[l].bias.end(), snapshot.layers[l].bias.begin());
+                }
+                epochs[slot] = epoch;
+                pending = slot;
+            }
+            wake.notify_one();
+        }
+
+        /**
+         * Waits until every submitted snapshot is on disk
+         * @return epoch of the last checkpoint written
+         */
+        std::uint64_t flush() {
+            std::unique_lock<std::mutex> lock(mutex);
+            idle.wait(lock, [this] { return pending == NONE && busy == NONE; });
+            if (!error.empty()) throw std::runtime_error(error);
+            return written_epoch;
+        }
+
+        std::size_t written() {
+            std::lock_guard<std::mutex> lock(mutex);
+            return written_count;
+        }
+    };
+
+    /**
+     * Checkpoint mapped read-only; its weights are used straight from the mapping
+     */
+    template <typename T>
+    class MappedCheckpoint {
+    private:
+        MappedFile file;
+        std::uint64_t run_seed = 0;
+        std::uint64_t run_epoch = 0;
+        NetworkView<T> view;
+
+        MappedCheckpoint() = default;
+
+        const T* block(std::uint64_t offset) const { return reinterpret_cast<const T*>(file.data() + offset); }
+
+        void open_v1(const std::string& path) {
+            CheckpointHeaderV1 header;
+            std::memcpy(&header, file.data(), sizeof(header));
+
+            const Topology topo = dense_topology(static_cast<std::size_t>(header.input), { static_cast<std::size_t>(header.hidden) }, static_cast<std::size_t>(header.output));
+            if (!checkpoint_block_fits<T>(header.hidden, header.input, file.size()) || !checkpoint_block_fits<T>(header.output, header.hidden, file.size())) {
+                throw std::invalid_argument("Checkpoint file is truncated or corrupt: " + path);
+            }
+            const std::uint64_t sizes[4] = { header.hidden * header.input, header.hidden, header.output * header.hidden, header.output };
+            std::uint64_t offset = sizeof(CheckpointHeaderV1);
+            for (std::size_t b = 0; b < 4; ++b) {
+                offset = checkpoint_align(offset);
+                if (header.offsets[b] != offset) throw std::invalid_argument("Checkpoint file is truncated or corrupt: " + path);
+                offset += sizes[b] * sizeof(T);
+            }
+            if (header.file_size != offset || header.file_size > file.size()) throw std::invalid_argument("Checkpoint file is truncated or corrupt: " + path);
+
+            run_seed = header.seed;
+            run_epoch = header.epoch;
+            view.topology = topo;
+            view.layers = {
+                LayerView<T>{ math::BasicMatrixView<const T>(block(header.offsets[0]), topo.layers[0].units, topo.input), math::BasicRowView<const T>(block(header.offsets[1]), topo.layers[0].units), Activation::Tanh },
+                LayerView<T>{ math::BasicMatrixView<const T>(block(header.offsets[2]), topo.layers[1].units, topo.layers[0].units), math::BasicRowView<const T>(block(header.offsets[3]), topo.layers[1].units), Activation::Identity },
+            };
+        }
+
+        void open_v2(const std::string& path) {
+            CheckpointHeader header;
+            std::memcpy(&header, file.data(), sizeof(header));
+
+            if (header.layer_count == 0 || header.layer_count > (file.size() - sizeof(CheckpointHeader)) / sizeof(CheckpointLayer)) {
+                throw std::invalid_argument("Checkpoint file is truncated or corrupt: " + path);
+            }
+
+            Topology topo;
+            topo.input = static_cast<std::size_t>(header.input);
+            std::vector<CheckpointLayer> entries(static_cast<std::size_t>(header.layer_count));
+            std::memcpy(entries.data(), file.data() + sizeof(CheckpointHeader), entries.size() * sizeof(CheckpointLayer));
+            // every block must fit in what the earlier ones left of the file before the layout is summed up
+            std::uint64_t room = file.size();
+            for (const CheckpointLayer& entry : entries) {
+                const std::uint64_t fan_in = topo.output();
+                if (entry.activation > static_cast<std::uint32_t>(Activation::Sigmoid) || !checkpoint_block_fits<T>(entry.units, fan_in, room)) {
+                    throw std::invalid_argument("Checkpoint file is truncated or corrupt: " + path);
+                }
+                room -= entry.units * fan_in * sizeof(T);
+                if (!checkpoint_block_fits<T>(entry.units, 1, room)) throw std::invalid_argument("Checkpoint file is truncated or corrupt: " + path);
+                room -= entry.units * sizeof(T);
+                topo.layers.push_back(LayerSpec{ static_cast<std::size_t>(entry.units), static_cast<Activation>(entry.activation) });
+            }
+            topo.validate();
+
+            const CheckpointHeader expected = checkpoint_header<T>(topo, header.seed, header.epoch);
+            if (header.file_size != expected.file_size || header.file_size > file.size()) throw std::invalid_argument("Checkpoint file is truncated or corrupt: " + path);
+
+            run_seed = header.seed;
+            run_epoch = header.epoch;
+            view.topology = topo;
+            for (std::size_t l = 0; l < entries.size(); ++l) {
+                const CheckpointLayer layout = checkpoint_layer<T>(topo, l);
+                if (entries[l].weight_offset != layout.weight_offset || entries[l].bias_offset != layout.bias_offset) {
+                    throw std::invalid_argument("Checkpoint file is truncated or corrupt: " + path);
+                }
+                view.layers.push_back(LayerView<T>{
+                    math::BasicMatrixView<const T>(block(layout.weight_offset), topo.layers[l].units, topo.fan_in(l)),
+                    math::BasicRowView<const T>(block(layout.bias_offset), topo.layers[l].units),
+                    topo.layers[l].activation });
+            }
+        }
+
+    public:
+        static MappedCheckpoint Open(const std::string& path) {
+            MappedCheckpoint result;
+            result.file = MappedFile(path);
+
+            if (result.file.size() < sizeof(CheckpointHeader)) throw std::invalid_argument("Not a checkpoint file: " + path);
+            CheckpointHeader header;
+            std::memcpy(&header, result.file.data(), sizeof(CheckpointHeader));
+
+            if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) throw std::invalid_argument("Not a checkpoint file: " + path);
+            if (header.version != 1 && header.version != CHECKPOINT_VERSION) throw std::invalid_argument("Unsupported checkpoint version " + std::to_string(header.version) + " in " + path);
+            if (header.scalar_bytes != sizeof(T)) {
+                throw std::invalid_argument(path + " stores " + std::to_string(header.scalar_bytes * 8) + "-bit weights, but "
+                    + std::to_string(sizeof(T) * 8) + "-bit ones were requested");
+            }
+
+            if (header.version == 1) result.open_v1(path);
+            else result.open_v2(path);
+            return result;
+        }
+
+        const Topology& topology() const { return view.topology; }
+        std::uint64_t seed() const { return run_seed; }
+        std::uint64_t epoch() const { return run_epoch; }
+
+        /**
+         * @return weights inside the mapping, valid while this object lives
+         */
+        const NetworkView<T>& parameters() const { return view; }
+    };
+
+#pragma endregion
+
+}
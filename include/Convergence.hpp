@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "Network.hpp"
+#include "Workspace.hpp"
+
+/**
+ * Convergence.hpp
+ * What the training loop decides between epochs: the learning rate of the next one, whether its loss
+ * has to be measured at all, whether the run is done, and which weights to keep.
+ * Measuring the loss is skipped on epochs where neither a printout nor a stop criterion reads it,
+ * and the best weights are copied into buffers allocated up front.
+ */
+namespace nn {
+
+#pragma region schedules
+
+    enum class ScheduleKind { Constant, Step, Cosine };
+
+    inline const char* schedule_name(ScheduleKind kind) {
+        switch (kind) {
+        case ScheduleKind::Step: return "step";
+        case ScheduleKind::Cosine: return "cosine";
+        default: return "constant";
+        }
+    }
+
+    inline ScheduleKind parse_schedule(const std::string& name) {
+        if (name == "constant") return ScheduleKind::Constant;
+        if (name == "step") return ScheduleKind::Step;
+        if (name == "cosine") return ScheduleKind::Cosine;
+        throw std::invalid_argument("Expected constant, step or cosine schedule. Received: " + name);
+    }
+
+    /**
+     * Learning rate per epoch: base, optionally ramped up linearly over the first warmup epochs,
+     * then held constant, multiplied by step_factor every step_size epochs, or annealed along a
+     * half cosine from base down to minimum at the last epoch
+     */
+    struct LearningRateSchedule {
+        ScheduleKind kind = ScheduleKind::Constant;
+        double base = 0.5;
+        std::size_t warmup = 0;
+        std::size_t step_size = 100;
+        double step_factor = 0.5;
+        double minimum = 0.0;
+        std::size_t epochs = 1;
+
+        void validate() const {
+            if (!(base > 0.0)) throw std::invalid_argument("Learning rate must be positive");
+            if (step_size == 0) throw std::invalid_argument("Step size must be positive");
+            if (!(step_factor > 0.0 && step_factor <= 1.0)) throw std::invalid_argument("Step factor must be in (0, 1]");
+            if (!(minimum >= 0.0 && minimum <= base)) throw std::invalid_argument("Minimum learning rate must be in [0, learning rate]");
+        }
+
+        /**
+         * @return rate of epoch (counted from 1)
+         */
+        double rate(std::size_t epoch) const {
+            if (epoch <= warmup) return base * static_cast<double>(epoch) / static_cast<double>(warmup);
+
+            const std::size_t t = epoch - warmup - 1;
+            switch (kind) {
+            case ScheduleKind::Step:
+                return base * std::pow(step_factor, static_cast<double>(t / step_size));
+            case ScheduleKind::Cosine: {
+                const std::size_t span = epochs > warmup + 1 ? epochs - warmup - 1 : 1;
+                const double progress = std::min(1.0, static_cast<double>(t) / static_cast<double>(span));
+                return minimum + (base - minimum) * 0.5 * (1.0 + std::cos(3.14159265358979323846 * progress));
+            }
+            default:
+                return base;
+            }
+        }
+    };
+
+#pragma endregion
+
+#pragma region stopping
+
+    /**
+     * When to end a run before its last epoch. A zero target_loss or patience disables that criterion.
+     */
+    struct StopCriteria {
+        // stop as soon as a measured loss is at or below this
+        double target_loss = 0.0;
+        // stop after this many epochs without an improvement of more than min_delta
+        std::size_t patience = 0;
+        double min_delta = 0.0;
+        // epochs between loss measurements, besides the ones printed anyway; 0 measures every epoch
+        // while a criterion (or keeping the best weights) reads the loss, and otherwise only printed ones
+        std::size_t check_every = 0;
+
+        bool active() const { return target_loss > 0.0 || patience > 0; }
+
+        void validate() const {
+            if (!(target_loss >= 0.0)) throw std::invalid_argument("Target loss must not be negative");
+            if (!(min_delta >= 0.0)) throw std::invalid_argument("Minimum improvement must not be negative");
+        }
+    };
+
+    enum class StopReason { None, TargetLoss, Patience };
+
+    inline const char* stop_reason_name(StopReason reason) {
+        switch (reason) {
+        case StopReason::TargetLoss: return "target loss reached";
+        case StopReason::Patience: return "no improvement within patience";
+        default: return "last epoch";
+        }
+    }
+
+    /**
+     * Drives one training run epoch by epoch: the learning rate, whether the epoch's loss is needed,
+     * the best loss so far and, optionally, the weights that loss was measured on.
+     * Per epoch the loop asks needs_loss(), stage()s the weights before training an epoch whose loss it
+     * measures, trains with learning_rate(), hands the loss to record() (calling snapshot() when it
+     * returns true) and ends when should_stop() says so.
+     *
+     * An epoch's loss is summed over its batches, each measured before that batch's update, so it
+     * belongs to the weights the epoch started from, not to the ones after it. Those are what get kept:
+     * exactly the weights of the loss with one batch per epoch, the epoch's starting point with several.
+     */
+    template <typename T, typename Acc = T>
+    class ConvergenceController {
+    private:
+        StopCriteria criteria;
+        LearningRateSchedule schedule;
+        Network<T> best_weights;
+        Network<T> staged_weights;
+        bool keep_best = false;
+        Acc best = std::numeric_limits<Acc>::max();
+        Acc last = Acc(0);
+        std::size_t best_at = 0;
+        std::size_t staged_at = 0;
+        std::size_t snapshot_at = 0;
+        std::size_t last_at = 0;
+        StopReason stop = StopReason::None;
+
+    public:
+        /**
+         * @param keep_best_weights whether snapshot() keeps copies; the buffers for them are allocated here either way
+         */
+        ConvergenceController(const Topology& topo, const StopCriteria& stopping, const LearningRateSchedule& rates, bool keep_best_weights)
+            : criteria(stopping), schedule(rates), best_weights(topo), staged_weights(topo), keep_best(keep_best_weights) {
+            stopping.validate();
+            rates.validate();
+        }
+
+        double learning_rate(std::size_t epoch) const { return schedule.rate(epoch); }
+
+        /**
+         * @param reported whether the caller shows this epoch's loss anyway
+         * @return whether the epoch's loss has to be measured
+         */
+        bool needs_loss(std::size_t epoch, bool reported) const {
+            const std::size_t interval = criteria.check_every > 0 ? criteria.check_every : (criteria.active() || keep_best ? 1 : 0);
+            return reported || (interval > 0 && epoch % interval == 0);
+        }
+
+        /**
+         * Takes the mean loss of epoch and checks the stop criteria against it
+         * @return true if it's a new best, whose weights the caller should snapshot()
+         */
+        bool record(std::size_t epoch, Acc loss) {
+            last = loss;
+            last_at = epoch;
+
+            const bool improved = best == std::numeric_limits<Acc>::max() || loss < best - static_cast<Acc>(criteria.min_delta);
+            if (improved) {
+                best = loss;
+                best_at = epoch;
+            }
+
+            if (criteria.target_loss > 0.0 && loss <= static_cast<Acc>(criteria.target_loss)) stop = StopReason::TargetLoss;
+            else if (criteria.patience > 0 && epoch - best_at >= criteria.patience) stop = StopReason::Patience;
+            return improved;
+        }
+
+        /**
+         * Copies the weights epoch is about to start from, unless best weights aren't kept
+         */
+        void stage(const Network<T>& net, std::size_t epoch) {
+            if (!keep_best) return;
+            for (std::size_t l = 0; l < net.depth(); ++l) {
+                std::copy(net.layers[l].weight.data(), net.layers[l].weight.data() + net.layers[l].weight.size(), staged_weights.layers[l].weight.data());
+                std::copy(net.layers[l].bias.begin(), net.layers[l].bias.end(), staged_weights.layers[l].bias.begin());
+            }
+            staged_at = epoch;
+        }
+
+        /**
+         * Keeps the weights staged for the best epoch so far, unless best weights aren't kept or none were staged for it
+         */
+        void snapshot() {
+            if (!keep_best || staged_at != best_at) return;
+            std::swap(best_weights, staged_weights);
+            snapshot_at = best_at;
+        }
+
+        /**
+         * Puts the kept weights back into net
+         * @return whether there were any
+         */
+        bool restore(Network<T>& net) const {
+            if (!keep_best || snapshot_at == 0) return false;
+            for (std::size_t l = 0; l < net.depth(); ++l) {
+                const Layer<T>& src = best_weights.layers[l];
+                std::copy(src.weight.data(), src.weight.data() + src.weight.size(), net.layers[l].weight.data());
+                std::copy(src.bias.begin(), src.bias.end(), net.layers[l].bias.begin());
+            }
+            return true;
+        }
+
+        bool should_stop() const { return stop != StopReason::None; }
+        StopReason reason() const { return stop; }
+
+        Acc best_loss() const { return best; }
+        std::size_t best_epoch() const { return best_at; }
+
+        /**
+         * @return epoch whose loss the kept weights were measured on; they are the weights after the epoch before it
+         */
+        std::size_t snapshot_epoch() const { return snapshot_at; }
+
+        /**
+         * @return the most recent measured loss, and its epoch
+         */
+        Acc last_loss() const { return last; }
+        std::size_t last_measured_epoch() const { return last_at; }
+    };
+
+#pragma endregion
+
+}
@@ -0,0 +1,434 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Math.hpp"
+#include "Random.hpp"
+
+/**
+ * Dataset.hpp
+ * Binary dataset format, a memory-mapped loader for it and a shuffled minibatch stream.
+ *
+ * File layout (little endian):
+ *   64-byte DatasetHeader
+ *   inputs:  samples x input_count scalars, row-major, starting at inputs_offset
+ *   targets: samples x output_count scalars, row-major, starting at targets_offset
+ * Both blocks start on a 64-byte boundary, so a mapped file can be read in place with aligned loads.
+ * Minibatches are random samples from anywhere in the file, gathered in the background.
+ */
+namespace nn {
+
+#pragma region format
+
+    struct DatasetHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t scalar_bytes;
+        std::uint64_t samples;
+        std::uint64_t input_count;
+        std::uint64_t output_count;
+        std::uint64_t inputs_offset;
+        std::uint64_t targets_offset;
+        std::uint8_t reserved[8];
+    };
+    static_assert(sizeof(DatasetHeader) == 64, "DatasetHeader must stay 64 bytes");
+
+    constexpr char DATASET_MAGIC[8] = { 'S', 'N', 'N', 'D', 'A', 'T', 'A', '\0' };
+    constexpr std::uint32_t DATASET_VERSION = 1;
+    constexpr std::size_t DATASET_ALIGNMENT = 64;
+
+    inline std::uint64_t dataset_align(std::uint64_t offset) {
+        return (offset + DATASET_ALIGNMENT - 1) / DATASET_ALIGNMENT * DATASET_ALIGNMENT;
+    }
+
+    /**
+     * @return whether path starts like a dataset file
+     */
+    inline bool is_dataset_file(const std::string& path) {
+        char magic[sizeof(DATASET_MAGIC)] = {};
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+        const bool read = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic);
+        std::fclose(file);
+        return read && std::memcmp(magic, DATASET_MAGIC, sizeof(DATASET_MAGIC)) == 0;
+    }
+
+#pragma endregion
+#pragma region dataset
+
+    /**
+     * Samples as two row-major blocks, inputs and targets, stored as T.
+     * Either memory-maps a dataset file (Open) or owns matrices built in memory.
+     */
+    template <typename T>
+    class Dataset {
+    private:
+        MappedFile file;
+        math::BasicMatrix<T> owned_inputs;
+        math::BasicMatrix<T> owned_targets;
+        const T* input_data = nullptr;
+        const T* target_data = nullptr;
+        std::size_t samples = 0;
+        std::size_t inputs_per_sample = 0;
+        std::size_t outputs_per_sample = 0;
+
+        Dataset() = default;
+
+    public:
+        /**
+         * Takes ownership of in-memory samples, one row per sample in both matrices
+         */
+        Dataset(math::BasicMatrix<T> inputs, math::BasicMatrix<T> targets)
+            : owned_inputs(std::move(inputs)), owned_targets(std::move(targets)) {
+            if (owned_inputs.rows() != owned_targets.rows()) throw std::invalid_argument("Expected one target row per input row");
+            samples = owned_inputs.rows();
+            inputs_per_sample = owned_inputs.cols();
+            outputs_per_sample = owned_targets.cols();
+            input_data = owned_inputs.data();
+            target_data = owned_targets.data();
+        }
+
+        /**
+         * Maps a dataset file written by DatasetWriter<T>. Nothing is read until a sample is touched.
+         */
+        static Dataset Open(const std::string& path) {
+            Dataset result;
+            result.file = MappedFile(path);
+
+            DatasetHeader header;
+            if (result.file.size() < sizeof(header)) throw std::invalid_argument("Not a dataset file: " + path);
+            std::memcpy(&header, result.file.data(), sizeof(header));
+
+            if (std::memcmp(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC)) != 0) throw std::invalid_argument("Not a dataset file: " + path);
+            if (header.version != DATASET_VERSION) throw std::invalid_argument("Unsupported dataset version " + std::to_string(header.version) + " in " + path);
+            if (header.scalar_bytes != sizeof(T)) {
+                throw std::invalid_argument(path + " stores " + std::to_string(header.scalar_bytes * 8) + "-bit values, but training uses "
+                    + std::to_string(sizeof(T) * 8) + "-bit ones; convert it with the matching --precision");
+            }
+            if (header.input_count == 0 || header.output_count == 0) throw std::invalid_argument("Dataset has no inputs or no outputs: " + path);
+
+            // sizes are compared by division, so a forged header can't overflow its way past the checks
+            const auto fits = [&header](std::uint64_t per_sample, std::uint64_t room) {
+                return header.samples == 0 || (per_sample <= room / sizeof(T) && header.samples <= room / (per_sample * sizeof(T)));
+            };
+            const std::uint64_t size = result.file.size();
+            if (header.inputs_offset % DATASET_ALIGNMENT != 0 || header.targets_offset % DATASET_ALIGNMENT != 0
+                || header.inputs_offset < sizeof(header) || header.inputs_offset > header.targets_offset || header.targets_offset > size
+                || !fits(header.input_count, header.targets_offset - header.inputs_offset) || !fits(header.output_count, size - header.targets_offset)) {
+                throw std::invalid_argument("Dataset file is truncated or corrupt: " + path);
+            }
+
+            result.samples = static_cast<std::size_t>(header.samples);
+            result.inputs_per_sample = static_cast<std::size_t>(header.input_count);
+            result.outputs_per_sample = static_cast<std::size_t>(header.output_count);
+            result.input_data = reinterpret_cast<const T*>(result.file.data() + header.inputs_offset);
+            result.target_data = reinterpret_cast<const T*>(result.file.data() + header.targets_offset);
+            return result;
+        }
+
+        std::size_t size() const { return samples; }
+        std::size_t input_count() const { return inputs_per_sample; }
+        std::size_t output_count() const { return outputs_per_sample; }
+
+        /**
+         * @return inputs of samples [first, first + count), row-major
+         */
+        math::BasicRowView<const T> inputs(std::size_t first, std::size_t count) const {
+            return math::BasicRowView<const T>(input_data + first * inputs_per_sample, count * inputs_per_sample);
+        }
+
+        /**
+         * @return targets of samples [first, first + count), row-major
+         */
+        math::BasicRowView<const T> targets(std::size_t first, std::size_t count) const {
+            return math::BasicRowView<const T>(target_data + first * outputs_per_sample, count * outputs_per_sample);
+        }
+    };
+
+    /**
+     * Streams samples into a dataset file without holding them in memory.
+     * Inputs go straight to the file, targets to a temporary file that finish() appends.
+     */
+    template <typename T>
+    class DatasetWriter {
+    private:
+        std::FILE* out = nullptr;
+        std::FILE* pending_targets = nullptr;
+        std::string path;
+        DatasetHeader header{};
+        std::uint64_t position = 0;
+        std::vector<T> row;
+
+        void close() {
+            if (out) std::fclose(out);
+            if (pending_targets) std::fclose(pending_targets);
+            out = nullptr;
+            pending_targets = nullptr;
+        }
+
+        void write(std::FILE* file, const void* data, std::size_t bytes) {
+            if (bytes != 0 && std::fwrite(data, 1, bytes, file) != bytes) throw std::runtime_error("Cannot write " + path);
+            if (file == out) position += bytes;
+        }
+
+        void pad_to(std::uint64_t offset) {
+            static const unsigned char zeros[DATASET_ALIGNMENT] = {};
+            write(out, zeros, static_cast<std::size_t>(offset - position));
+        }
+
+    public:
+        DatasetWriter(const std::string& file_path, std::size_t input_count, std::size_t output_count) : path(file_path) {
+            if (input_count == 0 || output_count == 0) throw std::invalid_argument("Samples need at least one input and one output");
+
+            std::memcpy(header.magic, DATASET_MAGIC, sizeof(DATASET_MAGIC));
+            header.version = DATASET_VERSION;
+            header.scalar_bytes = sizeof(T);
+            header.input_count = input_count;
+            header.output_count = output_count;
+            header.inputs_offset = dataset_align(sizeof(DatasetHeader));
+
+            out = std::fopen(path.c_str(), "wb");
+            if (!out) throw std::invalid_argument("Cannot create file: " + path);
+            pending_targets = std::tmpfile();
+            if (!pending_targets) {
+                close();
+                throw std::runtime_error("Cannot create a temporary file");
+            }
+
+            write(out, &header, sizeof(header));
+            pad_to(header.inputs_offset);
+        }
+
+        ~DatasetWriter() { close(); }
+
+        DatasetWriter(const DatasetWriter&) = delete;
+        DatasetWriter& operator=(const DatasetWriter&) = delete;
+
+        /**
+         * Appends one sample, converting input_count inputs and output_count targets to T
+         */
+        void append(const double* inputs, const double* targets) {
+            row.assign(inputs, inputs + header.input_count);
+            write(out, row.data(), row.size() * sizeof(T));
+            row.assign(targets, targets + header.output_count);
+            write(pending_targets, row.data(), row.size() * sizeof(T));
+            ++header.samples;
+        }
+
+        std::size_t size() const { return static_cast<std::size_t>(header.samples); }
+
+        /**
+         * Appends the targets block, fills in the header and closes the file
+         */
+        void finish() {
+            header.targets_offset = dataset_align(header.inputs_offset + header.samples * header.input_count * sizeof(T));
+            pad_to(header.targets_offset);
+
+            std::rewind(pending_targets);
+            unsigned char buffer[1 << 16];
+            for (std::size_t read; (read = std::fread(buffer, 1, sizeof(buffer), pending_targets)) > 0;) write(out, buffer, read);
+
+            if (std::fseek(out, 0, SEEK_SET) != 0) throw std::runtime_error("Cannot write " + path);
+            write(out, &header, sizeof(header));
+            if (std::fflush(out) != 0) throw std::runtime_error("Cannot write " + path);
+            close();
+        }
+    };
+
+#pragma endregion
+#pragma region minibatches
+
+    /**
+     * Samples of one minibatch: the dataset itself when the batch covers all of it, otherwise rows gathered
+     * into a buffer of the stream, valid until the next call to MinibatchStream::next()
+     */
+    template <typename T>
+    struct Minibatch {
+        std::size_t size = 0;
+        math::BasicRowView<const T> inputs;
+        math::BasicRowView<const T> targets;
+    };
+
+    /**
+     * Endless stream of shuffled fixed-size minibatches over a Dataset.
+     * Every epoch draws a new permutation of the samples and cuts it into size() / batch batches, so each
+     * batch mixes rows from the whole file whatever order they were written in (a class-sorted CSV stays
+     * class-sorted on disk), and the leftover samples change from epoch to epoch.
+     * A background thread gathers the next batch's rows into one of two buffers while the current batch
+     * trains from the other. A batch as large as the dataset is used in place instead: its gradient
+     * doesn't depend on the order of its rows.
+     * Reshuffling reuses one permutation buffer, so the stream never allocates after construction.
+     */
+    template <typename T>
+    class MinibatchStream {
+    private:
+        const Dataset<T>& data;
+        std::size_t batch = 0;
+        std::size_t batches = 0;
+        std::uint64_t seed = 0;
+        Xoshiro256 engine;
+        std::vector<std::size_t> order;
+        std::size_t cursor = 0;
+
+        std::vector<T> gathered_inputs[2];
+        std::vector<T> gathered_targets[2];
+        std::size_t slot = 0;
+
+        std::thread prefetcher;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable prepared;
+        std::size_t pending = SIZE_MAX;
+        std::size_t pending_slot = 0;
+        bool preparing = false;
+        bool stopping = false;
+
+        bool in_place() const { return batch == data.size(); }
+
+        void start_epoch() {
+            if (!in_place()) {
+                for (std::size_t i = 0; i < order.size(); ++i) order[i] = i;
+                Random::Shuffle(order.begin(), order.end(), engine);
+            }
+            cursor = 0;
+        }
+
+        /**
+         * Gathers the rows of batch index into buffer target, or faults in the dataset if it's used in place
+         */
+        void prepare(std::size_t index, std::size_t target) {
+            if (in_place()) {
+                const math::BasicRowView<const T> inputs = data.inputs(0, batch);
+                const math::BasicRowView<const T> targets = data.targets(0, batch);
+                MappedFile::Prefetch(inputs.data(), inputs.size() * sizeof(T));
+                MappedFile::Prefetch(targets.data(), targets.size() * sizeof(T));
+                return;
+            }
+
+            T* inputs = gathered_inputs[target].data();
+            T* targets = gathered_targets[target].data();
+            for (std::size_t row = 0; row < batch; ++row) {
+                const std::size_t sample = order[index * batch + row];
+                const math::BasicRowView<const T> x = data.inputs(sample, 1);
+                const math::BasicRowView<const T> y = data.targets(sample, 1);
+                inputs = std::copy(x.begin(), x.end(), inputs);
+                targets = std::copy(y.begin(), y.end(), targets);
+            }
+        }
+
+        void prefetch_loop() {
+            while (true) {
+                std::size_t index, target;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this] { return stopping || pending != SIZE_MAX; });
+                    if (stopping) return;
+                    index = pending;
+                    target = pending_slot;
+                    pending = SIZE_MAX;
+                }
+                prepare(index, target);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    preparing = false;
+                }
+                prepared.notify_all();
+            }
+        }
+
+        void request(std::size_t index, std::size_t target) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending = index;
+                pending_slot = target;
+                preparing = true;
+            }
+            wake.notify_one();
+        }
+
+        void wait_prepared() {
+            std::unique_lock<std::mutex> lock(mutex);
+            prepared.wait(lock, [this] { return !preparing; });
+        }
+
+    public:
+        /**
+         * @param batch_size samples per minibatch, capped at the dataset size
+         */
+        MinibatchStream(const Dataset<T>& dataset, std::size_t batch_size, std::uint64_t shuffle_seed)
+            : data(dataset), seed(shuffle_seed), engine(shuffle_seed) {
+            if (dataset.size() == 0) throw std::invalid_argument("Dataset is empty");
+            batch = std::clamp<std::size_t>(batch_size, 1, dataset.size());
+            batches = dataset.size() / batch;
+            if (!in_place()) {
+                order.resize(dataset.size());
+                for (std::size_t s = 0; s < 2; ++s) {
+                    gathered_inputs[s].resize(batch * dataset.input_count());
+                    gathered_targets[s].resize(batch * dataset.output_count());
+                }
+            }
+            start_epoch();
+
+            prefetcher = std::thread([this] { prefetch_loop(); });
+            request(0, slot);
+        }
+
+        ~MinibatchStream() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            prefetcher.join();
+        }
+
+        MinibatchStream(const MinibatchStream&) = delete;
+        MinibatchStream& operator=(const MinibatchStream&) = delete;
+
+        std::size_t batch_size() const { return batch; }
+        std::size_t batches_per_epoch() const { return batches; }
+        std::size_t samples_per_epoch() const { return batches * batch; }
+
+        /**
+         * @return next minibatch; a new epoch is reshuffled right after the last batch of the previous one
+         */
+        Minibatch<T> next() {
+            wait_prepared();
+            const Minibatch<T> result = in_place()
+                ? Minibatch<T>{ batch, data.inputs(0, batch), data.targets(0, batch) }
+                : Minibatch<T>{ batch, gathered_inputs[slot], gathered_targets[slot] };
+
+            if (++cursor == batches) start_epoch();
+            slot = 1 - slot;
+            request(cursor, slot);
+            return result;
+        }
+
+        /**
+         * Restarts from the first epoch, reproducing the same sequence of batches
+         */
+        void reset() {
+            wait_prepared();
+            engine = Xoshiro256(seed);
+            start_epoch();
+            slot = 0;
+            request(0, slot);
+        }
+    };
+
+#pragma endregion
+
+}
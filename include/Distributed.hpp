@@ -0,0 +1,686 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "Math.hpp"
+#include "Network.hpp"
+#include "Optimizer.hpp"
+#include "Workspace.hpp"
+
+/**
+ * Distributed.hpp
+ * Synchronous data-parallel training across processes on one machine.
+ * The launcher forks one process per rank and joins them in a ring over a pluggable Transport
+ * (shared memory, Unix domain sockets or TCP on localhost). Every step the ranks sum their gradients
+ * with a ring all-reduce, layer by layer, while the backward pass is still computing the layers below.
+ * Processes are started with fork(), so this needs a POSIX system.
+ */
+namespace nn {
+
+#pragma region transports
+
+    enum class TransportKind { SharedMemory, UnixSocket, Tcp };
+
+    inline const char* transport_name(TransportKind kind) {
+        switch (kind) {
+        case TransportKind::UnixSocket: return "unix";
+        case TransportKind::Tcp: return "tcp";
+        default: return "shm";
+        }
+    }
+
+    inline TransportKind parse_transport(const std::string& name) {
+        if (name == "shm") return TransportKind::SharedMemory;
+        if (name == "unix") return TransportKind::UnixSocket;
+        if (name == "tcp") return TransportKind::Tcp;
+        throw std::invalid_argument("Expected shm, unix or tcp transport. Received: " + name);
+    }
+
+    /**
+     * One process's place in a ring: a byte stream to the next rank and one from the previous rank
+     */
+    class Transport {
+    public:
+        virtual ~Transport() = default;
+
+        /**
+         * Sends out_bytes to the next rank while receiving in_bytes from the previous one, and returns once both are done.
+         * Both directions make progress together, so a whole ring exchanging at once never deadlocks, whatever the message size.
+         */
+        virtual void exchange(const void* out, std::size_t out_bytes, void* in, std::size_t in_bytes) = 0;
+    };
+
+#ifndef _WIN32
+
+    namespace detail {
+
+        inline int check_call(int result, const char* what) {
+            if (result < 0) throw std::runtime_error(std::string(what) + " failed: " + std::strerror(errno));
+            return result;
+        }
+
+        inline void close_fd(int& fd) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+
+    }
+
+    /**
+     * Anonymous memory mapping that survives fork() as shared memory between parent and children
+     */
+    class SharedMapping {
+    private:
+        void* ptr = nullptr;
+        std::size_t length = 0;
+
+    public:
+        explicit SharedMapping(std::size_t bytes) : length(std::max<std::size_t>(bytes, 1)) {
+            ptr = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            if (ptr == MAP_FAILED) {
+                ptr = nullptr;
+                throw std::runtime_error("Cannot map " + std::to_string(length) + " bytes of shared memory");
+            }
+        }
+
+        ~SharedMapping() {
+            if (ptr) ::munmap(ptr, length);
+        }
+
+        SharedMapping(const SharedMapping&) = delete;
+        SharedMapping& operator=(const SharedMapping&) = delete;
+
+        void* data() const { return ptr; }
+    };
+
+    /**
+     * Single-producer single-consumer byte queue in shared memory, from one rank to the next.
+     * Both counters only grow; the writer owns written and the reader owns read, so neither side ever locks.
+     */
+    struct SharedChannel {
+        static constexpr std::size_t CAPACITY = std::size_t(1) << 20;
+        static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "Shared channels need lock-free 64-bit atomics");
+
+        alignas(64) std::atomic<std::uint64_t> written;
+        alignas(64) std::atomic<std::uint64_t> read;
+        alignas(64) unsigned char data[CAPACITY];
+
+        /**
+         * @return bytes queued, as many of the given ones as there is room for
+         */
+        std::size_t push(const unsigned char* src, std::size_t bytes) {
+            const std::uint64_t w = written.load(std::memory_order_relaxed);
+            const std::size_t n = std::min<std::size_t>(bytes, CAPACITY - static_cast<std::size_t>(w - read.load(std::memory_order_acquire)));
+            const std::size_t at = static_cast<std::size_t>(w % CAPACITY);
+            const std::size_t first = std::min(n, CAPACITY - at);
+            std::memcpy(data + at, src, first);
+            std::memcpy(data, src + first, n - first);
+            written.store(w + n, std::memory_order_release);
+            return n;
+        }
+
+        /**
+         * @return bytes dequeued, as many of the wanted ones as have arrived
+         */
+        std::size_t pop(unsigned char* dst, std::size_t bytes) {
+            const std::uint64_t r = read.load(std::memory_order_relaxed);
+            const std::size_t n = std::min<std::size_t>(bytes, static_cast<std::size_t>(written.load(std::memory_order_acquire) - r));
+            const std::size_t at = static_cast<std::size_t>(r % CAPACITY);
+            const std::size_t first = std::min(n, CAPACITY - at);
+            std::memcpy(dst, data + at, first);
+            std::memcpy(dst + first, data, n - first);
+            read.store(r + n, std::memory_order_release);
+            return n;
+        }
+    };
+
+    /**
+     * Ring link through shared-memory channels; waiting spins briefly, then yields the core
+     */
+    class SharedMemoryTransport : public Transport {
+    private:
+        SharedChannel* to_next;
+        SharedChannel* from_previous;
+
+    public:
+        SharedMemoryTransport(SharedChannel* next, SharedChannel* previous) : to_next(next), from_previous(previous) {}
+
+        void exchange(const void* out, std::size_t out_bytes, void* in, std::size_t in_bytes) override {
+            const unsigned char* src = static_cast<const unsigned char*>(out);
+            unsigned char* dst = static_cast<unsigned char*>(in);
+            unsigned idle = 0;
+            while (out_bytes > 0 || in_bytes > 0) {
+                const std::size_t sent = out_bytes > 0 ? to_next->push(src, out_bytes) : 0;
+                const std::size_t received = in_bytes > 0 ? from_previous->pop(dst, in_bytes) : 0;
+                src += sent;
+                out_bytes -= sent;
+                dst += received;
+                in_bytes -= received;
+
+                if (sent + received > 0) idle = 0;
+                else if (++idle > 64) std::this_thread::yield();
+            }
+        }
+    };
+
+    /**
+     * Ring link over two connected stream sockets (Unix domain or TCP), driven with poll() so sending
+     * and receiving interleave
+     */
+    class SocketTransport : public Transport {
+    private:
+        int next_fd = -1;
+        int previous_fd = -1;
+
+    public:
+        SocketTransport(int next, int previous) : next_fd(next), previous_fd(previous) {
+            detail::check_call(::fcntl(next_fd, F_SETFL, ::fcntl(next_fd, F_GETFL) | O_NONBLOCK), "fcntl");
+            detail::check_call(::fcntl(previous_fd, F_SETFL, ::fcntl(previous_fd, F_GETFL) | O_NONBLOCK), "fcntl");
+        }
+
+        ~SocketTransport() override {
+            detail::close_fd(next_fd);
+            detail::close_fd(previous_fd);
+        }
+
+        SocketTransport(const SocketTransport&) = delete;
+        SocketTransport& operator=(const SocketTransport&) = delete;
+
+        void exchange(const void* out, std::size_t out_bytes, void* in, std::size_t in_bytes) override {
+            const char* src = static_cast<const char*>(out);
+            char* dst = static_cast<char*>(in);
+            while (out_bytes > 0 || in_bytes > 0) {
+                pollfd fds[2] = { { next_fd, static_cast<short>(out_bytes > 0 ? POLLOUT : 0), 0 }, { previous_fd, static_cast<short>(in_bytes > 0 ? POLLIN : 0), 0 } };
+                if (::poll(fds, 2, -1) < 0) {
+                    if (errno == EINTR) continue;
+                    detail::check_call(-1, "poll");
+                }
+
+                if (out_bytes > 0 && (fds[0].revents & (POLLOUT | POLLERR | POLLHUP))) {
+                    const ssize_t sent = ::send(next_fd, src, out_bytes, MSG_NOSIGNAL);
+                    if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) detail::check_call(-1, "send");
+                    if (sent > 0) {
+                        src += sent;
+                        out_bytes -= static_cast<std::size_t>(sent);
+                    }
+                }
+                if (in_bytes > 0 && (fds[1].revents & (POLLIN | POLLERR | POLLHUP))) {
+                    const ssize_t received = ::recv(previous_fd, dst, in_bytes, 0);
+                    if (received == 0) throw std::runtime_error("Previous rank closed the connection");
+                    if (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) detail::check_call(-1, "recv");
+                    if (received > 0) {
+                        dst += received;
+                        in_bytes -= static_cast<std::size_t>(received);
+                    }
+                }
+            }
+        }
+    };
+
+    /**
+     * Links of a ring of processes, created by the launcher before it forks so that every rank inherits them.
+     * connect(rank), called in that rank's process, keeps its two ends and closes everything else.
+     * Shared memory: one channel per link. Unix: one socketpair per link. TCP: one listener per rank on
+     * 127.0.0.1 (port picked by the OS); each rank connects to the next rank's listener and accepts the previous rank.
+     */
+    class RingLinks {
+    private:
+        TransportKind kind;
+        std::size_t size;
+        std::unique_ptr<SharedMapping> channels;
+        std::vector<int> fds;
+        std::vector<std::uint16_t> ports;
+
+        SharedChannel* channel(std::size_t link) const { return static_cast<SharedChannel*>(channels->data()) + link; }
+
+        static int connect_tcp(std::uint16_t port) {
+            const int fd = detail::check_call(::socket(AF_INET, SOCK_STREAM, 0), "socket");
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+                const int error = errno;
+                ::close(fd);
+                throw std::runtime_error(std::string("connect to 127.0.0.1:") + std::to_string(port) + " failed: " + std::strerror(error));
+            }
+            return fd;
+        }
+
+        static void disable_nagle(int fd) {
+            const int on = 1;
+            detail::check_call(::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)), "setsockopt");
+        }
+
+    public:
+        RingLinks(TransportKind transport, std::size_t ranks) : kind(transport), size(ranks) {
+            if (ranks == 0) throw std::invalid_argument("A ring needs at least one rank");
+
+            switch (kind) {
+            case TransportKind::SharedMemory:
+                channels = std::make_unique<SharedMapping>(size * sizeof(SharedChannel));
+                for (std::size_t link = 0; link < size; ++link) {
+                    SharedChannel* c = new (channel(link)) SharedChannel;
+                    c->written.store(0);
+                    c->read.store(0);
+                }
+                break;
+            case TransportKind::UnixSocket:
+                // link r runs from rank r (fds[2r]) to rank r + 1 (fds[2r + 1])
+                fds.assign(2 * size, -1);
+                for (std::size_t link = 0; link < size; ++link) detail::check_call(::socketpair(AF_UNIX, SOCK_STREAM, 0, &fds[2 * link]), "socketpair");
+                break;
+            case TransportKind::Tcp:
+                fds.assign(size, -1);
+                ports.assign(size, 0);
+                for (std::size_t r = 0; r < size; ++r) {
+                    fds[r] = detail::check_call(::socket(AF_INET, SOCK_STREAM, 0), "socket");
+                    sockaddr_in address{};
+                    address.sin_family = AF_INET;
+                    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                    socklen_t length = sizeof(address);
+                    detail::check_call(::bind(fds[r], reinterpret_cast<const sockaddr*>(&address), sizeof(address)), "bind");
+                    detail::check_call(::listen(fds[r], 1), "listen");
+                    detail::check_call(::getsockname(fds[r], reinterpret_cast<sockaddr*>(&address), &length), "getsockname");
+                    ports[r] = ntohs(address.sin_port);
+                }
+                break;
+            }
+        }
+
+        ~RingLinks() {
+            for (int& fd : fds) detail::close_fd(fd);
+        }
+
+        RingLinks(const RingLinks&) = delete;
+        RingLinks& operator=(const RingLinks&) = delete;
+
+        std::unique_ptr<Transport> connect(std::size_t rank) {
+            const std::size_t next = (rank + 1) % size;
+            const std::size_t previous = (rank + size - 1) % size;
+
+            switch (kind) {
+            case TransportKind::UnixSocket: {
+                const int to_next = fds[2 * rank];
+                const int from_previous = fds[2 * previous + 1];
+                fds[2 * rank] = fds[2 * previous + 1] = -1;
+                for (int& fd : fds) detail::close_fd(fd);
+                return std::make_unique<SocketTransport>(to_next, from_previous);
+            }
+            case TransportKind::Tcp: {
+                // the listener's backlog holds our connection until the next rank gets round to accepting it
+                const int to_next = connect_tcp(ports[next]);
+                const int from_previous = ::accept(fds[rank], nullptr, nullptr);
+                if (from_previous < 0) {
+                    const int error = errno;
+                    ::close(to_next);
+                    throw std::runtime_error(std::string("accept failed: ") + std::strerror(error));
+                }
+                for (int& fd : fds) detail::close_fd(fd);
+                disable_nagle(to_next);
+                disable_nagle(from_previous);
+                return std::make_unique<SocketTransport>(to_next, from_previous);
+            }
+            default:
+                return std::make_unique<SharedMemoryTransport>(channel(rank), channel(previous));
+            }
+        }
+    };
+
+#endif
+
+    /**
+     * Runs body(rank, transport) in ranks forked processes joined in a ring, and waits for all of them.
+     * Each rank returns a trivially copyable Result, handed back through shared memory in rank order.
+     * The children leave with _exit(), so only the launcher runs destructors of what it owned before the fork.
+     * If any rank fails, the others are killed and the launcher throws.
+     */
+    template <typename Result, typename Body>
+    inline std::vector<Result> run_ring(std::size_t ranks, TransportKind kind, Body&& body) {
+        static_assert(std::is_trivially_copyable_v<Result>, "Results travel between processes as raw bytes");
+#ifdef _WIN32
+        (void)ranks;
+        (void)kind;
+        (void)body;
+        throw std::runtime_error("Multi-process training needs fork(), which Windows does not have");
+#else
+        if (ranks == 0) throw std::invalid_argument("Expected at least one process");
+
+        SharedMapping shared(ranks * sizeof(Result));
+        Result* results = static_cast<Result*>(shared.data());
+        RingLinks links(kind, ranks);
+
+        // anything still buffered would otherwise be written once per process
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+
+        std::vector<pid_t> children;
+        children.reserve(ranks);
+        for (std::size_t rank = 0; rank < ranks; ++rank) {
+            const pid_t pid = ::fork();
+            if (pid == 0) {
+                int status = 0;
+                try {
+                    std::unique_ptr<Transport> transport = links.connect(rank);
+                    const Result result = body(rank, *transport);
+                    std::memcpy(static_cast<void*>(results + rank), &result, sizeof(Result));
+                } catch (const std::exception& e) {
+                    std::cerr << "Rank " << rank << ": " << e.what() << std::endl;
+                    status = 1;
+                }
+                std::cout.flush();
+                std::fflush(nullptr);
+                ::_exit(status);
+            }
+            if (pid < 0) {
+                for (pid_t child : children) ::kill(child, SIGKILL);
+                for (pid_t child : children) ::waitpid(child, nullptr, 0);
+                throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+            }
+            children.push_back(pid);
+        }
+
+        // a rank that dies leaves its neighbours waiting forever, so the first failure takes everyone down
+        std::size_t running = ranks;
+        std::size_t failed = ranks;
+        while (running > 0) {
+            int status = 0;
+            const pid_t pid = ::waitpid(-1, &status, 0);
+            if (pid < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            const auto it = std::find(children.begin(), children.end(), pid);
+            if (it == children.end()) continue;
+            --running;
+            if ((!WIFEXITED(status) || WEXITSTATUS(status) != 0) && failed == ranks) {
+                failed = static_cast<std::size_t>(it - children.begin());
+                for (pid_t child : children) {
+                    if (child != pid) ::kill(child, SIGKILL);
+                }
+            }
+            *it = -1;
+        }
+        if (failed != ranks) throw std::runtime_error("Rank " + std::to_string(failed) + " of " + std::to_string(ranks) + " failed");
+
+        return std::vector<Result>(results, results + ranks);
+#endif
+    }
+
+#pragma endregion
+
+#pragma region all-reduce
+
+    /**
+     * Sums n values across all ranks in place with a ring all-reduce. The values are cut into one
+     * chunk per rank; ranks - 1 reduce-scatter steps leave every rank with the total of one chunk,
+     * then ranks - 1 all-gather steps pass the totals round the ring. Each rank sends
+     * 2 (ranks - 1) / ranks of the data whatever the ring size, and since every total is computed once
+     * and then copied, all ranks end up with the same bits.
+     * @param scratch room for the largest chunk, n / ranks + 1 values
+     * @return bytes this rank sent
+     */
+    template <typename T>
+    inline std::size_t ring_all_reduce(Transport& transport, std::size_t rank, std::size_t ranks, T* data, std::size_t n, T* scratch) {
+        const auto chunk_begin = [&](std::size_t c) { return n * c / ranks; };
+        const auto chunk_size = [&](std::size_t c) { return chunk_begin(c + 1) - chunk_begin(c); };
+        const math::simd::BasicKernels<T>& k = math::simd::kernels<T>();
+        std::size_t sent = 0;
+
+        for (std::size_t s = 0; s + 1 < ranks; ++s) {
+            const std::size_t out = (rank + ranks - s) % ranks;
+            const std::size_t in = (rank + ranks - s - 1) % ranks;
+            transport.exchange(data + chunk_begin(out), chunk_size(out) * sizeof(T), scratch, chunk_size(in) * sizeof(T));
+            k.add(data + chunk_begin(in), scratch, data + chunk_begin(in), chunk_size(in));
+            sent += chunk_size(out) * sizeof(T);
+        }
+        for (std::size_t s = 0; s + 1 < ranks; ++s) {
+            const std::size_t out = (rank + ranks + 1 - s) % ranks;
+            const std::size_t in = (rank + ranks - s) % ranks;
+            transport.exchange(data + chunk_begin(out), chunk_size(out) * sizeof(T), data + chunk_begin(in), chunk_size(in) * sizeof(T));
+            sent += chunk_size(out) * sizeof(T);
+        }
+        return sent;
+    }
+
+#pragma endregion
+
+#pragma region trainer
+
+    /**
+     * Communication counters of one rank
+     */
+    struct CommunicationStats {
+        std::uint64_t steps = 0;
+        std::uint64_t bytes_sent = 0;
+        // time spent inside all-reduces, and the part of that same time after the backward pass had finished,
+        // which the step waits for; the rest overlapped the backward pass
+        double reduce_seconds = 0.0;
+        double waiting_seconds = 0.0;
+    };
+
+    /**
+     * One rank of synchronous data-parallel training across processes.
+     * Every rank loads the same minibatch and trains on its own contiguous slice of it. As soon as the
+     * backward pass has finished a layer, a communication thread all-reduces that layer's gradients
+     * over the ring while the backward pass carries on below; the loss follows last. Each rank then
+     * applies the same optimizer step to its own copy of the weights, so the copies never drift apart.
+     * Without overlap, the training thread reduces everything itself once the backward pass is done.
+     */
+    template <typename T, typename Acc = T>
+    class DistributedTrainer {
+    private:
+        Transport& transport;
+        std::size_t rank;
+        std::size_t ranks;
+        Topology topology;
+        std::size_t batch_size = 0;
+        std::size_t row_begin = 0;
+        std::size_t row_end = 0;
+        BasicWorkspace<T> workspace;
+        std::vector<T> targets;
+        Optimizer<T> optimizer;
+        math::aligned_vector<T> scratch;
+        Acc step_loss = Acc(0);
+        Acc loss_scratch = Acc(0);
+        bool overlap = true;
+        CommunicationStats counters;
+
+        // buckets are numbered in the order the backward pass finishes them: layer depth - 1 down to 0, then the loss if measured
+        std::thread communicator;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable finished;
+        std::size_t posted = 0;
+        std::size_t completed = 0;
+        bool stopping = false;
+        // start and end of every bucket's all-reduce in the current step
+        std::vector<std::pair<std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point>> intervals;
+
+        void reduce(std::size_t bucket) {
+            const auto start = std::chrono::steady_clock::now();
+            std::size_t sent = 0;
+            if (bucket < topology.depth()) {
+                const std::size_t l = topology.depth() - 1 - bucket;
+                const math::BasicRowView<T> weights = workspace.weight_gradients[l].flat();
+                sent += ring_all_reduce(transport, rank, ranks, weights.data(), weights.size(), scratch.data());
+                sent += ring_all_reduce(transport, rank, ranks, workspace.bias_gradients[l].data(), workspace.bias_gradients[l].size(), scratch.data());
+            } else {
+                sent += ring_all_reduce(transport, rank, ranks, &step_loss, 1, &loss_scratch);
+            }
+            counters.bytes_sent += sent;
+            intervals[bucket] = { start, std::chrono::steady_clock::now() };
+            counters.reduce_seconds += std::chrono::duration<double>(intervals[bucket].second - start).count();
+        }
+
+        /**
+         * Adds the part of this step's all-reduces (the first buckets) that ran after backward_end to the waiting time
+         */
+        void count_waiting(std::size_t buckets, std::chrono::steady_clock::time_point backward_end) {
+            for (std::size_t bucket = 0; bucket < buckets; ++bucket) {
+                const auto start = std::max(intervals[bucket].first, backward_end);
+                if (intervals[bucket].second > start) counters.waiting_seconds += std::chrono::duration<double>(intervals[bucket].second - start).count();
+            }
+        }
+
+        void communicate() {
+            while (true) {
+                std::size_t bucket;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [this] { return stopping || completed < posted; });
+                    if (stopping) return;
+                    bucket = completed;
+                }
+                reduce(bucket);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    ++completed;
+                }
+                finished.notify_one();
+            }
+        }
+
+        void post() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ++posted;
+            }
+            wake.notify_one();
+        }
+
+    public:
+        /**
+         * @param batch samples per minibatch over all ranks; this rank trains on rows [batch * rank / ranks, batch * (rank + 1) / ranks)
+         */
+        DistributedTrainer(Transport& link, std::size_t this_rank, std::size_t rank_count, const Topology& topo, std::size_t batch,
+                           const OptimizerSettings& settings = {}, bool overlap_backward = true)
+            : transport(link), rank(this_rank), ranks(rank_count), topology(topo), batch_size(batch),
+              row_begin(batch * this_rank / std::max<std::size_t>(rank_count, 1)), row_end(batch * (this_rank + 1) / std::max<std::size_t>(rank_count, 1)),
+              workspace(topo, std::max<std::size_t>(row_end - row_begin, 1)), targets(workspace.batch_size * topo.output()),
+              optimizer(topo, settings), overlap(overlap_backward && rank_count > 1) {
+            if (rank_count == 0 || this_rank >= rank_count) throw std::invalid_argument("Rank must be below the rank count");
+            if (batch < rank_count) throw std::invalid_argument("Every rank needs at least one sample of the minibatch");
+
+            std::size_t largest = 0;
+            for (std::size_t l = 0; l < topo.depth(); ++l) largest = std::max(largest, topo.layers[l].units * topo.fan_in(l));
+            scratch.resize(largest / rank_count + 1);
+            intervals.resize(topo.depth() + 1);
+
+            if (overlap) communicator = std::thread([this] { communicate(); });
+        }
+
+        ~DistributedTrainer() {
+            if (!communicator.joinable()) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_one();
+            communicator.join();
+        }
+
+        DistributedTrainer(const DistributedTrainer&) = delete;
+        DistributedTrainer& operator=(const DistributedTrainer&) = delete;
+
+        std::size_t size() const { return batch_size; }
+        std::size_t local_size() const { return row_end - row_begin; }
+        const CommunicationStats& stats() const { return counters; }
+
+        /**
+         * Copies this rank's slice of a minibatch (row-major inputs and targets of all batch samples) into its workspace
+         */
+        void load_batch(math::identity_t<math::BasicRowView<const T>> inputs, math::identity_t<math::BasicRowView<const T>> batch_targets) {
+            if (inputs.size() != batch_size * topology.input) throw std::invalid_argument("Inputs must have shape batch x input");
+            if (batch_targets.size() != batch_size * topology.output()) throw std::invalid_argument("Targets must have shape batch x output");
+
+            const T* first = inputs.data() + row_begin * topology.input;
+            std::copy(first, first + local_size() * topology.input, workspace.input.data());
+            const T* first_target = batch_targets.data() + row_begin * topology.output();
+            std::copy(first_target, first_target + local_size() * topology.output(), targets.begin());
+        }
+
+        /**
+         * One synchronous optimizer step on the loaded minibatch, identical on every rank
+         * @param with_loss false skips measuring the loss and its all-reduce
+         * @return loss summed over the whole minibatch, before the update (0 without with_loss)
+         */
+        Acc step(Network<T>& p, double learning_rate, bool with_loss = true) {
+            const math::BasicRowView<const T> local_targets(targets.data(), targets.size());
+
+            const std::size_t buckets = topology.depth() + (with_loss ? 1 : 0);
+            if (overlap) {
+                step_loss = accumulate_gradients<Acc>(p, workspace, local_targets, with_loss, [this](std::size_t) { post(); });
+                if (with_loss) post();
+
+                const auto backward_end = std::chrono::steady_clock::now();
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    finished.wait(lock, [this] { return completed == posted; });
+                    posted = completed = 0;
+                }
+                count_waiting(buckets, backward_end);
+            } else {
+                step_loss = accumulate_gradients<Acc>(p, workspace, local_targets, with_loss);
+                const auto backward_end = std::chrono::steady_clock::now();
+                for (std::size_t bucket = 0; bucket < buckets; ++bucket) reduce(bucket);
+                count_waiting(buckets, backward_end);
+            }
+
+            ++counters.steps;
+            optimizer.apply(p, workspace, learning_rate, batch_size);
+            return step_loss;
+        }
+    };
+
+    /**
+     * @return FNV-1a hash of every weight and bias, to check that replicas agree bit for bit
+     */
+    template <typename T>
+    inline std::uint64_t weights_fingerprint(const Network<T>& net) {
+        std::uint64_t hash = 14695981039346656037ull;
+        const auto mix = [&hash](const T* values, std::size_t n) {
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+            for (std::size_t i = 0; i < n * sizeof(T); ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+        };
+        for (const Layer<T>& layer : net.layers) {
+            mix(layer.weight.data(), layer.weight.size());
+            mix(layer.bias.data(), layer.bias.size());
+        }
+        return hash;
+    }
+
+#pragma endregion
+
+}
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "Math.hpp"
+#include "Network.hpp"
+#include "Optimizer.hpp"
+#include "Profiler.hpp"
+#include "Workspace.hpp"
+
+/**
+ * FixedNetwork.hpp
+ * Compile-time sized path for tiny networks (one hidden layer, a handful of units).
+ * At XOR size the generic engine spends its time on bookkeeping, not arithmetic: heap buffers,
+ * size checks and dispatch in every Math.hpp call, and loops whose bounds the compiler can't see.
+ * Here every width is a template argument, the weights live in std::arrays, and forward, backward
+ * and the gradient sums run fused per sample over loops the compiler unrolls completely.
+ * Activations are evaluated exactly (MATH_APPROX only affects the generic engine).
+ */
+namespace nn {
+
+#pragma region parameters
+
+    /**
+     * Weights of an In-Hidden-Out network, row-major like Layer::weight
+     */
+    template <typename T, std::size_t In, std::size_t Hidden, std::size_t Out>
+    struct FixedNetwork {
+        alignas(64) std::array<T, Hidden * In> weight_hidd{};
+        std::array<T, Hidden> bias_hidd{};
+        alignas(64) std::array<T, Out * Hidden> weight_outp{};
+        std::array<T, Out> bias_outp{};
+
+        void load(const NetworkView<T>& net) {
+            std::copy_n(net.layers[0].weight.data(), weight_hidd.size(), weight_hidd.begin());
+            std::copy_n(net.layers[0].bias.data(), bias_hidd.size(), bias_hidd.begin());
+            std::copy_n(net.layers[1].weight.data(), weight_outp.size(), weight_outp.begin());
+            std::copy_n(net.layers[1].bias.data(), bias_outp.size(), bias_outp.begin());
+        }
+
+        void store(Network<T>& net) const {
+            std::copy(weight_hidd.begin(), weight_hidd.end(), net.layers[0].weight.begin());
+            std::copy(bias_hidd.begin(), bias_hidd.end(), net.layers[0].bias.begin());
+            std::copy(weight_outp.begin(), weight_outp.end(), net.layers[1].weight.begin());
+            std::copy(bias_outp.begin(), bias_outp.end(), net.layers[1].bias.begin());
+        }
+    };
+
+#pragma endregion
+#pragma region passes
+
+    template <Activation A, typename T>
+    inline T activate(T x) {
+        if constexpr (A == Activation::Relu) return math::relu(x);
+        else if constexpr (A == Activation::Tanh) return std::tanh(x);
+        else if constexpr (A == Activation::Sigmoid) return math::sigmoid(x);
+        else return x;
+    }
+
+    template <Activation A, typename T>
+    inline T activation_derivative_from_output(T y) {
+        if constexpr (A == Activation::Relu) return math::relu_derivative_from_output(y);
+        else if constexpr (A == Activation::Tanh) return math::tanh_derivative_from_output(y);
+        else if constexpr (A == Activation::Sigmoid) return math::sigmoid_derivative_from_output(y);
+        else return T(1);
+    }
+
+    /**
+     * Gradients of an In-Hidden-Out network summed over a batch; weights in T, biases in Acc
+     */
+    template <typename T, typename Acc, std::size_t In, std::size_t Hidden, std::size_t Out>
+    struct FixedGradients {
+        alignas(64) std::array<T, Hidden * In> weight_hidd{};
+        std::array<Acc, Hidden> bias_hidd{};
+        alignas(64) std::array<T, Out * Hidden> weight_outp{};
+        std::array<Acc, Out> bias_outp{};
+    };
+
+    /**
+     * Forward and backward pass over batch samples (row-major inputs and targets), adding into g,
+     * which the caller zeroes. Writes every sample's logits when logits is not null.
+     * @return loss summed over the samples, accumulated in Acc; 0 without with_loss
+     */
+    template <Activation A, typename T, typename Acc, std::size_t In, std::size_t Hidden, std::size_t Out>
+    inline Acc accumulate_gradients(const FixedNetwork<T, In, Hidden, Out>& net, FixedGradients<T, Acc, In, Hidden, Out>& g,
+        const T* inputs, const T* targets, std::size_t batch, T* logits, bool with_loss) {
+        Acc loss = Acc(0);
+        for (std::size_t n = 0; n < batch; ++n) {
+            const T* x = inputs + n * In;
+            const T* t = targets + n * Out;
+
+            std::array<T, Hidden> hidden;
+            for (std::size_t h = 0; h < Hidden; ++h) {
+                T sum = net.bias_hidd[h];
+                for (std::size_t i = 0; i < In; ++i) sum += net.weight_hidd[h * In + i] * x[i];
+                hidden[h] = activate<A>(sum);
+            }
+
+            std::array<T, Hidden> delta_hidd{};
+            for (std::size_t o = 0; o < Out; ++o) {
+                T logit = net.bias_outp[o];
+                for (std::size_t h = 0; h < Hidden; ++h) logit += net.weight_outp[o * Hidden + h] * hidden[h];
+                if (logits) logits[n * Out + o] = logit;
+
+                if (with_loss) loss += math::bce_with_logits_loss(logit, t[o]);
+                const T delta = math::bce_with_logits_loss_delta(logit, t[o]);
+                for (std::size_t h = 0; h < Hidden; ++h) {
+                    g.weight_outp[o * Hidden + h] += delta * hidden[h];
+                    delta_hidd[h] += delta * net.weight_outp[o * Hidden + h];
+                }
+                g.bias_outp[o] += delta;
+            }
+
+            for (std::size_t h = 0; h < Hidden; ++h) {
+                const T delta = delta_hidd[h] * activation_derivative_from_output<A>(hidden[h]);
+                for (std::size_t i = 0; i < In; ++i) g.weight_hidd[h * In + i] += delta * x[i];
+                g.bias_hidd[h] += delta;
+            }
+        }
+        return loss;
+    }
+
+    /**
+     * One optimizer update of net from the summed gradients g. The optimizer state (velocity, or
+     * Adam's two moments) has the shape of the network, so it is kept in FixedNetworks too.
+     */
+    template <typename T, typename Acc, std::size_t In, std::size_t Hidden, std::size_t Out>
+    inline void apply_gradients(FixedNetwork<T, In, Hidden, Out>& net, const FixedGradients<T, Acc, In, Hidden, Out>& g,
+        FixedNetwork<T, In, Hidden, Out>& first, FixedNetwork<T, In, Hidden, Out>& second, OptimizerKind kind, const math::simd::UpdateStep<T>& step) {
+        update_inline(kind, net.weight_hidd.data(), g.weight_hidd.data(), first.weight_hidd.data(), second.weight_hidd.data(), Hidden * In, step);
+        update_inline(kind, net.bias_hidd.data(), g.bias_hidd.data(), first.bias_hidd.data(), second.bias_hidd.data(), Hidden, step);
+        update_inline(kind, net.weight_outp.data(), g.weight_outp.data(), first.weight_outp.data(), second.weight_outp.data(), Out * Hidden, step);
+        update_inline(kind, net.bias_outp.data(), g.bias_outp.data(), first.bias_outp.data(), second.bias_outp.data(), Out, step);
+    }
+
+#pragma endregion
+#pragma region trainer
+
+    /**
+     * Single-threaded synchronous training on a compile-time sized copy of the network.
+     * The copy is the one being trained: load() it from a Network before training and store()
+     * it back whenever the Network is needed (checkpoints, evaluation).
+     */
+    template <typename T, typename Acc = T>
+    class FixedTrainer {
+    public:
+        virtual ~FixedTrainer() = default;
+
+        virtual void load(const NetworkView<T>& net) = 0;
+        virtual void store(Network<T>& net) const = 0;
+
+        /**
+         * Points the trainer at a minibatch (row-major inputs and targets, one row of each per sample),
+         * read in place until the next load_batch
+         */
+        virtual void load_batch(math::identity_t<math::BasicRowView<const T>> inputs, math::identity_t<math::BasicRowView<const T>> targets) = 0;
+
+        /**
+         * One optimizer step on the loaded minibatch (for SGD: weights -= learning_rate * mean gradient)
+         * @param with_loss false skips measuring the loss, for steps whose loss nobody reads
+         * @return loss summed over the minibatch, before the update (0 without with_loss)
+         */
+        virtual Acc step(double learning_rate, bool with_loss = true) = 0;
+
+        /**
+         * @return logit of one output of a sample from the last step
+         */
+        virtual T logit(std::size_t sample, std::size_t output = 0) const = 0;
+    };
+
+    template <typename T, typename Acc, Activation A, std::size_t In, std::size_t Hidden, std::size_t Out>
+    class BasicFixedTrainer final : public FixedTrainer<T, Acc> {
+    private:
+        FixedNetwork<T, In, Hidden, Out> net;
+        FixedGradients<T, Acc, In, Hidden, Out> gradients;
+        FixedNetwork<T, In, Hidden, Out> first_state;
+        FixedNetwork<T, In, Hidden, Out> second_state;
+        OptimizerSettings optimizer;
+        std::uint64_t steps = 0;
+        std::size_t batch_size = 0;
+        const T* inputs = nullptr;
+        const T* targets = nullptr;
+        std::vector<T> logits;
+
+    public:
+        BasicFixedTrainer(std::size_t batch, const OptimizerSettings& settings) : optimizer(settings), batch_size(batch), logits(batch * Out) {
+            if (batch == 0) throw std::invalid_argument("Batch must not be empty");
+            settings.validate();
+        }
+
+        void load(const NetworkView<T>& p) override { net.load(p); }
+        void store(Network<T>& p) const override { net.store(p); }
+
+        void load_batch(math::identity_t<math::BasicRowView<const T>> batch_inputs, math::identity_t<math::BasicRowView<const T>> batch_targets) override {
+            if (batch_inputs.size() != batch_size * In) throw std::invalid_argument("Inputs must have shape batch x input");
+            if (batch_targets.size() != batch_size * Out) throw std::invalid_argument("Targets must have shape batch x output");
+            inputs = batch_inputs.data();
+            targets = batch_targets.data();
+        }
+
+        Acc step(double learning_rate, bool with_loss) override {
+            gradients = {};
+            Acc loss;
+            {
+                // forward and backward are fused per sample, so both show up as backward time
+                const Profiler::Timer timer(Profiler::Phase::Backward);
+                loss = accumulate_gradients<A>(net, gradients, inputs, targets, batch_size, logits.data(), with_loss);
+            }
+            const Profiler::Timer timer(Profiler::Phase::Update);
+            apply_gradients(net, gradients, first_state, second_state, optimizer.kind, update_step<T>(optimizer, learning_rate, batch_size, ++steps));
+            return loss;
+        }
+
+        T logit(std::size_t sample, std::size_t output = 0) const override { return logits[sample * Out + output]; }
+    };
+
+    namespace fixed_detail {
+
+        template <typename T, typename Acc, std::size_t In, std::size_t Hidden>
+        inline std::unique_ptr<FixedTrainer<T, Acc>> make_with_hidden(const Topology& topo, std::size_t batch, const OptimizerSettings& settings) {
+            if (topo.output() != 1) return nullptr;
+            switch (topo.layers[0].activation) {
+            case Activation::Relu: return std::make_unique<BasicFixedTrainer<T, Acc, Activation::Relu, In, Hidden, 1>>(batch, settings);
+            case Activation::Tanh: return std::make_unique<BasicFixedTrainer<T, Acc, Activation::Tanh, In, Hidden, 1>>(batch, settings);
+            case Activation::Sigmoid: return std::make_unique<BasicFixedTrainer<T, Acc, Activation::Sigmoid, In, Hidden, 1>>(batch, settings);
+            default: return nullptr;
+            }
+        }
+
+        template <typename T, typename Acc, std::size_t In>
+        inline std::unique_ptr<FixedTrainer<T, Acc>> make_with_input(const Topology& topo, std::size_t batch, const OptimizerSettings& settings) {
+            switch (topo.layers[0].units) {
+            case 4: return make_with_hidden<T, Acc, In, 4>(topo, batch, settings);
+            case 8: return make_with_hidden<T, Acc, In, 8>(topo, batch, settings);
+            case 16: return make_with_hidden<T, Acc, In, 16>(topo, batch, settings);
+            default: return nullptr;
+            }
+        }
+
+    }
+
+    /**
+     * @return a compile-time sized trainer for topo, or null if topo is not one of the sizes built in:
+     *         2 to 4 inputs, one relu, tanh or sigmoid hidden layer of 4, 8 or 16 units, and one output.
+     *         Each (inputs, hidden) pair costs nine instantiations (three activations, three precisions).
+     */
+    template <typename T, typename Acc = T>
+    inline std::unique_ptr<FixedTrainer<T, Acc>> make_fixed_trainer(const Topology& topo, std::size_t batch, const OptimizerSettings& settings = {}) {
+        if (topo.depth() != 2) return nullptr;
+        switch (topo.input) {
+        case 2: return fixed_detail::make_with_input<T, Acc, 2>(topo, batch, settings);
+        case 3: return fixed_detail::make_with_input<T, Acc, 3>(topo, batch, settings);
+        case 4: return fixed_detail::make_with_input<T, Acc, 4>(topo, batch, settings);
+        default: return nullptr;
+        }
+    }
+
+#pragma endregion
+
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Dataset.hpp"
+#include "Math.hpp"
+#include "Network.hpp"
+#include "Quantize.hpp"
+#include "Workspace.hpp"
+
+/**
+ * Inference.hpp
+ * Batched, streaming prediction for shell pipelines.
+ * Rows are parsed straight out of a large read buffer, pushed through the network a whole batch
+ * at a time and formatted into a large write buffer, so neither iostreams nor per-row allocations
+ * sit on the hot path.
+ * Given a QuantizedNetwork, the batches run through its int8 forward pass instead.
+ */
+namespace nn {
+
+    /**
+     * What is written per output: the sigmoid probability, the raw logit, or the 0/1 class
+     */
+    enum class Prediction { Probability, Logit, Class };
+
+    template <typename T>
+    class Predictor {
+    private:
+        static constexpr std::size_t READ_BUFFER = std::size_t(1) << 20;
+        static constexpr std::size_t WRITE_BUFFER = std::size_t(1) << 20;
+        static constexpr std::size_t MAX_FIELD = 64;
+
+        NetworkView<T> params;
+        const QuantizedNetwork<T>* quantized;
+        BasicWorkspace<T> ws;
+        QuantizedWorkspace quantized_ws;
+        math::BasicMatrix<T> probabilities;
+        Prediction kind;
+
+        std::vector<char> out;
+        std::size_t out_size = 0;
+        std::FILE* sink = nullptr;
+        std::uint64_t predicted = 0;
+
+        void flush_output() {
+            if (out_size != 0 && std::fwrite(out.data(), 1, out_size, sink) != out_size) throw std::runtime_error("Cannot write predictions");
+            out_size = 0;
+        }
+
+        void put(char c) {
+            out[out_size++] = c;
+        }
+
+        void put_value(T value) {
+            const std::to_chars_result result = std::to_chars(out.data() + out_size, out.data() + out.size(), value);
+            out_size = static_cast<std::size_t>(result.ptr - out.data());
+        }
+
+        /**
+         * Runs the first rows rows of ws.input through the network and formats their predictions
+         */
+        void predict(std::size_t rows) {
+            if (rows == 0) return;
+            if (quantized) quantized->forward(ws.input.data(), rows, ws.logits().data(), quantized_ws);
+            else forward(params, ws);
+            if (kind == Prediction::Probability) math::sigmoid(ws.logits(), probabilities);
+
+            const std::size_t outputs = ws.topology.output();
+            const math::BasicMatrix<T>& values = kind == Prediction::Probability ? probabilities : ws.logits();
+            for (std::size_t r = 0; r < rows; ++r) {
+                if (out.size() - out_size < outputs * MAX_FIELD) flush_output();
+                const T* row = values.row_data(r);
+                for (std::size_t o = 0; o < outputs; ++o) {
+                    if (o != 0) put(',');
+                    if (kind == Prediction::Class) put(row[o] > T(0) ? '1' : '0');
+                    else put_value(row[o]);
+                }
+                put('\n');
+            }
+            predicted += rows;
+        }
+
+        static bool is_separator(char c) {
+            return c == ',' || c == ';' || c == ' ' || c == '\t' || c == '\r';
+        }
+
+    public:
+        /**
+         * @param batch rows per forward pass; larger batches amortise more and use the thread pool
+         * @param int8 quantized copy of parameters to predict with, or nullptr; must outlive the predictor
+         */
+        Predictor(const NetworkView<T>& parameters, std::size_t batch, Prediction prediction, const QuantizedNetwork<T>* int8 = nullptr)
+            : params(parameters),
+            quantized(int8),
+            ws(parameters.topology, std::max<std::size_t>(batch, 1)),
+            quantized_ws(parameters.topology, int8 ? std::max<std::size_t>(batch, 1) : 0),
+            probabilities(std::max<std::size_t>(batch, 1), parameters.topology.output()),
+            kind(prediction),
+            out(WRITE_BUFFER) {}
+
+        std::uint64_t count() const { return predicted; }
+
+        /**
+         * Predicts every line of text read from in: input_count numbers separated by commas,
+         * semicolons or whitespace. Blank lines are skipped. One line of predictions per row.
+         */
+        void run(std::FILE* in, std::FILE* output) {
+            sink = output;
+            const std::size_t inputs = ws.topology.input;
+            std::vector<char> buffer(READ_BUFFER);
+            std::size_t filled = 0;
+            std::size_t rows = 0;
+            std::uint64_t line_number = 0;
+            bool eof = false;
+
+            while (!eof || filled != 0) {
+                if (!eof) {
+                    const std::size_t read = std::fread(buffer.data() + filled, 1, buffer.size() - filled, in);
+                    filled += read;
+                    if (read == 0) eof = true;
+                }
+
+                const char* cursor = buffer.data();
+                const char* const end = buffer.data() + filled;
+                while (cursor < end) {
+                    const char* eol = static_cast<const char*>(std::memchr(cursor, '\n', static_cast<std::size_t>(end - cursor)));
+                    if (!eol) {
+                        if (!eof) break;
+                        eol = end;
+                    }
+                    ++line_number;
+
+                    T* row = ws.input.row_data(rows);
+                    std::size_t columns = 0;
+                    const char* p = cursor;
+                    while (true) {
+                        while (p < eol && is_separator(*p)) ++p;
+                        if (p == eol) break;
+                        T value;
+                        if (*p == '+') ++p;
+                        const std::from_chars_result result = std::from_chars(p, eol, value);
+                        if (result.ec != std::errc() || columns == inputs) {
+                            throw std::invalid_argument("Line " + std::to_string(line_number) + ": expected " + std::to_string(inputs) + " numbers");
+                        }
+                        row[columns++] = value;
+                        p = result.ptr;
+                    }
+
+                    if (columns != 0) {
+                        if (columns != inputs) throw std::invalid_argument("Line " + std::to_string(line_number) + ": expected " + std::to_string(inputs) + " numbers");
+                        if (++rows == ws.batch_size) {
+                            predict(rows);
+                            rows = 0;
+                        }
+                    }
+                    cursor = eol == end ? end : eol + 1;
+                }
+
+                const std::size_t rest = static_cast<std::size_t>(end - cursor);
+                if (rest == buffer.size()) throw std::invalid_argument("Line " + std::to_string(line_number + 1) + " is longer than the read buffer");
+                std::memmove(buffer.data(), cursor, rest);
+                filled = rest;
+                if (eof && rest == 0) break;
+            }
+
+            predict(rows);
+            flush_output();
+        }
+
+        /**
+         * Predicts every sample of a dataset file, which is already binary and needs no parsing
+         */
+        void run(const Dataset<T>& data, std::FILE* output) {
+            if (data.input_count() != ws.topology.input) throw std::invalid_argument("Dataset and network disagree on the number of inputs");
+            sink = output;
+
+            for (std::size_t first = 0; first < data.size(); first += ws.batch_size) {
+                const std::size_t rows = std::min(ws.batch_size, data.size() - first);
+                const math::BasicRowView<const T> inputs = data.inputs(first, rows);
+                std::copy(inputs.begin(), inputs.end(), ws.input.data());
+                predict(rows);
+            }
+            flush_output();
+        }
+    };
+
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * MappedFile.hpp
+ * Thin wrappers over the OS file API: read-only memory mappings, and files that are written
+ * aside and renamed into place. Shared by the dataset and checkpoint formats.
+ */
+namespace nn {
+
+    /**
+     * Read-only memory mapping of a whole file
+     */
+    class MappedFile {
+    private:
+        const unsigned char* ptr = nullptr;
+        std::size_t length = 0;
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#endif
+
+        void release() {
+#ifdef _WIN32
+            if (ptr) UnmapViewOfFile(ptr);
+            if (mapping) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+            mapping = nullptr;
+#else
+            if (ptr) munmap(const_cast<unsigned char*>(ptr), length);
+#endif
+            ptr = nullptr;
+            length = 0;
+        }
+
+    public:
+        MappedFile() = default;
+
+        explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) throw std::invalid_argument("Cannot open file: " + path);
+
+            LARGE_INTEGER size;
+            if (!GetFileSizeEx(file, &size)) {
+                release();
+                throw std::invalid_argument("Cannot read size of file: " + path);
+            }
+            length = static_cast<std::size_t>(size.QuadPart);
+            if (length == 0) return;
+
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) ptr = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (!ptr) {
+                release();
+                throw std::invalid_argument("Cannot map file: " + path);
+            }
+#else
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) throw std::invalid_argument("Cannot open file: " + path);
+
+            struct stat info;
+            if (::fstat(fd, &info) != 0) {
+                ::close(fd);
+                throw std::invalid_argument("Cannot read size of file: " + path);
+            }
+            length = static_cast<std::size_t>(info.st_size);
+            if (length == 0) {
+                ::close(fd);
+                return;
+            }
+
+            void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (mapped == MAP_FAILED) {
+                length = 0;
+                throw std::invalid_argument("Cannot map file: " + path);
+            }
+            ptr = static_cast<const unsigned char*>(mapped);
+#endif
+        }
+
+        ~MappedFile() { release(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+        MappedFile& operator=(MappedFile&& other) noexcept {
+            if (this != &other) {
+                release();
+                std::swap(ptr, other.ptr);
+                std::swap(length, other.length);
+#ifdef _WIN32
+                std::swap(file, other.file);
+                std::swap(mapping, other.mapping);
+#endif
+            }
+            return *this;
+        }
+
+        const unsigned char* data() const { return ptr; }
+        std::size_t size() const { return length; }
+
+        /**
+         * Faults in the pages of [data, data + bytes) ahead of use, so the reader doesn't stall on them.
+         * Works on any memory; for anonymous memory it's just a cheap pass over the pages.
+         */
+        static void Prefetch(const void* data, std::size_t bytes) {
+            if (!data || bytes == 0) return;
+            constexpr std::size_t PAGE = 4096;
+            const auto first = reinterpret_cast<std::uintptr_t>(data);
+#ifndef _WIN32
+            const std::uintptr_t page_begin = first / PAGE * PAGE;
+            ::madvise(reinterpret_cast<void*>(page_begin), first + bytes - page_begin, MADV_WILLNEED);
+#endif
+            const volatile unsigned char* bytes_ptr = static_cast<const volatile unsigned char*>(data);
+            unsigned char sink = 0;
+            for (std::size_t offset = 0; offset < bytes; offset += PAGE - (first + offset) % PAGE) sink ^= bytes_ptr[offset];
+            (void)sink;
+        }
+    };
+
+    /**
+     * Write-only file that replaces its destination atomically on commit():
+     * data goes to path + ".tmp", which is renamed over path once complete, so readers
+     * (and a crash mid-write) never see a half-written file.
+     * commit() flushes the data to disk before the rename and the directory entry after it,
+     * so once it returns the new file survives a power loss too.
+     */
+    class AtomicFileWriter {
+    private:
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+#else
+        int fd = -1;
+#endif
+        const char* final_path = nullptr;
+        const char* temp_path = nullptr;
+
+        void close() {
+#ifdef _WIN32
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+#endif
+        }
+
+        /**
+         * @return error naming what failed on path, and why according to the OS (read before anything else can change it)
+         */
+        static std::runtime_error failure(const char* what, const char* path) {
+#ifdef _WIN32
+            const std::string reason = "error " + std::to_string(GetLastError());
+#else
+            const std::string reason = std::strerror(errno);
+#endif
+            return std::runtime_error(std::string(what) + " " + path + ": " + reason);
+        }
+
+#ifndef _WIN32
+        /**
+         * Flushes the directory holding final_path, which is where the rename is recorded
+         */
+        void sync_directory() const {
+            char directory[PATH_MAX];
+            const char* slash = std::strrchr(final_path, '/');
+            const std::size_t length = slash ? std::max<std::size_t>(slash - final_path, 1) : 1;
+            if (length >= sizeof(directory)) throw std::runtime_error(std::string("Path too long: ") + final_path);
+            if (slash) std::memcpy(directory, final_path, length);
+            else directory[0] = '.';
+            directory[length] = '\0';
+
+            const int dir = ::open(directory, O_RDONLY | O_DIRECTORY);
+            if (dir < 0) throw failure("Cannot open directory", directory);
+            int result;
+            while ((result = ::fsync(dir)) != 0 && errno == EINTR) {}
+            // some file systems can't sync a directory, and sync every rename anyway
+            if (result != 0 && errno != EINVAL && errno != ENOTSUP) {
+                const std::runtime_error error = failure("Cannot flush directory", directory);
+                ::close(dir);
+                throw error;
+            }
+            ::close(dir);
+        }
+#endif
+
+    public:
+        /**
+         * @param path destination, @param temp path to write to first; both must outlive the writer
+         */
+        AtomicFileWriter(const char* path, const char* temp) : final_path(path), temp_path(temp) {
+#ifdef _WIN32
+            file = CreateFileA(temp_path, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE) throw failure("Cannot create", temp_path);
+#else
+            fd = ::open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) throw failure("Cannot create", temp_path);
+#endif
+        }
+
+        ~AtomicFileWriter() {
+            const bool abandoned =
+#ifdef _WIN32
+                file != INVALID_HANDLE_VALUE;
+#else
+                fd >= 0;
+#endif
+            close();
+            if (abandoned) std::remove(temp_path);
+        }
+
+        AtomicFileWriter(const AtomicFileWriter&) = delete;
+        AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+        void write(const void* data, std::size_t bytes) {
+            const unsigned char* cursor = static_cast<const unsigned char*>(data);
+            while (bytes > 0) {
+#ifdef _WIN32
+                DWORD written = 0;
+                const DWORD chunk = static_cast<DWORD>(std::min<std::size_t>(bytes, 1u << 30));
+                if (!WriteFile(file, cursor, chunk, &written, nullptr) || written == 0) throw failure("Cannot write", temp_path);
+#else
+                const ssize_t written = ::write(fd, cursor, bytes);
+                if (written < 0 && errno == EINTR) continue;
+                if (written == 0) errno = EIO;
+                if (written <= 0) throw failure("Cannot write", temp_path);
+#endif
+                cursor += written;
+                bytes -= static_cast<std::size_t>(written);
+            }
+        }
+
+        /**
+         * Flushes the file to disk, closes it, moves it over the destination and flushes that move
+         */
+        void commit() {
+#ifdef _WIN32
+            if (!FlushFileBuffers(file)) throw failure("Cannot flush", temp_path);
+            close();
+            // write-through: returns once the rename itself is on disk
+            if (!MoveFileExA(temp_path, final_path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) throw failure("Cannot replace", final_path);
+#else
+            int result;
+            while ((result = ::fsync(fd)) != 0 && errno == EINTR) {}
+            if (result != 0) throw failure("Cannot flush", temp_path);
+            close();
+            if (std::rename(temp_path, final_path) != 0) throw failure("Cannot replace", final_path);
+            sync_directory();
+#endif
+        }
+    };
+
+}
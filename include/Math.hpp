@@ -3,9 +3,16 @@
 #include <vector>
 #include <stdexcept>
 #include <algorithm>
-#include <execution>
-#include <numeric>
 #include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <string_view>
+#include <type_traits>
+
+#include "Simd.hpp"
+#include "ThreadPool.hpp"
 
 /**
  * Math.hpp
@@ -15,166 +22,1278 @@
  */
 namespace math {
 
+#pragma region matrix
+
+    /**
+     * Minimal allocator that hands out storage aligned to Alignment bytes,
+     * so every Matrix buffer starts on a cache line / SIMD register boundary.
+     */
+    template <typename T, std::size_t Alignment = 64>
+    struct AlignedAllocator {
+        using value_type = T;
+
+        template <typename U>
+        struct rebind { using other = AlignedAllocator<U, Alignment>; };
+
+        AlignedAllocator() noexcept = default;
+
+        template <typename U>
+        AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+        T* allocate(std::size_t n) {
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+        }
+
+        void deallocate(T* p, std::size_t) noexcept {
+            ::operator delete(p, std::align_val_t(Alignment));
+        }
+
+        template <typename U>
+        bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+        template <typename U>
+        bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+    };
+
+    constexpr std::size_t MATRIX_ALIGNMENT = 64;
+
+    /**
+     * identity_t<X> is X, but keeps X out of template argument deduction,
+     * so e.g. a std::vector<T> still converts to the view parameter of a function deduced from its matrix
+     */
+    template <typename T>
+    struct identity { using type = T; };
+
+    template <typename T>
+    using identity_t = typename identity<T>::type;
+
+    /**
+     * Accumulator type of a reduction over T: Acc if given, T itself for void.
+     * Mixed precision keeps float data and passes Acc = double.
+     */
+    template <typename Acc, typename T>
+    using accumulator_t = std::conditional_t<std::is_void_v<Acc>, T, Acc>;
+
+    template <typename T>
+    using aligned_vector = std::vector<T, AlignedAllocator<T, MATRIX_ALIGNMENT>>;
+
+    /**
+     * Non-owning view over a contiguous run of elements (a matrix row or a plain vector).
+     * Ptr is a scalar type (double, float) or its const version.
+     */
+    template <typename Ptr>
+    class BasicRowView {
+    private:
+        Ptr* ptr = nullptr;
+        std::size_t count = 0;
+
+    public:
+        BasicRowView() = default;
+        BasicRowView(Ptr* data, std::size_t size) : ptr(data), count(size) {}
+
+        template <typename Other, typename = std::enable_if_t<std::is_convertible_v<Other*, Ptr*>>>
+        BasicRowView(const BasicRowView<Other>& other) : ptr(other.data()), count(other.size()) {}
+
+        template <typename Alloc>
+        BasicRowView(std::vector<std::remove_const_t<Ptr>, Alloc>& vec) : ptr(vec.data()), count(vec.size()) {}
+
+        template <typename Alloc, typename P = Ptr, typename = std::enable_if_t<std::is_const_v<P>>>
+        BasicRowView(const std::vector<std::remove_const_t<Ptr>, Alloc>& vec) : ptr(vec.data()), count(vec.size()) {}
+
+        Ptr* data() const { return ptr; }
+        std::size_t size() const { return count; }
+        Ptr* begin() const { return ptr; }
+        Ptr* end() const { return ptr + count; }
+        Ptr& operator[](std::size_t i) const { return ptr[i]; }
+    };
+
+    /**
+     * Non-owning view over a matrix column: count elements spaced stride apart.
+     */
+    template <typename Ptr>
+    class BasicColumnView {
+    private:
+        Ptr* ptr = nullptr;
+        std::size_t count = 0;
+        std::size_t step = 0;
+
+    public:
+        BasicColumnView() = default;
+        BasicColumnView(Ptr* data, std::size_t size, std::size_t stride) : ptr(data), count(size), step(stride) {}
+
+        Ptr* data() const { return ptr; }
+        std::size_t size() const { return count; }
+        std::size_t stride() const { return step; }
+        Ptr& operator[](std::size_t i) const { return ptr[i * step]; }
+    };
+
+    using RowView = BasicRowView<double>;
+    using ConstRowView = BasicRowView<const double>;
+    using ColumnView = BasicColumnView<double>;
+    using ConstColumnView = BasicColumnView<const double>;
+    using RowViewF = BasicRowView<float>;
+    using ConstRowViewF = BasicRowView<const float>;
+
+    namespace expr {
+        enum class Assign { Set, Add, Sub };
+
+        template <Assign Mode, typename T, typename E>
+        void evaluate(T* dst, const E& e);
+    }
+
+    /**
+     * CRTP base of the lazy arithmetic expressions, see the expressions region
+     */
+    template <typename E>
+    struct Expression {
+        const E& self() const { return static_cast<const E&>(*this); }
+
+        // lets std::vector<double> v = a + b; keep working
+        template <typename U, typename Alloc, typename V = E, std::enable_if_t<std::is_same_v<U, typename V::value_type>, int> = 0>
+        operator std::vector<U, Alloc>() const {
+            std::vector<U, Alloc> res(self().size());
+            expr::evaluate<expr::Assign::Set>(res.data(), self());
+            return res;
+        }
+    };
+
+    /**
+     * Dense row-major matrix stored in a single aligned buffer.
+     * Element (i, j) lives at data()[i * stride() + j]; rows are stored back to back,
+     * so the whole matrix can be streamed linearly.
+     */
+    template <typename T>
+    class BasicMatrix {
+    private:
+        std::size_t row_count = 0;
+        std::size_t col_count = 0;
+        std::size_t row_stride = 0;
+        aligned_vector<T> buffer;
+
+    public:
+        using value_type = T;
+
+        BasicMatrix() = default;
+
+        BasicMatrix(std::size_t rows, std::size_t cols, T value = T(0))
+            : row_count(rows), col_count(cols), row_stride(cols), buffer(rows * cols, value) {}
+
+        // evaluate a lazy expression in a single pass, see the expressions region
+        template <typename E>
+        BasicMatrix(const Expression<E>& e);
+
+        template <typename E>
+        BasicMatrix& operator=(const Expression<E>& e);
+
+        template <typename E>
+        BasicMatrix& operator+=(const Expression<E>& e);
+
+        template <typename E>
+        BasicMatrix& operator-=(const Expression<E>& e);
+
+        BasicMatrix& operator+=(const BasicMatrix& other);
+        BasicMatrix& operator-=(const BasicMatrix& other);
+
+        std::size_t rows() const { return row_count; }
+        std::size_t cols() const { return col_count; }
+        std::size_t stride() const { return row_stride; }
+        std::size_t size() const { return buffer.size(); }
+        bool empty() const { return buffer.empty(); }
+
+        bool same_shape(const BasicMatrix& other) const {
+            return row_count == other.row_count && col_count == other.col_count;
+        }
+
+        T* data() { return buffer.data(); }
+        const T* data() const { return buffer.data(); }
+
+        T* begin() { return buffer.data(); }
+        T* end() { return buffer.data() + buffer.size(); }
+        const T* begin() const { return buffer.data(); }
+        const T* end() const { return buffer.data() + buffer.size(); }
+
+        T* row_data(std::size_t i) { return buffer.data() + i * row_stride; }
+        const T* row_data(std::size_t i) const { return buffer.data() + i * row_stride; }
+
+        T& operator()(std::size_t i, std::size_t j) { return buffer[i * row_stride + j]; }
+        T operator()(std::size_t i, std::size_t j) const { return buffer[i * row_stride + j]; }
+
+        BasicRowView<T> operator[](std::size_t i) { return row(i); }
+        BasicRowView<const T> operator[](std::size_t i) const { return row(i); }
+
+        BasicRowView<T> row(std::size_t i) { return BasicRowView<T>(row_data(i), col_count); }
+        BasicRowView<const T> row(std::size_t i) const { return BasicRowView<const T>(row_data(i), col_count); }
+
+        BasicColumnView<T> col(std::size_t j) { return BasicColumnView<T>(buffer.data() + j, row_count, row_stride); }
+        BasicColumnView<const T> col(std::size_t j) const { return BasicColumnView<const T>(buffer.data() + j, row_count, row_stride); }
+
+        // all elements as one row, for element-wise operations
+        BasicRowView<T> flat() { return BasicRowView<T>(buffer.data(), buffer.size()); }
+        BasicRowView<const T> flat() const { return BasicRowView<const T>(buffer.data(), buffer.size()); }
+
+        void fill(T value) { std::fill(buffer.begin(), buffer.end(), value); }
+    };
+
+    using Matrix = BasicMatrix<double>;
+    using MatrixF = BasicMatrix<float>;
+
+    /**
+     * Non-owning view over a row-major matrix, laid out like BasicMatrix.
+     * Lets gemm read operands that live outside a BasicMatrix, e.g. in a memory-mapped file.
+     */
+    template <typename Ptr>
+    class BasicMatrixView {
+    private:
+        Ptr* ptr = nullptr;
+        std::size_t row_count = 0;
+        std::size_t col_count = 0;
+        std::size_t row_stride = 0;
+
+    public:
+        BasicMatrixView() = default;
+        BasicMatrixView(Ptr* data, std::size_t rows, std::size_t cols) : ptr(data), row_count(rows), col_count(cols), row_stride(cols) {}
+        BasicMatrixView(Ptr* data, std::size_t rows, std::size_t cols, std::size_t stride) : ptr(data), row_count(rows), col_count(cols), row_stride(stride) {}
+
+        BasicMatrixView(BasicMatrix<std::remove_const_t<Ptr>>& m) : ptr(m.data()), row_count(m.rows()), col_count(m.cols()), row_stride(m.stride()) {}
+
+        template <typename P = Ptr, typename = std::enable_if_t<std::is_const_v<P>>>
+        BasicMatrixView(const BasicMatrix<std::remove_const_t<Ptr>>& m) : ptr(m.data()), row_count(m.rows()), col_count(m.cols()), row_stride(m.stride()) {}
+
+        std::size_t rows() const { return row_count; }
+        std::size_t cols() const { return col_count; }
+        std::size_t stride() const { return row_stride; }
+
+        Ptr* data() const { return ptr; }
+        Ptr* row_data(std::size_t i) const { return ptr + i * row_stride; }
+        Ptr& operator()(std::size_t i, std::size_t j) const { return ptr[i * row_stride + j]; }
+
+        BasicRowView<Ptr> operator[](std::size_t i) const { return row(i); }
+        BasicRowView<Ptr> row(std::size_t i) const { return BasicRowView<Ptr>(row_data(i), col_count); }
+    };
+
+    using MatrixView = BasicMatrixView<double>;
+    using ConstMatrixView = BasicMatrixView<const double>;
+    using MatrixViewF = BasicMatrixView<float>;
+    using ConstMatrixViewF = BasicMatrixView<const float>;
+
+#pragma endregion
+#pragma region execution
+
+    /**
+     * How an operator runs: a plain scalar loop, the SIMD kernels on one thread,
+     * or the SIMD kernels split across the global ThreadPool
+     */
+    enum class Execution { Serial, Simd, Parallel };
+
+    /**
+     * Operand sizes (in elements, or multiply-adds for gemm) at which operators move
+     * from one execution mode to the next. Tune them per machine.
+     */
+    struct ExecutionThresholds {
+        std::size_t simd = 16;
+        std::size_t parallel = std::size_t(1) << 17;
+        std::size_t grain = std::size_t(1) << 15;
+        std::size_t gemm_parallel = std::size_t(1) << 22;
+    };
+
+    inline ExecutionThresholds execution_thresholds;
+
+    inline Execution execution_for(std::size_t work) {
+        if (work >= execution_thresholds.parallel) return Execution::Parallel;
+        if (work >= execution_thresholds.simd) return Execution::Simd;
+        return Execution::Serial;
+    }
+
+    /**
+     * Raw-pointer kernels that pick their execution mode from the operand size.
+     * All operators below are built on these.
+     */
+    namespace dispatch {
+
+        /**
+         * Runs body(kernels, begin, end) over [0, n), where each item costs work_per_item elements
+         */
+        template <typename T = double, typename Body>
+        inline void for_each_chunk(std::size_t n, std::size_t work_per_item, Body&& body) {
+            work_per_item = std::max<std::size_t>(work_per_item, 1);
+            switch (execution_for(n * work_per_item)) {
+            case Execution::Serial:
+                body(simd::kernels_for<T>(simd::Isa::Scalar), 0, n);
+                break;
+            case Execution::Simd:
+                body(simd::kernels<T>(), 0, n);
+                break;
+            case Execution::Parallel: {
+                const simd::BasicKernels<T>& k = simd::kernels<T>();
+                const std::size_t grain = std::max<std::size_t>(1, execution_thresholds.grain / work_per_item);
+                ThreadPool::Global().ParallelFor(0, n, grain, [&](std::size_t begin, std::size_t end) { body(k, begin, end); });
+                break;
+            }
+            }
+        }
+
+        template <typename T>
+        inline void add(const T* a, const T* b, T* out, std::size_t n) {
+            for_each_chunk<T>(n, 1, [=](const simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) { k.add(a + begin, b + begin, out + begin, end - begin); });
+        }
+
+        template <typename T>
+        inline void sub(const T* a, const T* b, T* out, std::size_t n) {
+            for_each_chunk<T>(n, 1, [=](const simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) { k.sub(a + begin, b + begin, out + begin, end - begin); });
+        }
+
+        template <typename T>
+        inline void scale(const T* x, identity_t<T> alpha, T* out, std::size_t n) {
+            for_each_chunk<T>(n, 1, [=](const simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) { k.scale(x + begin, alpha, out + begin, end - begin); });
+        }
+
+        template <typename T>
+        inline void axpy(identity_t<T> alpha, const T* x, T* y, std::size_t n) {
+            for_each_chunk<T>(n, 1, [=](const simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) { k.axpy(alpha, x + begin, y + begin, end - begin); });
+        }
+
+        template <typename T>
+        inline void mul_add(const T* a, const T* b, T* y, std::size_t n) {
+            for_each_chunk<T>(n, 1, [=](const simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) { k.mul_add(a + begin, b + begin, y + begin, end - begin); });
+        }
+
+        template <typename T>
+        inline void sgd_step(T* w, const T* g, std::size_t n, const simd::UpdateStep<T>& step) {
+            for_each_chunk<T>(n, 1, [=, &step](const simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) { k.sgd_step(w + begin, g + begin, end - begin, step); });
+        }
+
+        template <typename T>
+        inline void momentum_step(T* w, const T* g, T* v, std::size_t n, const simd::UpdateStep<T>& step) {
+            for_each_chunk<T>(n, 1, [=, &step](const simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) { k.momentum_step(w + begin, g + begin, v + begin, end - begin, step); });
+        }
+
+        template <typename T>
+        inline void adam_step(T* w, const T* g, T* m, T* v, std::size_t n, const simd::UpdateStep<T>& step) {
+            for_each_chunk<T>(n, 1, [=, &step](const simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) { k.adam_step(w + begin, g + begin, m + begin, v + begin, end - begin, step); });
+        }
+
+        template <typename T>
+        inline void gemv(const T* a, std::size_t rows, std::size_t cols, std::size_t stride, const T* x, T* y) {
+            for_each_chunk<T>(rows, cols, [=](const simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) { k.gemv(a + begin * stride, end - begin, cols, stride, x, y + begin); });
+        }
+
+        /**
+         * Sum of a[i] * b[i], accumulated in accumulator_t<Acc, T> (dot_wide for float data in double).
+         * Parallel dot products are reduced from fixed per-chunk partial sums in chunk order,
+         * so the result doesn't depend on which thread ran which chunk
+         */
+        template <typename Acc = void, typename T>
+        inline accumulator_t<Acc, T> dot(const T* a, const T* b, std::size_t n) {
+            using R = accumulator_t<Acc, T>;
+            static_assert(std::is_same_v<R, T> || std::is_same_v<R, double>, "dot accumulates in the data type or in double");
+            auto run = [](const simd::BasicKernels<T>& k, const T* x, const T* y, std::size_t count) -> R {
+                if constexpr (std::is_same_v<R, T>) return k.dot(x, y, count);
+                else return k.dot_wide(x, y, count);
+            };
+
+            const Execution mode = execution_for(n);
+            if (mode == Execution::Serial) return run(simd::kernels_for<T>(simd::Isa::Scalar), a, b, n);
+            if (mode == Execution::Simd) return run(simd::kernels<T>(), a, b, n);
+
+            constexpr std::size_t MAX_PARTS = 64;
+            const std::size_t parts = std::min(MAX_PARTS, std::max<std::size_t>(1, n / std::max<std::size_t>(1, execution_thresholds.grain)));
+            const std::size_t step = (n + parts - 1) / parts;
+            R partial[MAX_PARTS] = {};
+            const simd::BasicKernels<T>& k = simd::kernels<T>();
+
+            ThreadPool::Global().ParallelFor(0, parts, 1, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t p = begin; p < end; ++p) {
+                    const std::size_t lo = std::min(n, p * step);
+                    const std::size_t hi = std::min(n, lo + step);
+                    partial[p] = run(k, a + lo, b + lo, hi - lo);
+                }
+            });
+
+            R sum = 0;
+            for (std::size_t p = 0; p < parts; ++p) sum += partial[p];
+            return sum;
+        }
+
+    }
+
+#pragma endregion
 #pragma region linear_algebra
 
     const double EPS = 1e-12;
 
-    inline std::vector<double> operator+(const std::vector<double>& vec1, const std::vector<double>& vec2) {
+    template <typename T, typename Alloc>
+    inline T operator*(const std::vector<T, Alloc>& vec1, const std::vector<T, Alloc>& vec2) {
         if (vec1.size() != vec2.size()) throw std::invalid_argument("Vectors must have the same size");
+        return dispatch::dot(vec1.data(), vec2.data(), vec1.size());
+    }
 
-        std::vector<double> res(vec1.size());
-        std::transform(
-            std::execution::par_unseq, 
-            vec1.begin(), vec1.end(), 
-            vec2.begin(), res.begin(), 
-            [](double a, double b) { return a + b; }
-        );
-        
-        return res;
+    inline double operator*(ConstRowView vec1, ConstRowView vec2) {
+        if (vec1.size() != vec2.size()) throw std::invalid_argument("Vectors must have the same size");
+        return dispatch::dot(vec1.data(), vec2.data(), vec1.size());
     }
 
-    inline std::vector<double> operator-(const std::vector<double>& vec1, const std::vector<double>& vec2) {
+    inline float operator*(ConstRowViewF vec1, ConstRowViewF vec2) {
         if (vec1.size() != vec2.size()) throw std::invalid_argument("Vectors must have the same size");
+        return dispatch::dot(vec1.data(), vec2.data(), vec1.size());
+    }
 
-        std::vector<double> res(vec1.size());
-        std::transform(
-            std::execution::par_unseq, 
-            vec1.begin(), vec1.end(), 
-            vec2.begin(), res.begin(), 
-            [](double a, double b) { return a - b; }
-        );
+    /**
+     * vec1 * vec2 accumulated in Acc, e.g. dot<double>(a, b) on float data
+     */
+    template <typename Acc>
+    inline Acc dot(ConstRowView vec1, ConstRowView vec2) {
+        if (vec1.size() != vec2.size()) throw std::invalid_argument("Vectors must have the same size");
+        return dispatch::dot<Acc>(vec1.data(), vec2.data(), vec1.size());
+    }
 
-        return res;
+    template <typename Acc>
+    inline Acc dot(ConstRowViewF vec1, ConstRowViewF vec2) {
+        if (vec1.size() != vec2.size()) throw std::invalid_argument("Vectors must have the same size");
+        return dispatch::dot<Acc>(vec1.data(), vec2.data(), vec1.size());
     }
 
-    inline std::vector<double> operator*(const std::vector<double>& vec, const double& num) {
-        std::vector<double> res(vec.size());
-        std::transform(
-            std::execution::par_unseq,
-            vec.begin(), vec.end(), 
-            res.begin(), [num](double a) { return a * num; }
-        );
-        
+    template <typename T, typename Alloc>
+    inline std::vector<T> operator*(const BasicMatrix<T>& mtx, const std::vector<T, Alloc>& vec) {
+        if (mtx.cols() != vec.size()) throw std::invalid_argument("Matrix row and vector must have the same size");
+
+        std::vector<T> res(mtx.rows());
+        dispatch::gemv(mtx.data(), mtx.rows(), mtx.cols(), mtx.stride(), vec.data(), res.data());
+
         return res;
     }
 
-    inline double operator*(const std::vector<double>& vec1, const std::vector<double>& vec2) {
-        if (vec1.size() != vec2.size()) throw std::invalid_argument("Vectors must have the same size");
-        return std::inner_product(vec1.begin(), vec1.end(), vec2.begin(), 0.0);
+    /**
+     * out = mtx * vec, written into a preallocated buffer
+     */
+    template <typename T>
+    inline void gemv_into(const BasicMatrix<T>& mtx, identity_t<BasicRowView<const T>> vec, identity_t<BasicRowView<T>> out) {
+        if (mtx.cols() != vec.size()) throw std::invalid_argument("Matrix row and vector must have the same size");
+        if (mtx.rows() != out.size()) throw std::invalid_argument("Output must have one element per matrix row");
+
+        dispatch::gemv(mtx.data(), mtx.rows(), mtx.cols(), mtx.stride(), vec.data(), out.data());
     }
 
-    inline std::vector<std::vector<double>> operator+(const std::vector<std::vector<double>>& mtx1, const std::vector<std::vector<double>>& mtx2) {
-        if (mtx1.size() != mtx2.size()) throw std::invalid_argument("Matrixs must have the same size");
+    /**
+     * y += a * x, in place
+     */
+    inline void axpy(double a, ConstRowView x, RowView y) {
+        if (x.size() != y.size()) throw std::invalid_argument("Vectors must have the same size");
+        dispatch::axpy(a, x.data(), y.data(), x.size());
+    }
 
-        std::vector<std::vector<double>> res(mtx1.size(), std::vector<double>(mtx1[0].size()));
-        std::transform(
-            std::execution::par_unseq, 
-            mtx1.begin(), mtx1.end(), 
-            mtx2.begin(), res.begin(), 
-            [](const std::vector<double>& a, const std::vector<double>& b) { return a + b; }
-        );
+    inline void axpy(float a, ConstRowViewF x, RowViewF y) {
+        if (x.size() != y.size()) throw std::invalid_argument("Vectors must have the same size");
+        dispatch::axpy(a, x.data(), y.data(), x.size());
+    }
 
-        return res;
+    /**
+     * y += a * b element-wise, in place
+     */
+    template <typename T>
+    inline void mul_add(identity_t<BasicRowView<const T>> a, identity_t<BasicRowView<const T>> b, BasicRowView<T> y) {
+        if (a.size() != y.size() || b.size() != y.size()) throw std::invalid_argument("Vectors must have the same size");
+        dispatch::mul_add(a.data(), b.data(), y.data(), y.size());
     }
 
-    inline std::vector<std::vector<double>> operator-(const std::vector<std::vector<double>>& mtx1, const std::vector<std::vector<double>>& mtx2) {
-        if (mtx1.size() != mtx2.size()) throw std::invalid_argument("Matrixs must have the same size");
+    /**
+     * Adds row to every row of mtx (bias broadcast over a batch)
+     */
+    template <typename T>
+    inline void add_to_rows(BasicMatrix<T>& mtx, identity_t<BasicRowView<const T>> row) {
+        if (mtx.cols() != row.size()) throw std::invalid_argument("Row must have one element per matrix column");
+
+        for (size_t i = 0; i < mtx.rows(); ++i) {
+            T* dst = mtx.row_data(i);
+            for (size_t j = 0; j < mtx.cols(); ++j) dst[j] += row[j];
+        }
+    }
 
-        std::vector<std::vector<double>> res(mtx1.size(), std::vector<double>(mtx1[0].size()));
-        std::transform(
-            std::execution::par_unseq, 
-            mtx1.begin(), mtx1.end(), 
-            mtx2.begin(), res.begin(), 
-            [](const std::vector<double>& a, const std::vector<double>& b) { return a - b; }
-        );
+    /**
+     * out[j] = sum over i of mtx(i, j), accumulated in accumulator_t<Acc, T>
+     */
+    template <typename Acc = void, typename T>
+    inline void column_sums_into(const BasicMatrix<T>& mtx, identity_t<BasicRowView<T>> out) {
+        using R = accumulator_t<Acc, T>;
+        if (mtx.cols() != out.size()) throw std::invalid_argument("Output must have one element per matrix column");
 
-        return res;
+        if constexpr (std::is_same_v<R, T>) {
+            std::fill(out.begin(), out.end(), T(0));
+            for (size_t i = 0; i < mtx.rows(); ++i) {
+                const T* src = mtx.row_data(i);
+                for (size_t j = 0; j < mtx.cols(); ++j) out[j] += src[j];
+            }
+        }
+        else {
+            // wider sums live in a stack block of columns, so this stays allocation-free
+            constexpr std::size_t BLOCK = 256;
+            R sums[BLOCK];
+            for (size_t jb = 0; jb < mtx.cols(); jb += BLOCK) {
+                const size_t count = std::min(BLOCK, mtx.cols() - jb);
+                std::fill(sums, sums + count, R(0));
+                for (size_t i = 0; i < mtx.rows(); ++i) {
+                    const T* src = mtx.row_data(i) + jb;
+                    for (size_t j = 0; j < count; ++j) sums[j] += src[j];
+                }
+                for (size_t j = 0; j < count; ++j) out[jb + j] = static_cast<T>(sums[j]);
+            }
+        }
     }
 
-    inline std::vector<std::vector<double>> operator*(const std::vector<std::vector<double>>& mtx, double num) {
-        std::vector<std::vector<double>> res(mtx.size(), std::vector<double>(mtx[0].size()));
-        std::transform(
-            std::execution::par_unseq,
-            mtx.begin(), mtx.end(),
-            res.begin(),
-            [num](const std::vector<double>& a) { return a * num; }
-        );
+#pragma endregion
+#pragma region expressions
 
-        return res;
+    /**
+     * Element-wise +, - and scalar * on vectors, matrices and row views build lazy expressions
+     * instead of temporaries. Assigning one to a destination (a constructor, =, += or -=)
+     * runs a single fused loop, so e.g. w -= g * lr reads every element once and writes it once.
+     * Expressions only hold pointers to their operands: evaluate them in the same full-expression.
+     * Both operands of an expression must have the same scalar type.
+     */
+    namespace expr {
+
+        struct Plus { template <typename T> static T apply(T a, T b) { return a + b; } };
+        struct Minus { template <typename T> static T apply(T a, T b) { return a - b; } };
+
+        /**
+         * Contiguous operand: a vector (rows x 1) or a whole matrix
+         */
+        template <typename T>
+        struct Leaf : Expression<Leaf<T>> {
+            using value_type = T;
+
+            const T* ptr;
+            std::size_t row_count;
+            std::size_t col_count;
+
+            Leaf(const T* data, std::size_t rows, std::size_t cols) : ptr(data), row_count(rows), col_count(cols) {}
+
+            std::size_t rows() const { return row_count; }
+            std::size_t cols() const { return col_count; }
+            std::size_t size() const { return row_count * col_count; }
+            T operator[](std::size_t i) const { return ptr[i]; }
+        };
+
+        template <typename L, typename R, typename Op>
+        struct Binary : Expression<Binary<L, R, Op>> {
+            static_assert(std::is_same_v<typename L::value_type, typename R::value_type>, "Operands must have the same scalar type");
+            using value_type = typename L::value_type;
+
+            L lhs;
+            R rhs;
+
+            Binary(const L& l, const R& r) : lhs(l), rhs(r) {
+                if (l.rows() != r.rows() || l.cols() != r.cols()) throw std::invalid_argument("Operands must have the same shape");
+            }
+
+            std::size_t rows() const { return lhs.rows(); }
+            std::size_t cols() const { return lhs.cols(); }
+            std::size_t size() const { return lhs.size(); }
+            value_type operator[](std::size_t i) const { return Op::apply(lhs[i], rhs[i]); }
+        };
+
+        template <typename E>
+        struct Scaled : Expression<Scaled<E>> {
+            using value_type = typename E::value_type;
+
+            E inner;
+            value_type scalar;
+
+            Scaled(const E& e, value_type s) : inner(e), scalar(s) {}
+
+            std::size_t rows() const { return inner.rows(); }
+            std::size_t cols() const { return inner.cols(); }
+            std::size_t size() const { return inner.size(); }
+            value_type operator[](std::size_t i) const { return inner[i] * scalar; }
+        };
+
+        template <typename T>
+        struct is_container : std::false_type {};
+        template <typename T, typename Alloc>
+        struct is_container<std::vector<T, Alloc>> : std::is_floating_point<T> {};
+        template <typename T>
+        struct is_container<BasicMatrix<T>> : std::true_type {};
+        template <typename Ptr>
+        struct is_container<BasicRowView<Ptr>> : std::true_type {};
+
+        template <typename T>
+        constexpr bool is_expression_v = std::is_base_of_v<Expression<T>, T>;
+
+        template <typename T>
+        constexpr bool is_operand_v = is_container<T>::value || is_expression_v<T>;
+
+        template <typename A, typename B>
+        using enable_binary = std::enable_if_t<is_operand_v<A> && is_operand_v<B>, int>;
+
+        template <typename A>
+        using enable_unary = std::enable_if_t<is_operand_v<A>, int>;
+
+        template <typename T>
+        inline Leaf<T> wrap(const BasicMatrix<T>& m) { return Leaf<T>(m.data(), m.rows(), m.cols()); }
+
+        template <typename T, typename Alloc>
+        inline Leaf<T> wrap(const std::vector<T, Alloc>& v) { return Leaf<T>(v.data(), v.size(), 1); }
+
+        template <typename Ptr>
+        inline Leaf<std::remove_const_t<Ptr>> wrap(const BasicRowView<Ptr>& v) { return Leaf<std::remove_const_t<Ptr>>(v.data(), v.size(), 1); }
+
+        template <typename E, std::enable_if_t<is_expression_v<E>, int> = 0>
+        inline const E& wrap(const E& e) { return e; }
+
+        template <typename T>
+        using wrapped_t = std::decay_t<decltype(wrap(std::declval<const T&>()))>;
+
+        template <typename T>
+        using scalar_t = typename wrapped_t<T>::value_type;
+
+        /**
+         * dst (op)= e over e.size() contiguous elements.
+         * Shapes that map onto a single kernel (x, x * a, x + y, x - y) go straight to the SIMD kernels;
+         * anything else becomes one fused loop, split across threads for large operands.
+         */
+        template <Assign Mode, typename T, typename E>
+        void evaluate(T* dst, const E& e) {
+            static_assert(std::is_same_v<T, typename E::value_type>, "Destination and expression must have the same scalar type");
+            const std::size_t n = e.size();
+
+            if constexpr (std::is_same_v<E, Leaf<T>>) {
+                if constexpr (Mode == Assign::Set) {
+                    if (dst != e.ptr) std::copy(e.ptr, e.ptr + n, dst);
+                }
+                else dispatch::axpy<T>(Mode == Assign::Add ? T(1) : T(-1), e.ptr, dst, n);
+            }
+            else if constexpr (std::is_same_v<E, Scaled<Leaf<T>>>) {
+                if constexpr (Mode == Assign::Set) dispatch::scale<T>(e.inner.ptr, e.scalar, dst, n);
+                else dispatch::axpy<T>(Mode == Assign::Add ? e.scalar : -e.scalar, e.inner.ptr, dst, n);
+            }
+            else if constexpr (Mode == Assign::Set && std::is_same_v<E, Binary<Leaf<T>, Leaf<T>, Plus>>) {
+                dispatch::add<T>(e.lhs.ptr, e.rhs.ptr, dst, n);
+            }
+            else if constexpr (Mode == Assign::Set && std::is_same_v<E, Binary<Leaf<T>, Leaf<T>, Minus>>) {
+                dispatch::sub<T>(e.lhs.ptr, e.rhs.ptr, dst, n);
+            }
+            else {
+                dispatch::for_each_chunk<T>(n, 1, [&](const simd::BasicKernels<T>&, std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i) {
+                        if constexpr (Mode == Assign::Set) dst[i] = e[i];
+                        else if constexpr (Mode == Assign::Add) dst[i] += e[i];
+                        else dst[i] -= e[i];
+                    }
+                });
+            }
+        }
+
+        template <Assign Mode, typename T, typename E>
+        inline void evaluate_checked(T* dst, std::size_t size, const E& e) {
+            if (size != e.size()) throw std::invalid_argument("Destination and expression must have the same size");
+            evaluate<Mode>(dst, e);
+        }
+
+    }
+
+    template <typename A, typename B, expr::enable_binary<A, B> = 0>
+    inline auto operator+(const A& a, const B& b) {
+        using namespace expr;
+        return Binary<wrapped_t<A>, wrapped_t<B>, Plus>(wrap(a), wrap(b));
+    }
+
+    template <typename A, typename B, expr::enable_binary<A, B> = 0>
+    inline auto operator-(const A& a, const B& b) {
+        using namespace expr;
+        return Binary<wrapped_t<A>, wrapped_t<B>, Minus>(wrap(a), wrap(b));
+    }
+
+    // the factor converts to the operand's scalar type, so matrix_f * 0.5 stays float
+    template <typename A, expr::enable_unary<A> = 0>
+    inline auto operator*(const A& a, double num) {
+        using namespace expr;
+        using T = scalar_t<A>;
+        if constexpr (std::is_same_v<wrapped_t<A>, Scaled<Leaf<T>>>) return Scaled<Leaf<T>>(wrap(a).inner, wrap(a).scalar * T(num));
+        else return Scaled<wrapped_t<A>>(wrap(a), T(num));
+    }
+
+    template <typename A, expr::enable_unary<A> = 0>
+    inline auto operator*(double num, const A& a) {
+        return a * num;
     }
 
-    inline std::vector<double> operator*(const std::vector<std::vector<double>>& mtx, const std::vector<double>& vec) {
-        if (mtx[0].size() != vec.size()) throw std::invalid_argument("Matrix row and vector must have the same size");
-        size_t size = mtx.size();
+    /**
+     * Evaluates an expression into an existing vector, reusing its storage when the size matches
+     */
+    template <typename T, typename Alloc, typename E>
+    inline std::vector<T, Alloc>& assign(std::vector<T, Alloc>& dst, const Expression<E>& e) {
+        if (dst.size() != e.self().size()) dst.resize(e.self().size());
+        expr::evaluate<expr::Assign::Set>(dst.data(), e.self());
+        return dst;
+    }
+
+    template <typename T, typename Alloc, typename B, std::enable_if_t<expr::is_operand_v<B>, int> = 0>
+    inline std::vector<T, Alloc>& operator+=(std::vector<T, Alloc>& dst, const B& b) {
+        expr::evaluate_checked<expr::Assign::Add>(dst.data(), dst.size(), expr::wrap(b));
+        return dst;
+    }
+
+    template <typename T, typename Alloc, typename B, std::enable_if_t<expr::is_operand_v<B>, int> = 0>
+    inline std::vector<T, Alloc>& operator-=(std::vector<T, Alloc>& dst, const B& b) {
+        expr::evaluate_checked<expr::Assign::Sub>(dst.data(), dst.size(), expr::wrap(b));
+        return dst;
+    }
 
-        std::vector<double> res(size);
-        for (size_t i = 0; i < size; ++i) {
-            res[i] = std::inner_product(mtx[i].begin(), mtx[i].end(), vec.begin(), 0.0);
+    template <typename T, typename B, std::enable_if_t<!std::is_const_v<T> && expr::is_operand_v<B>, int> = 0>
+    inline BasicRowView<T> operator+=(BasicRowView<T> dst, const B& b) {
+        expr::evaluate_checked<expr::Assign::Add>(dst.data(), dst.size(), expr::wrap(b));
+        return dst;
+    }
+
+    template <typename T, typename B, std::enable_if_t<!std::is_const_v<T> && expr::is_operand_v<B>, int> = 0>
+    inline BasicRowView<T> operator-=(BasicRowView<T> dst, const B& b) {
+        expr::evaluate_checked<expr::Assign::Sub>(dst.data(), dst.size(), expr::wrap(b));
+        return dst;
+    }
+
+    template <typename T>
+    template <typename E>
+    inline BasicMatrix<T>::BasicMatrix(const Expression<E>& e)
+        : row_count(e.self().rows()), col_count(e.self().cols()), row_stride(e.self().cols()), buffer(e.self().size()) {
+        expr::evaluate<expr::Assign::Set>(buffer.data(), e.self());
+    }
+
+    template <typename T>
+    template <typename E>
+    inline BasicMatrix<T>& BasicMatrix<T>::operator=(const Expression<E>& e) {
+        const E& x = e.self();
+        if (x.rows() != row_count || x.cols() != col_count) {
+            // evaluate first, the expression may read from this matrix
+            return *this = BasicMatrix(e);
         }
+        expr::evaluate<expr::Assign::Set>(buffer.data(), x);
+        return *this;
+    }
 
-        return res;
+    template <typename T>
+    template <typename E>
+    inline BasicMatrix<T>& BasicMatrix<T>::operator+=(const Expression<E>& e) {
+        expr::evaluate_checked<expr::Assign::Add>(buffer.data(), buffer.size(), e.self());
+        return *this;
+    }
+
+    template <typename T>
+    template <typename E>
+    inline BasicMatrix<T>& BasicMatrix<T>::operator-=(const Expression<E>& e) {
+        expr::evaluate_checked<expr::Assign::Sub>(buffer.data(), buffer.size(), e.self());
+        return *this;
+    }
+
+    template <typename T>
+    inline BasicMatrix<T>& BasicMatrix<T>::operator+=(const BasicMatrix& other) {
+        return *this += expr::wrap(other);
+    }
+
+    template <typename T>
+    inline BasicMatrix<T>& BasicMatrix<T>::operator-=(const BasicMatrix& other) {
+        return *this -= expr::wrap(other);
+    }
+
+#pragma endregion
+#pragma region gemm
+
+    enum class Transpose { No, Yes };
+
+    /**
+     * Cache blocking of gemm: a kc x nc panel of B is packed to stay in L2/L3,
+     * an mc x kc panel of A is packed to stay in L1/L2.
+     */
+    struct GemmBlocking {
+        std::size_t mc = 96;
+        std::size_t kc = 256;
+        std::size_t nc = 2048;
+    };
+
+    inline GemmBlocking gemm_blocking;
+
+    namespace detail {
+
+        using simd::GEMM_MR;
+        using simd::GEMM_NR;
+
+        /**
+         * Packs rows [ic, ic + mc) and columns [pc, pc + kc) of op(A) into GEMM_MR-row strips,
+         * each stored k-major so the micro-kernel reads it sequentially. Edges are zero-padded.
+         */
+        template <typename T>
+        inline void gemm_pack_a(BasicMatrixView<const T> a, Transpose ta, size_t ic, size_t pc, size_t mc, size_t kc, T* dst) {
+            for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+                const size_t mr = std::min(GEMM_MR, mc - ir);
+                for (size_t k = 0; k < kc; ++k) {
+                    for (size_t r = 0; r < GEMM_MR; ++r) {
+                        if (r >= mr) *dst++ = T(0);
+                        else if (ta == Transpose::No) *dst++ = a(ic + ir + r, pc + k);
+                        else *dst++ = a(pc + k, ic + ir + r);
+                    }
+                }
+            }
+        }
+
+        /**
+         * Packs rows [pc, pc + kc) and columns [jc, jc + nc) of op(B) into GEMM_NR-column strips.
+         */
+        template <typename T>
+        inline void gemm_pack_b(BasicMatrixView<const T> b, Transpose tb, size_t pc, size_t jc, size_t kc, size_t nc, T* dst) {
+            for (size_t jr = 0; jr < nc; jr += GEMM_NR) {
+                const size_t nr = std::min(GEMM_NR, nc - jr);
+                for (size_t k = 0; k < kc; ++k) {
+                    for (size_t c = 0; c < GEMM_NR; ++c) {
+                        if (c >= nr) *dst++ = T(0);
+                        else if (tb == Transpose::No) *dst++ = b(pc + k, jc + jr + c);
+                        else *dst++ = b(jc + jr + c, pc + k);
+                    }
+                }
+            }
+        }
+
+        template <typename T>
+        inline void gemm_grow(aligned_vector<T>& buffer, size_t size) {
+            if (buffer.size() < size) buffer.resize(size);
+        }
+
+        /**
+         * Packing buffers of the calling thread
+         */
+        template <typename T>
+        struct GemmPacks {
+            aligned_vector<T> a;
+            aligned_vector<T> b;
+        };
+
+        template <typename T>
+        inline GemmPacks<T>& gemm_packs() {
+            thread_local GemmPacks<T> packs;
+            return packs;
+        }
+
+    }
+
+    /**
+     * Grows the calling thread's gemm packing buffers to the current GemmBlocking,
+     * so its first gemm of T doesn't allocate
+     */
+    template <typename T>
+    inline void gemm_reserve() {
+        detail::GemmPacks<T>& packs = detail::gemm_packs<T>();
+        const size_t mc_max = std::max(simd::GEMM_MR, gemm_blocking.mc / simd::GEMM_MR * simd::GEMM_MR);
+        const size_t kc_max = std::max<size_t>(1, gemm_blocking.kc);
+        const size_t nc_max = std::max(simd::GEMM_NR, gemm_blocking.nc / simd::GEMM_NR * simd::GEMM_NR);
+        detail::gemm_grow(packs.a, mc_max * kc_max);
+        detail::gemm_grow(packs.b, kc_max * nc_max);
+    }
+
+    /**
+     * C = alpha * op(A) * op(B) + beta * C
+     * Blocked for cache (see GemmBlocking) with packed panels and a register-tiled micro-kernel.
+     * Large products split their row blocks across the ThreadPool.
+     * Packing buffers are kept per thread and only grow, so repeated calls don't allocate.
+     */
+    template <typename T>
+    inline void gemm(Transpose ta, Transpose tb, identity_t<T> alpha, identity_t<BasicMatrixView<const T>> a, identity_t<BasicMatrixView<const T>> b, identity_t<T> beta, BasicMatrix<T>& c) {
+        using namespace detail;
+
+        const size_t m = ta == Transpose::No ? a.rows() : a.cols();
+        const size_t k = ta == Transpose::No ? a.cols() : a.rows();
+        const size_t kb = tb == Transpose::No ? b.rows() : b.cols();
+        const size_t n = tb == Transpose::No ? b.cols() : b.rows();
+
+        if (k != kb) throw std::invalid_argument("Inner dimensions of op(A) and op(B) must match");
+        if (c.rows() != m || c.cols() != n) throw std::invalid_argument("C must have shape rows(op(A)) x cols(op(B))");
+
+        if (beta == T(0)) c.fill(T(0));
+        else if (beta != T(1)) for (T& x : c) x *= beta;
+
+        if (k == 0 || alpha == T(0)) return;
+
+        const size_t mc_max = std::max(GEMM_MR, gemm_blocking.mc / GEMM_MR * GEMM_MR);
+        const size_t kc_max = std::max<size_t>(1, gemm_blocking.kc);
+        const size_t nc_max = std::max(GEMM_NR, gemm_blocking.nc / GEMM_NR * GEMM_NR);
+
+        aligned_vector<T>& b_pack = gemm_packs<T>().b;
+        gemm_grow(b_pack, kc_max * nc_max);
+
+        const auto micro_kernel = simd::kernels<T>().gemm_micro;
+        const size_t row_blocks = (m + mc_max - 1) / mc_max;
+        const bool parallel = m * n * k >= execution_thresholds.gemm_parallel && row_blocks > 1;
+
+        for (size_t jc = 0; jc < n; jc += nc_max) {
+            const size_t nc = std::min(nc_max, n - jc);
+            for (size_t pc = 0; pc < k; pc += kc_max) {
+                const size_t kc = std::min(kc_max, k - pc);
+                gemm_pack_b(b, tb, pc, jc, kc, nc, b_pack.data());
+                const T* b_packed = b_pack.data();
+
+                // row blocks of C are independent: each packs its own A panel and writes its own rows
+                auto row_block = [&](size_t block_begin, size_t block_end) {
+                    aligned_vector<T>& a_pack = gemm_packs<T>().a;
+                    gemm_grow(a_pack, mc_max * kc_max);
+                    alignas(64) T tile[GEMM_MR * GEMM_NR];
+
+                    for (size_t block = block_begin; block < block_end; ++block) {
+                        const size_t ic = block * mc_max;
+                        const size_t mc = std::min(mc_max, m - ic);
+                        gemm_pack_a(a, ta, ic, pc, mc, kc, a_pack.data());
+
+                        for (size_t jr = 0; jr < nc; jr += GEMM_NR) {
+                            const size_t nr = std::min(GEMM_NR, nc - jr);
+                            const T* b_panel = b_packed + jr * kc;
+
+                            for (size_t ir = 0; ir < mc; ir += GEMM_MR) {
+                                const size_t mr = std::min(GEMM_MR, mc - ir);
+                                micro_kernel(kc, a_pack.data() + ir * kc, b_panel, tile);
+
+                                for (size_t r = 0; r < mr; ++r) {
+                                    T* dst = c.row_data(ic + ir + r) + jc + jr;
+                                    for (size_t col = 0; col < nr; ++col) dst[col] += alpha * tile[r * GEMM_NR + col];
+                                }
+                            }
+                        }
+                    }
+                };
+
+                if (parallel) ThreadPool::Global().ParallelFor(0, row_blocks, 1, row_block);
+                else row_block(0, row_blocks);
+            }
+        }
     }
 
 #pragma endregion
 #pragma region neural_network
 
-    inline double sigmoid(const double x) {
-        return 1.0 / (1.0 + std::exp(-x));
+    template <typename T>
+    inline T sigmoid(const T x) {
+        return T(1) / (T(1) + std::exp(-x));
     }
 
-    inline double sigmoid_derivative(const double x) {
-        double s = sigmoid(x);
-        return s * (1.0 - s);
+    template <typename T>
+    inline T sigmoid_derivative(const T x) {
+        T s = sigmoid(x);
+        return s * (T(1) - s);
     }
 
-    inline double relu(const double x) {
-        return std::max(0.0, x);
+    template <typename T>
+    inline T relu(const T x) {
+        return std::max(T(0), x);
     }
 
-    inline double relu_derivative(const double x) {
-        return x > 0.0 ? 1.0 : 0.0;
+    template <typename T>
+    inline T relu_derivative(const T x) {
+        return x > T(0) ? T(1) : T(0);
     }
 
-    inline double tanh(const double x) { return std::tanh(x); }
+    template <typename T>
+    inline T tanh(const T x) { return std::tanh(x); }
 
-    inline double tanh_derivative(const double x) {
-        double t = std::tanh(x);
-        return 1.0 - t * t;
+    template <typename T>
+    inline T tanh_derivative(const T x) {
+        T t = std::tanh(x);
+        return T(1) - t * t;
     }
 
-    inline double bce(const double answ, double pred) {
-        pred = std::clamp(pred, EPS, 1.0 - EPS);
-        return -(answ * std::log(pred) + (1.0 - answ) * std::log(1.0 - pred));
+    template <typename T>
+    inline T tanh_derivative_from_output(const T y) { return T(1) - y * y; }
+
+    template <typename T>
+    inline T sigmoid_derivative_from_output(const T s) { return s * (T(1) - s); }
+
+    template <typename T>
+    inline T relu_derivative_from_output(const T y) { return y > T(0) ? T(1) : T(0); }
+
+    template <typename T>
+    inline T bce(const T answ, T pred) {
+        // 1 - EPS rounds to 1 in float, so clamp no closer than the type's epsilon
+        const T eps = std::max(T(EPS), std::numeric_limits<T>::epsilon());
+        pred = std::clamp(pred, eps, T(1) - eps);
+        return -(answ * std::log(pred) + (T(1) - answ) * std::log(T(1) - pred));
     }
 
-    inline double bce_with_logits_loss(const double logit, const double answ) {
-        return std::max(logit, 0.0) - logit * answ + std::log(1 + std::exp(-std::abs(logit)));
+    // floating-point only, so it never competes with the batch overloads taking row views
+    template <typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+    inline T bce_with_logits_loss(const T logit, const T answ) {
+        return std::max(logit, T(0)) - logit * answ + std::log(1 + std::exp(-std::abs(logit)));
     }
 
-    inline double bce_with_logits_loss_delta(const double logit, const double answ) {
+    template <typename T>
+    inline T bce_with_logits_loss_delta(const T logit, const T answ) {
         return sigmoid(logit) - answ;
     }
 
-    inline double bce_delta(const double answ, const double pred) {
+    template <typename T>
+    inline T bce_delta(const T answ, const T pred) {
         return pred - answ;
     }
 
-    inline std::vector<std::vector<double>> weights_gradient(std::vector<double> delt, std::vector<double> inpt) {
-        std::vector<std::vector<double>> res(delt.size(), std::vector<double>(inpt.size()));
+    /**
+     * Outer product delt * inpt^T, written row by row into one contiguous block
+     * @return matrix of shape delt.size() x inpt.size()
+     */
+    template <typename T, typename Alloc>
+    inline BasicMatrix<T> weights_gradient(const std::vector<T, Alloc>& delt, const std::vector<T, Alloc>& inpt) {
+        BasicMatrix<T> res(delt.size(), inpt.size());
 
         for (size_t i = 0; i < delt.size(); ++i) {
+            T* row = res.row_data(i);
+            const T d = delt[i];
             for (size_t j = 0; j < inpt.size(); ++j) {
-                res[i][j] = delt[i] * inpt[j];
+                row[j] = d * inpt[j];
             }
         }
 
         return res;
     }
 
+    /**
+     * acc += delt * inpt^T, the in-place form of weights_gradient used to accumulate over a batch
+     */
+    template <typename T>
+    inline void accumulate_weights_gradient(BasicMatrix<T>& acc, identity_t<BasicRowView<const T>> delt, identity_t<BasicRowView<const T>> inpt) {
+        if (acc.rows() != delt.size() || acc.cols() != inpt.size()) throw std::invalid_argument("Accumulator shape must be delt.size() x inpt.size()");
+
+        for (size_t i = 0; i < delt.size(); ++i) {
+            T* row = acc.row_data(i);
+            const T d = delt[i];
+            for (size_t j = 0; j < inpt.size(); ++j) {
+                row[j] += d * inpt[j];
+            }
+        }
+    }
+
+    /**
+     * Fused optimizer updates of weights w from gradients g, in place (formulas at simd::UpdateStep)
+     */
+    template <typename T>
+    inline void sgd_update(identity_t<BasicRowView<T>> w, identity_t<BasicRowView<const T>> g, const simd::UpdateStep<T>& step) {
+        if (w.size() != g.size()) throw std::invalid_argument("Weights and gradients must have the same size");
+        dispatch::sgd_step(w.data(), g.data(), w.size(), step);
+    }
+
+    template <typename T>
+    inline void momentum_update(identity_t<BasicRowView<T>> w, identity_t<BasicRowView<const T>> g, identity_t<BasicRowView<T>> velocity, const simd::UpdateStep<T>& step) {
+        if (w.size() != g.size() || w.size() != velocity.size()) throw std::invalid_argument("Weights, gradients and velocity must have the same size");
+        dispatch::momentum_step(w.data(), g.data(), velocity.data(), w.size(), step);
+    }
+
+    template <typename T>
+    inline void adam_update(identity_t<BasicRowView<T>> w, identity_t<BasicRowView<const T>> g, identity_t<BasicRowView<T>> first_moment, identity_t<BasicRowView<T>> second_moment, const simd::UpdateStep<T>& step) {
+        if (w.size() != g.size() || w.size() != first_moment.size() || w.size() != second_moment.size()) throw std::invalid_argument("Weights, gradients and moments must have the same size");
+        dispatch::adam_step(w.data(), g.data(), first_moment.data(), second_moment.data(), w.size(), step);
+    }
+
     inline double xavier_limit(const double in, const double out) {
         return std::sqrt(6.0 / (in + out));
     }
 
+#pragma endregion
+#pragma region activations
+
+    /**
+     * Exact evaluates the batch activations with the standard library,
+     * Fast with the polynomial kernels of Simd.hpp (a few ULP off, see the table there)
+     */
+    enum class Approximation { Exact, Fast };
+
+    /**
+     * @return Fast if the MATH_APPROX environment variable is "fast", Exact otherwise
+     */
+    inline Approximation startup_approximation() {
+        const char* env = std::getenv("MATH_APPROX");
+        return env && std::string_view(env) == "fast" ? Approximation::Fast : Approximation::Exact;
+    }
+
+    inline Approximation activation_approximation = startup_approximation();
+
+    namespace detail {
+
+        // rough cost of one transcendental relative to an add, used to pick the execution mode
+        constexpr std::size_t TRANSCENDENTAL_WORK = 16;
+
+        template <typename T, typename Exact, typename Fast>
+        inline void activation(BasicRowView<const T> in, BasicRowView<T> out, Exact exact, Fast fast) {
+            if (in.size() != out.size()) throw std::invalid_argument("Input and output must have the same size");
+            const T* x = in.data();
+            T* y = out.data();
+
+            if (activation_approximation == Approximation::Fast) {
+                dispatch::for_each_chunk<T>(in.size(), TRANSCENDENTAL_WORK, [=](const simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) {
+                    (k.*fast)(x + begin, y + begin, end - begin);
+                });
+            }
+            else {
+                dispatch::for_each_chunk<T>(in.size(), TRANSCENDENTAL_WORK, [=](const simd::BasicKernels<T>&, std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i) y[i] = exact(x[i]);
+                });
+            }
+        }
+
+        template <typename T>
+        inline void exp(BasicRowView<const T> in, BasicRowView<T> out) {
+            activation(in, out, [](T x) { return std::exp(x); }, &simd::BasicKernels<T>::exp_fast);
+        }
+
+        template <typename T>
+        inline void log(BasicRowView<const T> in, BasicRowView<T> out) {
+            activation(in, out, [](T x) { return std::log(x); }, &simd::BasicKernels<T>::log_fast);
+        }
+
+        template <typename T>
+        inline void tanh(BasicRowView<const T> in, BasicRowView<T> out) {
+            activation(in, out, [](T x) { return std::tanh(x); }, &simd::BasicKernels<T>::tanh_fast);
+        }
+
+        template <typename T>
+        inline void sigmoid(BasicRowView<const T> in, BasicRowView<T> out) {
+            activation(in, out, [](T x) { return math::sigmoid(x); }, &simd::BasicKernels<T>::sigmoid_fast);
+        }
+
+        template <typename T>
+        inline void relu(BasicRowView<const T> in, BasicRowView<T> out) {
+            if (in.size() != out.size()) throw std::invalid_argument("Input and output must have the same size");
+            const T* x = in.data();
+            T* y = out.data();
+            dispatch::for_each_chunk<T>(in.size(), 1, [=](const simd::BasicKernels<T>&, std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) y[i] = x[i] > T(0) ? x[i] : T(0);
+            });
+        }
+
+        template <typename T, typename Derivative>
+        inline void backward(BasicRowView<const T> output, BasicRowView<T> delta, Derivative derivative) {
+            if (output.size() != delta.size()) throw std::invalid_argument("Output and delta must have the same size");
+            const T* y = output.data();
+            T* d = delta.data();
+            dispatch::for_each_chunk<T>(output.size(), 2, [=](const simd::BasicKernels<T>&, std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) d[i] *= derivative(y[i]);
+            });
+        }
+
+        template <typename Acc, typename T>
+        inline Acc bce_with_logits_loss(BasicRowView<const T> logits, BasicRowView<const T> targets) {
+            if (logits.size() != targets.size()) throw std::invalid_argument("Logits and targets must have the same size");
+
+            if (activation_approximation == Approximation::Exact) {
+                Acc sum = 0;
+                for (std::size_t i = 0; i < logits.size(); ++i) sum += math::bce_with_logits_loss(logits[i], targets[i]);
+                return sum;
+            }
+
+            constexpr std::size_t CHUNK = 256;
+            alignas(MATRIX_ALIGNMENT) T softplus[CHUNK];
+            const simd::BasicKernels<T>& k = simd::kernels<T>();
+            Acc sum = 0;
+            for (std::size_t begin = 0; begin < logits.size(); begin += CHUNK) {
+                const std::size_t n = std::min(CHUNK, logits.size() - begin);
+                for (std::size_t i = 0; i < n; ++i) softplus[i] = -std::abs(logits[begin + i]);
+                k.exp_fast(softplus, softplus, n);
+                k.log1p_fast(softplus, softplus, n);
+                for (std::size_t i = 0; i < n; ++i) {
+                    const T z = logits[begin + i];
+                    sum += std::max(z, T(0)) - z * targets[begin + i] + softplus[i];
+                }
+            }
+            return sum;
+        }
+
+        template <typename T>
+        inline void bce_with_logits_loss_delta(BasicRowView<const T> logits, BasicRowView<const T> targets, BasicRowView<T> delta) {
+            if (logits.size() != targets.size()) throw std::invalid_argument("Logits and targets must have the same size");
+            sigmoid(logits, delta);
+            for (std::size_t i = 0; i < delta.size(); ++i) delta[i] -= targets[i];
+        }
+
+    }
+
+    /**
+     * out = f(in) element-wise; in and out may be the same storage
+     */
+    inline void exp(ConstRowView in, RowView out) { detail::exp(in, out); }
+    inline void exp(ConstRowViewF in, RowViewF out) { detail::exp(in, out); }
+
+    inline void log(ConstRowView in, RowView out) { detail::log(in, out); }
+    inline void log(ConstRowViewF in, RowViewF out) { detail::log(in, out); }
+
+    inline void tanh(ConstRowView in, RowView out) { detail::tanh(in, out); }
+    inline void tanh(ConstRowViewF in, RowViewF out) { detail::tanh(in, out); }
+
+    inline void sigmoid(ConstRowView in, RowView out) { detail::sigmoid(in, out); }
+    inline void sigmoid(ConstRowViewF in, RowViewF out) { detail::sigmoid(in, out); }
+
+    inline void relu(ConstRowView in, RowView out) { detail::relu(in, out); }
+    inline void relu(ConstRowViewF in, RowViewF out) { detail::relu(in, out); }
+
+    template <typename T>
+    inline void tanh(const BasicMatrix<T>& in, BasicMatrix<T>& out) {
+        if (!in.same_shape(out)) throw std::invalid_argument("Input and output must have the same shape");
+        detail::tanh(in.flat(), out.flat());
+    }
+
+    template <typename T>
+    inline void sigmoid(const BasicMatrix<T>& in, BasicMatrix<T>& out) {
+        if (!in.same_shape(out)) throw std::invalid_argument("Input and output must have the same shape");
+        detail::sigmoid(in.flat(), out.flat());
+    }
+
+    template <typename T>
+    inline void relu(const BasicMatrix<T>& in, BasicMatrix<T>& out) {
+        if (!in.same_shape(out)) throw std::invalid_argument("Input and output must have the same shape");
+        detail::relu(in.flat(), out.flat());
+    }
+
+    /**
+     * delta *= tanh'(x), computed from the cached forward outputs y = tanh(x) as 1 - y^2,
+     * so the backward pass doesn't evaluate tanh again
+     */
+    inline void tanh_backward(ConstRowView output, RowView delta) { detail::backward(output, delta, tanh_derivative_from_output<double>); }
+    inline void tanh_backward(ConstRowViewF output, RowViewF delta) { detail::backward(output, delta, tanh_derivative_from_output<float>); }
+
+    /**
+     * delta *= sigmoid'(x), computed from the cached forward outputs s = sigmoid(x) as s(1 - s)
+     */
+    inline void sigmoid_backward(ConstRowView output, RowView delta) { detail::backward(output, delta, sigmoid_derivative_from_output<double>); }
+    inline void sigmoid_backward(ConstRowViewF output, RowViewF delta) { detail::backward(output, delta, sigmoid_derivative_from_output<float>); }
+
+    /**
+     * delta *= relu'(x), which is 1 exactly where the cached output y = relu(x) is positive
+     */
+    inline void relu_backward(ConstRowView output, RowView delta) { detail::backward(output, delta, relu_derivative_from_output<double>); }
+    inline void relu_backward(ConstRowViewF output, RowViewF delta) { detail::backward(output, delta, relu_derivative_from_output<float>); }
+
+    template <typename T>
+    inline void tanh_backward(const BasicMatrix<T>& output, BasicMatrix<T>& delta) {
+        if (!output.same_shape(delta)) throw std::invalid_argument("Output and delta must have the same shape");
+        tanh_backward(output.flat(), delta.flat());
+    }
+
+    template <typename T>
+    inline void sigmoid_backward(const BasicMatrix<T>& output, BasicMatrix<T>& delta) {
+        if (!output.same_shape(delta)) throw std::invalid_argument("Output and delta must have the same shape");
+        sigmoid_backward(output.flat(), delta.flat());
+    }
+
+    template <typename T>
+    inline void relu_backward(const BasicMatrix<T>& output, BasicMatrix<T>& delta) {
+        if (!output.same_shape(delta)) throw std::invalid_argument("Output and delta must have the same shape");
+        relu_backward(output.flat(), delta.flat());
+    }
+
+    /**
+     * Sum of bce_with_logits_loss over a batch, accumulated in Acc;
+     * in Fast mode log(1 + e^-|z|) uses the kernels
+     */
+    template <typename Acc = double>
+    inline Acc bce_with_logits_loss(ConstRowView logits, ConstRowView targets) { return detail::bce_with_logits_loss<Acc>(logits, targets); }
+
+    template <typename Acc = float>
+    inline Acc bce_with_logits_loss(ConstRowViewF logits, ConstRowViewF targets) { return detail::bce_with_logits_loss<Acc>(logits, targets); }
+
+    /**
+     * delta = sigmoid(logits) - targets, the gradient of the batch loss above per logit
+     */
+    inline void bce_with_logits_loss_delta(ConstRowView logits, ConstRowView targets, RowView delta) { detail::bce_with_logits_loss_delta(logits, targets, delta); }
+    inline void bce_with_logits_loss_delta(ConstRowViewF logits, ConstRowViewF targets, RowViewF delta) { detail::bce_with_logits_loss_delta(logits, targets, delta); }
+
 #pragma endregion
 
 }
\ No newline at end of file
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "Math.hpp"
+#include "Profiler.hpp"
+#include "Workspace.hpp"
+
+/**
+ * Network.hpp
+ * Fully connected network of any depth and width, with its batched forward and backward pass.
+ * Every layer computes activation(input * weight^T + bias) for a whole batch at once: one gemm,
+ * one broadcast add and one element-wise activation over contiguous buffers. The backward pass
+ * walks the layers in reverse with the same three kinds of operation, so every topology runs
+ * through the same code.
+ */
+namespace nn {
+
+#pragma region parameters
+
+    /**
+     * Read-only view of one layer's weights (units x fan_in) and biases, wherever they are stored
+     */
+    template <typename T>
+    struct LayerView {
+        math::BasicMatrixView<const T> weight;
+        math::BasicRowView<const T> bias;
+        Activation activation = Activation::Identity;
+    };
+
+    template <typename T>
+    struct Layer {
+        math::BasicMatrix<T> weight;
+        std::vector<T> bias;
+        Activation activation = Activation::Identity;
+
+        Layer(std::size_t fan_in, const LayerSpec& spec)
+            : weight(spec.units, fan_in), bias(spec.units, T(0)), activation(spec.activation) {}
+
+        LayerView<T> view() const { return LayerView<T>{ weight, bias, activation }; }
+    };
+
+    /**
+     * Weights and biases of every layer, stored as T
+     */
+    template <typename T>
+    struct Network {
+        Topology topology;
+        std::vector<Layer<T>> layers;
+
+        explicit Network(const Topology& topo) : topology(topo) {
+            topo.validate();
+            layers.reserve(topo.depth());
+            for (std::size_t l = 0; l < topo.depth(); ++l) layers.emplace_back(topo.fan_in(l), topo.layers[l]);
+        }
+
+        std::size_t depth() const { return layers.size(); }
+        LayerView<T> layer(std::size_t l) const { return layers[l].view(); }
+
+        /**
+         * Xavier initialisation: the weights of every layer uniform in +-xavier_limit(fan_in, units)
+         * of that layer, written a whole layer at a time by fill(layer, weights, count, min, max); biases zero
+         */
+        template <typename Fill>
+        void initialize(Fill&& fill) {
+            for (std::size_t l = 0; l < layers.size(); ++l) {
+                Layer<T>& layer = layers[l];
+                const double limit = math::xavier_limit(static_cast<double>(layer.weight.cols()), static_cast<double>(layer.weight.rows()));
+                fill(l, layer.weight.data(), layer.weight.size(), -limit, limit);
+                std::fill(layer.bias.begin(), layer.bias.end(), T(0));
+            }
+        }
+    };
+
+    /**
+     * Read-only view of a whole network (a Network object or a memory-mapped checkpoint)
+     */
+    template <typename T>
+    struct NetworkView {
+        Topology topology;
+        std::vector<LayerView<T>> layers;
+
+        NetworkView() = default;
+
+        NetworkView(const Network<T>& net) : topology(net.topology) {
+            layers.reserve(net.depth());
+            for (const Layer<T>& layer : net.layers) layers.push_back(layer.view());
+        }
+
+        std::size_t depth() const { return layers.size(); }
+        LayerView<T> layer(std::size_t l) const { return layers[l]; }
+    };
+
+#pragma endregion
+#pragma region passes
+
+    /**
+     * x = activation(x) in place
+     */
+    template <typename T>
+    inline void activate(Activation activation, math::BasicMatrix<T>& x) {
+        switch (activation) {
+        case Activation::Relu: math::relu(x, x); break;
+        case Activation::Tanh: math::tanh(x, x); break;
+        case Activation::Sigmoid: math::sigmoid(x, x); break;
+        default: break;
+        }
+    }
+
+    /**
+     * delta *= activation'(x), from the cached outputs of the forward pass
+     */
+    template <typename T>
+    inline void activation_backward(Activation activation, const math::BasicMatrix<T>& output, math::BasicMatrix<T>& delta) {
+        switch (activation) {
+        case Activation::Relu: math::relu_backward(output, delta); break;
+        case Activation::Tanh: math::tanh_backward(output, delta); break;
+        case Activation::Sigmoid: math::sigmoid_backward(output, delta); break;
+        default: break;
+        }
+    }
+
+    /**
+     * Whole-batch forward pass over every row of ws.input: one row of every activation matrix per sample.
+     * Net is a Network<T> or a NetworkView<T>.
+     */
+    template <typename Net, typename T>
+    inline void forward(const Net& net, BasicWorkspace<T>& ws) {
+        const Profiler::Timer timer(Profiler::Phase::Forward);
+        for (std::size_t l = 0; l < net.depth(); ++l) {
+            const LayerView<T> layer = net.layer(l);
+            const math::BasicMatrix<T>& in = l == 0 ? ws.input : ws.outputs[l - 1];
+            math::BasicMatrix<T>& out = ws.outputs[l];
+
+            math::gemm(math::Transpose::No, math::Transpose::Yes, 1.0, in, layer.weight, 0.0, out);
+            math::add_to_rows(out, layer.bias);
+            activate(layer.activation, out);
+        }
+    }
+
+    /**
+     * Layer hook of accumulate_gradients that does nothing
+     */
+    struct IgnoreLayer {
+        void operator()(std::size_t) const {}
+    };
+
+    /**
+     * Forward and backward pass over the rows of ws.input, leaving the gradients summed over those rows
+     * in ws.weight_gradients and ws.bias_gradients
+     * @param targets one row of output targets per workspace row
+     * @param with_loss false skips measuring the loss (only its gradient is needed to train) and returns 0
+     * @param layer_done called with l as soon as the gradients of layer l are final, last layer first;
+     *                   the backward pass no longer touches them, so they can be sent off while it goes on
+     * @return loss summed over the rows, accumulated in Acc
+     */
+    template <typename Acc, typename Net, typename T, typename LayerDone = IgnoreLayer>
+    inline Acc accumulate_gradients(const Net& net, BasicWorkspace<T>& ws, math::identity_t<math::BasicRowView<const T>> targets,
+                                    bool with_loss = true, LayerDone layer_done = {}) {
+        if (targets.size() != ws.logits().size()) throw std::invalid_argument("Expected one row of targets per workspace row");
+
+        forward(net, ws);
+        const Profiler::Timer timer(Profiler::Phase::Backward);
+
+        const Acc loss = with_loss ? math::bce_with_logits_loss<Acc>(ws.logits().flat(), targets) : Acc(0);
+        math::bce_with_logits_loss_delta(ws.logits().flat(), targets, ws.deltas.back().flat());
+
+        for (std::size_t l = net.depth(); l-- > 0;) {
+            const math::BasicMatrix<T>& in = l == 0 ? ws.input : ws.outputs[l - 1];
+
+            math::gemm(math::Transpose::Yes, math::Transpose::No, 1.0, ws.deltas[l], in, 0.0, ws.weight_gradients[l]);
+            math::column_sums_into<Acc>(ws.deltas[l], ws.bias_gradients[l]);
+            layer_done(l);
+
+            if (l > 0) {
+                math::gemm(math::Transpose::No, math::Transpose::No, 1.0, ws.deltas[l], net.layer(l).weight, 0.0, ws.deltas[l - 1]);
+                activation_backward(net.layer(l - 1).activation, ws.outputs[l - 1], ws.deltas[l - 1]);
+            }
+        }
+
+        return loss;
+    }
+
+    /**
+     * net -= step * accumulated gradients of ws
+     */
+    template <typename T>
+    inline void apply_gradients(Network<T>& net, const BasicWorkspace<T>& ws, T step) {
+        const Profiler::Timer timer(Profiler::Phase::Update);
+        for (std::size_t l = 0; l < net.depth(); ++l) {
+            net.layers[l].weight -= ws.weight_gradients[l] * step;
+            net.layers[l].bias -= ws.bias_gradients[l] * step;
+        }
+    }
+
+    /**
+     * dst gradients += src gradients
+     */
+    template <typename T>
+    inline void add_gradients(BasicWorkspace<T>& dst, const BasicWorkspace<T>& src) {
+        const Profiler::Timer timer(Profiler::Phase::Reduce);
+        for (std::size_t l = 0; l < dst.weight_gradients.size(); ++l) {
+            dst.weight_gradients[l] += src.weight_gradients[l];
+            dst.bias_gradients[l] += src.bias_gradients[l];
+        }
+    }
+
+#pragma endregion
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Math.hpp"
+#include "Network.hpp"
+#include "Profiler.hpp"
+#include "Workspace.hpp"
+
+/**
+ * Optimizer.hpp
+ * Update rules that turn a minibatch's summed gradients into a weight step: plain SGD, SGD with
+ * classical or Nesterov momentum, and Adam / AdamW.
+ * Every rule is a single fused kernel (see simd::UpdateStep) that reads the weights, gradients and
+ * optimizer state once and writes them back once. The batch mean, weight decay and Adam's bias
+ * correction are folded into a few per-step constants beforehand, so no extra pass is ever made.
+ */
+namespace nn {
+
+    enum class OptimizerKind { Sgd, Momentum, Nesterov, Adam, AdamW };
+
+    inline const char* optimizer_name(OptimizerKind kind) {
+        switch (kind) {
+        case OptimizerKind::Momentum: return "momentum";
+        case OptimizerKind::Nesterov: return "nesterov";
+        case OptimizerKind::Adam: return "adam";
+        case OptimizerKind::AdamW: return "adamw";
+        default: return "sgd";
+        }
+    }
+
+    inline OptimizerKind parse_optimizer(const std::string& name) {
+        if (name == "sgd") return OptimizerKind::Sgd;
+        if (name == "momentum") return OptimizerKind::Momentum;
+        if (name == "nesterov") return OptimizerKind::Nesterov;
+        if (name == "adam") return OptimizerKind::Adam;
+        if (name == "adamw") return OptimizerKind::AdamW;
+        throw std::invalid_argument("Expected sgd, momentum, nesterov, adam or adamw optimizer. Received: " + name);
+    }
+
+    /**
+     * Update rule and its hyperparameters. weight_decay is an L2 term added to the gradient,
+     * except for AdamW, which shrinks the weights directly by learning_rate * weight_decay per step.
+     */
+    struct OptimizerSettings {
+        OptimizerKind kind = OptimizerKind::Sgd;
+        double momentum = 0.9;
+        double beta1 = 0.9;
+        double beta2 = 0.999;
+        double epsilon = 1e-8;
+        double weight_decay = 0.0;
+
+        /**
+         * @return optimizer state buffers per weight: none for SGD, a velocity for momentum, two moments for Adam
+         */
+        std::size_t state_count() const {
+            switch (kind) {
+            case OptimizerKind::Momentum:
+            case OptimizerKind::Nesterov: return 1;
+            case OptimizerKind::Adam:
+            case OptimizerKind::AdamW: return 2;
+            default: return 0;
+            }
+        }
+
+        void validate() const {
+            if (!(momentum >= 0.0 && momentum < 1.0)) throw std::invalid_argument("Momentum must be in [0, 1)");
+            if (!(beta1 >= 0.0 && beta1 < 1.0) || !(beta2 >= 0.0 && beta2 < 1.0)) throw std::invalid_argument("Adam betas must be in [0, 1)");
+            if (!(epsilon > 0.0)) throw std::invalid_argument("Adam epsilon must be positive");
+            if (!(weight_decay >= 0.0)) throw std::invalid_argument("Weight decay must not be negative");
+        }
+    };
+
+    /**
+     * Kernel constants of update number step (counted from 1), for gradients summed over batch samples.
+     * The kernels take the sums as they are: the 1 / batch of the mean goes into the rate, and the
+     * terms added to the gradient (L2 decay, Adam's epsilon) are scaled up by batch to match.
+     */
+    template <typename T>
+    inline math::simd::UpdateStep<T> update_step(const OptimizerSettings& settings, double learning_rate, std::size_t batch, std::uint64_t step) {
+        const double n = static_cast<double>(batch);
+        math::simd::UpdateStep<T> result;
+        result.rate = static_cast<T>(learning_rate / n);
+        result.decay = static_cast<T>(settings.weight_decay * n);
+
+        switch (settings.kind) {
+        case OptimizerKind::Momentum:
+        case OptimizerKind::Nesterov: {
+            const bool nesterov = settings.kind == OptimizerKind::Nesterov;
+            result.momentum = static_cast<T>(settings.momentum);
+            result.velocity_weight = static_cast<T>(nesterov ? settings.momentum : 1.0);
+            result.gradient_weight = static_cast<T>(nesterov ? 1.0 : 0.0);
+            break;
+        }
+        case OptimizerKind::Adam:
+        case OptimizerKind::AdamW: {
+            // bias correction, folded into the rate and epsilon: rate * m_hat / (sqrt(v_hat) + epsilon)
+            const double t = static_cast<double>(step);
+            const double first_correction = 1.0 - std::pow(settings.beta1, t);
+            const double second_correction = std::sqrt(1.0 - std::pow(settings.beta2, t));
+            result.rate = static_cast<T>(learning_rate * second_correction / first_correction);
+            result.epsilon = static_cast<T>(settings.epsilon * n * second_correction);
+            result.beta1 = static_cast<T>(settings.beta1);
+            result.beta2 = static_cast<T>(settings.beta2);
+            if (settings.kind == OptimizerKind::AdamW) {
+                result.decay = T(0);
+                result.keep = static_cast<T>(1.0 - learning_rate * settings.weight_decay);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        return result;
+    }
+
+    /**
+     * One update of n weights with the scalar kernels, inlined at the call site; for fixed-size
+     * buffers where the loop unrolls completely and a dispatched call would cost more than the arithmetic
+     */
+    template <typename T, typename G>
+    inline void update_inline(OptimizerKind kind, T* w, const G* g, T* first, T* second, std::size_t n, const math::simd::UpdateStep<T>& step) {
+        switch (kind) {
+        case OptimizerKind::Momentum:
+        case OptimizerKind::Nesterov: math::simd::scalar::momentum_step(w, g, first, n, step); break;
+        case OptimizerKind::Adam:
+        case OptimizerKind::AdamW: math::simd::scalar::adam_step(w, g, first, second, n, step); break;
+        default: math::simd::scalar::sgd_step(w, g, n, step); break;
+        }
+    }
+
+    /**
+     * Applies one update rule to a Network<T>, keeping its state (velocities or Adam moments) in
+     * buffers shaped like the weights, allocated once here
+     */
+    template <typename T>
+    class Optimizer {
+    private:
+        OptimizerSettings config;
+        std::vector<math::BasicMatrix<T>> weight_first;
+        std::vector<math::BasicMatrix<T>> weight_second;
+        std::vector<math::aligned_vector<T>> bias_first;
+        std::vector<math::aligned_vector<T>> bias_second;
+        std::uint64_t steps = 0;
+
+        void update(math::BasicRowView<T> w, math::BasicRowView<const T> g, math::BasicRowView<T> first, math::BasicRowView<T> second, const math::simd::UpdateStep<T>& step) {
+            switch (config.kind) {
+            case OptimizerKind::Momentum:
+            case OptimizerKind::Nesterov: math::momentum_update(w, g, first, step); break;
+            case OptimizerKind::Adam:
+            case OptimizerKind::AdamW: math::adam_update(w, g, first, second, step); break;
+            default: math::sgd_update(w, g, step); break;
+            }
+        }
+
+    public:
+        Optimizer(const Topology& topo, const OptimizerSettings& settings) : config(settings) {
+            topo.validate();
+            settings.validate();
+
+            const std::size_t states = settings.state_count();
+            for (std::size_t l = 0; l < topo.depth(); ++l) {
+                const std::size_t units = topo.layers[l].units;
+                weight_first.emplace_back(states >= 1 ? units : 0, topo.fan_in(l));
+                weight_second.emplace_back(states >= 2 ? units : 0, topo.fan_in(l));
+                bias_first.emplace_back(states >= 1 ? units : 0);
+                bias_second.emplace_back(states >= 2 ? units : 0);
+            }
+        }
+
+        const OptimizerSettings& settings() const { return config; }
+        std::uint64_t step_count() const { return steps; }
+
+        /**
+         * Zeroes the optimizer state, as if no step had been taken
+         */
+        void reset() {
+            for (math::BasicMatrix<T>& m : weight_first) std::fill(m.data(), m.data() + m.size(), T(0));
+            for (math::BasicMatrix<T>& m : weight_second) std::fill(m.data(), m.data() + m.size(), T(0));
+            for (math::aligned_vector<T>& v : bias_first) std::fill(v.begin(), v.end(), T(0));
+            for (math::aligned_vector<T>& v : bias_second) std::fill(v.begin(), v.end(), T(0));
+            steps = 0;
+        }
+
+        /**
+         * One update of net from the gradients in ws, summed over batch samples
+         */
+        void apply(Network<T>& net, const BasicWorkspace<T>& ws, double learning_rate, std::size_t batch) {
+            const Profiler::Timer timer(Profiler::Phase::Update);
+            const math::simd::UpdateStep<T> step = update_step<T>(config, learning_rate, batch, ++steps);
+            for (std::size_t l = 0; l < net.depth(); ++l) {
+                update(net.layers[l].weight.flat(), ws.weight_gradients[l].flat(), weight_first[l].flat(), weight_second[l].flat(), step);
+                update(net.layers[l].bias, ws.bias_gradients[l], bias_first[l], bias_second[l], step);
+            }
+        }
+    };
+
+}
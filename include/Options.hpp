@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <fstream>
+#include <initializer_list>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+/**
+ * Options.hpp
+ * Command-line flags and config files as one set of key/value options.
+ * Flags are written --key value, --key=value or just --key (meaning "true").
+ * A config file holds one key = value per line; # starts a comment.
+ * Later sources override earlier ones, so a flag beats the config file it follows.
+ */
+class Options {
+private:
+    std::map<std::string, std::string> values;
+
+    static std::string Trim(const std::string& str) {
+        const auto first = std::find_if_not(str.begin(), str.end(), [](unsigned char c) { return std::isspace(c); });
+        const auto last = std::find_if_not(str.rbegin(), str.rend(), [](unsigned char c) { return std::isspace(c); }).base();
+        return first < last ? std::string(first, last) : std::string();
+    }
+
+    const std::string* Find(const std::string& key) const {
+        const auto it = values.find(key);
+        return it == values.end() ? nullptr : &it->second;
+    }
+
+public:
+    /**
+     * Reads argv[first, argc). Every argument must be a flag or the value of the flag before it.
+     */
+    void Parse(int argc, char** argv, int first = 1) {
+        for (int i = first; i < argc; ++i) {
+            const std::string arg = argv[i];
+            if (arg.size() < 3 || arg.compare(0, 2, "--") != 0) throw std::invalid_argument("Expected a --flag. Received: " + arg);
+
+            const std::size_t equals = arg.find('=');
+            if (equals != std::string::npos) {
+                values[arg.substr(2, equals - 2)] = arg.substr(equals + 1);
+            }
+            else if (i + 1 < argc && std::string(argv[i + 1]).compare(0, 2, "--") != 0) {
+                values[arg.substr(2)] = argv[++i];
+            }
+            else {
+                values[arg.substr(2)] = "true";
+            }
+        }
+    }
+
+    /**
+     * Reads key = value lines from a config file
+     */
+    void Load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) throw std::invalid_argument("Cannot open config file: " + path);
+
+        std::string line;
+        for (std::size_t number = 1; std::getline(file, line); ++number) {
+            line = Trim(line.substr(0, line.find('#')));
+            if (line.empty()) continue;
+
+            const std::size_t equals = line.find('=');
+            if (equals == std::string::npos) {
+                throw std::invalid_argument(path + ":" + std::to_string(number) + ": expected key = value. Received: " + line);
+            }
+            values[Trim(line.substr(0, equals))] = Trim(line.substr(equals + 1));
+        }
+    }
+
+    /**
+     * Throws on the first option that isn't one of known, so typos don't pass silently
+     */
+    void Expect(std::initializer_list<const char*> known) const {
+        for (const auto& [key, value] : values) {
+            if (std::none_of(known.begin(), known.end(), [&key](const char* k) { return key == k; })) {
+                throw std::invalid_argument("Unknown option: --" + key);
+            }
+        }
+    }
+
+    bool Has(const std::string& key) const { return Find(key) != nullptr; }
+
+    /**
+     * Overrides an option, e.g. with defaults taken from somewhere else
+     */
+    void Set(const std::string& key, const std::string& value) { values[key] = value; }
+
+    std::string String(const std::string& key, const std::string& fallback = "") const {
+        const std::string* value = Find(key);
+        return value ? *value : fallback;
+    }
+
+    /**
+     * @return non-negative integer option
+     */
+    std::size_t Number(const std::string& key, std::size_t fallback) const {
+        const std::string* value = Find(key);
+        if (!value) return fallback;
+        if (value->empty() || !std::all_of(value->begin(), value->end(), ::isdigit)) {
+            throw std::invalid_argument("Expected a non-negative integer for --" + key + ". Received: " + *value);
+        }
+        try {
+            return static_cast<std::size_t>(std::stoull(*value));
+        }
+        catch (const std::out_of_range&) {
+            throw std::invalid_argument("Value of --" + key + " is too large. Received: " + *value);
+        }
+    }
+
+    double Double(const std::string& key, double fallback) const {
+        const std::string* value = Find(key);
+        if (!value) return fallback;
+        try {
+            std::size_t pos;
+            const double result = std::stod(*value, &pos);
+            if (pos == value->size()) return result;
+        }
+        catch (const std::exception&) {
+        }
+        throw std::invalid_argument("Expected a number for --" + key + ". Received: " + *value);
+    }
+
+    bool Flag(const std::string& key) const {
+        const std::string* value = Find(key);
+        if (!value) return false;
+        if (*value == "true" || *value == "1" || *value == "yes") return true;
+        if (*value == "false" || *value == "0" || *value == "no") return false;
+        throw std::invalid_argument("Expected true or false for --" + key + ". Received: " + *value);
+    }
+};
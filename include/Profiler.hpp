@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Profiler.hpp
+ * Scoped timers and counters for the training hot path.
+ * Timers are off until Enable(true); a disabled timer costs a relaxed load and a branch.
+ * An enabled one reads the clock twice and adds to a per-phase atomic, which is cheap next to the
+ * work it wraps (a forward pass, a shard's backward pass, an update). Phase times are summed over
+ * all threads, so with several shards they add up to more than the wall time.
+ */
+namespace profiler_detail {
+
+    struct alignas(64) Slot {
+        std::atomic<std::uint64_t> nanoseconds{ 0 };
+        std::atomic<std::uint64_t> calls{ 0 };
+    };
+
+}
+
+class Profiler {
+public:
+    enum class Phase { Data, Forward, Backward, Reduce, Update };
+    static constexpr std::size_t PHASES = 5;
+
+    /**
+     * Totals since the last Reset()
+     */
+    struct Snapshot {
+        std::array<std::uint64_t, PHASES> nanoseconds{};
+        std::array<std::uint64_t, PHASES> calls{};
+        std::uint64_t samples = 0;
+    };
+
+    /**
+     * Adds the time between its construction and destruction to a phase
+     */
+    class Timer {
+    private:
+        Phase phase;
+        bool active;
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        explicit Timer(Phase timed) : phase(timed), active(Profiler::Enabled()) {
+            if (active) start = std::chrono::steady_clock::now();
+        }
+
+        ~Timer() {
+            if (active) Profiler::Add(phase, std::chrono::steady_clock::now() - start);
+        }
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+    };
+
+private:
+    using Slot = profiler_detail::Slot;
+
+    static inline Slot slots[PHASES];
+    static inline std::atomic<std::uint64_t> samples{ 0 };
+    static inline std::atomic<bool> enabled{ false };
+
+    Profiler() = delete;
+    ~Profiler() = delete;
+
+public:
+    static void Enable(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    static bool Enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    static void Add(Phase phase, std::chrono::steady_clock::duration elapsed) {
+        Slot& slot = slots[static_cast<std::size_t>(phase)];
+        slot.nanoseconds.fetch_add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), std::memory_order_relaxed);
+        slot.calls.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * Counts trained samples; always on, since it's one add per minibatch
+     */
+    static void CountSamples(std::uint64_t count) { samples.fetch_add(count, std::memory_order_relaxed); }
+
+    static Snapshot Read() {
+        Snapshot result;
+        for (std::size_t p = 0; p < PHASES; ++p) {
+            result.nanoseconds[p] = slots[p].nanoseconds.load(std::memory_order_relaxed);
+            result.calls[p] = slots[p].calls.load(std::memory_order_relaxed);
+        }
+        result.samples = samples.load(std::memory_order_relaxed);
+        return result;
+    }
+
+    static void Reset() {
+        for (Slot& slot : slots) {
+            slot.nanoseconds.store(0, std::memory_order_relaxed);
+            slot.calls.store(0, std::memory_order_relaxed);
+        }
+        samples.store(0, std::memory_order_relaxed);
+    }
+
+    static const char* Name(Phase phase) {
+        constexpr const char* names[PHASES] = { "data", "forward", "backward", "reduce", "update" };
+        return names[static_cast<std::size_t>(phase)];
+    }
+};
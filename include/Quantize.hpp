@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Dataset.hpp"
+#include "Math.hpp"
+#include "Network.hpp"
+#include "Workspace.hpp"
+
+/**
+ * Quantize.hpp
+ * Post-training int8 quantization for inference.
+ * Every layer's weights become signed bytes with one scale per row (output unit), so small rows
+ * keep their resolution next to large ones. Each sample's activations are quantized to bytes on
+ * the way into a layer, the products of a whole batch are summed exactly in 32-bit integers
+ * (gemm_i8, which is vpdpbusd on CPUs with AVX-512 VNNI, on weights stored in its block layout)
+ * and scaled back once per output. Tanh and sigmoid layers map those sums straight to byte
+ * outputs through a lookup table, so their activations never leave 8 bits; only the output
+ * layer's logits come back as T.
+ */
+namespace nn {
+
+    /**
+     * Byte output of a bounded activation (tanh or sigmoid) for any pre-activation z: code q stands
+     * for q * OUTPUT_SCALE. The table samples z every 1/STEPS_PER_UNIT over [-RANGE, RANGE], finer
+     * than the output resolution anywhere; beyond that range both functions are saturated.
+     */
+    class ActivationTable {
+    public:
+        static constexpr int RANGE = 8;
+        static constexpr int STEPS_PER_UNIT = 256;
+        static constexpr std::size_t SIZE = 2 * RANGE * STEPS_PER_UNIT + 1;
+        static constexpr float OUTPUT_SCALE = 1.0f / 127.0f;
+
+        ActivationTable() = default;
+
+        explicit ActivationTable(Activation activation) {
+            for (std::size_t i = 0; i < SIZE; ++i) {
+                const double z = static_cast<double>(i) / STEPS_PER_UNIT - RANGE;
+                const double y = activation == Activation::Tanh ? std::tanh(z) : 1.0 / (1.0 + std::exp(-z));
+                codes[i] = static_cast<std::int8_t>(std::lround(127.0 * y));
+            }
+        }
+
+        std::int8_t operator()(float z) const {
+            if (!(z > -RANGE)) return codes.front();
+            if (z >= RANGE) return codes.back();
+            return codes[static_cast<std::size_t>((z + RANGE) * STEPS_PER_UNIT + 0.5f)];
+        }
+
+    private:
+        std::array<std::int8_t, SIZE> codes{};
+    };
+
+    /**
+     * @return bytes per sample of byte activations n wide, as gemm_i8 reads them
+     */
+    inline std::size_t padded_codes(std::size_t n) {
+        using math::simd::I8_DEPTH;
+        return (n + I8_DEPTH - 1) / I8_DEPTH * I8_DEPTH;
+    }
+
+    /**
+     * weight(u, i) ~ code(u, i) * scale[u], with the codes in the block layout of gemm_i8 (see math::simd::I8_ROWS)
+     */
+    struct QuantizedLayer {
+        std::size_t units = 0;
+        std::size_t fan_in = 0;
+        math::aligned_vector<std::int8_t> weight;
+        std::vector<float> scale;
+        std::vector<float> bias;
+        Activation activation = Activation::Identity;
+        ActivationTable table;
+
+        bool bounded() const { return activation == Activation::Tanh || activation == Activation::Sigmoid; }
+    };
+
+    /**
+     * Byte activations, integer sums and activation scales of a quantized forward pass over batch_size rows.
+     * Rows [begin, end) of a batch use the buffers from row begin on, so row ranges can run in parallel.
+     */
+    struct QuantizedWorkspace {
+        std::size_t batch_size = 0;
+        std::size_t width = 0;
+        math::aligned_vector<std::int8_t> codes;
+        math::aligned_vector<std::int8_t> next_codes;
+        math::aligned_vector<std::int32_t> sums;
+        math::aligned_vector<float> values;
+        std::vector<float> scales;
+
+        QuantizedWorkspace(const Topology& topo, std::size_t batch) : batch_size(batch), width(padded_codes(topo.input)) {
+            for (const LayerSpec& layer : topo.layers) width = std::max(width, padded_codes(layer.units));
+            codes.resize(batch * width);
+            next_codes.resize(batch * width);
+            sums.resize(batch * width);
+            values.resize(batch * width);
+            scales.resize(batch);
+        }
+    };
+
+    /**
+     * Symmetric quantization of n values to codes in [-127, 127], zeroing codes up to padded_codes(n)
+     * @return scale of one code step
+     */
+    template <typename V>
+    inline float quantize_symmetric(const V* x, std::size_t n, std::int8_t* codes) {
+        std::fill(codes + n, codes + padded_codes(n), std::int8_t(0));
+        float largest = 0.0f;
+        for (std::size_t i = 0; i < n; ++i) largest = std::max(largest, std::abs(static_cast<float>(x[i])));
+        if (!(largest > 0.0f) || !std::isfinite(largest)) {
+            std::fill(codes, codes + n, std::int8_t(0));
+            return 1.0f;
+        }
+
+        // |x * inverse| <= 127, so rounding half away from zero by truncation stays in range;
+        // unlike std::lround it is inline and vectorizes
+        const float inverse = 127.0f / largest;
+        for (std::size_t i = 0; i < n; ++i) {
+            const float scaled = static_cast<float>(x[i]) * inverse;
+            codes[i] = static_cast<std::int8_t>(static_cast<std::int32_t>(scaled + (scaled < 0.0f ? -0.5f : 0.5f)));
+        }
+        return largest / 127.0f;
+    }
+
+    /**
+     * Int8 copy of a trained network, for inference only
+     */
+    template <typename T>
+    class QuantizedNetwork {
+    private:
+        Topology topo;
+        std::vector<QuantizedLayer> layers;
+
+        /**
+         * Forward pass of rows samples, layer by layer; activations of one layer are packed per sample,
+         * with scale[s] the step of sample s's codes
+         */
+        void forward_rows(const math::simd::BasicKernels<T>& k, const T* inputs, std::size_t rows, T* logits,
+            std::int8_t* codes, std::int8_t* next, std::int32_t* sums, float* values, float* scale) const {
+            const std::size_t input_width = padded_codes(topo.input);
+            for (std::size_t r = 0; r < rows; ++r) scale[r] = quantize_symmetric(inputs + r * topo.input, topo.input, codes + r * input_width);
+
+            for (std::size_t l = 0; l < layers.size(); ++l) {
+                const QuantizedLayer& layer = layers[l];
+                const std::size_t units = layer.units;
+                const std::size_t width = padded_codes(units);
+                k.gemm_i8(layer.weight.data(), units, layer.fan_in, codes, rows, sums);
+
+                for (std::size_t r = 0; r < rows; ++r) {
+                    const std::int32_t* sum = sums + r * units;
+                    const float step = scale[r];
+                    if (l + 1 == layers.size()) {
+                        for (std::size_t u = 0; u < units; ++u) logits[r * units + u] = static_cast<T>(static_cast<float>(sum[u]) * (layer.scale[u] * step) + layer.bias[u]);
+                    } else if (layer.bounded()) {
+                        std::int8_t* out = next + r * width;
+                        for (std::size_t u = 0; u < units; ++u) out[u] = layer.table(static_cast<float>(sum[u]) * (layer.scale[u] * step) + layer.bias[u]);
+                        std::fill(out + units, out + width, std::int8_t(0));
+                        scale[r] = ActivationTable::OUTPUT_SCALE;
+                    } else {
+                        for (std::size_t u = 0; u < units; ++u) {
+                            const float z = static_cast<float>(sum[u]) * (layer.scale[u] * step) + layer.bias[u];
+                            values[u] = layer.activation == Activation::Relu ? std::max(z, 0.0f) : z;
+                        }
+                        scale[r] = quantize_symmetric(values, units, next + r * width);
+                    }
+                }
+                std::swap(codes, next);
+            }
+        }
+
+    public:
+        /**
+         * Quantizes every layer of net (a Network<T> or NetworkView<T>)
+         */
+        template <typename Net>
+        explicit QuantizedNetwork(const Net& net) : topo(net.topology) {
+            topo.validate();
+            layers.reserve(net.depth());
+            for (std::size_t l = 0; l < net.depth(); ++l) {
+                const LayerView<T> source = net.layer(l);
+                QuantizedLayer layer;
+                layer.units = source.weight.rows();
+                layer.fan_in = source.weight.cols();
+                layer.activation = source.activation;
+                if (layer.bounded()) layer.table = ActivationTable(layer.activation);
+
+                // block b holds rows [b * I8_ROWS, (b + 1) * I8_ROWS), group g of a block columns [g * I8_DEPTH, (g + 1) * I8_DEPTH)
+                using math::simd::I8_DEPTH;
+                using math::simd::I8_ROWS;
+                const std::size_t width = padded_codes(layer.fan_in);
+                const std::size_t blocks = (layer.units + I8_ROWS - 1) / I8_ROWS;
+                layer.weight.assign(blocks * I8_ROWS * width, std::int8_t(0));
+                std::vector<std::int8_t> row(width);
+                for (std::size_t u = 0; u < layer.units; ++u) {
+                    layer.scale.push_back(quantize_symmetric(source.weight.row_data(u), layer.fan_in, row.data()));
+                    layer.bias.push_back(static_cast<float>(source.bias[u]));
+                    std::int8_t* block = layer.weight.data() + (u / I8_ROWS) * I8_ROWS * width + (u % I8_ROWS) * I8_DEPTH;
+                    for (std::size_t g = 0; g < width / I8_DEPTH; ++g) std::copy_n(row.data() + g * I8_DEPTH, I8_DEPTH, block + g * I8_ROWS * I8_DEPTH);
+                }
+                layers.push_back(std::move(layer));
+            }
+        }
+
+        const Topology& topology() const { return topo; }
+
+        /**
+         * @return bytes of weights, scales and biases
+         */
+        std::size_t size_bytes() const {
+            std::size_t bytes = 0;
+            for (const QuantizedLayer& layer : layers) bytes += layer.weight.size() + (layer.scale.size() + layer.bias.size()) * sizeof(float);
+            return bytes;
+        }
+
+        /**
+         * Logits of rows samples (topology().input values each, row-major) into logits (topology().output() each)
+         */
+        void forward(const T* inputs, std::size_t rows, T* logits, QuantizedWorkspace& ws) const {
+            if (rows > ws.batch_size) throw std::invalid_argument("Workspace is smaller than the batch");
+            const std::size_t width = ws.width;
+            const std::size_t outputs = topo.output();
+
+            math::dispatch::for_each_chunk<T>(rows, topo.parameter_count(), [&](const math::simd::BasicKernels<T>& k, std::size_t begin, std::size_t end) {
+                forward_rows(k, inputs + begin * topo.input, end - begin, logits + begin * outputs, ws.codes.data() + begin * width,
+                    ws.next_codes.data() + begin * width, ws.sums.data() + begin * width, ws.values.data() + begin * width, ws.scales.data() + begin);
+            });
+        }
+    };
+
+    /**
+     * How far the quantized predictions are from those of the original network
+     */
+    struct QuantizationReport {
+        // largest and mean absolute difference of the predicted probabilities
+        double max_difference = 0.0;
+        double mean_difference = 0.0;
+        // fraction of outputs where both predict the same class
+        double agreement = 0.0;
+        // mean binary cross-entropy of each over the dataset
+        double loss = 0.0;
+        double quantized_loss = 0.0;
+    };
+
+    /**
+     * Runs every sample of data through net (Network<T> or NetworkView<T>) and through its quantized copy
+     */
+    template <typename Net, typename T>
+    inline QuantizationReport compare_quantized(const Net& net, const QuantizedNetwork<T>& quantized, const Dataset<T>& data, std::size_t chunk = 256) {
+        if (net.topology != quantized.topology()) throw std::invalid_argument("Quantized network must have the topology of the original");
+        if (data.input_count() != net.topology.input || data.output_count() != net.topology.output()) throw std::invalid_argument("Dataset and network disagree on their shape");
+
+        QuantizationReport report;
+        if (data.size() == 0) return report;
+
+        chunk = std::clamp<std::size_t>(chunk, 1, data.size());
+        BasicWorkspace<T> ws(net.topology, chunk);
+        QuantizedWorkspace qws(net.topology, chunk);
+        math::BasicMatrix<T> logits(chunk, net.topology.output());
+        std::size_t agreeing = 0;
+
+        for (std::size_t first = 0; first < data.size(); first += chunk) {
+            const std::size_t rows = std::min(chunk, data.size() - first);
+            if (rows != ws.batch_size) {
+                ws = BasicWorkspace<T>(net.topology, rows);
+                logits = math::BasicMatrix<T>(rows, net.topology.output());
+            }
+
+            const math::BasicRowView<const T> inputs = data.inputs(first, rows);
+            const math::BasicRowView<const T> targets = data.targets(first, rows);
+            std::copy(inputs.begin(), inputs.end(), ws.input.data());
+            forward(net, ws);
+            quantized.forward(inputs.data(), rows, logits.data(), qws);
+
+            const T* reference = ws.logits().data();
+            for (std::size_t i = 0; i < targets.size(); ++i) {
+                const double difference = std::abs(static_cast<double>(math::sigmoid(logits.data()[i])) - static_cast<double>(math::sigmoid(reference[i])));
+                report.max_difference = std::max(report.max_difference, difference);
+                report.mean_difference += difference;
+                agreeing += (logits.data()[i] > T(0)) == (reference[i] > T(0));
+            }
+            report.loss += math::bce_with_logits_loss<double>(ws.logits().flat(), targets);
+            report.quantized_loss += math::bce_with_logits_loss<double>(logits.flat(), targets);
+        }
+
+        const double outputs = static_cast<double>(data.size() * data.output_count());
+        report.mean_difference /= outputs;
+        report.agreement = static_cast<double>(agreeing) / outputs;
+        report.loss /= outputs;
+        report.quantized_loss /= outputs;
+        return report;
+    }
+
+}
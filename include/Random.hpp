@@ -1,23 +1,198 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
 #include <random>
 #include <stdexcept>
+#include <thread>
 #include <vector>
+
+#include "Simd.hpp"
+#include "ThreadPool.hpp"
+
 /**
  * Random.hpp
  * My custom header-only library for random number generation.
- * In this project, only Random::Double() is used.
+ *
+ * Xoshiro256 (xoshiro256++) is the sequential generator: 32 bytes of state, a few adds, xors and
+ * rotates per number. Philox (Philox4x32-10) is counter-based: the n-th number of a stream is a
+ * pure function of (seed, stream, n), so a buffer can be filled by any number of threads, in any
+ * order, with the same result. Streams for different ids are derived from the seed with SplitMix64.
+ */
+
+#pragma region generators
+
+/**
+ * SplitMix64, used to expand seeds and stream ids into generator state
+ */
+struct SplitMix64 {
+    std::uint64_t state = 0;
+
+    static constexpr std::uint64_t Mix(std::uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    std::uint64_t operator()() { return Mix(state += 0x9E3779B97F4A7C15ull); }
+};
+
+/**
+ * xoshiro256++ (Blackman, Vigna). A UniformRandomBitGenerator, so it also works with <random>.
  */
+class Xoshiro256 {
+private:
+    std::uint64_t s[4] = { 1, 0, 0, 0 };
+
+    static constexpr std::uint64_t Rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    using result_type = std::uint64_t;
+
+    Xoshiro256() = default;
+
+    /**
+     * @param stream independent sequence of the same seed, e.g. one per thread
+     */
+    explicit Xoshiro256(std::uint64_t seed, std::uint64_t stream = 0) {
+        SplitMix64 init{ SplitMix64::Mix(seed) ^ SplitMix64::Mix(stream + 0x632BE59BD9B4E019ull) };
+        for (std::uint64_t& word : s) word = init();
+    }
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() {
+        const std::uint64_t result = Rotl(s[0] + s[3], 23) + s[0];
+        const std::uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = Rotl(s[3], 45);
+        return result;
+    }
+
+    /**
+     * @return uniform double in [0 ; 1), from the top 53 bits
+     */
+    double Unit() { return static_cast<double>((*this)() >> 11) * 0x1.0p-53; }
+
+    /**
+     * @return uniform integer in [0 ; bound), without modulo bias (Lemire's multiply-shift)
+     */
+    std::uint32_t Below(std::uint32_t bound) {
+        std::uint64_t m = ((*this)() >> 32) * bound;
+        if (static_cast<std::uint32_t>(m) < bound) {
+            const std::uint32_t threshold = static_cast<std::uint32_t>(-bound) % bound;
+            while (static_cast<std::uint32_t>(m) < threshold) m = ((*this)() >> 32) * bound;
+        }
+        return static_cast<std::uint32_t>(m >> 32);
+    }
+
+    /**
+     * @return uniform integer in [0 ; bound) for any 64-bit bound; the same draws as Below() for bounds that fit 32 bits
+     */
+    std::uint64_t Below64(std::uint64_t bound) {
+        if (bound <= std::numeric_limits<std::uint32_t>::max()) return Below(static_cast<std::uint32_t>(bound));
+
+        // rejection from the smallest power of two covering bound: fewer than 2 draws on average
+        std::uint64_t mask = bound - 1;
+        for (unsigned shift = 1; shift < 64; shift *= 2) mask |= mask >> shift;
+        std::uint64_t x;
+        do x = (*this)() & mask; while (x >= bound);
+        return x;
+    }
+};
+
+/**
+ * Philox4x32-10 (Salmon et al.): each 128-bit counter encrypts to 128 random bits under a 64-bit key.
+ * Blocks run on the SIMD kernel of math::simd, several counters per register.
+ */
+class Philox {
+private:
+    std::uint64_t key;
+
+public:
+    /**
+     * Counter blocks generated per kernel call in Fill
+     */
+    static constexpr std::size_t BLOCKS = 64;
+
+    explicit Philox(std::uint64_t seed) : key(SplitMix64::Mix(seed)) {}
+
+    /**
+     * out[2i], out[2i + 1] = the two 64-bit words of counter block (first + i, stream), for i < count
+     */
+    void Blocks(std::uint64_t stream, std::uint64_t first, std::size_t count, std::uint64_t* out) const {
+        math::simd::kernels<double>().philox(key, stream, first, count, out);
+    }
+
+    /**
+     * out[i] = min + (max - min) * u(first + i), with u(n) the n-th uniform [0 ; 1) number of the stream.
+     * Number n is word n % 2 of block n / 2; its top 52 bits become the mantissa of a double in [1 ; 2).
+     */
+    template <typename T>
+    void Fill(std::uint64_t stream, std::uint64_t first, T* out, std::size_t n, double min, double max) const {
+        std::uint64_t words[2 * BLOCKS];
+        std::uint64_t index = first;
+        std::size_t done = 0;
+        while (done < n) {
+            const std::size_t skip = static_cast<std::size_t>(index % 2);
+            const std::size_t count = std::min<std::size_t>(2 * BLOCKS - skip, n - done);
+            Blocks(stream, index / 2, (skip + count + 1) / 2, words);
+            for (std::size_t w = 0; w < count; ++w) {
+                const std::uint64_t bits = (words[skip + w] >> 12) | 0x3FF0000000000000ull;
+                double unit;
+                std::memcpy(&unit, &bits, sizeof(unit));
+                out[done + w] = static_cast<T>(min + (max - min) * (unit - 1.0));
+            }
+            done += count;
+            index += count;
+        }
+    }
+};
+
+#pragma endregion
+
 class Random {
 private:
-    static inline int seed = 0;
-    static inline bool isInitialized = false;
-    static inline std::mt19937 engine;
+    static inline std::uint64_t seed = 0;
+    static inline std::atomic<bool> isInitialized{ false };
+    static inline std::thread::id initThread;
+    static inline std::atomic<std::uint64_t> nextStream{ 1 };
 
     Random() = delete;
     ~Random() = delete;
 
+    /**
+     * Elements per task of a parallel fill
+     */
+    static constexpr std::size_t FILL_GRAIN = std::size_t(1) << 15;
+
+    /**
+     * @return this thread's engine: stream 0 on the thread that called Init, a fresh stream on any other
+     */
+    static Xoshiro256& ThisEngine() {
+        thread_local bool seeded = false;
+        thread_local Xoshiro256 engine;
+        if (!seeded) {
+            if (!isInitialized.load(std::memory_order_acquire)) {
+                throw std::logic_error("Random generator isn't initialized! Call Random::Init() first");
+            }
+            engine = Xoshiro256(seed, std::this_thread::get_id() == initThread ? 0 : nextStream.fetch_add(1, std::memory_order_relaxed));
+            seeded = true;
+        }
+        return engine;
+    }
+
 public:
     /**
      * Initialize an engine
@@ -25,34 +200,73 @@ public:
      */
     static void Init(int initSeed) {
         if (!isInitialized) {
-            seed = initSeed;
-            engine.seed(initSeed);
-            isInitialized = true;
+            seed = static_cast<std::uint64_t>(static_cast<std::int64_t>(initSeed));
+            initThread = std::this_thread::get_id();
+            isInitialized.store(true, std::memory_order_release);
         }
     }
 
     /**
-     * @return random float in range [min ; max]
+     * @return random double in range [min ; max), from the calling thread's engine
      */
     static double Double(double min, double max) {
-        if (!isInitialized) {
-            throw std::logic_error("Random generator isn't initialized! Call Random::Init() first");
-        }
+        return min + (max - min) * ThisEngine().Unit();
+    }
 
-        std::uniform_real_distribution<double> dist(min, max);
-        return dist(engine);
+    /**
+     * @return engine for stream id, the same sequence for the same seed on any thread.
+     *         Give each parallel task its own id for reproducible results.
+     */
+    static Xoshiro256 Stream(std::uint64_t id) {
+        if (!isInitialized) throw std::logic_error("Random generator isn't initialized! Call Random::Init() first");
+        return Xoshiro256(seed, id);
     }
 
-#ifdef FULL_RANDOM
     /**
-     * @return randoms engine
+     * Fills out[0, n) with uniform numbers in [min ; max). Element i only depends on the seed, stream
+     * and i, so large buffers are split across the thread pool without changing the result.
      */
-    static std::mt19937 Engine() {
-        if (!isInitialized) {
-            throw std::logic_error("Random generator isn't initialized! Call Random::Init() first");
+    template <typename T>
+    static void Uniform(T* out, std::size_t n, double min, double max, std::uint64_t stream) {
+        if (!isInitialized) throw std::logic_error("Random generator isn't initialized! Call Random::Init() first");
+        const Philox philox(seed);
+
+        if (n < 2 * FILL_GRAIN) {
+            philox.Fill(stream, 0, out, n, min, max);
+            return;
         }
+        ThreadPool::Global().ParallelFor(0, n, FILL_GRAIN, [&](std::size_t begin, std::size_t end) {
+            philox.Fill(stream, begin, out + begin, end - begin, min, max);
+        });
+    }
 
-        return engine;
+    /**
+     * Fisher-Yates shuffle of [first ; last) driven by engine
+     */
+    template <typename RandomIt>
+    static void Shuffle(RandomIt first, RandomIt last, Xoshiro256& engine) {
+        const auto count = last - first;
+        for (auto i = count; i > 1; --i) {
+            const auto j = static_cast<decltype(count)>(engine.Below64(static_cast<std::uint64_t>(i)));
+            std::iter_swap(first + (i - 1), first + j);
+        }
+    }
+
+    /**
+     * Fills out[0, n) with a random permutation of 0 .. n - 1
+     */
+    template <typename Index>
+    static void Permutation(Index* out, std::size_t n, Xoshiro256& engine) {
+        for (std::size_t i = 0; i < n; ++i) out[i] = static_cast<Index>(i);
+        Shuffle(out, out + n, engine);
+    }
+
+#ifdef FULL_RANDOM
+    /**
+     * @return copy of the calling thread's engine
+     */
+    static Xoshiro256 Engine() {
+        return ThisEngine();
     }
 
     /**
@@ -64,7 +278,7 @@ public:
         }
 
         std::uniform_int_distribution<int> dist(min, max);
-        return dist(engine);
+        return dist(ThisEngine());
     }
 
     /**
@@ -76,7 +290,7 @@ public:
         }
 
         std::uniform_real_distribution<float> dist(min, max);
-        return dist(engine);
+        return dist(ThisEngine());
     }
 
 
@@ -91,7 +305,7 @@ public:
         }
 
         std::uniform_real_distribution<float> dist(0.0f, 100.0f);
-        return dist(engine) <= p;
+        return dist(ThisEngine()) <= p;
     }
 
     /**
@@ -0,0 +1,1761 @@
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MATH_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+/**
+ * Simd.hpp
+ * Hand-vectorized kernels behind Math.hpp.
+ * The widest instruction set the CPU supports is picked once at startup via CPUID,
+ * so one binary built for generic x86-64 still runs AVX2 / AVX-512 code where available.
+ * Every kernel keeps several independent accumulators to hide FMA latency.
+ * Tables exist for double and for float; float doubles the lanes per register.
+ * dot_wide accumulates float products in double, for mixed-precision reductions.
+ * The *_step kernels are the fused optimizer updates; each makes one pass over the weights,
+ * the gradients and the optimizer state (see UpdateStep).
+ * gemm_i8 is the 8-bit integer product of quantized inference, summed exactly in 32 bits;
+ * with AVX-512 it uses VNNI (vpdpbusd) where the CPU has it.
+ *
+ * The *_fast kernels are polynomial approximations of transcendental functions, evaluated
+ * the same way on every ISA. Max error measured against long double references:
+ *   exp_fast     3 ULP     inputs clamped to [-708, 709]
+ *   log_fast     2 ULP     zero, negative, subnormal, inf and NaN inputs fall back to std::log
+ *   log1p_fast   3 ULP     same fallback for 1 + u
+ *   tanh_fast    6 ULP
+ *   sigmoid_fast 3 ULP
+ * NaN inputs give NaN on every ISA. Float data is widened to double and the result rounded back.
+ * tests/FastMathTests.cpp checks these bounds and the special values per ISA.
+ */
+namespace math::simd {
+
+    enum class Isa { Scalar, SSE2, AVX2, AVX512 };
+
+    // register tile of the gemm micro-kernel, see math::gemm
+    constexpr std::size_t GEMM_MR = 4;
+    constexpr std::size_t GEMM_NR = 8;
+
+    // gemm_i8 takes A in blocks of I8_ROWS rows, zero-padded; a block stores, for each group of I8_DEPTH
+    // columns (the last one zero-padded), the I8_DEPTH bytes of each of its rows in turn: 64 bytes per
+    // group, which is what one vpdpbusd multiplies by four bytes of x
+    constexpr std::size_t I8_ROWS = 16;
+    constexpr std::size_t I8_DEPTH = 4;
+
+    /**
+     * Shared constants of the *_fast approximations
+     */
+    namespace approx {
+
+        constexpr double EXP_MIN = -708.0;
+        constexpr double EXP_MAX = 709.0;
+        constexpr double LOG2E = 1.4426950408889634;
+        // ln 2 split so that n * LN2_HI is exact for |n| < 2^20
+        constexpr double LN2_HI = 6.93147180369123816490e-01;
+        constexpr double LN2_LO = 1.90821492927058770002e-10;
+        constexpr double SQRT2 = 1.4142135623730951;
+        // adding it to a double holding a small integer leaves that integer in the low mantissa bits
+        constexpr double ROUND_MAGIC = 6755399441055744.0;
+        constexpr double TWO_52 = 4503599627370496.0;
+
+        // 1/k! for k = 2..12: e^r - 1 = r + r^2 * (1/2! + r/3! + ...), |r| <= ln2 / 2
+        constexpr double EXP_POLY[] = {
+            1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040, 1.0 / 40320,
+            1.0 / 362880, 1.0 / 3628800, 1.0 / 39916800, 1.0 / 479001600
+        };
+        constexpr std::size_t EXP_POLY_SIZE = sizeof(EXP_POLY) / sizeof(EXP_POLY[0]);
+
+        // 1/(2k+1) for k = 1..10: log(m) = 2s * (1 + s^2/3 + s^4/5 + ...), s = (m-1)/(m+1), |s| <= 0.172
+        constexpr double LOG_POLY[] = {
+            1.0 / 3, 1.0 / 5, 1.0 / 7, 1.0 / 9, 1.0 / 11, 1.0 / 13, 1.0 / 15, 1.0 / 17, 1.0 / 19, 1.0 / 21
+        };
+        constexpr std::size_t LOG_POLY_SIZE = sizeof(LOG_POLY) / sizeof(LOG_POLY[0]);
+
+    }
+
+    /**
+     * Constants of Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+     */
+    namespace philox {
+
+        constexpr std::uint64_t M0 = 0xD2511F53u;
+        constexpr std::uint64_t M1 = 0xCD9E8D57u;
+        constexpr std::uint32_t W0 = 0x9E3779B9u;
+        constexpr std::uint32_t W1 = 0xBB67AE85u;
+        constexpr std::size_t ROUNDS = 10;
+        constexpr std::uint64_t LOW = 0xFFFFFFFFu;
+
+    }
+
+    /**
+     * Constants of one optimizer step, folded by the caller (see nn::update_step).
+     * With gradient g and g' = g + decay * w, the update kernels compute
+     *   sgd_step       w -= rate * g'
+     *   momentum_step  v = momentum * v + g', then w -= rate * (velocity_weight * v + gradient_weight * g')
+     *   adam_step      m = beta1 * m + (1 - beta1) * g', v = beta2 * v + (1 - beta2) * g'^2,
+     *                  then w = keep * w - rate * m / (sqrt(v) + epsilon)
+     */
+    template <typename T>
+    struct UpdateStep {
+        T rate = T(0);
+        T decay = T(0);
+        T keep = T(1);
+        T momentum = T(0);
+        T velocity_weight = T(1);
+        T gradient_weight = T(0);
+        T beta1 = T(0);
+        T beta2 = T(0);
+        T epsilon = T(0);
+    };
+
+    template <typename T>
+    struct BasicKernels {
+        Isa isa;
+        const char* name;
+
+        T (*dot)(const T* a, const T* b, std::size_t n);
+        // y += alpha * x
+        void (*axpy)(T alpha, const T* x, T* y, std::size_t n);
+        // y += a * b element-wise
+        void (*mul_add)(const T* a, const T* b, T* y, std::size_t n);
+        // out = alpha * x
+        void (*scale)(const T* x, T alpha, T* out, std::size_t n);
+        // out = a + b
+        void (*add)(const T* a, const T* b, T* out, std::size_t n);
+        // out = a - b
+        void (*sub)(const T* a, const T* b, T* out, std::size_t n);
+        // y = A * x for a row-major rows x cols matrix with the given row stride
+        void (*gemv)(const T* a, std::size_t rows, std::size_t cols, std::size_t stride, const T* x, T* y);
+        // y_s = A * x_s in 8-bit integers summed in 32 bits, for elements in [-127, 127] and s < samples:
+        // A packed as described at I8_ROWS, x_s at x + s * (cols rounded up to I8_DEPTH), y_s at y + s * rows
+        void (*gemm_i8)(const std::int8_t* a, std::size_t rows, std::size_t cols, const std::int8_t* x, std::size_t samples, std::int32_t* y);
+        // tile (GEMM_MR x GEMM_NR, row-major) = sum over kc packed columns of a and rows of b
+        void (*gemm_micro)(std::size_t kc, const T* a, const T* b, T* tile);
+
+        // out = f(x) element-wise, see the accuracy table above
+        void (*exp_fast)(const T* x, T* out, std::size_t n);
+        void (*log_fast)(const T* x, T* out, std::size_t n);
+        void (*log1p_fast)(const T* x, T* out, std::size_t n);
+        void (*tanh_fast)(const T* x, T* out, std::size_t n);
+        void (*sigmoid_fast)(const T* x, T* out, std::size_t n);
+
+        // dot accumulated in double
+        double (*dot_wide)(const T* a, const T* b, std::size_t n);
+
+        // out[2i], out[2i + 1] = Philox4x32-10 of counter (first + i, stream) under key, for i < blocks
+        void (*philox)(std::uint64_t key, std::uint64_t stream, std::uint64_t first, std::size_t blocks, std::uint64_t* out);
+
+        // fused optimizer updates of n weights w from their gradients g and optimizer state v (and m), see UpdateStep
+        void (*sgd_step)(T* w, const T* g, std::size_t n, const UpdateStep<T>& step);
+        void (*momentum_step)(T* w, const T* g, T* v, std::size_t n, const UpdateStep<T>& step);
+        void (*adam_step)(T* w, const T* g, T* m, T* v, std::size_t n, const UpdateStep<T>& step);
+    };
+
+    using Kernels = BasicKernels<double>;
+    using KernelsF = BasicKernels<float>;
+
+#pragma region scalar
+
+    namespace scalar {
+
+        template <typename T>
+        inline T dot(const T* a, const T* b, std::size_t n) {
+            T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                s0 += a[i] * b[i];
+                s1 += a[i + 1] * b[i + 1];
+                s2 += a[i + 2] * b[i + 2];
+                s3 += a[i + 3] * b[i + 3];
+            }
+            for (; i < n; ++i) s0 += a[i] * b[i];
+            return (s0 + s1) + (s2 + s3);
+        }
+
+        template <typename T>
+        inline double dot_wide(const T* a, const T* b, std::size_t n) {
+            double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                s0 += double(a[i]) * double(b[i]);
+                s1 += double(a[i + 1]) * double(b[i + 1]);
+                s2 += double(a[i + 2]) * double(b[i + 2]);
+                s3 += double(a[i + 3]) * double(b[i + 3]);
+            }
+            for (; i < n; ++i) s0 += double(a[i]) * double(b[i]);
+            return (s0 + s1) + (s2 + s3);
+        }
+
+        template <typename T>
+        inline void axpy(T alpha, const T* x, T* y, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) y[i] += alpha * x[i];
+        }
+
+        template <typename T>
+        inline void mul_add(const T* a, const T* b, T* y, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) y[i] += a[i] * b[i];
+        }
+
+        template <typename T>
+        inline void scale(const T* x, T alpha, T* out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = x[i] * alpha;
+        }
+
+        template <typename T>
+        inline void add(const T* a, const T* b, T* out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = a[i] + b[i];
+        }
+
+        template <typename T>
+        inline void sub(const T* a, const T* b, T* out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = a[i] - b[i];
+        }
+
+        template <typename T>
+        inline void gemv(const T* a, std::size_t rows, std::size_t cols, std::size_t stride, const T* x, T* y) {
+            for (std::size_t i = 0; i < rows; ++i, a += stride) y[i] = dot(a, x, cols);
+        }
+
+        /**
+         * A packed as described at I8_ROWS; x_s zero-padded to cols rounded up to I8_DEPTH
+         */
+        inline void gemm_i8(const std::int8_t* a, std::size_t rows, std::size_t cols, const std::int8_t* x, std::size_t samples, std::int32_t* y) {
+            const std::size_t groups = (cols + I8_DEPTH - 1) / I8_DEPTH;
+            for (std::size_t s = 0; s < samples; ++s, x += groups * I8_DEPTH, y += rows) {
+                for (std::size_t i = 0; i < rows; ++i) {
+                    const std::int8_t* block = a + (i / I8_ROWS) * groups * I8_ROWS * I8_DEPTH + (i % I8_ROWS) * I8_DEPTH;
+                    std::int32_t sum = 0;
+                    for (std::size_t g = 0; g < groups; ++g, block += I8_ROWS * I8_DEPTH) {
+                        for (std::size_t d = 0; d < I8_DEPTH; ++d) sum += std::int32_t(block[d]) * std::int32_t(x[g * I8_DEPTH + d]);
+                    }
+                    y[i] = sum;
+                }
+            }
+        }
+
+        template <typename T>
+        inline void gemm_micro(std::size_t kc, const T* a, const T* b, T* tile) {
+            T acc[GEMM_MR * GEMM_NR] = {};
+            for (std::size_t k = 0; k < kc; ++k, a += GEMM_MR, b += GEMM_NR) {
+                for (std::size_t r = 0; r < GEMM_MR; ++r) {
+                    const T ar = a[r];
+                    for (std::size_t c = 0; c < GEMM_NR; ++c) acc[r * GEMM_NR + c] += ar * b[c];
+                }
+            }
+            std::memcpy(tile, acc, sizeof(acc));
+        }
+
+        /**
+         * Splits x = n ln2 + r and returns e^r - 1, with two_n = 2^n
+         */
+        inline double exp_parts(double x, double& two_n) {
+            using namespace approx;
+            x = std::min(std::max(x, EXP_MIN), EXP_MAX);
+            const double n = std::nearbyint(x * LOG2E);
+            const double r = (x - n * LN2_HI) - n * LN2_LO;
+
+            double q = EXP_POLY[EXP_POLY_SIZE - 1];
+            for (std::size_t i = EXP_POLY_SIZE - 1; i-- > 0;) q = q * r + EXP_POLY[i];
+
+            const std::uint64_t bits = static_cast<std::uint64_t>(static_cast<std::int64_t>(n) + 1023) << 52;
+            std::memcpy(&two_n, &bits, sizeof(bits));
+            return r + r * r * q;
+        }
+
+        inline double exp_one(double x) {
+            double two_n;
+            const double p = exp_parts(x, two_n);
+            return two_n * p + two_n;
+        }
+
+        inline double expm1_one(double x) {
+            double two_n;
+            const double p = exp_parts(x, two_n);
+            return two_n * p + (two_n - 1.0);
+        }
+
+        inline double log_one(double x) {
+            using namespace approx;
+            if (!(x >= DBL_MIN) || x == HUGE_VAL) return std::log(x);
+
+            std::uint64_t bits;
+            std::memcpy(&bits, &x, sizeof(bits));
+            double e = static_cast<double>(static_cast<std::int64_t>(bits >> 52) - 1023);
+            bits = (bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull;
+            double m;
+            std::memcpy(&m, &bits, sizeof(m));
+            if (m > SQRT2) {
+                m *= 0.5;
+                e += 1.0;
+            }
+
+            const double f = m - 1.0;
+            const double s = f / (2.0 + f);
+            const double z = s * s;
+            double q = LOG_POLY[LOG_POLY_SIZE - 1];
+            for (std::size_t i = LOG_POLY_SIZE - 1; i-- > 0;) q = q * z + LOG_POLY[i];
+
+            const double two_s = 2.0 * s;
+            return e * LN2_HI + (e * LN2_LO + (two_s + two_s * z * q));
+        }
+
+        inline double log1p_one(double u) {
+            const double w = 1.0 + u;
+            if (!(w >= DBL_MIN) || w == HUGE_VAL) return std::log1p(u);
+            // (u - (w - 1)) / w corrects for the rounding of 1 + u
+            return log_one(w) + (u - (w - 1.0)) / w;
+        }
+
+        /**
+         * tanh|x| = -t / (t + 2) with t = e^(-2|x|) - 1, which stays accurate near 0
+         */
+        inline double tanh_one(double x) {
+            const double t = expm1_one(-2.0 * std::fabs(x));
+            return std::copysign(-t / (t + 2.0), x);
+        }
+
+        inline double sigmoid_one(double x) {
+            return 1.0 / (1.0 + exp_one(-x));
+        }
+
+        inline void exp_fast(const double* x, double* out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = exp_one(x[i]);
+        }
+
+        inline void log_fast(const double* x, double* out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = log_one(x[i]);
+        }
+
+        inline void log1p_fast(const double* x, double* out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = log1p_one(x[i]);
+        }
+
+        inline void tanh_fast(const double* x, double* out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = tanh_one(x[i]);
+        }
+
+        inline void sigmoid_fast(const double* x, double* out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) out[i] = sigmoid_one(x[i]);
+        }
+
+        inline void philox(std::uint64_t key, std::uint64_t stream, std::uint64_t first, std::size_t blocks, std::uint64_t* out) {
+            using namespace simd::philox;
+            for (std::size_t i = 0; i < blocks; ++i) {
+                std::uint32_t c0 = static_cast<std::uint32_t>(first + i), c1 = static_cast<std::uint32_t>((first + i) >> 32);
+                std::uint32_t c2 = static_cast<std::uint32_t>(stream), c3 = static_cast<std::uint32_t>(stream >> 32);
+                std::uint32_t k0 = static_cast<std::uint32_t>(key), k1 = static_cast<std::uint32_t>(key >> 32);
+                for (std::size_t round = 0; round < ROUNDS; ++round) {
+                    const std::uint64_t p0 = M0 * c0;
+                    const std::uint64_t p1 = M1 * c2;
+                    c0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+                    c2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+                    c1 = static_cast<std::uint32_t>(p1);
+                    c3 = static_cast<std::uint32_t>(p0);
+                    k0 += W0;
+                    k1 += W1;
+                }
+                out[2 * i] = (std::uint64_t(c1) << 32) | c0;
+                out[2 * i + 1] = (std::uint64_t(c3) << 32) | c2;
+            }
+        }
+
+        /**
+         * The gradients may be wider than the weights (mixed-precision bias sums); the update is
+         * then computed in the wider type and rounded once
+         */
+        template <typename T, typename G>
+        inline void sgd_step(T* w, const G* g, std::size_t n, const UpdateStep<T>& step) {
+            for (std::size_t i = 0; i < n; ++i) w[i] -= static_cast<T>(step.rate * (g[i] + step.decay * w[i]));
+        }
+
+        template <typename T, typename G>
+        inline void momentum_step(T* w, const G* g, T* v, std::size_t n, const UpdateStep<T>& step) {
+            for (std::size_t i = 0; i < n; ++i) {
+                const auto grad = g[i] + step.decay * w[i];
+                v[i] = static_cast<T>(step.momentum * v[i] + grad);
+                w[i] -= static_cast<T>(step.rate * (step.velocity_weight * v[i] + step.gradient_weight * grad));
+            }
+        }
+
+        template <typename T, typename G>
+        inline void adam_step(T* w, const G* g, T* m, T* v, std::size_t n, const UpdateStep<T>& step) {
+            const T one_minus_beta1 = T(1) - step.beta1;
+            const T one_minus_beta2 = T(1) - step.beta2;
+            for (std::size_t i = 0; i < n; ++i) {
+                const auto grad = g[i] + step.decay * w[i];
+                m[i] = static_cast<T>(step.beta1 * m[i] + one_minus_beta1 * grad);
+                v[i] = static_cast<T>(step.beta2 * v[i] + one_minus_beta2 * grad * grad);
+                w[i] = step.keep * w[i] - step.rate * m[i] / (std::sqrt(v[i]) + step.epsilon);
+            }
+        }
+
+    }
+
+#pragma endregion
+#ifdef MATH_SIMD_X86
+#pragma region sse2
+
+    namespace sse2 {
+
+        // float and dot_wide use the scalar templates, which the compiler vectorizes for SSE2 anyway
+        using scalar::dot;
+        using scalar::dot_wide;
+        using scalar::axpy;
+        using scalar::mul_add;
+        using scalar::scale;
+        using scalar::add;
+        using scalar::sub;
+        using scalar::gemv;
+        using scalar::gemm_i8;
+        using scalar::gemm_micro;
+        using scalar::sgd_step;
+        using scalar::momentum_step;
+        using scalar::adam_step;
+
+        __attribute__((target("sse2"))) inline double hsum(__m128d v) {
+            return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+        }
+
+        __attribute__((target("sse2"))) inline double dot(const double* a, const double* b, std::size_t n) {
+            __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd(), s2 = _mm_setzero_pd(), s3 = _mm_setzero_pd();
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+                s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+                s2 = _mm_add_pd(s2, _mm_mul_pd(_mm_loadu_pd(a + i + 4), _mm_loadu_pd(b + i + 4)));
+                s3 = _mm_add_pd(s3, _mm_mul_pd(_mm_loadu_pd(a + i + 6), _mm_loadu_pd(b + i + 6)));
+            }
+            for (; i + 2 <= n; i += 2) s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            double sum = hsum(_mm_add_pd(_mm_add_pd(s0, s1), _mm_add_pd(s2, s3)));
+            for (; i < n; ++i) sum += a[i] * b[i];
+            return sum;
+        }
+
+        __attribute__((target("sse2"))) inline void axpy(double alpha, const double* x, double* y, std::size_t n) {
+            const __m128d va = _mm_set1_pd(alpha);
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(va, _mm_loadu_pd(x + i))));
+                _mm_storeu_pd(y + i + 2, _mm_add_pd(_mm_loadu_pd(y + i + 2), _mm_mul_pd(va, _mm_loadu_pd(x + i + 2))));
+            }
+            for (; i < n; ++i) y[i] += alpha * x[i];
+        }
+
+        __attribute__((target("sse2"))) inline void mul_add(const double* a, const double* b, double* y, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2) _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i))));
+            for (; i < n; ++i) y[i] += a[i] * b[i];
+        }
+
+        __attribute__((target("sse2"))) inline void scale(const double* x, double alpha, double* out, std::size_t n) {
+            const __m128d va = _mm_set1_pd(alpha);
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(x + i), va));
+            for (; i < n; ++i) out[i] = x[i] * alpha;
+        }
+
+        __attribute__((target("sse2"))) inline void add(const double* a, const double* b, double* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            for (; i < n; ++i) out[i] = a[i] + b[i];
+        }
+
+        __attribute__((target("sse2"))) inline void sub(const double* a, const double* b, double* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2) _mm_storeu_pd(out + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            for (; i < n; ++i) out[i] = a[i] - b[i];
+        }
+
+        __attribute__((target("sse2"))) inline void gemv(const double* a, std::size_t rows, std::size_t cols, std::size_t stride, const double* x, double* y) {
+            for (std::size_t i = 0; i < rows; ++i, a += stride) y[i] = dot(a, x, cols);
+        }
+
+        __attribute__((target("sse2"))) inline void gemm_micro(std::size_t kc, const double* a, const double* b, double* tile) {
+            __m128d c[GEMM_MR][GEMM_NR / 2];
+            for (auto& row : c) for (auto& v : row) v = _mm_setzero_pd();
+
+            for (std::size_t k = 0; k < kc; ++k, a += GEMM_MR, b += GEMM_NR) {
+                const __m128d b0 = _mm_loadu_pd(b), b1 = _mm_loadu_pd(b + 2), b2 = _mm_loadu_pd(b + 4), b3 = _mm_loadu_pd(b + 6);
+                for (std::size_t r = 0; r < GEMM_MR; ++r) {
+                    const __m128d ar = _mm_set1_pd(a[r]);
+                    c[r][0] = _mm_add_pd(c[r][0], _mm_mul_pd(ar, b0));
+                    c[r][1] = _mm_add_pd(c[r][1], _mm_mul_pd(ar, b1));
+                    c[r][2] = _mm_add_pd(c[r][2], _mm_mul_pd(ar, b2));
+                    c[r][3] = _mm_add_pd(c[r][3], _mm_mul_pd(ar, b3));
+                }
+            }
+
+            for (std::size_t r = 0; r < GEMM_MR; ++r) {
+                for (std::size_t v = 0; v < GEMM_NR / 2; ++v) _mm_storeu_pd(tile + r * GEMM_NR + v * 2, c[r][v]);
+            }
+        }
+
+    }
+
+#pragma endregion
+#pragma region avx2
+
+    namespace avx2 {
+
+        __attribute__((target("avx2,fma"))) inline double hsum(__m256d v) {
+            __m128d lo = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+        }
+
+        __attribute__((target("avx2,fma"))) inline double dot(const double* a, const double* b, std::size_t n) {
+            __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+                s1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), s1);
+                s2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8), s2);
+                s3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), s3);
+            }
+            for (; i + 4 <= n; i += 4) s0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), s0);
+            double sum = hsum(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+            for (; i < n; ++i) sum += a[i] * b[i];
+            return sum;
+        }
+
+        __attribute__((target("avx2,fma"))) inline void axpy(double alpha, const double* x, double* y, std::size_t n) {
+            const __m256d va = _mm256_set1_pd(alpha);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+                _mm256_storeu_pd(y + i + 4, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+            }
+            for (; i + 4 <= n; i += 4) _mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+            for (; i < n; ++i) y[i] += alpha * x[i];
+        }
+
+        __attribute__((target("avx2,fma"))) inline void mul_add(const double* a, const double* b, double* y, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) _mm256_storeu_pd(y + i, _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), _mm256_loadu_pd(y + i)));
+            for (; i < n; ++i) y[i] += a[i] * b[i];
+        }
+
+        __attribute__((target("avx2,fma"))) inline void scale(const double* x, double alpha, double* out, std::size_t n) {
+            const __m256d va = _mm256_set1_pd(alpha);
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), va));
+            for (; i < n; ++i) out[i] = x[i] * alpha;
+        }
+
+        __attribute__((target("avx2,fma"))) inline void add(const double* a, const double* b, double* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+            for (; i < n; ++i) out[i] = a[i] + b[i];
+        }
+
+        __attribute__((target("avx2,fma"))) inline void sub(const double* a, const double* b, double* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+            for (; i < n; ++i) out[i] = a[i] - b[i];
+        }
+
+        /**
+         * Four rows at a time, so every load of x feeds four FMAs
+         */
+        __attribute__((target("avx2,fma"))) inline void gemv(const double* a, std::size_t rows, std::size_t cols, std::size_t stride, const double* x, double* y) {
+            std::size_t i = 0;
+            for (; i + 4 <= rows; i += 4, a += 4 * stride) {
+                const double* r0 = a;
+                const double* r1 = a + stride;
+                const double* r2 = a + 2 * stride;
+                const double* r3 = a + 3 * stride;
+                __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+                std::size_t j = 0;
+                for (; j + 4 <= cols; j += 4) {
+                    const __m256d vx = _mm256_loadu_pd(x + j);
+                    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(r0 + j), vx, s0);
+                    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(r1 + j), vx, s1);
+                    s2 = _mm256_fmadd_pd(_mm256_loadu_pd(r2 + j), vx, s2);
+                    s3 = _mm256_fmadd_pd(_mm256_loadu_pd(r3 + j), vx, s3);
+                }
+                double t0 = hsum(s0), t1 = hsum(s1), t2 = hsum(s2), t3 = hsum(s3);
+                for (; j < cols; ++j) {
+                    t0 += r0[j] * x[j];
+                    t1 += r1[j] * x[j];
+                    t2 += r2[j] * x[j];
+                    t3 += r3[j] * x[j];
+                }
+                y[i] = t0;
+                y[i + 1] = t1;
+                y[i + 2] = t2;
+                y[i + 3] = t3;
+            }
+            for (; i < rows; ++i, a += stride) y[i] = dot(a, x, cols);
+        }
+
+        __attribute__((target("avx2,fma"))) inline void gemm_micro(std::size_t kc, const double* a, const double* b, double* tile) {
+            __m256d c00 = _mm256_setzero_pd(), c01 = _mm256_setzero_pd();
+            __m256d c10 = _mm256_setzero_pd(), c11 = _mm256_setzero_pd();
+            __m256d c20 = _mm256_setzero_pd(), c21 = _mm256_setzero_pd();
+            __m256d c30 = _mm256_setzero_pd(), c31 = _mm256_setzero_pd();
+
+            for (std::size_t k = 0; k < kc; ++k, a += GEMM_MR, b += GEMM_NR) {
+                const __m256d b0 = _mm256_loadu_pd(b);
+                const __m256d b1 = _mm256_loadu_pd(b + 4);
+                __m256d ar = _mm256_broadcast_sd(a);
+                c00 = _mm256_fmadd_pd(ar, b0, c00);
+                c01 = _mm256_fmadd_pd(ar, b1, c01);
+                ar = _mm256_broadcast_sd(a + 1);
+                c10 = _mm256_fmadd_pd(ar, b0, c10);
+                c11 = _mm256_fmadd_pd(ar, b1, c11);
+                ar = _mm256_broadcast_sd(a + 2);
+                c20 = _mm256_fmadd_pd(ar, b0, c20);
+                c21 = _mm256_fmadd_pd(ar, b1, c21);
+                ar = _mm256_broadcast_sd(a + 3);
+                c30 = _mm256_fmadd_pd(ar, b0, c30);
+                c31 = _mm256_fmadd_pd(ar, b1, c31);
+            }
+
+            _mm256_storeu_pd(tile, c00);
+            _mm256_storeu_pd(tile + 4, c01);
+            _mm256_storeu_pd(tile + 8, c10);
+            _mm256_storeu_pd(tile + 12, c11);
+            _mm256_storeu_pd(tile + 16, c20);
+            _mm256_storeu_pd(tile + 20, c21);
+            _mm256_storeu_pd(tile + 24, c30);
+            _mm256_storeu_pd(tile + 28, c31);
+        }
+
+        __attribute__((target("avx2,fma"))) inline double dot_wide(const double* a, const double* b, std::size_t n) {
+            return dot(a, b, n);
+        }
+
+        __attribute__((target("avx2,fma"))) inline float hsum(__m256 v) {
+            __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+            lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+            return _mm_cvtss_f32(_mm_add_ss(lo, _mm_movehdup_ps(lo)));
+        }
+
+        __attribute__((target("avx2,fma"))) inline float dot(const float* a, const float* b, std::size_t n) {
+            __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+            std::size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+                s1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), s1);
+                s2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), s2);
+                s3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), s3);
+            }
+            for (; i + 8 <= n; i += 8) s0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), s0);
+            float sum = hsum(_mm256_add_ps(_mm256_add_ps(s0, s1), _mm256_add_ps(s2, s3)));
+            for (; i < n; ++i) sum += a[i] * b[i];
+            return sum;
+        }
+
+        /**
+         * Widens four floats at a time to double before the FMA
+         */
+        __attribute__((target("avx2,fma"))) inline double dot_wide(const float* a, const float* b, std::size_t n) {
+            __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd(), s2 = _mm256_setzero_pd(), s3 = _mm256_setzero_pd();
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                s0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i)), _mm256_cvtps_pd(_mm_loadu_ps(b + i)), s0);
+                s1 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i + 4)), _mm256_cvtps_pd(_mm_loadu_ps(b + i + 4)), s1);
+                s2 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i + 8)), _mm256_cvtps_pd(_mm_loadu_ps(b + i + 8)), s2);
+                s3 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i + 12)), _mm256_cvtps_pd(_mm_loadu_ps(b + i + 12)), s3);
+            }
+            for (; i + 4 <= n; i += 4) s0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm_loadu_ps(a + i)), _mm256_cvtps_pd(_mm_loadu_ps(b + i)), s0);
+            double sum = hsum(_mm256_add_pd(_mm256_add_pd(s0, s1), _mm256_add_pd(s2, s3)));
+            for (; i < n; ++i) sum += double(a[i]) * double(b[i]);
+            return sum;
+        }
+
+        __attribute__((target("avx2,fma"))) inline void axpy(float alpha, const float* x, float* y, std::size_t n) {
+            const __m256 va = _mm256_set1_ps(alpha);
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+                _mm256_storeu_ps(y + i + 8, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8)));
+            }
+            for (; i + 8 <= n; i += 8) _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+            for (; i < n; ++i) y[i] += alpha * x[i];
+        }
+
+        __attribute__((target("avx2,fma"))) inline void mul_add(const float* a, const float* b, float* y, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) _mm256_storeu_ps(y + i, _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), _mm256_loadu_ps(y + i)));
+            for (; i < n; ++i) y[i] += a[i] * b[i];
+        }
+
+        __attribute__((target("avx2,fma"))) inline void scale(const float* x, float alpha, float* out, std::size_t n) {
+            const __m256 va = _mm256_set1_ps(alpha);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), va));
+            for (; i < n; ++i) out[i] = x[i] * alpha;
+        }
+
+        __attribute__((target("avx2,fma"))) inline void add(const float* a, const float* b, float* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            for (; i < n; ++i) out[i] = a[i] + b[i];
+        }
+
+        __attribute__((target("avx2,fma"))) inline void sub(const float* a, const float* b, float* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) _mm256_storeu_ps(out + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            for (; i < n; ++i) out[i] = a[i] - b[i];
+        }
+
+        __attribute__((target("avx2,fma"))) inline void gemv(const float* a, std::size_t rows, std::size_t cols, std::size_t stride, const float* x, float* y) {
+            std::size_t i = 0;
+            for (; i + 4 <= rows; i += 4, a += 4 * stride) {
+                const float* r0 = a;
+                const float* r1 = a + stride;
+                const float* r2 = a + 2 * stride;
+                const float* r3 = a + 3 * stride;
+                __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps(), s2 = _mm256_setzero_ps(), s3 = _mm256_setzero_ps();
+                std::size_t j = 0;
+                for (; j + 8 <= cols; j += 8) {
+                    const __m256 vx = _mm256_loadu_ps(x + j);
+                    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(r0 + j), vx, s0);
+                    s1 = _mm256_fmadd_ps(_mm256_loadu_ps(r1 + j), vx, s1);
+                    s2 = _mm256_fmadd_ps(_mm256_loadu_ps(r2 + j), vx, s2);
+                    s3 = _mm256_fmadd_ps(_mm256_loadu_ps(r3 + j), vx, s3);
+                }
+                float t0 = hsum(s0), t1 = hsum(s1), t2 = hsum(s2), t3 = hsum(s3);
+                for (; j < cols; ++j) {
+                    t0 += r0[j] * x[j];
+                    t1 += r1[j] * x[j];
+                    t2 += r2[j] * x[j];
+                    t3 += r3[j] * x[j];
+                }
+                y[i] = t0;
+                y[i + 1] = t1;
+                y[i + 2] = t2;
+                y[i + 3] = t3;
+            }
+            for (; i < rows; ++i, a += stride) y[i] = dot(a, x, cols);
+        }
+
+        /**
+         * A float tile row fits one ymm; k is unrolled by two so eight FMA chains are in flight
+         */
+        __attribute__((target("avx2,fma"))) inline void gemm_micro(std::size_t kc, const float* a, const float* b, float* tile) {
+            __m256 c0 = _mm256_setzero_ps(), c1 = _mm256_setzero_ps(), c2 = _mm256_setzero_ps(), c3 = _mm256_setzero_ps();
+            __m256 d0 = _mm256_setzero_ps(), d1 = _mm256_setzero_ps(), d2 = _mm256_setzero_ps(), d3 = _mm256_setzero_ps();
+
+            std::size_t k = 0;
+            for (; k + 2 <= kc; k += 2, a += 2 * GEMM_MR, b += 2 * GEMM_NR) {
+                const __m256 b0 = _mm256_loadu_ps(b);
+                const __m256 b1 = _mm256_loadu_ps(b + GEMM_NR);
+                c0 = _mm256_fmadd_ps(_mm256_broadcast_ss(a), b0, c0);
+                c1 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 1), b0, c1);
+                c2 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 2), b0, c2);
+                c3 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 3), b0, c3);
+                d0 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 4), b1, d0);
+                d1 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 5), b1, d1);
+                d2 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 6), b1, d2);
+                d3 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 7), b1, d3);
+            }
+            if (k < kc) {
+                const __m256 b0 = _mm256_loadu_ps(b);
+                c0 = _mm256_fmadd_ps(_mm256_broadcast_ss(a), b0, c0);
+                c1 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 1), b0, c1);
+                c2 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 2), b0, c2);
+                c3 = _mm256_fmadd_ps(_mm256_broadcast_ss(a + 3), b0, c3);
+            }
+
+            _mm256_storeu_ps(tile, _mm256_add_ps(c0, d0));
+            _mm256_storeu_ps(tile + 8, _mm256_add_ps(c1, d1));
+            _mm256_storeu_ps(tile + 16, _mm256_add_ps(c2, d2));
+            _mm256_storeu_ps(tile + 24, _mm256_add_ps(c3, d3));
+        }
+
+        /**
+         * Four-lane version of scalar::exp_parts
+         */
+        __attribute__((target("avx2,fma"))) inline __m256d exp_parts(__m256d x, __m256d& two_n) {
+            using namespace approx;
+            // min/max return their second operand when either is NaN, so x goes second to let NaN through
+            x = _mm256_min_pd(_mm256_set1_pd(EXP_MAX), _mm256_max_pd(_mm256_set1_pd(EXP_MIN), x));
+            const __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(LN2_HI), x);
+            r = _mm256_fnmadd_pd(n, _mm256_set1_pd(LN2_LO), r);
+
+            __m256d q = _mm256_set1_pd(EXP_POLY[EXP_POLY_SIZE - 1]);
+            for (std::size_t i = EXP_POLY_SIZE - 1; i-- > 0;) q = _mm256_fmadd_pd(q, r, _mm256_set1_pd(EXP_POLY[i]));
+
+            const __m256d magic = _mm256_set1_pd(ROUND_MAGIC);
+            const __m256i ni = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n, magic)), _mm256_castpd_si256(magic));
+            two_n = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(ni, _mm256_set1_epi64x(1023)), 52));
+            return _mm256_fmadd_pd(_mm256_mul_pd(r, r), q, r);
+        }
+
+        __attribute__((target("avx2,fma"))) inline __m256d exp4(__m256d x) {
+            __m256d two_n;
+            const __m256d p = exp_parts(x, two_n);
+            return _mm256_fmadd_pd(two_n, p, two_n);
+        }
+
+        __attribute__((target("avx2,fma"))) inline __m256d tanh4(__m256d x) {
+            const __m256d sign = _mm256_set1_pd(-0.0);
+            const __m256d ax = _mm256_andnot_pd(sign, x);
+            __m256d two_n;
+            const __m256d p = exp_parts(_mm256_mul_pd(_mm256_set1_pd(-2.0), ax), two_n);
+            const __m256d t = _mm256_fmadd_pd(two_n, p, _mm256_sub_pd(two_n, _mm256_set1_pd(1.0)));
+            const __m256d y = _mm256_div_pd(_mm256_sub_pd(_mm256_setzero_pd(), t), _mm256_add_pd(t, _mm256_set1_pd(2.0)));
+            return _mm256_or_pd(y, _mm256_and_pd(sign, x));
+        }
+
+        __attribute__((target("avx2,fma"))) inline __m256d sigmoid4(__m256d x) {
+            const __m256d one = _mm256_set1_pd(1.0);
+            return _mm256_div_pd(one, _mm256_add_pd(one, exp4(_mm256_sub_pd(_mm256_setzero_pd(), x))));
+        }
+
+        /**
+         * Four-lane version of scalar::log_one; lanes outside the positive normal range
+         * are recomputed with std::log
+         */
+        __attribute__((target("avx2,fma"))) inline __m256d log4(__m256d x) {
+            using namespace approx;
+            const __m256i bits = _mm256_castpd_si256(x);
+            const __m256d exp_magic = _mm256_set1_pd(TWO_52);
+            __m256d e = _mm256_sub_pd(
+                _mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52), _mm256_castpd_si256(exp_magic))),
+                _mm256_set1_pd(TWO_52 + 1023.0));
+            __m256d m = _mm256_castsi256_pd(_mm256_or_si256(
+                _mm256_and_si256(bits, _mm256_set1_epi64x(0x000FFFFFFFFFFFFFll)),
+                _mm256_set1_epi64x(0x3FF0000000000000ll)));
+
+            const __m256d big = _mm256_cmp_pd(m, _mm256_set1_pd(SQRT2), _CMP_GT_OQ);
+            m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), big);
+            e = _mm256_add_pd(e, _mm256_and_pd(big, _mm256_set1_pd(1.0)));
+
+            const __m256d f = _mm256_sub_pd(m, _mm256_set1_pd(1.0));
+            const __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.0), f));
+            const __m256d z = _mm256_mul_pd(s, s);
+            __m256d q = _mm256_set1_pd(LOG_POLY[LOG_POLY_SIZE - 1]);
+            for (std::size_t i = LOG_POLY_SIZE - 1; i-- > 0;) q = _mm256_fmadd_pd(q, z, _mm256_set1_pd(LOG_POLY[i]));
+
+            const __m256d two_s = _mm256_add_pd(s, s);
+            const __m256d log_m = _mm256_fmadd_pd(_mm256_mul_pd(two_s, z), q, two_s);
+            __m256d res = _mm256_fmadd_pd(e, _mm256_set1_pd(LN2_HI), _mm256_fmadd_pd(e, _mm256_set1_pd(LN2_LO), log_m));
+
+            const __m256d special = _mm256_or_pd(
+                _mm256_cmp_pd(x, _mm256_set1_pd(DBL_MIN), _CMP_NGE_UQ),
+                _mm256_cmp_pd(x, _mm256_set1_pd(HUGE_VAL), _CMP_EQ_OQ));
+            if (_mm256_movemask_pd(special)) {
+                alignas(32) double lanes[4], in[4];
+                _mm256_store_pd(lanes, res);
+                _mm256_store_pd(in, x);
+                const int mask = _mm256_movemask_pd(special);
+                for (int l = 0; l < 4; ++l) if (mask & (1 << l)) lanes[l] = std::log(in[l]);
+                res = _mm256_load_pd(lanes);
+            }
+            return res;
+        }
+
+        __attribute__((target("avx2,fma"))) inline __m256d log1p4(__m256d u) {
+            const __m256d one = _mm256_set1_pd(1.0);
+            const __m256d w = _mm256_add_pd(one, u);
+            const __m256d correction = _mm256_div_pd(_mm256_sub_pd(u, _mm256_sub_pd(w, one)), w);
+            __m256d res = _mm256_add_pd(log4(w), correction);
+
+            const __m256d special = _mm256_or_pd(
+                _mm256_cmp_pd(w, _mm256_set1_pd(DBL_MIN), _CMP_NGE_UQ),
+                _mm256_cmp_pd(w, _mm256_set1_pd(HUGE_VAL), _CMP_EQ_OQ));
+            if (_mm256_movemask_pd(special)) {
+                alignas(32) double lanes[4], in[4];
+                _mm256_store_pd(lanes, res);
+                _mm256_store_pd(in, u);
+                const int mask = _mm256_movemask_pd(special);
+                for (int l = 0; l < 4; ++l) if (mask & (1 << l)) lanes[l] = std::log1p(in[l]);
+                res = _mm256_load_pd(lanes);
+            }
+            return res;
+        }
+
+        /**
+         * Applies a four-lane function over n elements; the tail goes through a padded local block
+         */
+        template <__m256d (*F)(__m256d)>
+        __attribute__((target("avx2,fma"))) inline void map4(const double* x, double* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) _mm256_storeu_pd(out + i, F(_mm256_loadu_pd(x + i)));
+            if (i < n) {
+                alignas(32) double block[4] = { 1.0, 1.0, 1.0, 1.0 };
+                std::copy(x + i, x + n, block);
+                _mm256_store_pd(block, F(_mm256_load_pd(block)));
+                std::copy(block, block + (n - i), out + i);
+            }
+        }
+
+        __attribute__((target("avx2,fma"))) inline void exp_fast(const double* x, double* out, std::size_t n) { map4<exp4>(x, out, n); }
+        __attribute__((target("avx2,fma"))) inline void log_fast(const double* x, double* out, std::size_t n) { map4<log4>(x, out, n); }
+        __attribute__((target("avx2,fma"))) inline void log1p_fast(const double* x, double* out, std::size_t n) { map4<log1p4>(x, out, n); }
+        __attribute__((target("avx2,fma"))) inline void tanh_fast(const double* x, double* out, std::size_t n) { map4<tanh4>(x, out, n); }
+        __attribute__((target("avx2,fma"))) inline void sigmoid_fast(const double* x, double* out, std::size_t n) { map4<sigmoid4>(x, out, n); }
+
+        /**
+         * Four counter blocks per iteration, one per 64-bit lane; each 32-bit word sits in the low half
+         * of its lane, which is what _mm256_mul_epu32 multiplies
+         */
+        __attribute__((target("avx2,fma"))) inline void philox(std::uint64_t key, std::uint64_t stream, std::uint64_t first, std::size_t blocks, std::uint64_t* out) {
+            using namespace simd::philox;
+            const __m256i low = _mm256_set1_epi64x(static_cast<long long>(LOW));
+            const __m256i m0 = _mm256_set1_epi64x(static_cast<long long>(M0));
+            const __m256i m1 = _mm256_set1_epi64x(static_cast<long long>(M1));
+            const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+            __m256i k0[ROUNDS], k1[ROUNDS];
+            for (std::size_t round = 0; round < ROUNDS; ++round) {
+                k0[round] = _mm256_set1_epi64x(static_cast<std::uint32_t>(key) + static_cast<std::uint32_t>(round * W0));
+                k1[round] = _mm256_set1_epi64x(static_cast<std::uint32_t>(key >> 32) + static_cast<std::uint32_t>(round * W1));
+            }
+
+            std::size_t i = 0;
+            for (; i + 4 <= blocks; i += 4) {
+                const __m256i counter = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>(first + i)), lanes);
+                __m256i c0 = _mm256_and_si256(counter, low), c1 = _mm256_srli_epi64(counter, 32);
+                __m256i c2 = _mm256_set1_epi64x(static_cast<long long>(stream & LOW)), c3 = _mm256_set1_epi64x(static_cast<long long>(stream >> 32));
+                for (std::size_t round = 0; round < ROUNDS; ++round) {
+                    const __m256i p0 = _mm256_mul_epu32(c0, m0);
+                    const __m256i p1 = _mm256_mul_epu32(c2, m1);
+                    c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1), k0[round]);
+                    c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3), k1[round]);
+                    c1 = _mm256_and_si256(p1, low);
+                    c3 = _mm256_and_si256(p0, low);
+                }
+                const __m256i w0 = _mm256_or_si256(_mm256_slli_epi64(c1, 32), c0);
+                const __m256i w1 = _mm256_or_si256(_mm256_slli_epi64(c3, 32), c2);
+                const __m256i even = _mm256_unpacklo_epi64(w0, w1);
+                const __m256i odd = _mm256_unpackhi_epi64(w0, w1);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), _mm256_permute2x128_si256(even, odd, 0x20));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i + 4), _mm256_permute2x128_si256(even, odd, 0x31));
+            }
+            scalar::philox(key, stream, first + i, blocks - i, out + 2 * i);
+        }
+
+        /**
+         * Without VNNI: each 16-byte quarter of a block (four rows by four columns) is widened to 16 bits and
+         * vpmaddwd against the four broadcast values of x leaves two partial sums per row, added pairwise at the end
+         */
+        __attribute__((target("avx2,fma"))) inline void gemm_i8(const std::int8_t* a, std::size_t rows, std::size_t cols, const std::int8_t* x, std::size_t samples, std::int32_t* y) {
+            const std::size_t groups = (cols + I8_DEPTH - 1) / I8_DEPTH;
+            const std::size_t block_size = groups * I8_ROWS * I8_DEPTH;
+            for (std::size_t s = 0; s < samples; ++s, x += groups * I8_DEPTH, y += rows) {
+                for (std::size_t i = 0; i < rows; i += I8_ROWS) {
+                    const std::int8_t* block = a + (i / I8_ROWS) * block_size;
+                    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256(), s2 = _mm256_setzero_si256(), s3 = _mm256_setzero_si256();
+                    for (std::size_t g = 0; g < groups; ++g, block += I8_ROWS * I8_DEPTH) {
+                        std::int32_t quad;
+                        std::memcpy(&quad, x + g * I8_DEPTH, sizeof(quad));
+                        const __m256i vx = _mm256_broadcastq_epi64(_mm_cvtepi8_epi16(_mm_cvtsi32_si128(quad)));
+                        const __m128i* w = reinterpret_cast<const __m128i*>(block);
+                        s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128(w)), vx));
+                        s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128(w + 1)), vx));
+                        s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128(w + 2)), vx));
+                        s3 = _mm256_add_epi32(s3, _mm256_madd_epi16(_mm256_cvtepi8_epi16(_mm_loadu_si128(w + 3)), vx));
+                    }
+                    // hadd leaves rows 0 1 4 5 | 2 3 6 7 of the two accumulators; the permute restores their order
+                    alignas(32) std::int32_t sums[I8_ROWS];
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(sums), _mm256_permute4x64_epi64(_mm256_hadd_epi32(s0, s1), 0xD8));
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(sums + 8), _mm256_permute4x64_epi64(_mm256_hadd_epi32(s2, s3), 0xD8));
+                    std::memcpy(y + i, sums, std::min(I8_ROWS, rows - i) * sizeof(std::int32_t));
+                }
+            }
+        }
+
+        /**
+         * Optimizer updates: every element is loaded and stored once, whatever the update rule
+         */
+        __attribute__((target("avx2,fma"))) inline void sgd_step(double* w, const double* g, std::size_t n, const UpdateStep<double>& step) {
+            const __m256d rate = _mm256_set1_pd(step.rate), decay = _mm256_set1_pd(step.decay);
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const __m256d wi = _mm256_loadu_pd(w + i);
+                const __m256d grad = _mm256_fmadd_pd(decay, wi, _mm256_loadu_pd(g + i));
+                _mm256_storeu_pd(w + i, _mm256_fnmadd_pd(rate, grad, wi));
+            }
+            scalar::sgd_step(w + i, g + i, n - i, step);
+        }
+
+        __attribute__((target("avx2,fma"))) inline void momentum_step(double* w, const double* g, double* v, std::size_t n, const UpdateStep<double>& step) {
+            const __m256d rate = _mm256_set1_pd(step.rate), decay = _mm256_set1_pd(step.decay), momentum = _mm256_set1_pd(step.momentum);
+            const __m256d velocity_weight = _mm256_set1_pd(step.velocity_weight), gradient_weight = _mm256_set1_pd(step.gradient_weight);
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const __m256d wi = _mm256_loadu_pd(w + i);
+                const __m256d grad = _mm256_fmadd_pd(decay, wi, _mm256_loadu_pd(g + i));
+                const __m256d vi = _mm256_fmadd_pd(momentum, _mm256_loadu_pd(v + i), grad);
+                _mm256_storeu_pd(v + i, vi);
+                _mm256_storeu_pd(w + i, _mm256_fnmadd_pd(rate, _mm256_fmadd_pd(velocity_weight, vi, _mm256_mul_pd(gradient_weight, grad)), wi));
+            }
+            scalar::momentum_step(w + i, g + i, v + i, n - i, step);
+        }
+
+        __attribute__((target("avx2,fma"))) inline void adam_step(double* w, const double* g, double* m, double* v, std::size_t n, const UpdateStep<double>& step) {
+            const __m256d rate = _mm256_set1_pd(step.rate), decay = _mm256_set1_pd(step.decay), keep = _mm256_set1_pd(step.keep), epsilon = _mm256_set1_pd(step.epsilon);
+            const __m256d beta1 = _mm256_set1_pd(step.beta1), beta2 = _mm256_set1_pd(step.beta2);
+            const __m256d one_minus_beta1 = _mm256_set1_pd(double(1) - step.beta1), one_minus_beta2 = _mm256_set1_pd(double(1) - step.beta2);
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                const __m256d wi = _mm256_loadu_pd(w + i);
+                const __m256d grad = _mm256_fmadd_pd(decay, wi, _mm256_loadu_pd(g + i));
+                const __m256d mi = _mm256_fmadd_pd(beta1, _mm256_loadu_pd(m + i), _mm256_mul_pd(one_minus_beta1, grad));
+                const __m256d vi = _mm256_fmadd_pd(beta2, _mm256_loadu_pd(v + i), _mm256_mul_pd(_mm256_mul_pd(one_minus_beta2, grad), grad));
+                _mm256_storeu_pd(m + i, mi);
+                _mm256_storeu_pd(v + i, vi);
+                _mm256_storeu_pd(w + i, _mm256_fnmadd_pd(rate, _mm256_div_pd(mi, _mm256_add_pd(_mm256_sqrt_pd(vi), epsilon)), _mm256_mul_pd(keep, wi)));
+            }
+            scalar::adam_step(w + i, g + i, m + i, v + i, n - i, step);
+        }
+
+        __attribute__((target("avx2,fma"))) inline void sgd_step(float* w, const float* g, std::size_t n, const UpdateStep<float>& step) {
+            const __m256 rate = _mm256_set1_ps(step.rate), decay = _mm256_set1_ps(step.decay);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m256 wi = _mm256_loadu_ps(w + i);
+                const __m256 grad = _mm256_fmadd_ps(decay, wi, _mm256_loadu_ps(g + i));
+                _mm256_storeu_ps(w + i, _mm256_fnmadd_ps(rate, grad, wi));
+            }
+            scalar::sgd_step(w + i, g + i, n - i, step);
+        }
+
+        __attribute__((target("avx2,fma"))) inline void momentum_step(float* w, const float* g, float* v, std::size_t n, const UpdateStep<float>& step) {
+            const __m256 rate = _mm256_set1_ps(step.rate), decay = _mm256_set1_ps(step.decay), momentum = _mm256_set1_ps(step.momentum);
+            const __m256 velocity_weight = _mm256_set1_ps(step.velocity_weight), gradient_weight = _mm256_set1_ps(step.gradient_weight);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m256 wi = _mm256_loadu_ps(w + i);
+                const __m256 grad = _mm256_fmadd_ps(decay, wi, _mm256_loadu_ps(g + i));
+                const __m256 vi = _mm256_fmadd_ps(momentum, _mm256_loadu_ps(v + i), grad);
+                _mm256_storeu_ps(v + i, vi);
+                _mm256_storeu_ps(w + i, _mm256_fnmadd_ps(rate, _mm256_fmadd_ps(velocity_weight, vi, _mm256_mul_ps(gradient_weight, grad)), wi));
+            }
+            scalar::momentum_step(w + i, g + i, v + i, n - i, step);
+        }
+
+        __attribute__((target("avx2,fma"))) inline void adam_step(float* w, const float* g, float* m, float* v, std::size_t n, const UpdateStep<float>& step) {
+            const __m256 rate = _mm256_set1_ps(step.rate), decay = _mm256_set1_ps(step.decay), keep = _mm256_set1_ps(step.keep), epsilon = _mm256_set1_ps(step.epsilon);
+            const __m256 beta1 = _mm256_set1_ps(step.beta1), beta2 = _mm256_set1_ps(step.beta2);
+            const __m256 one_minus_beta1 = _mm256_set1_ps(float(1) - step.beta1), one_minus_beta2 = _mm256_set1_ps(float(1) - step.beta2);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m256 wi = _mm256_loadu_ps(w + i);
+                const __m256 grad = _mm256_fmadd_ps(decay, wi, _mm256_loadu_ps(g + i));
+                const __m256 mi = _mm256_fmadd_ps(beta1, _mm256_loadu_ps(m + i), _mm256_mul_ps(one_minus_beta1, grad));
+                const __m256 vi = _mm256_fmadd_ps(beta2, _mm256_loadu_ps(v + i), _mm256_mul_ps(_mm256_mul_ps(one_minus_beta2, grad), grad));
+                _mm256_storeu_ps(m + i, mi);
+                _mm256_storeu_ps(v + i, vi);
+                _mm256_storeu_ps(w + i, _mm256_fnmadd_ps(rate, _mm256_div_ps(mi, _mm256_add_ps(_mm256_sqrt_ps(vi), epsilon)), _mm256_mul_ps(keep, wi)));
+            }
+            scalar::adam_step(w + i, g + i, m + i, v + i, n - i, step);
+        }
+
+    }
+
+#pragma endregion
+#pragma region avx512
+
+    namespace avx512 {
+
+        // zero-masked forms with every lane enabled: the unmasked intrinsics start from
+        // _mm512_undefined_*, which GCC 12 reports as maybe-uninitialized
+        constexpr __mmask8 ALL_LANES = 0xFF;
+        constexpr __mmask16 ALL_FLOAT_LANES = 0xFFFF;
+
+        // reduces through memory: the GCC 12 reduce/extract intrinsics trip -Wuninitialized
+        __attribute__((target("avx512f"))) inline double hsum(__m512d v) {
+            alignas(64) double lanes[8];
+            _mm512_store_pd(lanes, v);
+            return ((lanes[0] + lanes[4]) + (lanes[1] + lanes[5])) + ((lanes[2] + lanes[6]) + (lanes[3] + lanes[7]));
+        }
+
+        __attribute__((target("avx512f"))) inline double dot(const double* a, const double* b, std::size_t n) {
+            __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(), s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+            std::size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+                s1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), s1);
+                s2 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 16), _mm512_loadu_pd(b + i + 16), s2);
+                s3 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 24), _mm512_loadu_pd(b + i + 24), s3);
+            }
+            for (; i + 8 <= n; i += 8) s0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), s0);
+            if (i < n) {
+                const __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+                s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, a + i), _mm512_maskz_loadu_pd(tail, b + i), s1);
+            }
+            return hsum(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+        }
+
+        __attribute__((target("avx512f"))) inline void axpy(double alpha, const double* x, double* y, std::size_t n) {
+            const __m512d va = _mm512_set1_pd(alpha);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) _mm512_storeu_pd(y + i, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+            if (i < n) {
+                const __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_pd(y + i, tail, _mm512_fmadd_pd(va, _mm512_maskz_loadu_pd(tail, x + i), _mm512_maskz_loadu_pd(tail, y + i)));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void mul_add(const double* a, const double* b, double* y, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) _mm512_storeu_pd(y + i, _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), _mm512_loadu_pd(y + i)));
+            if (i < n) {
+                const __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_pd(y + i, tail, _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, a + i), _mm512_maskz_loadu_pd(tail, b + i), _mm512_maskz_loadu_pd(tail, y + i)));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void scale(const double* x, double alpha, double* out, std::size_t n) {
+            const __m512d va = _mm512_set1_pd(alpha);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) _mm512_storeu_pd(out + i, _mm512_mul_pd(_mm512_loadu_pd(x + i), va));
+            if (i < n) {
+                const __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_pd(out + i, tail, _mm512_mul_pd(_mm512_maskz_loadu_pd(tail, x + i), va));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void add(const double* a, const double* b, double* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) _mm512_storeu_pd(out + i, _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+            if (i < n) {
+                const __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_pd(out + i, tail, _mm512_add_pd(_mm512_maskz_loadu_pd(tail, a + i), _mm512_maskz_loadu_pd(tail, b + i)));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void sub(const double* a, const double* b, double* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) _mm512_storeu_pd(out + i, _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+            if (i < n) {
+                const __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_pd(out + i, tail, _mm512_sub_pd(_mm512_maskz_loadu_pd(tail, a + i), _mm512_maskz_loadu_pd(tail, b + i)));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void gemv(const double* a, std::size_t rows, std::size_t cols, std::size_t stride, const double* x, double* y) {
+            std::size_t i = 0;
+            for (; i + 4 <= rows; i += 4, a += 4 * stride) {
+                const double* r0 = a;
+                const double* r1 = a + stride;
+                const double* r2 = a + 2 * stride;
+                const double* r3 = a + 3 * stride;
+                __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(), s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+                std::size_t j = 0;
+                for (; j + 8 <= cols; j += 8) {
+                    const __m512d vx = _mm512_loadu_pd(x + j);
+                    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(r0 + j), vx, s0);
+                    s1 = _mm512_fmadd_pd(_mm512_loadu_pd(r1 + j), vx, s1);
+                    s2 = _mm512_fmadd_pd(_mm512_loadu_pd(r2 + j), vx, s2);
+                    s3 = _mm512_fmadd_pd(_mm512_loadu_pd(r3 + j), vx, s3);
+                }
+                if (j < cols) {
+                    const __mmask8 tail = static_cast<__mmask8>((1u << (cols - j)) - 1);
+                    const __m512d vx = _mm512_maskz_loadu_pd(tail, x + j);
+                    s0 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, r0 + j), vx, s0);
+                    s1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, r1 + j), vx, s1);
+                    s2 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, r2 + j), vx, s2);
+                    s3 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(tail, r3 + j), vx, s3);
+                }
+                y[i] = hsum(s0);
+                y[i + 1] = hsum(s1);
+                y[i + 2] = hsum(s2);
+                y[i + 3] = hsum(s3);
+            }
+            for (; i < rows; ++i, a += stride) y[i] = dot(a, x, cols);
+        }
+
+        /**
+         * One zmm per tile row; k is unrolled by two into separate accumulators
+         * so eight independent FMA chains are in flight
+         */
+        __attribute__((target("avx512f"))) inline void gemm_micro(std::size_t kc, const double* a, const double* b, double* tile) {
+            __m512d c0 = _mm512_setzero_pd(), c1 = _mm512_setzero_pd(), c2 = _mm512_setzero_pd(), c3 = _mm512_setzero_pd();
+            __m512d d0 = _mm512_setzero_pd(), d1 = _mm512_setzero_pd(), d2 = _mm512_setzero_pd(), d3 = _mm512_setzero_pd();
+
+            std::size_t k = 0;
+            for (; k + 2 <= kc; k += 2, a += 2 * GEMM_MR, b += 2 * GEMM_NR) {
+                const __m512d b0 = _mm512_loadu_pd(b);
+                const __m512d b1 = _mm512_loadu_pd(b + GEMM_NR);
+                c0 = _mm512_fmadd_pd(_mm512_set1_pd(a[0]), b0, c0);
+                c1 = _mm512_fmadd_pd(_mm512_set1_pd(a[1]), b0, c1);
+                c2 = _mm512_fmadd_pd(_mm512_set1_pd(a[2]), b0, c2);
+                c3 = _mm512_fmadd_pd(_mm512_set1_pd(a[3]), b0, c3);
+                d0 = _mm512_fmadd_pd(_mm512_set1_pd(a[4]), b1, d0);
+                d1 = _mm512_fmadd_pd(_mm512_set1_pd(a[5]), b1, d1);
+                d2 = _mm512_fmadd_pd(_mm512_set1_pd(a[6]), b1, d2);
+                d3 = _mm512_fmadd_pd(_mm512_set1_pd(a[7]), b1, d3);
+            }
+            if (k < kc) {
+                const __m512d b0 = _mm512_loadu_pd(b);
+                c0 = _mm512_fmadd_pd(_mm512_set1_pd(a[0]), b0, c0);
+                c1 = _mm512_fmadd_pd(_mm512_set1_pd(a[1]), b0, c1);
+                c2 = _mm512_fmadd_pd(_mm512_set1_pd(a[2]), b0, c2);
+                c3 = _mm512_fmadd_pd(_mm512_set1_pd(a[3]), b0, c3);
+            }
+
+            _mm512_storeu_pd(tile, _mm512_add_pd(c0, d0));
+            _mm512_storeu_pd(tile + 8, _mm512_add_pd(c1, d1));
+            _mm512_storeu_pd(tile + 16, _mm512_add_pd(c2, d2));
+            _mm512_storeu_pd(tile + 24, _mm512_add_pd(c3, d3));
+        }
+
+        __attribute__((target("avx512f"))) inline double dot_wide(const double* a, const double* b, std::size_t n) {
+            return dot(a, b, n);
+        }
+
+        __attribute__((target("avx512f"))) inline float hsum(__m512 v) {
+            alignas(64) float lanes[16];
+            _mm512_store_ps(lanes, v);
+            float sum = 0.0f;
+            for (std::size_t i = 0; i < 8; ++i) sum += lanes[i] + lanes[i + 8];
+            return sum;
+        }
+
+        __attribute__((target("avx512f"))) inline float dot(const float* a, const float* b, std::size_t n) {
+            __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps(), s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+            std::size_t i = 0;
+            for (; i + 64 <= n; i += 64) {
+                s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+                s1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), s1);
+                s2 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32), s2);
+                s3 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48), s3);
+            }
+            for (; i + 16 <= n; i += 16) s0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), s0);
+            if (i < n) {
+                const __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+                s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, a + i), _mm512_maskz_loadu_ps(tail, b + i), s1);
+            }
+            return hsum(_mm512_add_ps(_mm512_add_ps(s0, s1), _mm512_add_ps(s2, s3)));
+        }
+
+        /**
+         * Widens eight floats at a time to double before the FMA
+         */
+        __attribute__((target("avx512f"))) inline double dot_wide(const float* a, const float* b, std::size_t n) {
+            __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd(), s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+            std::size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                s0 = _mm512_fmadd_pd(_mm512_maskz_cvtps_pd(ALL_LANES, _mm256_loadu_ps(a + i)), _mm512_maskz_cvtps_pd(ALL_LANES, _mm256_loadu_ps(b + i)), s0);
+                s1 = _mm512_fmadd_pd(_mm512_maskz_cvtps_pd(ALL_LANES, _mm256_loadu_ps(a + i + 8)), _mm512_maskz_cvtps_pd(ALL_LANES, _mm256_loadu_ps(b + i + 8)), s1);
+                s2 = _mm512_fmadd_pd(_mm512_maskz_cvtps_pd(ALL_LANES, _mm256_loadu_ps(a + i + 16)), _mm512_maskz_cvtps_pd(ALL_LANES, _mm256_loadu_ps(b + i + 16)), s2);
+                s3 = _mm512_fmadd_pd(_mm512_maskz_cvtps_pd(ALL_LANES, _mm256_loadu_ps(a + i + 24)), _mm512_maskz_cvtps_pd(ALL_LANES, _mm256_loadu_ps(b + i + 24)), s3);
+            }
+            for (; i + 8 <= n; i += 8) {
+                s0 = _mm512_fmadd_pd(_mm512_maskz_cvtps_pd(ALL_LANES, _mm256_loadu_ps(a + i)), _mm512_maskz_cvtps_pd(ALL_LANES, _mm256_loadu_ps(b + i)), s0);
+            }
+            double sum = hsum(_mm512_add_pd(_mm512_add_pd(s0, s1), _mm512_add_pd(s2, s3)));
+            for (; i < n; ++i) sum += double(a[i]) * double(b[i]);
+            return sum;
+        }
+
+        __attribute__((target("avx512f"))) inline void axpy(float alpha, const float* x, float* y, std::size_t n) {
+            const __m512 va = _mm512_set1_ps(alpha);
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+            if (i < n) {
+                const __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_ps(y + i, tail, _mm512_fmadd_ps(va, _mm512_maskz_loadu_ps(tail, x + i), _mm512_maskz_loadu_ps(tail, y + i)));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void mul_add(const float* a, const float* b, float* y, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) _mm512_storeu_ps(y + i, _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), _mm512_loadu_ps(y + i)));
+            if (i < n) {
+                const __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_ps(y + i, tail, _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, a + i), _mm512_maskz_loadu_ps(tail, b + i), _mm512_maskz_loadu_ps(tail, y + i)));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void scale(const float* x, float alpha, float* out, std::size_t n) {
+            const __m512 va = _mm512_set1_ps(alpha);
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(x + i), va));
+            if (i < n) {
+                const __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_ps(out + i, tail, _mm512_mul_ps(_mm512_maskz_loadu_ps(tail, x + i), va));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void add(const float* a, const float* b, float* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+            if (i < n) {
+                const __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_ps(out + i, tail, _mm512_add_ps(_mm512_maskz_loadu_ps(tail, a + i), _mm512_maskz_loadu_ps(tail, b + i)));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void sub(const float* a, const float* b, float* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) _mm512_storeu_ps(out + i, _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+            if (i < n) {
+                const __mmask16 tail = static_cast<__mmask16>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_ps(out + i, tail, _mm512_sub_ps(_mm512_maskz_loadu_ps(tail, a + i), _mm512_maskz_loadu_ps(tail, b + i)));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void gemv(const float* a, std::size_t rows, std::size_t cols, std::size_t stride, const float* x, float* y) {
+            std::size_t i = 0;
+            for (; i + 4 <= rows; i += 4, a += 4 * stride) {
+                const float* r0 = a;
+                const float* r1 = a + stride;
+                const float* r2 = a + 2 * stride;
+                const float* r3 = a + 3 * stride;
+                __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps(), s2 = _mm512_setzero_ps(), s3 = _mm512_setzero_ps();
+                std::size_t j = 0;
+                for (; j + 16 <= cols; j += 16) {
+                    const __m512 vx = _mm512_loadu_ps(x + j);
+                    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(r0 + j), vx, s0);
+                    s1 = _mm512_fmadd_ps(_mm512_loadu_ps(r1 + j), vx, s1);
+                    s2 = _mm512_fmadd_ps(_mm512_loadu_ps(r2 + j), vx, s2);
+                    s3 = _mm512_fmadd_ps(_mm512_loadu_ps(r3 + j), vx, s3);
+                }
+                if (j < cols) {
+                    const __mmask16 tail = static_cast<__mmask16>((1u << (cols - j)) - 1);
+                    const __m512 vx = _mm512_maskz_loadu_ps(tail, x + j);
+                    s0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, r0 + j), vx, s0);
+                    s1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, r1 + j), vx, s1);
+                    s2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, r2 + j), vx, s2);
+                    s3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, r3 + j), vx, s3);
+                }
+                y[i] = hsum(s0);
+                y[i + 1] = hsum(s1);
+                y[i + 2] = hsum(s2);
+                y[i + 3] = hsum(s3);
+            }
+            for (; i < rows; ++i, a += stride) y[i] = dot(a, x, cols);
+        }
+
+        // a float tile row (GEMM_NR = 8) only fills half a zmm, the AVX2 kernel is as fast
+        __attribute__((target("avx512f,avx2,fma"))) inline void gemm_micro(std::size_t kc, const float* a, const float* b, float* tile) {
+            avx2::gemm_micro(kc, a, b, tile);
+        }
+
+        /**
+         * Eight-lane version of scalar::exp_parts
+         */
+        __attribute__((target("avx512f"))) inline __m512d exp_parts(__m512d x, __m512d& two_n) {
+            using namespace approx;
+            x = _mm512_maskz_min_pd(ALL_LANES, _mm512_set1_pd(EXP_MAX), _mm512_maskz_max_pd(ALL_LANES, _mm512_set1_pd(EXP_MIN), x));
+            const __m512d n = _mm512_maskz_roundscale_pd(ALL_LANES, _mm512_mul_pd(x, _mm512_set1_pd(LOG2E)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            __m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(LN2_HI), x);
+            r = _mm512_fnmadd_pd(n, _mm512_set1_pd(LN2_LO), r);
+
+            __m512d q = _mm512_set1_pd(EXP_POLY[EXP_POLY_SIZE - 1]);
+            for (std::size_t i = EXP_POLY_SIZE - 1; i-- > 0;) q = _mm512_fmadd_pd(q, r, _mm512_set1_pd(EXP_POLY[i]));
+
+            const __m512d magic = _mm512_set1_pd(ROUND_MAGIC);
+            const __m512i ni = _mm512_sub_epi64(_mm512_castpd_si512(_mm512_add_pd(n, magic)), _mm512_castpd_si512(magic));
+            two_n = _mm512_castsi512_pd(_mm512_maskz_slli_epi64(ALL_LANES, _mm512_add_epi64(ni, _mm512_set1_epi64(1023)), 52));
+            return _mm512_fmadd_pd(_mm512_mul_pd(r, r), q, r);
+        }
+
+        __attribute__((target("avx512f"))) inline __m512d exp8(__m512d x) {
+            __m512d two_n;
+            const __m512d p = exp_parts(x, two_n);
+            return _mm512_fmadd_pd(two_n, p, two_n);
+        }
+
+        __attribute__((target("avx512f"))) inline __m512d tanh8(__m512d x) {
+            const __m512i sign = _mm512_set1_epi64(static_cast<long long>(0x8000000000000000ull));
+            const __m512i xi = _mm512_castpd_si512(x);
+            const __m512d ax = _mm512_castsi512_pd(_mm512_maskz_andnot_epi64(ALL_LANES, sign, xi));
+            __m512d two_n;
+            const __m512d p = exp_parts(_mm512_mul_pd(_mm512_set1_pd(-2.0), ax), two_n);
+            const __m512d t = _mm512_fmadd_pd(two_n, p, _mm512_sub_pd(two_n, _mm512_set1_pd(1.0)));
+            const __m512d y = _mm512_div_pd(_mm512_sub_pd(_mm512_setzero_pd(), t), _mm512_add_pd(t, _mm512_set1_pd(2.0)));
+            return _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(y), _mm512_and_si512(sign, xi)));
+        }
+
+        __attribute__((target("avx512f"))) inline __m512d sigmoid8(__m512d x) {
+            const __m512d one = _mm512_set1_pd(1.0);
+            return _mm512_div_pd(one, _mm512_add_pd(one, exp8(_mm512_sub_pd(_mm512_setzero_pd(), x))));
+        }
+
+        /**
+         * Eight-lane version of scalar::log_one; lanes outside the positive normal range
+         * are recomputed with std::log
+         */
+        __attribute__((target("avx512f"))) inline __m512d log8(__m512d x) {
+            using namespace approx;
+            const __m512i bits = _mm512_castpd_si512(x);
+            __m512d e = _mm512_sub_pd(
+                _mm512_castsi512_pd(_mm512_or_si512(_mm512_maskz_srli_epi64(ALL_LANES, bits, 52), _mm512_castpd_si512(_mm512_set1_pd(TWO_52)))),
+                _mm512_set1_pd(TWO_52 + 1023.0));
+            __m512d m = _mm512_castsi512_pd(_mm512_or_si512(
+                _mm512_and_si512(bits, _mm512_set1_epi64(0x000FFFFFFFFFFFFFll)),
+                _mm512_set1_epi64(0x3FF0000000000000ll)));
+
+            const __mmask8 big = _mm512_cmp_pd_mask(m, _mm512_set1_pd(SQRT2), _CMP_GT_OQ);
+            m = _mm512_mask_mul_pd(m, big, m, _mm512_set1_pd(0.5));
+            e = _mm512_mask_add_pd(e, big, e, _mm512_set1_pd(1.0));
+
+            const __m512d f = _mm512_sub_pd(m, _mm512_set1_pd(1.0));
+            const __m512d s = _mm512_div_pd(f, _mm512_add_pd(_mm512_set1_pd(2.0), f));
+            const __m512d z = _mm512_mul_pd(s, s);
+            __m512d q = _mm512_set1_pd(LOG_POLY[LOG_POLY_SIZE - 1]);
+            for (std::size_t i = LOG_POLY_SIZE - 1; i-- > 0;) q = _mm512_fmadd_pd(q, z, _mm512_set1_pd(LOG_POLY[i]));
+
+            const __m512d two_s = _mm512_add_pd(s, s);
+            const __m512d log_m = _mm512_fmadd_pd(_mm512_mul_pd(two_s, z), q, two_s);
+            __m512d res = _mm512_fmadd_pd(e, _mm512_set1_pd(LN2_HI), _mm512_fmadd_pd(e, _mm512_set1_pd(LN2_LO), log_m));
+
+            const __mmask8 special = _mm512_cmp_pd_mask(x, _mm512_set1_pd(DBL_MIN), _CMP_NGE_UQ)
+                | _mm512_cmp_pd_mask(x, _mm512_set1_pd(HUGE_VAL), _CMP_EQ_OQ);
+            if (special) {
+                alignas(64) double lanes[8], in[8];
+                _mm512_store_pd(lanes, res);
+                _mm512_store_pd(in, x);
+                for (int l = 0; l < 8; ++l) if (special & (1 << l)) lanes[l] = std::log(in[l]);
+                res = _mm512_load_pd(lanes);
+            }
+            return res;
+        }
+
+        __attribute__((target("avx512f"))) inline __m512d log1p8(__m512d u) {
+            const __m512d one = _mm512_set1_pd(1.0);
+            const __m512d w = _mm512_add_pd(one, u);
+            const __m512d correction = _mm512_div_pd(_mm512_sub_pd(u, _mm512_sub_pd(w, one)), w);
+            __m512d res = _mm512_add_pd(log8(w), correction);
+
+            const __mmask8 special = _mm512_cmp_pd_mask(w, _mm512_set1_pd(DBL_MIN), _CMP_NGE_UQ)
+                | _mm512_cmp_pd_mask(w, _mm512_set1_pd(HUGE_VAL), _CMP_EQ_OQ);
+            if (special) {
+                alignas(64) double lanes[8], in[8];
+                _mm512_store_pd(lanes, res);
+                _mm512_store_pd(in, u);
+                for (int l = 0; l < 8; ++l) if (special & (1 << l)) lanes[l] = std::log1p(in[l]);
+                res = _mm512_load_pd(lanes);
+            }
+            return res;
+        }
+
+        /**
+         * Applies an eight-lane function over n elements; the tail is loaded masked,
+         * with inactive lanes set to 1.0 so they stay in every function's domain
+         */
+        template <__m512d (*F)(__m512d)>
+        __attribute__((target("avx512f"))) inline void map8(const double* x, double* out, std::size_t n) {
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) _mm512_storeu_pd(out + i, F(_mm512_loadu_pd(x + i)));
+            if (i < n) {
+                const __mmask8 tail = static_cast<__mmask8>((1u << (n - i)) - 1);
+                _mm512_mask_storeu_pd(out + i, tail, F(_mm512_mask_loadu_pd(_mm512_set1_pd(1.0), tail, x + i)));
+            }
+        }
+
+        __attribute__((target("avx512f"))) inline void exp_fast(const double* x, double* out, std::size_t n) { map8<exp8>(x, out, n); }
+        __attribute__((target("avx512f"))) inline void log_fast(const double* x, double* out, std::size_t n) { map8<log8>(x, out, n); }
+        __attribute__((target("avx512f"))) inline void log1p_fast(const double* x, double* out, std::size_t n) { map8<log1p8>(x, out, n); }
+        __attribute__((target("avx512f"))) inline void tanh_fast(const double* x, double* out, std::size_t n) { map8<tanh8>(x, out, n); }
+        __attribute__((target("avx512f"))) inline void sigmoid_fast(const double* x, double* out, std::size_t n) { map8<sigmoid8>(x, out, n); }
+
+        /**
+         * Eight counter blocks per iteration, laid out like the AVX2 version
+         */
+        __attribute__((target("avx512f"))) inline void philox(std::uint64_t key, std::uint64_t stream, std::uint64_t first, std::size_t blocks, std::uint64_t* out) {
+            using namespace simd::philox;
+            const __m512i low = _mm512_set1_epi64(static_cast<long long>(LOW));
+            const __m512i m0 = _mm512_set1_epi64(static_cast<long long>(M0));
+            const __m512i m1 = _mm512_set1_epi64(static_cast<long long>(M1));
+            const __m512i lanes = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+            const __m512i first_half = _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11);
+            const __m512i second_half = _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15);
+            __m512i k0[ROUNDS], k1[ROUNDS];
+            for (std::size_t round = 0; round < ROUNDS; ++round) {
+                k0[round] = _mm512_set1_epi64(static_cast<std::uint32_t>(key) + static_cast<std::uint32_t>(round * W0));
+                k1[round] = _mm512_set1_epi64(static_cast<std::uint32_t>(key >> 32) + static_cast<std::uint32_t>(round * W1));
+            }
+
+            std::size_t i = 0;
+            for (; i + 8 <= blocks; i += 8) {
+                const __m512i counter = _mm512_add_epi64(_mm512_set1_epi64(static_cast<long long>(first + i)), lanes);
+                __m512i c0 = _mm512_and_si512(counter, low), c1 = _mm512_maskz_srli_epi64(ALL_LANES, counter, 32);
+                __m512i c2 = _mm512_set1_epi64(static_cast<long long>(stream & LOW)), c3 = _mm512_set1_epi64(static_cast<long long>(stream >> 32));
+                for (std::size_t round = 0; round < ROUNDS; ++round) {
+                    const __m512i p0 = _mm512_maskz_mul_epu32(ALL_LANES, c0, m0);
+                    const __m512i p1 = _mm512_maskz_mul_epu32(ALL_LANES, c2, m1);
+                    c0 = _mm512_xor_si512(_mm512_xor_si512(_mm512_maskz_srli_epi64(ALL_LANES, p1, 32), c1), k0[round]);
+                    c2 = _mm512_xor_si512(_mm512_xor_si512(_mm512_maskz_srli_epi64(ALL_LANES, p0, 32), c3), k1[round]);
+                    c1 = _mm512_and_si512(p1, low);
+                    c3 = _mm512_and_si512(p0, low);
+                }
+                const __m512i w0 = _mm512_or_si512(_mm512_maskz_slli_epi64(ALL_LANES, c1, 32), c0);
+                const __m512i w1 = _mm512_or_si512(_mm512_maskz_slli_epi64(ALL_LANES, c3, 32), c2);
+                const __m512i even = _mm512_maskz_unpacklo_epi64(ALL_LANES, w0, w1);
+                const __m512i odd = _mm512_maskz_unpackhi_epi64(ALL_LANES, w0, w1);
+                _mm512_storeu_si512(out + 2 * i, _mm512_permutex2var_epi64(even, first_half, odd));
+                _mm512_storeu_si512(out + 2 * i + 8, _mm512_permutex2var_epi64(even, second_half, odd));
+            }
+            scalar::philox(key, stream, first + i, blocks - i, out + 2 * i);
+        }
+
+        // the four bytes at p, offset by 128 each
+        inline std::int32_t offset_quad(const std::int8_t* p) {
+            std::int32_t quad;
+            std::memcpy(&quad, p, sizeof(quad));
+            return quad ^ std::int32_t(0x80808080u);
+        }
+
+        /**
+         * One vpdpbusd multiplies a whole block group (16 rows by 4 columns) by four broadcast bytes of x.
+         * It takes unsigned bytes on one side, so x is offset by 128 into [1, 255]; the excess, 128 times
+         * each row's sum, is computed once per block and subtracted. Eight vectors share every load of A.
+         */
+        __attribute__((target("avx512f,avx512bw,avx512vnni"))) inline void gemm_i8_vnni(const std::int8_t* a, std::size_t rows, std::size_t cols, const std::int8_t* x, std::size_t samples, std::int32_t* y) {
+            const std::size_t groups = (cols + I8_DEPTH - 1) / I8_DEPTH;
+            const std::size_t padded = groups * I8_DEPTH;
+            const __m512i offset = _mm512_set1_epi8(static_cast<char>(0x80));
+
+            for (std::size_t i = 0; i < rows; i += I8_ROWS) {
+                const std::int8_t* block = a + (i / I8_ROWS) * groups * I8_ROWS * I8_DEPTH;
+                const __mmask16 store = static_cast<__mmask16>((1u << std::min(I8_ROWS, rows - i)) - 1);
+
+                __m512i excess = _mm512_setzero_si512();
+                for (std::size_t g = 0; g < groups; ++g) excess = _mm512_dpbusd_epi32(excess, offset, _mm512_loadu_si512(block + g * I8_ROWS * I8_DEPTH));
+
+                std::size_t s = 0;
+                for (; s + 8 <= samples; s += 8) {
+                    const std::int8_t* x0 = x + s * padded;
+                    __m512i sums[8];
+                    for (__m512i& sum : sums) sum = _mm512_setzero_si512();
+                    for (std::size_t g = 0; g < groups; ++g) {
+                        const __m512i w = _mm512_loadu_si512(block + g * I8_ROWS * I8_DEPTH);
+                        for (std::size_t t = 0; t < 8; ++t) sums[t] = _mm512_dpbusd_epi32(sums[t], _mm512_set1_epi32(offset_quad(x0 + t * padded + g * I8_DEPTH)), w);
+                    }
+                    for (std::size_t t = 0; t < 8; ++t) _mm512_mask_storeu_epi32(y + (s + t) * rows + i, store, _mm512_sub_epi32(sums[t], excess));
+                }
+                for (; s < samples; ++s) {
+                    __m512i s0 = _mm512_setzero_si512();
+                    for (std::size_t g = 0; g < groups; ++g) {
+                        s0 = _mm512_dpbusd_epi32(s0, _mm512_set1_epi32(offset_quad(x + s * padded + g * I8_DEPTH)), _mm512_loadu_si512(block + g * I8_ROWS * I8_DEPTH));
+                    }
+                    _mm512_mask_storeu_epi32(y + s * rows + i, store, _mm512_sub_epi32(s0, excess));
+                }
+            }
+        }
+
+        /**
+         * Optimizer updates, as in the AVX2 versions
+         */
+        __attribute__((target("avx512f"))) inline void sgd_step(double* w, const double* g, std::size_t n, const UpdateStep<double>& step) {
+            const __m512d rate = _mm512_set1_pd(step.rate), decay = _mm512_set1_pd(step.decay);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m512d wi = _mm512_loadu_pd(w + i);
+                const __m512d grad = _mm512_fmadd_pd(decay, wi, _mm512_loadu_pd(g + i));
+                _mm512_storeu_pd(w + i, _mm512_fnmadd_pd(rate, grad, wi));
+            }
+            scalar::sgd_step(w + i, g + i, n - i, step);
+        }
+
+        __attribute__((target("avx512f"))) inline void momentum_step(double* w, const double* g, double* v, std::size_t n, const UpdateStep<double>& step) {
+            const __m512d rate = _mm512_set1_pd(step.rate), decay = _mm512_set1_pd(step.decay), momentum = _mm512_set1_pd(step.momentum);
+            const __m512d velocity_weight = _mm512_set1_pd(step.velocity_weight), gradient_weight = _mm512_set1_pd(step.gradient_weight);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m512d wi = _mm512_loadu_pd(w + i);
+                const __m512d grad = _mm512_fmadd_pd(decay, wi, _mm512_loadu_pd(g + i));
+                const __m512d vi = _mm512_fmadd_pd(momentum, _mm512_loadu_pd(v + i), grad);
+                _mm512_storeu_pd(v + i, vi);
+                _mm512_storeu_pd(w + i, _mm512_fnmadd_pd(rate, _mm512_fmadd_pd(velocity_weight, vi, _mm512_mul_pd(gradient_weight, grad)), wi));
+            }
+            scalar::momentum_step(w + i, g + i, v + i, n - i, step);
+        }
+
+        __attribute__((target("avx512f"))) inline void adam_step(double* w, const double* g, double* m, double* v, std::size_t n, const UpdateStep<double>& step) {
+            const __m512d rate = _mm512_set1_pd(step.rate), decay = _mm512_set1_pd(step.decay), keep = _mm512_set1_pd(step.keep), epsilon = _mm512_set1_pd(step.epsilon);
+            const __m512d beta1 = _mm512_set1_pd(step.beta1), beta2 = _mm512_set1_pd(step.beta2);
+            const __m512d one_minus_beta1 = _mm512_set1_pd(double(1) - step.beta1), one_minus_beta2 = _mm512_set1_pd(double(1) - step.beta2);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                const __m512d wi = _mm512_loadu_pd(w + i);
+                const __m512d grad = _mm512_fmadd_pd(decay, wi, _mm512_loadu_pd(g + i));
+                const __m512d mi = _mm512_fmadd_pd(beta1, _mm512_loadu_pd(m + i), _mm512_mul_pd(one_minus_beta1, grad));
+                const __m512d vi = _mm512_fmadd_pd(beta2, _mm512_loadu_pd(v + i), _mm512_mul_pd(_mm512_mul_pd(one_minus_beta2, grad), grad));
+                _mm512_storeu_pd(m + i, mi);
+                _mm512_storeu_pd(v + i, vi);
+                _mm512_storeu_pd(w + i, _mm512_fnmadd_pd(rate, _mm512_div_pd(mi, _mm512_add_pd(_mm512_maskz_sqrt_pd(ALL_LANES, vi), epsilon)), _mm512_mul_pd(keep, wi)));
+            }
+            scalar::adam_step(w + i, g + i, m + i, v + i, n - i, step);
+        }
+
+        __attribute__((target("avx512f"))) inline void sgd_step(float* w, const float* g, std::size_t n, const UpdateStep<float>& step) {
+            const __m512 rate = _mm512_set1_ps(step.rate), decay = _mm512_set1_ps(step.decay);
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                const __m512 wi = _mm512_loadu_ps(w + i);
+                const __m512 grad = _mm512_fmadd_ps(decay, wi, _mm512_loadu_ps(g + i));
+                _mm512_storeu_ps(w + i, _mm512_fnmadd_ps(rate, grad, wi));
+            }
+            scalar::sgd_step(w + i, g + i, n - i, step);
+        }
+
+        __attribute__((target("avx512f"))) inline void momentum_step(float* w, const float* g, float* v, std::size_t n, const UpdateStep<float>& step) {
+            const __m512 rate = _mm512_set1_ps(step.rate), decay = _mm512_set1_ps(step.decay), momentum = _mm512_set1_ps(step.momentum);
+            const __m512 velocity_weight = _mm512_set1_ps(step.velocity_weight), gradient_weight = _mm512_set1_ps(step.gradient_weight);
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                const __m512 wi = _mm512_loadu_ps(w + i);
+                const __m512 grad = _mm512_fmadd_ps(decay, wi, _mm512_loadu_ps(g + i));
+                const __m512 vi = _mm512_fmadd_ps(momentum, _mm512_loadu_ps(v + i), grad);
+                _mm512_storeu_ps(v + i, vi);
+                _mm512_storeu_ps(w + i, _mm512_fnmadd_ps(rate, _mm512_fmadd_ps(velocity_weight, vi, _mm512_mul_ps(gradient_weight, grad)), wi));
+            }
+            scalar::momentum_step(w + i, g + i, v + i, n - i, step);
+        }
+
+        __attribute__((target("avx512f"))) inline void adam_step(float* w, const float* g, float* m, float* v, std::size_t n, const UpdateStep<float>& step) {
+            const __m512 rate = _mm512_set1_ps(step.rate), decay = _mm512_set1_ps(step.decay), keep = _mm512_set1_ps(step.keep), epsilon = _mm512_set1_ps(step.epsilon);
+            const __m512 beta1 = _mm512_set1_ps(step.beta1), beta2 = _mm512_set1_ps(step.beta2);
+            const __m512 one_minus_beta1 = _mm512_set1_ps(float(1) - step.beta1), one_minus_beta2 = _mm512_set1_ps(float(1) - step.beta2);
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                const __m512 wi = _mm512_loadu_ps(w + i);
+                const __m512 grad = _mm512_fmadd_ps(decay, wi, _mm512_loadu_ps(g + i));
+                const __m512 mi = _mm512_fmadd_ps(beta1, _mm512_loadu_ps(m + i), _mm512_mul_ps(one_minus_beta1, grad));
+                const __m512 vi = _mm512_fmadd_ps(beta2, _mm512_loadu_ps(v + i), _mm512_mul_ps(_mm512_mul_ps(one_minus_beta2, grad), grad));
+                _mm512_storeu_ps(m + i, mi);
+                _mm512_storeu_ps(v + i, vi);
+                _mm512_storeu_ps(w + i, _mm512_fnmadd_ps(rate, _mm512_div_ps(mi, _mm512_add_ps(_mm512_maskz_sqrt_ps(ALL_FLOAT_LANES, vi), epsilon)), _mm512_mul_ps(keep, wi)));
+            }
+            scalar::adam_step(w + i, g + i, m + i, v + i, n - i, step);
+        }
+
+    }
+
+#pragma endregion
+#endif
+#pragma region dispatch
+
+    namespace detail {
+
+        /**
+         * Runs a double kernel on float data through a small stack block
+         */
+        template <void (*F)(const double*, double*, std::size_t)>
+        inline void widened(const float* x, float* out, std::size_t n) {
+            constexpr std::size_t BLOCK = 256;
+            double block[BLOCK];
+            for (std::size_t begin = 0; begin < n; begin += BLOCK) {
+                const std::size_t count = std::min(BLOCK, n - begin);
+                std::copy(x + begin, x + begin + count, block);
+                F(block, block, count);
+                std::copy(block, block + count, out + begin);
+            }
+        }
+
+        // the *_fast approximations are written for double, float data goes through widened
+        template <typename T, void (*F)(const double*, double*, std::size_t)>
+        constexpr auto fast_kernel() {
+            if constexpr (std::is_same_v<T, double>) return F;
+            else return &widened<F>;
+        }
+
+#ifdef MATH_SIMD_X86
+        /**
+         * VNNI is missing on some CPUs with AVX-512F; they use the AVX2 kernel
+         */
+        inline auto avx512_gemm_i8() {
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw")) return &avx512::gemm_i8_vnni;
+            return &avx2::gemm_i8;
+        }
+#endif
+
+    }
+
+    template <typename T = double>
+    inline const BasicKernels<T>& kernels_for(Isa isa) {
+        static_assert(std::is_same_v<T, double> || std::is_same_v<T, float>, "Kernels exist for double and float");
+        using detail::fast_kernel;
+
+        static const BasicKernels<T> scalar_kernels = { Isa::Scalar, "scalar", scalar::dot, scalar::axpy, scalar::mul_add, scalar::scale, scalar::add, scalar::sub, scalar::gemv, scalar::gemm_i8, scalar::gemm_micro,
+            fast_kernel<T, scalar::exp_fast>(), fast_kernel<T, scalar::log_fast>(), fast_kernel<T, scalar::log1p_fast>(), fast_kernel<T, scalar::tanh_fast>(), fast_kernel<T, scalar::sigmoid_fast>(),
+            scalar::dot_wide, scalar::philox, scalar::sgd_step, scalar::momentum_step, scalar::adam_step };
+#ifdef MATH_SIMD_X86
+        static const BasicKernels<T> sse2_kernels = { Isa::SSE2, "sse2", sse2::dot, sse2::axpy, sse2::mul_add, sse2::scale, sse2::add, sse2::sub, sse2::gemv, sse2::gemm_i8, sse2::gemm_micro,
+            fast_kernel<T, scalar::exp_fast>(), fast_kernel<T, scalar::log_fast>(), fast_kernel<T, scalar::log1p_fast>(), fast_kernel<T, scalar::tanh_fast>(), fast_kernel<T, scalar::sigmoid_fast>(),
+            sse2::dot_wide, scalar::philox, sse2::sgd_step, sse2::momentum_step, sse2::adam_step };
+        static const BasicKernels<T> avx2_kernels = { Isa::AVX2, "avx2", avx2::dot, avx2::axpy, avx2::mul_add, avx2::scale, avx2::add, avx2::sub, avx2::gemv, avx2::gemm_i8, avx2::gemm_micro,
+            fast_kernel<T, avx2::exp_fast>(), fast_kernel<T, avx2::log_fast>(), fast_kernel<T, avx2::log1p_fast>(), fast_kernel<T, avx2::tanh_fast>(), fast_kernel<T, avx2::sigmoid_fast>(),
+            avx2::dot_wide, avx2::philox, avx2::sgd_step, avx2::momentum_step, avx2::adam_step };
+        static const BasicKernels<T> avx512_kernels = { Isa::AVX512, "avx512", avx512::dot, avx512::axpy, avx512::mul_add, avx512::scale, avx512::add, avx512::sub, avx512::gemv, detail::avx512_gemm_i8(), avx512::gemm_micro,
+            fast_kernel<T, avx512::exp_fast>(), fast_kernel<T, avx512::log_fast>(), fast_kernel<T, avx512::log1p_fast>(), fast_kernel<T, avx512::tanh_fast>(), fast_kernel<T, avx512::sigmoid_fast>(),
+            avx512::dot_wide, avx512::philox, avx512::sgd_step, avx512::momentum_step, avx512::adam_step };
+
+        switch (isa) {
+        case Isa::AVX512: return avx512_kernels;
+        case Isa::AVX2: return avx2_kernels;
+        case Isa::SSE2: return sse2_kernels;
+        default: break;
+        }
+#endif
+        (void)isa;
+        return scalar_kernels;
+    }
+
+    /**
+     * @return widest instruction set supported by this CPU (and enabled by the OS)
+     */
+    inline Isa detect_isa() {
+#ifdef MATH_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return Isa::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Isa::AVX2;
+        if (__builtin_cpu_supports("sse2")) return Isa::SSE2;
+#endif
+        return Isa::Scalar;
+    }
+
+    /**
+     * @return instruction set named by the MATH_SIMD environment variable
+     * (scalar, sse2, avx2, avx512), capped at what the CPU supports
+     */
+    inline Isa startup_isa() {
+        const Isa best = detect_isa();
+        const char* env = std::getenv("MATH_SIMD");
+        if (!env) return best;
+
+        Isa requested = best;
+        if (std::strcmp(env, "scalar") == 0) requested = Isa::Scalar;
+        else if (std::strcmp(env, "sse2") == 0) requested = Isa::SSE2;
+        else if (std::strcmp(env, "avx2") == 0) requested = Isa::AVX2;
+        else if (std::strcmp(env, "avx512") == 0) requested = Isa::AVX512;
+
+        return std::min(requested, best);
+    }
+
+    namespace detail {
+        inline Isa& active_isa() {
+            static Isa active = startup_isa();
+            return active;
+        }
+    }
+
+    /**
+     * @return kernel table of the instruction set selected at startup
+     */
+    template <typename T = double>
+    inline const BasicKernels<T>& kernels() {
+        return kernels_for<T>(detail::active_isa());
+    }
+
+    /**
+     * Switches every Math.hpp kernel to the given instruction set (capped at what the CPU supports)
+     * @return instruction set actually in use
+     */
+    inline Isa set_isa(Isa isa) {
+        detail::active_isa() = std::min(isa, detect_isa());
+        return detail::active_isa();
+    }
+
+#pragma endregion
+
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+#include "Dataset.hpp"
+#include "Math.hpp"
+#include "Network.hpp"
+#include "Random.hpp"
+#include "ThreadPool.hpp"
+#include "Workspace.hpp"
+
+/**
+ * Sweep.hpp
+ * Trains many independent models of one topology in lockstep, for hyperparameter sweeps.
+ * Storage is structure-of-arrays: every weight, bias, activation and gradient is a row of
+ * one value per model (a lane), so each SIMD kernel call advances every model at once and the
+ * per-call overhead is shared by all of them. Models of different shapes go into separate
+ * groups, and sweep() spreads the groups, cut into blocks of lanes, across the ThreadPool.
+ */
+namespace nn {
+
+    /**
+     * One model of a sweep: hidden layer widths, the seed its weights are drawn from, and its learning rate
+     */
+    struct SweepConfig {
+        std::vector<std::size_t> hidden;
+        std::uint64_t seed = 0;
+        double learning_rate = 0.0;
+    };
+
+    /**
+     * Outcome of one model; loss is the mean over each epoch's samples, as in a single run
+     */
+    template <typename T>
+    struct SweepResult {
+        SweepConfig config;
+        double best_loss = std::numeric_limits<double>::max();
+        std::size_t best_epoch = 0;
+        double final_loss = 0.0;
+        Network<T> weights;
+    };
+
+    /**
+     * Plain SGD for lanes models of one topology over a fixed-size minibatch.
+     * Every model sees the same minibatches; only their initial weights and learning rates differ.
+     * Parameter p of layer l is row p of weights[l] (unit-major, like Layer::weight), and sample n's
+     * activation of unit u is row n * units + u of outputs[l]; every row holds lanes values.
+     */
+    template <typename T>
+    class SweepTrainer {
+    private:
+        Topology topology;
+        std::size_t lane_count = 0;
+        std::size_t batch_size = 0;
+
+        std::vector<math::BasicMatrix<T>> weights;
+        std::vector<math::BasicMatrix<T>> biases;
+        std::vector<math::BasicMatrix<T>> weight_gradients;
+        std::vector<math::BasicMatrix<T>> bias_gradients;
+        std::vector<math::BasicMatrix<T>> outputs;
+        std::vector<math::BasicMatrix<T>> deltas;
+
+        // -learning_rate / batch of every lane, so the update is one multiply-add per parameter row
+        math::aligned_vector<T> steps;
+        std::vector<double> loss;
+
+        void forward(const T* inputs, const math::simd::BasicKernels<T>& k) {
+            for (std::size_t l = 0; l < topology.depth(); ++l) {
+                const std::size_t units = topology.layers[l].units;
+                const std::size_t fan_in = topology.fan_in(l);
+                math::BasicMatrix<T>& out = outputs[l];
+
+                for (std::size_t n = 0; n < batch_size; ++n) {
+                    for (std::size_t u = 0; u < units; ++u) {
+                        T* row = out.row_data(n * units + u);
+                        std::copy(biases[l].row_data(u), biases[l].row_data(u) + lane_count, row);
+                        for (std::size_t i = 0; i < fan_in; ++i) {
+                            // the dataset inputs are the same for every lane; deeper inputs are per lane
+                            if (l == 0) k.axpy(inputs[n * fan_in + i], weights[l].row_data(u * fan_in + i), row, lane_count);
+                            else k.mul_add(weights[l].row_data(u * fan_in + i), outputs[l - 1].row_data(n * fan_in + i), row, lane_count);
+                        }
+                    }
+                }
+                activate(topology.layers[l].activation, out);
+            }
+        }
+
+        void backward(const T* inputs, const math::simd::BasicKernels<T>& k) {
+            for (std::size_t l = topology.depth(); l-- > 0;) {
+                const std::size_t units = topology.layers[l].units;
+                const std::size_t fan_in = topology.fan_in(l);
+                if (l > 0) std::fill(deltas[l - 1].data(), deltas[l - 1].data() + deltas[l - 1].size(), T(0));
+
+                for (std::size_t n = 0; n < batch_size; ++n) {
+                    for (std::size_t u = 0; u < units; ++u) {
+                        const T* delta = deltas[l].row_data(n * units + u);
+                        k.add(bias_gradients[l].row_data(u), delta, bias_gradients[l].row_data(u), lane_count);
+                        for (std::size_t i = 0; i < fan_in; ++i) {
+                            T* gradient = weight_gradients[l].row_data(u * fan_in + i);
+                            if (l == 0) {
+                                k.axpy(inputs[n * fan_in + i], delta, gradient, lane_count);
+                            } else {
+                                k.mul_add(delta, outputs[l - 1].row_data(n * fan_in + i), gradient, lane_count);
+                                k.mul_add(delta, weights[l].row_data(u * fan_in + i), deltas[l - 1].row_data(n * fan_in + i), lane_count);
+                            }
+                        }
+                    }
+                }
+                if (l > 0) activation_backward(topology.layers[l - 1].activation, outputs[l - 1], deltas[l - 1]);
+            }
+        }
+
+    public:
+        /**
+         * Xavier-initialises every model from its own seed, drawing exactly the numbers a single run
+         * with that seed draws (Philox stream l for layer l), so lane i starts where that run starts
+         * @param models one seed and learning rate per lane
+         */
+        SweepTrainer(const Topology& topo, const std::vector<SweepConfig>& models, std::size_t batch)
+            : topology(topo), lane_count(models.size()), batch_size(batch), steps(models.size()), loss(models.size(), 0.0) {
+            topo.validate();
+            if (models.empty()) throw std::invalid_argument("A sweep needs at least one model");
+            if (batch == 0) throw std::invalid_argument("Batch must not be empty");
+
+            std::vector<T> column;
+            for (std::size_t l = 0; l < topo.depth(); ++l) {
+                const std::size_t units = topo.layers[l].units;
+                const std::size_t fan_in = topo.fan_in(l);
+                weights.emplace_back(units * fan_in, lane_count);
+                biases.emplace_back(units, lane_count);
+                weight_gradients.emplace_back(units * fan_in, lane_count);
+                bias_gradients.emplace_back(units, lane_count);
+                outputs.emplace_back(batch * units, lane_count);
+                deltas.emplace_back(batch * units, lane_count);
+
+                const double limit = math::xavier_limit(static_cast<double>(fan_in), static_cast<double>(units));
+                column.resize(units * fan_in);
+                for (std::size_t m = 0; m < lane_count; ++m) {
+                    Philox(models[m].seed).Fill(l, 0, column.data(), column.size(), -limit, limit);
+                    for (std::size_t p = 0; p < column.size(); ++p) weights[l](p, m) = column[p];
+                }
+            }
+            for (std::size_t m = 0; m < lane_count; ++m) steps[m] = static_cast<T>(-models[m].learning_rate / static_cast<double>(batch));
+        }
+
+        std::size_t lanes() const { return lane_count; }
+        std::size_t size() const { return batch_size; }
+
+        /**
+         * One SGD step of every model on the same minibatch (row-major inputs and targets, one row of each per sample)
+         * @return loss of every lane summed over the minibatch, before the update
+         */
+        const std::vector<double>& step(math::identity_t<math::BasicRowView<const T>> inputs, math::identity_t<math::BasicRowView<const T>> targets) {
+            if (inputs.size() != batch_size * topology.input) throw std::invalid_argument("Inputs must have shape batch x input");
+            if (targets.size() != batch_size * topology.output()) throw std::invalid_argument("Targets must have shape batch x output");
+            const math::simd::BasicKernels<T>& k = math::simd::kernels<T>();
+
+            forward(inputs.data(), k);
+
+            std::fill(loss.begin(), loss.end(), 0.0);
+            const std::size_t outputs_per_sample = topology.output();
+            for (std::size_t r = 0; r < batch_size * outputs_per_sample; ++r) {
+                const T target = targets[r];
+                const T* logit = outputs.back().row_data(r);
+                T* delta = deltas.back().row_data(r);
+                for (std::size_t m = 0; m < lane_count; ++m) {
+                    loss[m] += math::bce_with_logits_loss(logit[m], target);
+                    delta[m] = math::bce_with_logits_loss_delta(logit[m], target);
+                }
+            }
+
+            for (math::BasicMatrix<T>& g : weight_gradients) std::fill(g.data(), g.data() + g.size(), T(0));
+            for (math::BasicMatrix<T>& g : bias_gradients) std::fill(g.data(), g.data() + g.size(), T(0));
+            backward(inputs.data(), k);
+
+            for (std::size_t l = 0; l < topology.depth(); ++l) {
+                for (std::size_t p = 0; p < weights[l].rows(); ++p) k.mul_add(steps.data(), weight_gradients[l].row_data(p), weights[l].row_data(p), lane_count);
+                for (std::size_t u = 0; u < biases[l].rows(); ++u) k.mul_add(steps.data(), bias_gradients[l].row_data(u), biases[l].row_data(u), lane_count);
+            }
+            return loss;
+        }
+
+        /**
+         * Copies the weights of one lane into net, which must have this trainer's topology
+         */
+        void extract(std::size_t lane, Network<T>& net) const {
+            if (net.topology != topology) throw std::invalid_argument("Network must have the sweep topology");
+            for (std::size_t l = 0; l < topology.depth(); ++l) {
+                for (std::size_t p = 0; p < weights[l].rows(); ++p) net.layers[l].weight.data()[p] = weights[l](p, lane);
+                for (std::size_t u = 0; u < biases[l].rows(); ++u) net.layers[l].bias[u] = biases[l](u, lane);
+            }
+        }
+    };
+
+    /**
+     * Trains every configuration for the given number of epochs on dataset, every model seeing the same
+     * minibatches (shuffled by data_seed). Configurations with the same hidden layers share a group;
+     * each group is cut into blocks of at most max_lanes models, and the blocks run in parallel.
+     * @return one result per configuration, in order
+     */
+    template <typename T>
+    inline std::vector<SweepResult<T>> sweep(const Dataset<T>& dataset, const std::vector<SweepConfig>& configs, Activation activation,
+        std::size_t epochs, std::size_t batch, std::uint64_t data_seed, std::size_t max_lanes = 64) {
+        if (configs.empty()) throw std::invalid_argument("A sweep needs at least one configuration");
+        max_lanes = std::max<std::size_t>(max_lanes, 1);
+
+        struct Block {
+            Topology topology;
+            std::vector<std::size_t> members;
+        };
+
+        // too few models per group would leave threads idle, so groups split down to blocks of 8 lanes
+        constexpr std::size_t MIN_LANES = 8;
+        const std::size_t threads = ThreadPool::Global().Size() + 1;
+        std::map<std::vector<std::size_t>, std::vector<std::size_t>> groups;
+        for (std::size_t c = 0; c < configs.size(); ++c) groups[configs[c].hidden].push_back(c);
+
+        std::vector<Block> blocks;
+        for (const auto& [hidden, members] : groups) {
+            const std::size_t count = members.size();
+            const std::size_t parts = std::max((count + max_lanes - 1) / max_lanes, std::min(threads, (count + MIN_LANES - 1) / MIN_LANES));
+            const Topology topology = dense_topology(dataset.input_count(), hidden, dataset.output_count(), activation);
+            for (std::size_t part = 0; part < parts; ++part) {
+                const std::size_t first = count * part / parts, last = count * (part + 1) / parts;
+                if (first == last) continue;
+                blocks.push_back(Block{ topology, std::vector<std::size_t>(members.begin() + first, members.begin() + last) });
+            }
+        }
+
+        std::vector<SweepResult<T>> results;
+        results.reserve(configs.size());
+        for (std::size_t c = 0; c < configs.size(); ++c) {
+            results.push_back(SweepResult<T>{ configs[c], std::numeric_limits<double>::max(), 0, 0.0,
+                Network<T>(dense_topology(dataset.input_count(), configs[c].hidden, dataset.output_count(), activation)) });
+        }
+
+        ThreadPool::Global().ParallelFor(0, blocks.size(), 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t b = begin; b < end; ++b) {
+                const Block& block = blocks[b];
+                std::vector<SweepConfig> models;
+                for (std::size_t c : block.members) models.push_back(configs[c]);
+
+                MinibatchStream<T> stream(dataset, batch == 0 ? dataset.size() : batch, data_seed);
+                SweepTrainer<T> trainer(block.topology, models, stream.batch_size());
+                std::vector<double> epoch_loss(models.size());
+
+                for (std::size_t epoch = 1; epoch <= epochs; ++epoch) {
+                    std::fill(epoch_loss.begin(), epoch_loss.end(), 0.0);
+                    for (std::size_t s = 0; s < stream.batches_per_epoch(); ++s) {
+                        const Minibatch<T> minibatch = stream.next();
+                        const std::vector<double>& loss = trainer.step(minibatch.inputs, minibatch.targets);
+                        for (std::size_t m = 0; m < models.size(); ++m) epoch_loss[m] += loss[m];
+                    }
+                    for (std::size_t m = 0; m < models.size(); ++m) {
+                        SweepResult<T>& result = results[block.members[m]];
+                        result.final_loss = epoch_loss[m] / static_cast<double>(stream.samples_per_epoch());
+                        if (result.final_loss < result.best_loss) {
+                            result.best_loss = result.final_loss;
+                            result.best_epoch = epoch;
+                        }
+                    }
+                }
+                for (std::size_t m = 0; m < models.size(); ++m) trainer.extract(m, results[block.members[m]].weights);
+            }
+        });
+
+        return results;
+    }
+
+}
@@ -0,0 +1,300 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * ThreadPool.hpp
+ * Persistent work-stealing thread pool used by Math.hpp for large operands.
+ * Every worker owns a bounded task queue; it pops its own newest task and, when empty,
+ * steals the oldest task of another worker. The thread that calls ParallelFor runs
+ * chunks too, so no core sits idle waiting. Tasks are plain structs (a function pointer, its
+ * context and a range), not std::function.
+ */
+class ThreadPool {
+private:
+    struct Task {
+        void (*run)(void* context, std::size_t begin, std::size_t end) = nullptr;
+        void* context = nullptr;
+        std::size_t begin = 0;
+        std::size_t end = 0;
+        std::atomic<std::size_t>* remaining = nullptr;
+    };
+
+    /**
+     * Fixed-capacity ring buffer of tasks guarded by its own lock
+     */
+    struct Queue {
+        static constexpr std::size_t CAPACITY = 256;
+
+        std::mutex mutex;
+        Task tasks[CAPACITY];
+        std::size_t head = 0;
+        std::size_t count = 0;
+
+        bool push(const Task& task) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (count == CAPACITY) return false;
+            tasks[(head + count) % CAPACITY] = task;
+            ++count;
+            return true;
+        }
+
+        // owner side: newest task first, it's most likely still in cache
+        bool pop(Task& task) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (count == 0) return false;
+            --count;
+            task = tasks[(head + count) % CAPACITY];
+            return true;
+        }
+
+        // thief side: oldest task first
+        bool steal(Task& task) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (count == 0) return false;
+            task = tasks[head];
+            head = (head + 1) % CAPACITY;
+            --count;
+            return true;
+        }
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> queued{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+
+    static inline std::mutex global_mutex;
+    static inline std::unique_ptr<ThreadPool> global;
+    // set once, when the global pool is created; it is resized in place, never replaced
+    static inline std::atomic<ThreadPool*> global_instance{ nullptr };
+    static inline std::size_t configured_threads = 0;
+    static inline thread_local std::size_t worker_index = SIZE_MAX;
+
+    static void Execute(const Task& task) {
+        task.run(task.context, task.begin, task.end);
+        task.remaining->fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    bool TryTake(std::size_t self, Task& task) {
+        if (queues.empty()) return false;
+        if (self < queues.size() && queues[self]->pop(task)) {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+        const std::size_t start = self < queues.size() ? self + 1 : 0;
+        for (std::size_t i = 0; i < queues.size(); ++i) {
+            if (queues[(start + i) % queues.size()]->steal(task)) {
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WorkerLoop(std::size_t index) {
+        worker_index = index;
+        Task task;
+        while (true) {
+            if (TryTake(index, task)) {
+                Execute(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [this] { return stopping.load() || queued.load() > 0; });
+            if (stopping.load() && queued.load() == 0) return;
+        }
+    }
+
+    template <typename F>
+    static void Trampoline(void* context, std::size_t begin, std::size_t end) {
+        (*static_cast<F*>(context))(begin, end);
+    }
+
+    void Start(std::size_t threadCount) {
+        queues.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i) queues.push_back(std::make_unique<Queue>());
+        threads.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i) threads.emplace_back([this, i] { WorkerLoop(i); });
+    }
+
+    // workers finish every queued task before they exit
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping.store(true);
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+        threads.clear();
+        queues.clear();
+        stopping.store(false);
+    }
+
+    /**
+     * @return total thread count for a Configure() argument: as given, else MATH_THREADS, else one per hardware thread
+     */
+    static std::size_t ResolveThreads(std::size_t threadCount) {
+        if (threadCount == 0) {
+            if (const char* env = std::getenv("MATH_THREADS")) threadCount = static_cast<std::size_t>(std::strtoul(env, nullptr, 10));
+        }
+        if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+        return threadCount;
+    }
+
+public:
+    /**
+     * @param threadCount number of worker threads (the calling thread always helps on top of these)
+     */
+    explicit ThreadPool(std::size_t threadCount) { Start(threadCount); }
+
+    ~ThreadPool() { Stop(); }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @return number of worker threads, not counting callers
+     */
+    std::size_t Size() const { return threads.size(); }
+
+    /**
+     * Replaces the worker threads with threadCount new ones. The pool object stays the same, so references
+     * to it remain valid; objects sized from an earlier Size() keep that size.
+     * Must not run while any thread is inside ParallelFor or Broadcast, and throws if called from a pool task.
+     */
+    void Resize(std::size_t threadCount) {
+        if (worker_index != SIZE_MAX) throw std::logic_error("A thread pool cannot be resized from one of its own tasks");
+        if (threadCount == threads.size()) return;
+        Stop();
+        Start(threadCount);
+    }
+
+    /**
+     * Runs fn(begin, end) over [first, last) split into chunks of at least grain elements.
+     * Blocks until every chunk has finished; the calling thread executes chunks as well.
+     */
+    template <typename F>
+    void ParallelFor(std::size_t first, std::size_t last, std::size_t grain, F&& fn) {
+        if (last <= first) return;
+        const std::size_t total = last - first;
+        grain = std::max<std::size_t>(grain, 1);
+
+        const std::size_t max_chunks = (threads.size() + 1) * 4;
+        const std::size_t chunks = std::min((total + grain - 1) / grain, max_chunks);
+        if (threads.empty() || chunks <= 1) {
+            fn(first, last);
+            return;
+        }
+
+        using Fn = std::remove_reference_t<F>;
+        std::atomic<std::size_t> remaining{ chunks };
+        const std::size_t step = total / chunks;
+        const std::size_t extra = total % chunks;
+
+        // chunk 0 stays with the caller, the rest are dealt round-robin to the workers
+        std::size_t begin = first + step + (extra > 0 ? 1 : 0);
+        const std::size_t first_end = begin;
+        for (std::size_t c = 1; c < chunks; ++c) {
+            const std::size_t end = begin + step + (c < extra ? 1 : 0);
+            Task task{ &Trampoline<Fn>, const_cast<void*>(static_cast<const void*>(&fn)), begin, end, &remaining };
+            // counted before it's visible, so a worker taking it can never drive queued below zero
+            queued.fetch_add(1, std::memory_order_relaxed);
+            if (!queues[c % queues.size()]->push(task)) {
+                queued.fetch_sub(1, std::memory_order_relaxed);
+                Execute(task);
+            }
+            begin = end;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        wake.notify_all();
+
+        fn(first, first_end);
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+
+        Task task;
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (TryTake(worker_index, task)) Execute(task);
+            else std::this_thread::yield();
+        }
+    }
+
+    /**
+     * Runs fn() exactly once on every worker thread and once on the caller, e.g. to warm up
+     * thread_local buffers. Each worker task waits until all of them have started, so no worker
+     * can pick up a second one. Must not be called from inside a pool task.
+     */
+    template <typename F>
+    void Broadcast(F&& fn) {
+        fn();
+        if (threads.empty()) return;
+
+        struct Context {
+            std::remove_reference_t<F>* fn;
+            std::atomic<std::size_t> started;
+            std::size_t workers;
+        } context{ &fn, { 0 }, threads.size() };
+
+        auto run = [](void* raw, std::size_t, std::size_t) {
+            Context& ctx = *static_cast<Context*>(raw);
+            ctx.started.fetch_add(1, std::memory_order_acq_rel);
+            while (ctx.started.load(std::memory_order_acquire) < ctx.workers) std::this_thread::yield();
+            (*ctx.fn)();
+        };
+
+        std::atomic<std::size_t> remaining{ threads.size() };
+        for (std::size_t i = 0; i < threads.size(); ++i) {
+            Task task{ run, &context, 0, 0, &remaining };
+            queued.fetch_add(1, std::memory_order_relaxed);
+            while (!queues[i]->push(task)) std::this_thread::yield();
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        wake.notify_all();
+
+        while (remaining.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+    }
+
+    /**
+     * Sets how many threads the global pool computes on, the calling thread included
+     * (so 1 disables worker threads); 0 goes back to MATH_THREADS, or one per hardware thread.
+     * An existing pool is resized in place (see Resize()), otherwise it takes effect on first use.
+     */
+    static void Configure(std::size_t threadCount) {
+        std::lock_guard<std::mutex> lock(global_mutex);
+        configured_threads = threadCount;
+        if (global) global->Resize(ResolveThreads(threadCount) - 1);
+    }
+
+    /**
+     * @return pool shared by the math library, created on first use.
+     * Without Configure(), the MATH_THREADS environment variable sets the thread count.
+     */
+    static ThreadPool& Global() {
+        if (ThreadPool* pool = global_instance.load(std::memory_order_acquire)) return *pool;
+
+        std::lock_guard<std::mutex> lock(global_mutex);
+        if (!global) {
+            global = std::make_unique<ThreadPool>(ResolveThreads(configured_threads) - 1);
+            global_instance.store(global.get(), std::memory_order_release);
+        }
+        return *global;
+    }
+};
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "Dataset.hpp"
+#include "Math.hpp"
+#include "Network.hpp"
+#include "Optimizer.hpp"
+#include "ThreadPool.hpp"
+#include "Workspace.hpp"
+
+/**
+ * Trainer.hpp
+ * Evaluation of a network, and the trainers that drive its forward and backward pass.
+ * DataParallelTrainer shards every minibatch across the ThreadPool. Each shard fills its own
+ * Workspace, and the shard gradients are summed along a fixed binary tree,
+ * so a run is bit-reproducible for a given seed and shard count however the threads are scheduled.
+ * HogwildTrainer trades that reproducibility for throughput: workers update the shared weights
+ * per sample without any locking.
+ */
+namespace nn {
+
+    /**
+     * Mean loss per output and fraction of outputs classified correctly
+     */
+    template <typename Acc>
+    struct Evaluation {
+        Acc loss = Acc(0);
+        double accuracy = 0.0;
+    };
+
+    /**
+     * Loss and accuracy of a network (Network<T> or NetworkView<T>) over a whole dataset, in chunks of at most chunk samples
+     */
+    template <typename Acc, typename Net, typename T>
+    inline Evaluation<Acc> evaluate(const Net& net, const Dataset<T>& data, std::size_t chunk = 256) {
+        if (data.input_count() != net.topology.input) throw std::invalid_argument("Dataset and network disagree on the number of inputs");
+        if (data.output_count() != net.topology.output()) throw std::invalid_argument("Dataset and network disagree on the number of outputs");
+
+        Evaluation<Acc> result;
+        if (data.size() == 0) return result;
+
+        chunk = std::clamp<std::size_t>(chunk, 1, data.size());
+        const Topology& topology = net.topology;
+        BasicWorkspace<T> ws(topology, chunk);
+        std::size_t correct = 0;
+
+        for (std::size_t first = 0; first < data.size(); first += chunk) {
+            const std::size_t rows = std::min(chunk, data.size() - first);
+            if (rows != ws.batch_size) ws = BasicWorkspace<T>(topology, rows);
+
+            const math::BasicRowView<const T> inputs = data.inputs(first, rows);
+            const math::BasicRowView<const T> targets = data.targets(first, rows);
+            std::copy(inputs.begin(), inputs.end(), ws.input.data());
+            forward(net, ws);
+
+            const math::BasicMatrix<T>& logits = ws.logits();
+            result.loss += math::bce_with_logits_loss<Acc>(logits.flat(), targets);
+            for (std::size_t i = 0; i < targets.size(); ++i) correct += (logits.data()[i] > T(0)) == (targets[i] > T(0.5));
+        }
+
+        result.loss /= static_cast<Acc>(data.size() * data.output_count());
+        result.accuracy = static_cast<double>(correct) / static_cast<double>(data.size() * data.output_count());
+        return result;
+    }
+
+    /**
+     * @return largest absolute difference between any two corresponding weights or biases
+     */
+    template <typename T>
+    inline T max_abs_difference(const Network<T>& a, const Network<T>& b) {
+        if (a.topology != b.topology) throw std::invalid_argument("Networks must have the same topology");
+
+        T worst = T(0);
+        auto compare = [&worst](const T* x, const T* y, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i) worst = std::max(worst, static_cast<T>(std::abs(x[i] - y[i])));
+        };
+        for (std::size_t l = 0; l < a.depth(); ++l) {
+            compare(a.layers[l].weight.data(), b.layers[l].weight.data(), a.layers[l].weight.size());
+            compare(a.layers[l].bias.data(), b.layers[l].bias.data(), a.layers[l].bias.size());
+        }
+        return worst;
+    }
+
+    /**
+     * Synchronous data-parallel training over a fixed-size minibatch.
+     * The batch is split into contiguous shards, one Workspace each. A step runs every shard
+     * on the ThreadPool, sums the shard gradients pairwise (shard i absorbs shard i + stride
+     * for stride = 1, 2, 4, ...) and hands the total to the Optimizer once. The tree depends only
+     * on the shard count, so the result does too.
+     */
+    template <typename T, typename Acc = T>
+    class DataParallelTrainer {
+    private:
+        Topology topology;
+        std::size_t batch_size = 0;
+        std::vector<std::size_t> shard_begin;
+        std::vector<BasicWorkspace<T>> shards;
+        std::vector<Acc> shard_loss;
+        std::vector<T> targets;
+        Optimizer<T> optimizer;
+
+    public:
+        /**
+         * @param shard_count number of shards, capped at the batch size; one per pool thread is a good default
+         */
+        DataParallelTrainer(const Topology& topo, std::size_t batch, std::size_t shard_count, const OptimizerSettings& settings = {})
+            : topology(topo), batch_size(batch), targets(batch * topo.output()), optimizer(topo, settings) {
+            if (batch == 0) throw std::invalid_argument("Batch must not be empty");
+            shard_count = std::clamp<std::size_t>(shard_count, 1, batch);
+
+            shard_begin.reserve(shard_count + 1);
+            shards.reserve(shard_count);
+            for (std::size_t s = 0; s <= shard_count; ++s) shard_begin.push_back(batch * s / shard_count);
+            for (std::size_t s = 0; s < shard_count; ++s) shards.emplace_back(topo, shard_begin[s + 1] - shard_begin[s]);
+            shard_loss.assign(shard_count, Acc(0));
+
+            // any thread may end up running any shard, so every one gets its packing buffers now
+            ThreadPool::Global().Broadcast([] { math::gemm_reserve<T>(); });
+        }
+
+        std::size_t size() const { return batch_size; }
+        std::size_t shard_count() const { return shards.size(); }
+        const OptimizerSettings& optimizer_settings() const { return optimizer.settings(); }
+
+        /**
+         * Zeroes the optimizer state, for training another network from scratch
+         */
+        void reset_optimizer() { optimizer.reset(); }
+
+        /**
+         * Copies a minibatch (row-major inputs and targets, one row of each per sample) into the shard workspaces
+         */
+        void load_batch(math::identity_t<math::BasicRowView<const T>> inputs, math::identity_t<math::BasicRowView<const T>> batch_targets) {
+            if (inputs.size() != batch_size * topology.input) throw std::invalid_argument("Inputs must have shape batch x input");
+            if (batch_targets.size() != batch_size * topology.output()) throw std::invalid_argument("Targets must have shape batch x output");
+
+            for (std::size_t s = 0; s < shards.size(); ++s) {
+                const std::size_t rows = shard_begin[s + 1] - shard_begin[s];
+                const T* first = inputs.data() + shard_begin[s] * topology.input;
+                std::copy(first, first + rows * topology.input, shards[s].input.data());
+            }
+            std::copy(batch_targets.begin(), batch_targets.end(), targets.begin());
+        }
+
+        /**
+         * One synchronous optimizer step on the loaded minibatch (for SGD: p -= learning_rate * mean gradient)
+         * @param with_loss false skips measuring the loss, for steps whose loss nobody reads
+         * @return loss summed over the minibatch, before the update (0 without with_loss)
+         */
+        Acc step(Network<T>& p, double learning_rate, bool with_loss = true) {
+            ThreadPool& pool = ThreadPool::Global();
+            const std::size_t count = shards.size();
+
+            pool.ParallelFor(0, count, 1, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t s = begin; s < end; ++s) {
+                    const std::size_t outputs = topology.output();
+                    const math::BasicRowView<const T> shard_targets(targets.data() + shard_begin[s] * outputs, shards[s].batch_size * outputs);
+                    shard_loss[s] = accumulate_gradients<Acc>(p, shards[s], shard_targets, with_loss);
+                }
+            });
+
+            for (std::size_t stride = 1; stride < count; stride *= 2) {
+                const std::size_t pairs = (count + 2 * stride - 1) / (2 * stride);
+                pool.ParallelFor(0, pairs, 1, [&](std::size_t begin, std::size_t end) {
+                    for (std::size_t pair = begin; pair < end; ++pair) {
+                        const std::size_t dst = pair * 2 * stride;
+                        const std::size_t src = dst + stride;
+                        if (src >= count) continue;
+                        add_gradients(shards[dst], shards[src]);
+                        shard_loss[dst] += shard_loss[src];
+                    }
+                });
+            }
+
+            optimizer.apply(p, shards[0], learning_rate, batch_size);
+            return shard_loss[0];
+        }
+
+        /**
+         * @return logit of one output of a sample from the last step's forward pass
+         */
+        T logit(std::size_t sample, std::size_t output = 0) const {
+            const std::size_t s = std::upper_bound(shard_begin.begin(), shard_begin.end(), sample) - shard_begin.begin() - 1;
+            return shards[s].logits()(sample - shard_begin[s], output);
+        }
+    };
+
+    /**
+     * How far the weights an asynchronous worker read were behind the weights it updated
+     */
+    struct AsyncStats {
+        std::uint64_t updates = 0;
+        std::uint64_t max_staleness = 0;
+        double mean_staleness = 0.0;
+    };
+
+    /**
+     * Asynchronous (Hogwild) SGD over a fixed-size minibatch.
+     * Every worker pulls samples from a shared cursor, runs forward and backward for one sample
+     * against the current weights and applies its gradient straight away, without locks.
+     * Concurrent updates to the same weight may overwrite each other; for the small, dense
+     * updates here that noise is far below the gradient noise, and nobody ever waits for the slowest
+     * sample. Each sample steps by learning_rate / batch, so an epoch moves the weights about as far as
+     * one synchronous step. Results depend on scheduling and are only reproducible with one worker.
+     */
+    template <typename T, typename Acc = T>
+    class HogwildTrainer {
+    private:
+        struct alignas(64) Worker {
+            BasicWorkspace<T> ws;
+            Acc loss = Acc(0);
+            std::uint64_t updates = 0;
+            std::uint64_t staleness_sum = 0;
+            std::uint64_t staleness_max = 0;
+
+            explicit Worker(const Topology& topo) : ws(topo, 1) {}
+        };
+
+        Topology topology;
+        std::size_t batch_size = 0;
+        std::vector<Worker> workers;
+        math::BasicRowView<const T> inputs;
+        math::BasicRowView<const T> targets;
+        std::vector<T> logits;
+
+        alignas(64) std::atomic<std::size_t> cursor{ 0 };
+        alignas(64) std::atomic<std::uint64_t> version{ 0 };
+
+        void run(Network<T>& p, Worker& w, T step, bool with_loss) {
+            for (std::size_t n = cursor.fetch_add(1, std::memory_order_relaxed); n < batch_size; n = cursor.fetch_add(1, std::memory_order_relaxed)) {
+                std::copy(inputs.data() + n * topology.input, inputs.data() + (n + 1) * topology.input, w.ws.input.data());
+
+                const std::uint64_t read = version.load(std::memory_order_acquire);
+                const std::size_t outputs = topology.output();
+                w.loss += accumulate_gradients<Acc>(p, w.ws, math::BasicRowView<const T>(targets.data() + n * outputs, outputs), with_loss);
+                std::copy(w.ws.logits().begin(), w.ws.logits().end(), logits.begin() + n * outputs);
+                apply_gradients(p, w.ws, step);
+
+                // updates other workers published between our read and our write
+                const std::uint64_t staleness = version.fetch_add(1, std::memory_order_acq_rel) - read;
+                ++w.updates;
+                w.staleness_sum += staleness;
+                w.staleness_max = std::max(w.staleness_max, staleness);
+            }
+        }
+
+    public:
+        /**
+         * @param worker_count number of concurrent workers, capped at the batch size; one per pool thread is a good default
+         */
+        HogwildTrainer(const Topology& topo, std::size_t batch, std::size_t worker_count)
+            : topology(topo), batch_size(batch), logits(batch * topo.output()) {
+            if (batch == 0) throw std::invalid_argument("Batch must not be empty");
+            worker_count = std::clamp<std::size_t>(worker_count, 1, batch);
+
+            workers.reserve(worker_count);
+            for (std::size_t w = 0; w < worker_count; ++w) workers.emplace_back(topo);
+
+            ThreadPool::Global().Broadcast([] { math::gemm_reserve<T>(); });
+        }
+
+        std::size_t size() const { return batch_size; }
+        std::size_t worker_count() const { return workers.size(); }
+
+        /**
+         * Points the trainer at a minibatch (row-major inputs and targets, one row of each per sample).
+         * Workers read samples in place, so the data must stay valid until the next load_batch.
+         */
+        void load_batch(math::identity_t<math::BasicRowView<const T>> batch_inputs, math::identity_t<math::BasicRowView<const T>> batch_targets) {
+            if (batch_inputs.size() != batch_size * topology.input) throw std::invalid_argument("Inputs must have shape batch x input");
+            if (batch_targets.size() != batch_size * topology.output()) throw std::invalid_argument("Targets must have shape batch x output");
+
+            inputs = batch_inputs;
+            targets = batch_targets;
+        }
+
+        /**
+         * One asynchronous pass over the loaded minibatch, every sample updating p as soon as it's done
+         * @param with_loss false skips measuring the loss, for steps whose loss nobody reads
+         * @return loss summed over the minibatch, each sample measured against the weights it read (0 without with_loss)
+         */
+        Acc step(Network<T>& p, double learning_rate, bool with_loss = true) {
+            const T sample_step = static_cast<T>(learning_rate / batch_size);
+            cursor.store(0, std::memory_order_relaxed);
+            for (Worker& w : workers) w.loss = Acc(0);
+
+            ThreadPool::Global().ParallelFor(0, workers.size(), 1, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t w = begin; w < end; ++w) run(p, workers[w], sample_step, with_loss);
+            });
+
+            Acc loss = Acc(0);
+            for (const Worker& w : workers) loss += w.loss;
+            return loss;
+        }
+
+        /**
+         * @return logit of one output of a sample from the last step, computed against the weights it read
+         */
+        T logit(std::size_t sample, std::size_t output = 0) const { return logits[sample * topology.output() + output]; }
+
+        /**
+         * @return staleness of every update since construction
+         */
+        AsyncStats stats() const {
+            AsyncStats result;
+            std::uint64_t staleness_sum = 0;
+            for (const Worker& w : workers) {
+                result.updates += w.updates;
+                staleness_sum += w.staleness_sum;
+                result.max_staleness = std::max(result.max_staleness, w.staleness_max);
+            }
+            if (result.updates > 0) result.mean_staleness = static_cast<double>(staleness_sum) / result.updates;
+            return result;
+        }
+    };
+
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#include "AllocationCounter.hpp"
+#include "Profiler.hpp"
+
+/**
+ * TrainingLogger.hpp
+ * Progress logging that stays off the training thread.
+ * The training loop publishes its progress into a seqlock (a handful of relaxed stores, no locks,
+ * no formatting); a background thread wakes on a fixed time cadence, reads the latest progress
+ * plus the Profiler and (if counting is on) AllocationCounter totals, and writes one line with a single fwrite.
+ * However short the epochs, there is at most one line per interval.
+ */
+namespace nn {
+
+    struct Progress {
+        std::uint64_t epoch = 0;
+        double loss = 0.0;
+        double best_loss = 0.0;
+        std::uint64_t best_epoch = 0;
+    };
+
+    class TrainingLogger {
+    private:
+        using clock = std::chrono::steady_clock;
+
+        std::FILE* sink;
+        clock::duration interval;
+        std::uint64_t epochs;
+        clock::time_point started;
+
+        // seqlock: odd while the training thread is writing
+        alignas(64) std::atomic<std::uint64_t> sequence{ 0 };
+        std::atomic<std::uint64_t> epoch{ 0 };
+        std::atomic<double> loss{ 0.0 };
+        std::atomic<double> best_loss{ 0.0 };
+        std::atomic<std::uint64_t> best_epoch{ 0 };
+
+        // only touched by the logging thread
+        alignas(64) std::uint64_t logged_epoch = 0;
+        Profiler::Snapshot last_profile;
+        clock::time_point last_time;
+
+        bool stopping = false;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::thread worker;
+
+        Progress read() const {
+            Progress result;
+            while (true) {
+                const std::uint64_t before = sequence.load(std::memory_order_acquire);
+                if (before % 2 != 0) continue;
+                result.epoch = epoch.load(std::memory_order_relaxed);
+                result.loss = loss.load(std::memory_order_relaxed);
+                result.best_loss = best_loss.load(std::memory_order_relaxed);
+                result.best_epoch = best_epoch.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before) return result;
+            }
+        }
+
+        void write_line() {
+            const Progress progress = read();
+            if (progress.epoch == logged_epoch) return;
+            logged_epoch = progress.epoch;
+
+            const clock::time_point now = clock::now();
+            const Profiler::Snapshot profile = Profiler::Read();
+            const double elapsed = std::chrono::duration<double>(now - started).count();
+            const double window = std::chrono::duration<double>(now - last_time).count();
+            const double rate = window > 0 ? (profile.samples - last_profile.samples) / window : 0.0;
+
+            char line[512];
+            int length = std::snprintf(line, sizeof(line), "[%8.1f s] epoch %llu/%llu  loss %.8f  best %.8f @ %llu  %.0f samples/s",
+                elapsed, static_cast<unsigned long long>(progress.epoch), static_cast<unsigned long long>(epochs), progress.loss,
+                progress.best_loss, static_cast<unsigned long long>(progress.best_epoch), rate);
+            if (AllocationCounter::Enabled()) {
+                length += std::snprintf(line + length, sizeof(line) - length, "  allocations %llu", static_cast<unsigned long long>(AllocationCounter::Count()));
+            }
+
+            if (Profiler::Enabled()) {
+                std::uint64_t total = 0;
+                for (std::size_t p = 0; p < Profiler::PHASES; ++p) total += profile.nanoseconds[p] - last_profile.nanoseconds[p];
+                for (std::size_t p = 0; p < Profiler::PHASES && total > 0 && length < static_cast<int>(sizeof(line)); ++p) {
+                    length += std::snprintf(line + length, sizeof(line) - length, "%s%s %.1f%%", p == 0 ? "  | " : " ",
+                        Profiler::Name(static_cast<Profiler::Phase>(p)), 100.0 * (profile.nanoseconds[p] - last_profile.nanoseconds[p]) / total);
+                }
+            }
+            if (length >= static_cast<int>(sizeof(line))) length = sizeof(line) - 1;
+            line[length++] = '\n';
+
+            std::fwrite(line, 1, static_cast<std::size_t>(length), sink);
+            std::fflush(sink);
+            last_profile = profile;
+            last_time = now;
+        }
+
+        void loop() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!wake.wait_for(lock, interval, [this] { return stopping; })) {
+                lock.unlock();
+                write_line();
+                lock.lock();
+            }
+            lock.unlock();
+            write_line();
+        }
+
+    public:
+        /**
+         * @param seconds time between two progress lines
+         * @param epoch_count total epochs, shown next to the current one
+         */
+        TrainingLogger(std::FILE* output, double seconds, std::uint64_t epoch_count)
+            : sink(output),
+            interval(std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds))),
+            epochs(epoch_count),
+            started(clock::now()),
+            last_profile(Profiler::Read()),
+            last_time(started) {
+            worker = std::thread([this] { loop(); });
+        }
+
+        /**
+         * Writes the last published progress, if not yet written, and stops the logging thread
+         */
+        ~TrainingLogger() { stop(); }
+
+        TrainingLogger(const TrainingLogger&) = delete;
+        TrainingLogger& operator=(const TrainingLogger&) = delete;
+
+        void stop() {
+            if (!worker.joinable()) return;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            worker.join();
+        }
+
+        /**
+         * Makes progress visible to the logging thread. Lock- and allocation-free; call it every epoch.
+         */
+        void publish(const Progress& progress) {
+            const std::uint64_t s = sequence.load(std::memory_order_relaxed);
+            sequence.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            epoch.store(progress.epoch, std::memory_order_relaxed);
+            loss.store(progress.loss, std::memory_order_relaxed);
+            best_loss.store(progress.best_loss, std::memory_order_relaxed);
+            best_epoch.store(progress.best_epoch, std::memory_order_relaxed);
+            sequence.store(s + 2, std::memory_order_release);
+        }
+    };
+
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Math.hpp"
+
+/**
+ * Workspace.hpp
+ * Shape of the network, and preallocated buffers for one training step of it.
+ * Everything is sized once from the topology, so a steady-state step never touches the heap.
+ */
+namespace nn {
+
+    /**
+     * Element-wise function applied after a dense layer. Identity is used by the output layer,
+     * whose logits go straight into the loss.
+     */
+    enum class Activation { Identity, Relu, Tanh, Sigmoid };
+
+    inline const char* activation_name(Activation activation) {
+        switch (activation) {
+        case Activation::Relu: return "relu";
+        case Activation::Tanh: return "tanh";
+        case Activation::Sigmoid: return "sigmoid";
+        default: return "identity";
+        }
+    }
+
+    inline Activation parse_activation(const std::string& name) {
+        if (name == "relu") return Activation::Relu;
+        if (name == "tanh") return Activation::Tanh;
+        if (name == "sigmoid") return Activation::Sigmoid;
+        if (name == "identity") return Activation::Identity;
+        throw std::invalid_argument("Expected relu, tanh, sigmoid or identity activation. Received: " + name);
+    }
+
+    struct LayerSpec {
+        std::size_t units = 0;
+        Activation activation = Activation::Identity;
+    };
+
+    /**
+     * Width of the input plus every dense layer after it, in order.
+     * The last layer produces the logits, so it must be linear; the sigmoid is part of the loss.
+     */
+    struct Topology {
+        std::size_t input = 0;
+        std::vector<LayerSpec> layers;
+
+        std::size_t depth() const { return layers.size(); }
+        std::size_t output() const { return layers.empty() ? input : layers.back().units; }
+
+        /**
+         * @return width of the input to layer l
+         */
+        std::size_t fan_in(std::size_t l) const { return l == 0 ? input : layers[l - 1].units; }
+
+        /**
+         * @return number of weights and biases
+         */
+        std::size_t parameter_count() const {
+            std::size_t count = 0;
+            for (std::size_t l = 0; l < layers.size(); ++l) count += (fan_in(l) + 1) * layers[l].units;
+            return count;
+        }
+
+        /**
+         * Throws unless every width is positive and the output layer is linear
+         */
+        void validate() const {
+            if (input == 0 || layers.empty()) throw std::invalid_argument("A network needs inputs and at least one layer");
+            for (const LayerSpec& layer : layers) {
+                if (layer.units == 0) throw std::invalid_argument("Every layer needs at least one unit");
+            }
+            if (layers.back().activation != Activation::Identity) throw std::invalid_argument("The output layer must be linear; its sigmoid is part of the loss");
+        }
+
+        bool operator==(const Topology& other) const {
+            if (input != other.input || layers.size() != other.layers.size()) return false;
+            for (std::size_t l = 0; l < layers.size(); ++l) {
+                if (layers[l].units != other.layers[l].units || layers[l].activation != other.layers[l].activation) return false;
+            }
+            return true;
+        }
+
+        bool operator!=(const Topology& other) const { return !(*this == other); }
+    };
+
+    /**
+     * @return fully connected topology: input, then one layer per entry of hidden, then a linear output layer
+     */
+    inline Topology dense_topology(std::size_t input, const std::vector<std::size_t>& hidden, std::size_t output, Activation activation = Activation::Tanh) {
+        Topology topo;
+        topo.input = input;
+        for (std::size_t units : hidden) topo.layers.push_back(LayerSpec{ units, activation });
+        topo.layers.push_back(LayerSpec{ output, Activation::Identity });
+        topo.validate();
+        return topo;
+    }
+
+    /**
+     * @return layer widths joined by dashes, e.g. "2-4-1"
+     */
+    inline std::string to_string(const Topology& topo) {
+        std::string result = std::to_string(topo.input);
+        for (const LayerSpec& layer : topo.layers) result += "-" + std::to_string(layer.units);
+        return result;
+    }
+
+    /**
+     * Buffers for a minibatch of batch_size samples, one row per sample, stored as T.
+     */
+    template <typename T>
+    class BasicWorkspace {
+    public:
+        Topology topology;
+        std::size_t batch_size = 0;
+
+        // activations and deltas, batch_size x layer width; the last output holds the logits
+        math::BasicMatrix<T> input;
+        std::vector<math::BasicMatrix<T>> outputs;
+        std::vector<math::BasicMatrix<T>> deltas;
+
+        // gradients accumulated over the batch, one per layer
+        std::vector<math::BasicMatrix<T>> weight_gradients;
+        std::vector<math::aligned_vector<T>> bias_gradients;
+
+        BasicWorkspace(const Topology& topo, std::size_t batch)
+            : topology(topo), batch_size(batch), input(batch, topo.input) {
+            topo.validate();
+            for (std::size_t l = 0; l < topo.depth(); ++l) {
+                const std::size_t units = topo.layers[l].units;
+                outputs.emplace_back(batch, units);
+                deltas.emplace_back(batch, units);
+                weight_gradients.emplace_back(units, topo.fan_in(l));
+                bias_gradients.emplace_back(units);
+            }
+        }
+
+        math::BasicMatrix<T>& logits() { return outputs.back(); }
+        const math::BasicMatrix<T>& logits() const { return outputs.back(); }
+    };
+
+    using Workspace = BasicWorkspace<double>;
+
+}
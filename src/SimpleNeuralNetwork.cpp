@@ -1,10 +1,34 @@
 ﻿#include <iostream>
 
+#include "../include/AllocationCounter.hpp"
+#include "../include/Autotune.hpp"
+#include "../include/Checkpoint.hpp"
+#include "../include/Convergence.hpp"
+#include "../include/Dataset.hpp"
+#include "../include/Distributed.hpp"
+#include "../include/FixedNetwork.hpp"
+#include "../include/Inference.hpp"
 #include "../include/Math.hpp"
+#include "../include/Optimizer.hpp"
+#include "../include/Options.hpp"
+#include "../include/Profiler.hpp"
+#include "../include/Quantize.hpp"
 #include "../include/Random.hpp"
+#include "../include/Sweep.hpp"
+#include "../include/Trainer.hpp"
+#include "../include/TrainingLogger.hpp"
+#include "../include/Workspace.hpp"
 #include <string_view>
 #include <string>
+#include <sstream>
 #include <iomanip>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <memory>
+#include <optional>
+#include <vector>
 
 #pragma region ansi_colors
 
@@ -61,220 +85,1162 @@ static inline double string_to_double(const std::string& str) {
 	}
 }
 
-int main() {
-	try {
+/**
+ * @return layer widths from a comma-separated list, e.g. "16,8"
+ */
+static std::vector<size_t> string_to_layers(const std::string& str) {
+	std::vector<size_t> layers;
+	size_t start = 0;
+	while (true) {
+		const size_t comma = str.find(',', start);
+		const int units = string_to_number(str.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+		if (units <= 0) throw std::invalid_argument("Every hidden layer needs at least one neuron. Received: " + str);
+		layers.push_back(static_cast<size_t>(units));
+		if (comma == std::string::npos) return layers;
+		start = comma + 1;
+	}
+}
 
-#pragma region initialisation
+/**
+ * @return seeds from a comma-separated list of numbers and inclusive ranges, e.g. "1-100,200"
+ */
+static std::vector<uint64_t> string_to_seeds(const std::string& str) {
+	std::vector<uint64_t> seeds;
+	size_t start = 0;
+	while (true) {
+		const size_t comma = str.find(',', start);
+		const std::string item = str.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+		const size_t dash = item.find('-');
+		const int first = string_to_number(item.substr(0, dash));
+		const int last = dash == std::string::npos ? first : string_to_number(item.substr(dash + 1));
+		if (last < first) throw std::invalid_argument("Expected a seed range from low to high. Received: " + item);
+		for (int seed = first; seed <= last; ++seed) seeds.push_back(static_cast<uint64_t>(seed));
+		if (comma == std::string::npos) return seeds;
+		start = comma + 1;
+	}
+}
 
-		std::cout << std::fixed << std::setprecision(8);
+/**
+ * @return numbers from a comma-separated list, e.g. "0.1,0.5"
+ */
+static std::vector<double> string_to_doubles(const std::string& str) {
+	std::vector<double> values;
+	size_t start = 0;
+	while (true) {
+		const size_t comma = str.find(',', start);
+		values.push_back(string_to_double(str.substr(start, comma == std::string::npos ? std::string::npos : comma - start)));
+		if (comma == std::string::npos) return values;
+		start = comma + 1;
+	}
+}
+
+/**
+ * Everything the configuration prompts ask for
+ */
+struct Config {
+	int seed = 0;
+	size_t epochs = 0;
+	size_t print_frequency = 0;
+	double learning_rate = 0.0;
+	std::vector<size_t> hidden_layers;
+	std::string activation = "tanh";
+	std::string dataset_path;
+	size_t batch_size = 0;
+	std::string checkpoint_path;
+	std::string precision = "double";
+	bool asynchronous = false;
+	nn::OptimizerSettings optimizer;
+	nn::LearningRateSchedule schedule;
+	nn::StopCriteria stopping;
+	bool restore_best = false;
+	std::string tuning_cache = nn::default_tuning_cache();
+	bool autotune = false;
+	bool generic = false;
+	double log_interval = 0.0;
+	bool profile = false;
+	bool interactive = true;
+	bool show_weights = false;
+};
+
+/**
+ * @return the four XOR samples
+ */
+template <typename T>
+static nn::Dataset<T> xor_dataset() {
+	math::BasicMatrix<T> inputs(4, 2);
+	math::BasicMatrix<T> targets(4, 1);
+	constexpr double samples[4][3] = { {0.0, 0.0, 0.0}, {1.0, 0.0, 1.0}, {0.0, 1.0, 1.0}, {1.0, 1.0, 0.0} };
+
+	for (size_t n = 0; n < 4; ++n) {
+		inputs(n, 0) = static_cast<T>(samples[n][0]);
+		inputs(n, 1) = static_cast<T>(samples[n][1]);
+		targets(n, 0) = static_cast<T>(samples[n][2]);
+	}
+	return nn::Dataset<T>(std::move(inputs), std::move(targets));
+}
+
+/**
+ * Applies the kernel settings tuned for this CPU and shape, if the tuning cache has them.
+ * On a miss with --autotune, tunes them first and adds them to the cache.
+ */
+template <typename T, typename Acc>
+static void apply_tuning(const Config& config, const nn::Topology& topology, size_t batch_size) {
+	if (config.tuning_cache.empty()) return;
+
+	nn::TuningCache cache(config.tuning_cache);
+	const std::string cpu = nn::cpu_model();
+	const std::string shape = nn::tuning_shape(config.precision, topology, batch_size);
+
+	const nn::TuningCache::Entry* entry = cache.find(cpu, shape);
+	if (!entry && !config.autotune) return;
+
+	nn::TuningCache::Entry tuned;
+	if (!entry) {
+		std::cout << GRAY << "Autotuning " << shape << " on " << cpu << "..." << ENDL;
+		tuned = nn::autotune<T, Acc>(topology, batch_size);
+		cache.store(tuned);
+		cache.save();
+		entry = &tuned;
+	}
+
+	nn::apply_kernel_settings(entry->settings, true);
+	std::cout << GRAY << "Tuning: " << nn::describe(nn::current_kernel_settings()) << " (" << config.tuning_cache << ")" << ENDL;
+}
+
+/**
+ * Trains the network on the configured dataset (XOR by default) with weights and activations stored as T.
+ * Bias gradients and the loss are accumulated in Acc, so float storage can keep double sums.
+ * Asynchronous training is followed by a synchronous run from the same initial weights to compare against.
+ */
+template <typename T, typename Acc>
+static void train(const Config& config) {
+	const bool builtin = config.dataset_path.empty();
+	const nn::Dataset<T> dataset = builtin ? xor_dataset<T>() : nn::Dataset<T>::Open(config.dataset_path);
+	const size_t input_neuron_count = dataset.input_count();
+
+	nn::MinibatchStream<T> stream(dataset, config.batch_size == 0 ? dataset.size() : config.batch_size, static_cast<uint64_t>(config.seed));
+
+	if (!builtin) {
+		std::cout << GRAY << "Dataset: " << config.dataset_path << " (" << dataset.size() << " samples, "
+			<< input_neuron_count << " inputs)" << ENDL;
+	}
+	std::cout << GRAY << "Minibatch: " << stream.batch_size() << " samples, " << stream.batches_per_epoch() << " per epoch" << ENDL;
+
+#pragma region parameters
+
+	const nn::Topology topology = nn::dense_topology(input_neuron_count, config.hidden_layers, dataset.output_count(), nn::parse_activation(config.activation));
+	nn::Network<T> params(topology);
+	// one counter-based stream per layer, so the weights only depend on the seed
+	params.initialize([](size_t layer, T* weights, size_t count, double min, double max) { Random::Uniform(weights, count, min, max, layer); });
+
+	std::cout << GRAY << "Network: " << nn::to_string(topology) << " (" << config.activation << ", "
+		<< topology.parameter_count() << " parameters)" << ENDL;
+
+#pragma endregion 
 
-		int seed;
-		size_t epochs;
-		double learning_rate;
-		size_t hidd_neuron_count;
-		size_t print_frequency;
-		std::string input_buffer;
-
-		std::cout << GRAY << std::string(61, '-') << CURSE << ORANGE 
-			<< "\nSimpleNeuralNetwork v1.0" << NCURSE << GRAY << " | " << BLUE << "By " << YELLOW << "Vladysla\n" 
-			<< GRAY << "A neural network learning " << GREEN << "XOR" << GRAY << " in " << PURPLE << CURSE << "real time" << ENDL
-			<< RED << "\033[2m" << "Note: Colors require a console with ANSI escape code support." << ENDL
-			<< GRAY << std::string(61, '-') << ENDL << ENDL;
-
-		std::cout << GREEN << "=== Neural Network Configuration ===" << ENDL;
-		std::cout << GRAY << "Please enter the following parameters:" << ENDL << ENDL;
-
-		std::cout << CYAN << "Enter a integer seed " << CURSE << GRAY << "(press \"Enter\" to generate a random one): " << NCURSE << YELLOW;
-		if (!std::getline(std::cin, input_buffer)) return 1;
-		try {
-			seed = string_to_number(input_buffer);
-		} catch (const std::exception&) {
-			seed = std::random_device{}();
+	// the synchronous reference after asynchronous training starts from the same weights
+	std::optional<nn::Network<T>> initial_params;
+	if (config.asynchronous) initial_params.emplace(params);
+
+	// the schedule's base rate and length come from the run itself
+	nn::LearningRateSchedule schedule = config.schedule;
+	schedule.base = config.learning_rate;
+	schedule.epochs = config.epochs;
+	nn::ConvergenceController<T, Acc> controller(topology, config.stopping, schedule, config.restore_best);
+
+	// snapshots go to disk from a background thread at every progress print
+	std::unique_ptr<nn::CheckpointWriter<T>> checkpoints;
+	if (!config.checkpoint_path.empty()) checkpoints = std::make_unique<nn::CheckpointWriter<T>>(config.checkpoint_path, topology, static_cast<uint64_t>(config.seed));
+
+	// tiny synchronous networks train on compile-time sized kernels, on this thread alone
+	std::unique_ptr<nn::FixedTrainer<T, Acc>> fixed;
+	if (!config.asynchronous && !config.generic) fixed = nn::make_fixed_trainer<T, Acc>(topology, stream.batch_size(), config.optimizer);
+	if (fixed) fixed->load(params);
+
+	// the others run on the math kernels, whose thread count the tuning may change, so it comes before the shards
+	if (!fixed) apply_tuning<T, Acc>(config, topology, stream.batch_size());
+
+	// one shard (or worker) per pool thread; the synchronous result only depends on the shard count.
+	// only the trainer the mode uses gets its workspaces
+	std::optional<nn::DataParallelTrainer<T, Acc>> trainer;
+	std::optional<nn::HogwildTrainer<T, Acc>> hogwild;
+	if (config.asynchronous) hogwild.emplace(topology, stream.batch_size(), ThreadPool::Global().Size() + 1);
+	else if (!fixed) trainer.emplace(topology, stream.batch_size(), ThreadPool::Global().Size() + 1, config.optimizer);
+
+	if (config.asynchronous) std::cout << GRAY << "Hogwild workers: " << hogwild->worker_count() << ENDL << ENDL;
+	else if (fixed) std::cout << GRAY << "Fixed-size kernels: " << nn::to_string(topology) << ENDL << ENDL;
+	else std::cout << GRAY << "Data-parallel shards: " << trainer->shard_count() << ENDL << ENDL;
+
+	// per-sample lines only make sense while one batch covers the whole (small) dataset
+	const bool print_samples = builtin && stream.batches_per_epoch() == 1;
+
+	// with a log interval, progress is written by a background thread on a timer instead of every print_frequency epochs
+	Profiler::Enable(config.profile);
+	Profiler::Reset();
+	std::unique_ptr<nn::TrainingLogger> logger;
+	if (config.log_interval > 0) logger = std::make_unique<nn::TrainingLogger>(stdout, config.log_interval, config.epochs);
+
+	size_t steady_state_allocations = 0;
+	size_t epochs_trained = 0;
+	std::chrono::steady_clock::duration training_time{};
+
+	for (size_t epoch = 1; epoch <= config.epochs; ++epoch) {
+		const size_t allocations_before = AllocationCounter::Count();
+		const auto step_start = std::chrono::steady_clock::now();
+
+		// the loss is only measured on epochs that print it or check a stop criterion
+		const bool reported = !logger && (epoch % config.print_frequency == 0 || epoch == 1);
+		const bool measured = controller.needs_loss(epoch, reported);
+		const double learning_rate = controller.learning_rate(epoch);
+
+		// a measured loss belongs to the weights the epoch starts from, so those are the ones kept if it's the best
+		if (measured && config.restore_best) {
+			if (fixed) fixed->store(params);
+			controller.stage(params, epoch);
 		}
 
-		std::cout << CYAN << "Enter number of epochs: " << YELLOW;
-		if (!std::getline(std::cin, input_buffer)) return 1; 
-		epochs = string_to_number(input_buffer);
-
-		std::cout << CYAN << "Enter display interval in epochs: " << YELLOW;
-		if (!std::getline(std::cin, input_buffer)) return 1;
-		print_frequency = string_to_number(input_buffer);
-
-		std::cout << CYAN << "Enter learning rate: " << YELLOW;
-		if (!std::getline(std::cin, input_buffer)) return 1;
-		learning_rate = string_to_double(input_buffer);
-
-		std::cout << CYAN << "Enter number of hidden neurons: " << YELLOW;
-		if (!std::getline(std::cin, input_buffer)) return 1;
-		hidd_neuron_count = string_to_number(input_buffer);
-
-		std::cout << GREEN << "Configuration completed successfully!" << ENDL << ENDL;
-
-		Random::Init(seed);
-
-		double best_loss = 1.0e300;
-		size_t best_loss_epoch = 0;
-
-		constexpr size_t input_neuron_count = 2;
-		constexpr size_t output_neuron_count = 1;
-
-		constexpr std::array<std::pair<double, double>, 4> batch = { {
-			{0.0, 0.0},
-			{1.0, 0.0},
-			{0.0, 1.0},
-			{1.0, 1.0}
-		} };
-		constexpr std::array<double, 4> batch_answ = { 0.0, 1.0, 1.0, 0.0 };
-		
-		const double xavier_hidden = math::xavier_limit((double)input_neuron_count, (double)hidd_neuron_count);
-		std::vector<std::vector<double>> weight_hidd(hidd_neuron_count, std::vector<double>(input_neuron_count));
-		for (size_t i = 0; i < hidd_neuron_count; ++i) {
-			for (size_t j = 0; j < input_neuron_count; ++j) {
-				weight_hidd[i][j] = Random::Double(-xavier_hidden, xavier_hidden);
+		Acc total_loss = Acc(0);
+		nn::Minibatch<T> batch;
+		for (size_t b = 0; b < stream.batches_per_epoch(); ++b) {
+			{
+				const Profiler::Timer timer(Profiler::Phase::Data);
+				batch = stream.next();
+				if (config.asynchronous) hogwild->load_batch(batch.inputs, batch.targets);
+				else if (fixed) fixed->load_batch(batch.inputs, batch.targets);
+				else trainer->load_batch(batch.inputs, batch.targets);
 			}
+			if (config.asynchronous) total_loss += hogwild->step(params, learning_rate, measured);
+			else if (fixed) total_loss += fixed->step(learning_rate, measured);
+			else total_loss += trainer->step(params, learning_rate, measured);
+			Profiler::CountSamples(batch.size);
 		}
-		std::vector<double> bias_hidd(hidd_neuron_count, 0.0);
+		total_loss /= static_cast<Acc>(stream.samples_per_epoch());
+
+		if (measured && controller.record(epoch, total_loss)) controller.snapshot();
+		epochs_trained = epoch;
+		const bool stopping = controller.should_stop();
+
+		training_time += std::chrono::steady_clock::now() - step_start;
+		if (epoch > 1) steady_state_allocations += AllocationCounter::Count() - allocations_before;
+
+		if (print_samples && reported) {
+			for (size_t n = 0; n < batch.size; ++n) {
+				T logit_outp = config.asynchronous ? hogwild->logit(n) : fixed ? fixed->logit(n) : trainer->logit(n);
+				T target = batch.targets[n];
+				T probability = math::sigmoid(logit_outp);
 
-		const double xavier_output = math::xavier_limit((double)hidd_neuron_count, (double)output_neuron_count);
-		std::vector<std::vector<double>> weight_outp(output_neuron_count, std::vector<double>(hidd_neuron_count));
-		for (size_t i = 0; i < output_neuron_count; ++i) {
-			for (size_t j = 0; j < hidd_neuron_count; ++j) {
-				weight_outp[i][j] = Random::Double(-xavier_hidden, xavier_hidden);
+				std::cout << GRAY << "Epoch " << ORANGE << epoch << GRAY << " | " << CYAN
+					<< (int)batch.inputs[n * 2] << GRAY << " XOR " << CYAN << (int)batch.inputs[n * 2 + 1] << GRAY << " = "
+					<< GREEN << probability << GRAY << " (logit: " << YELLOW << logit_outp
+					<< GRAY << ", target: " << PURPLE << (int)target << GRAY << ")" << ENDL;
 			}
 		}
-		std::vector<double> bias_outp(output_neuron_count, 0.0);
 
-#pragma endregion 
+		if (checkpoints && (epoch % config.print_frequency == 0 || epoch == config.epochs || stopping)) {
+			if (fixed) fixed->store(params);
+			checkpoints->submit(params, epoch);
+		}
 
-		for (size_t epoch = 1; epoch <= epochs; ++epoch) {
-			double total_loss = 0.0;
+		if (logger) {
+			logger->publish({ epoch, static_cast<double>(controller.last_loss()), static_cast<double>(controller.best_loss()), controller.best_epoch() });
+		} else if (reported) {
+			if (!print_samples) std::cout << GRAY << "Epoch " << ORANGE << epoch << ENDL;
+			std::cout << "  Loss: " << RED << total_loss << ENDL << ENDL;
+		}
 
-			std::vector<std::vector<double>> acc_gradient_hidd(hidd_neuron_count, std::vector<double>(input_neuron_count, 0.0));
-			std::vector<double> acc_gradient_bias_hidd(hidd_neuron_count, 0.0);
-			std::vector<double> acc_gradient_outp(hidd_neuron_count, 0.0);
-			double acc_gradient_bias_outp = 0.0;
+		if (stopping) break;
+	}
 
-			for (size_t n = 0; n < batch.size(); ++n) {
-				const std::vector<double>& input = { batch[n].first, batch[n].second };
-				double target = batch_answ[n];
+	if (logger) logger->stop();
+	if (fixed) fixed->store(params);
 
-#pragma region forward_pass
+	std::cout << BOLD << CYAN << std::string(40, '-') << WHITE 
+		<< "\nNeural Network Training Complete!\n" << CYAN << std::string(40, '-') << ENDL;
 
-				std::vector<double> logit_hidd(hidd_neuron_count);
-				std::vector<double> output_hidd(hidd_neuron_count);
-				for (size_t i = 0; i < hidd_neuron_count; ++i) {
-					logit_hidd[i] = weight_hidd[i] * input + bias_hidd[i];
-					output_hidd[i] = math::tanh(logit_hidd[i]);
-				}
+	if (controller.should_stop()) {
+		std::cout << YELLOW << "Stopped after epoch " << epochs_trained << " of " << config.epochs << ": " << nn::stop_reason_name(controller.reason()) << ENDL;
+	}
+	std::cout << GREEN << CURSE << "Best Loss: " << controller.best_loss() << " at Epoch " << controller.best_epoch() << ENDL;
 
-				double logit_outp = weight_outp[0] * output_hidd + bias_outp[0];
-				double loss = math::bce_with_logits_loss(logit_outp, target);
+	// everything below (checkpoint, evaluation, weights) uses the best weights; a final checkpoint then holds them too
+	size_t final_epoch = epochs_trained;
+	if (controller.restore(params)) {
+		final_epoch = controller.snapshot_epoch() - 1;
+		std::cout << GRAY << "Restored the weights the best loss was measured on (after epoch " << final_epoch << ")" << ENDL;
+		if (checkpoints) checkpoints->submit(params, final_epoch);
+	}
+	if (AllocationCounter::Enabled()) {
+		std::cout << (steady_state_allocations == 0 ? GRAY : RED)
+			<< "Heap allocations in steady-state training steps: " << steady_state_allocations << ENDL;
+	}
+	std::cout << ENDL;
 
-#pragma endregion 
-#pragma region Backpropagation
-
-				total_loss += loss;
-				
-				double delta_outp = math::bce_with_logits_loss_delta(logit_outp, target);
-
-				std::vector<double> gradient_outp = output_hidd * delta_outp;
-				double gradient_bias_outp = delta_outp;
-
-				std::vector<double> delta_hidd(hidd_neuron_count);
-				for (size_t i = 0; i < hidd_neuron_count; ++i) {
-					delta_hidd[i] = (weight_outp[0][i] * delta_outp) * math::tanh_derivative(logit_hidd[i]);
-				}
-
-				std::vector<std::vector<double>> gradient_hidd = math::weights_gradient(delta_hidd, input);
-				std::vector<double> gradient_bias_hidd = delta_hidd;
-
-				for (size_t i = 0; i < hidd_neuron_count; ++i) {
-					for (size_t j = 0; j < input_neuron_count; ++j) acc_gradient_hidd[i][j] += gradient_hidd[i][j];
-					acc_gradient_bias_hidd[i] += gradient_bias_hidd[i];
-
-					acc_gradient_outp[i] += gradient_outp[i];
-				}
-				acc_gradient_bias_outp += gradient_bias_outp;
-
-				if (epoch % print_frequency == 0 || epoch == 1) {
-					double probability = math::sigmoid(logit_outp);
-					std::cout << GRAY << "Epoch " << ORANGE << epoch << GRAY << " | " << CYAN
-						<< (int)input[0] << GRAY << " XOR " << CYAN << (int)input[1] << GRAY << " = "
-						<< GREEN << probability << GRAY << " (logit: " << YELLOW << logit_outp
-						<< GRAY << ", target: " << PURPLE << (int)target << GRAY << ")" << ENDL;
-				}
-			}
+	if (config.profile) {
+		const Profiler::Snapshot profile = Profiler::Read();
+		uint64_t total = 0;
+		for (uint64_t ns : profile.nanoseconds) total += ns;
 
-			for (size_t i = 0; i < hidd_neuron_count; ++i) {
-				for (size_t j = 0; j < input_neuron_count; ++j) weight_hidd[i][j] -= learning_rate * (acc_gradient_hidd[i][j] / batch.size());
-				bias_hidd[i] -= learning_rate * (acc_gradient_bias_hidd[i] / batch.size());
-				weight_outp[0][i] -= learning_rate * (acc_gradient_outp[i] / batch.size());
-			}
-			bias_outp[0] -= learning_rate * (acc_gradient_bias_outp / batch.size());
+		std::cout << YELLOW << BOLD << "Profile " << NONE << GRAY << "(time summed over threads):" << ENDL << std::setprecision(2);
+		for (size_t p = 0; p < Profiler::PHASES; ++p) {
+			std::cout << "   " << GRAY << std::left << std::setw(10) << Profiler::Name(static_cast<Profiler::Phase>(p)) << std::right
+				<< WHITE << std::setw(10) << profile.nanoseconds[p] / 1e6 << GRAY << " ms " << WHITE << std::setw(6)
+				<< (total ? 100.0 * profile.nanoseconds[p] / total : 0.0) << GRAY << " %  " << profile.calls[p] << " calls" << ENDL;
+		}
+		std::cout << "   " << GRAY << "Throughput: " << WHITE << (size_t)(profile.samples / std::chrono::duration<double>(training_time).count())
+			<< GRAY << " samples/s" << ENDL << ENDL << std::setprecision(8);
+	}
 
-#pragma endregion
-			if (best_loss > (total_loss / batch.size())) {
-				best_loss = total_loss / batch.size();
-				best_loss_epoch = epoch;
-			}
-			
-			if (epoch % print_frequency == 0 || epoch == 1) {
-				std::cout << "  Loss: " << RED << total_loss / batch.size() << ENDL << ENDL;
+	if (checkpoints) {
+		const uint64_t saved_epoch = checkpoints->flush();
+		const auto load_start = std::chrono::steady_clock::now();
+		const nn::MappedCheckpoint<T> saved = nn::MappedCheckpoint<T>::Open(config.checkpoint_path);
+		const std::chrono::duration<double, std::milli> load_time = std::chrono::steady_clock::now() - load_start;
+
+		std::cout << GRAY << "Checkpoint: " << config.checkpoint_path << " (epoch " << saved_epoch << ", "
+			<< checkpoints->written() << " written, mapped back in " << load_time.count() << " ms)" << ENDL << ENDL;
+		if (saved.epoch() != final_epoch) throw std::runtime_error("Checkpoint does not hold the final epoch");
+	}
+
+	if (config.asynchronous) {
+		// the reference stops where params did: at the restored epoch if the best weights were put back
+		nn::Network<T> reference = *initial_params;
+		nn::DataParallelTrainer<T, Acc> reference_trainer(topology, stream.batch_size(), ThreadPool::Global().Size() + 1, config.optimizer);
+		stream.reset();
+		const auto reference_start = std::chrono::steady_clock::now();
+		for (size_t epoch = 1; epoch <= final_epoch; ++epoch) {
+			for (size_t b = 0; b < stream.batches_per_epoch(); ++b) {
+				const nn::Minibatch<T> batch = stream.next();
+				reference_trainer.load_batch(batch.inputs, batch.targets);
+				reference_trainer.step(reference, controller.learning_rate(epoch), false);
 			}
 		}
+		const std::chrono::duration<double> reference_time = std::chrono::steady_clock::now() - reference_start;
 
-		std::cout << BOLD << CYAN << std::string(40, '-') << WHITE 
-			<< "\nNeural Network Training Complete!\n" << CYAN << std::string(40, '-') << ENDL;
+		const Acc reference_loss = nn::evaluate<Acc>(reference, dataset).loss;
+		const Acc async_loss = nn::evaluate<Acc>(params, dataset).loss;
 
-		std::cout << GREEN << CURSE << "Best Loss: " << best_loss << " at Epoch " << best_loss_epoch << ENDL << ENDL;
+		const nn::AsyncStats stats = hogwild->stats();
+		const double samples = static_cast<double>(epochs_trained * stream.samples_per_epoch());
+		const double reference_samples = static_cast<double>(final_epoch * stream.samples_per_epoch());
 
-		std::cout << YELLOW << BOLD << "Final XOR Evaluation:" << ENDL;
-		for (auto& x : batch) {
-			const std::vector<double>& input = { x.first, x.second };
-			std::vector<double> logit_hidd(hidd_neuron_count);
-			std::vector<double> output_hidd(hidd_neuron_count);
-
-			for (size_t i = 0; i < hidd_neuron_count; ++i) {
-				logit_hidd[i] = weight_hidd[i] * input + bias_hidd[i];
-				output_hidd[i] = math::tanh(logit_hidd[i]);
-			}
+		std::cout << YELLOW << BOLD << "Asynchronous vs Synchronous:" << ENDL;
+		std::cout << "   " << GRAY << "Updates applied: " << WHITE << stats.updates << ENDL;
+		std::cout << "   " << GRAY << "Staleness: " << WHITE << stats.mean_staleness << GRAY << " updates on average, "
+			<< WHITE << stats.max_staleness << GRAY << " at most" << ENDL;
+		std::cout << "   " << GRAY << "Final loss: " << GREEN << async_loss << GRAY << " async, " << GREEN << reference_loss << GRAY << " sync" << ENDL;
+		std::cout << "   " << GRAY << "Largest weight difference: " << YELLOW << nn::max_abs_difference(params, reference) << ENDL;
+		std::cout << "   " << GRAY << "Throughput: " << WHITE << (size_t)(samples / std::chrono::duration<double>(training_time).count()) << GRAY << " samples/s async, "
+			<< WHITE << (size_t)(reference_time.count() > 0.0 ? reference_samples / reference_time.count() : 0.0) << GRAY << " samples/s sync" << ENDL << ENDL;
+	}
 
-			double logit_outp = weight_outp[0] * output_hidd + bias_outp[0];
-			double out = math::sigmoid(logit_outp);
+	const nn::QuantizedNetwork<T> quantized(params);
 
-			std::cout << "   " << GRAY << (int)x.first << " XOR " << (int)x.second << " = " << GREEN << out << ENDL;
+	if (builtin) {
+		std::cout << YELLOW << BOLD << "Final XOR Evaluation:" << ENDL;
+		nn::BasicWorkspace<T> eval(topology, dataset.size());
+		nn::QuantizedWorkspace quantized_eval(topology, dataset.size());
+		math::BasicMatrix<T> quantized_logits(dataset.size(), topology.output());
+		const math::BasicRowView<const T> inputs = dataset.inputs(0, dataset.size());
+		std::copy(inputs.begin(), inputs.end(), eval.input.data());
+		nn::forward(params, eval);
+		quantized.forward(inputs.data(), dataset.size(), quantized_logits.data(), quantized_eval);
+		for (size_t n = 0; n < dataset.size(); ++n) {
+			T out = math::sigmoid(eval.logits()(n, 0));
+
+			std::cout << "   " << GRAY << (int)eval.input(n, 0) << " XOR " << (int)eval.input(n, 1) << " = " << GREEN << out
+				<< GRAY << " (int8: " << math::sigmoid(quantized_logits(n, 0)) << ")" << ENDL;
 		}
+	} else {
+		const nn::Evaluation<Acc> result = nn::evaluate<Acc>(params, dataset);
+		std::cout << YELLOW << BOLD << "Final Evaluation:" << ENDL;
+		std::cout << "   " << GRAY << "Loss: " << GREEN << result.loss << ENDL;
+		std::cout << "   " << GRAY << "Accuracy: " << GREEN << result.accuracy * 100.0 << "%" << ENDL;
+	}
 
+	const nn::QuantizationReport report = nn::compare_quantized(params, quantized, dataset);
+	std::cout << std::endl << YELLOW << BOLD << "Int8 Quantized Model:" << ENDL;
+	std::cout << "   " << GRAY << "Size: " << WHITE << quantized.size_bytes() << GRAY << " bytes, "
+		<< WHITE << topology.parameter_count() * sizeof(T) << GRAY << " as " << config.precision << ENDL;
+	std::cout << "   " << GRAY << "Loss: " << GREEN << report.quantized_loss << GRAY << " int8, " << GREEN << report.loss << GRAY << " " << config.precision << ENDL;
+	std::cout << "   " << GRAY << "Probability difference: " << YELLOW << report.max_difference << GRAY << " at most, "
+		<< YELLOW << report.mean_difference << GRAY << " on average" << ENDL;
+	std::cout << "   " << GRAY << "Same class: " << GREEN << report.agreement * 100.0 << "%" << ENDL;
+
+	bool show_weights = config.show_weights;
+	if (config.interactive) {
 		std::cout << std::endl << CYAN << "Would you like to " << CURSE << "see final weights?" << NCURSE << " (y/n): " << ENDL;
-		char choice = std::cin.get();
+		show_weights = std::tolower(std::cin.get()) == 'y';
+	}
 
-		if (std::tolower(choice) == 'y') {
-			std::cout << std::endl << BOLD << BLUE << "Hidden Layer Weights:" << ENDL;
-			for (size_t i = 0; i < weight_hidd.size(); ++i) {
+	if (show_weights) {
+		for (size_t l = 0; l + 1 < params.depth(); ++l) {
+			std::cout << std::endl << BOLD << BLUE << "Hidden Layer " << (params.depth() > 2 ? std::to_string(l + 1) + " " : "") << "Weights:" << ENDL;
+			for (size_t i = 0; i < params.layers[l].weight.rows(); ++i) {
 				std::cout << "   ";
-				for (double w : weight_hidd[i])
+				for (T w : params.layers[l].weight[i])
 					std::cout << std::setw(10) << w << " ";
 				std::cout << std::endl;
 			}
+		}
 
-			std::cout << std::endl << BOLD << BLUE << "Output Layer Weights:" << ENDL;
-			for (double w : weight_outp[0])
+		std::cout << std::endl << BOLD << BLUE << "Output Layer Weights:" << ENDL;
+		const math::BasicMatrix<T>& output_weights = params.layers.back().weight;
+		for (size_t i = 0; i < output_weights.rows(); ++i) {
+			if (i != 0) std::cout << std::endl;
+			for (T w : output_weights[i])
 				std::cout << "   " << std::setw(10) << w << std::endl;
 		}
+	}
+}
+
+static void check_precision(const std::string& precision) {
+	if (precision != "double" && precision != "float" && precision != "mixed") {
+		throw std::invalid_argument("Expected double, float or mixed precision. Received: " + precision);
+	}
+}
+
+static bool check_mode(const std::string& mode) {
+	if (mode != "sync" && mode != "async") {
+		throw std::invalid_argument("Expected sync or async training mode. Received: " + mode);
+	}
+	return mode == "async";
+}
+
+/**
+ * Zero epochs would train nothing, and the training loop divides by print_frequency
+ */
+static void check_epochs(const Config& config) {
+	if (config.epochs == 0 || config.print_frequency == 0) throw std::invalid_argument("The epochs (--epochs) and the display interval (--print-every) must be positive");
+}
+
+/**
+ * Hogwild workers update the weights straight from each sample's gradient, with no optimizer state to share
+ */
+static void check_optimizer(const Config& config) {
+	config.optimizer.validate();
+	if (config.asynchronous && config.optimizer.kind != nn::OptimizerKind::Sgd) {
+		throw std::invalid_argument("Asynchronous training only supports the sgd optimizer. Received: " + std::string(nn::optimizer_name(config.optimizer.kind)));
+	}
+	// Hogwild workers apply plain gradient steps; momentum is only read by the optimizers rejected above
+	if (config.asynchronous && config.optimizer.weight_decay != 0.0) throw std::invalid_argument("Asynchronous training does not support weight decay");
+}
+
+/**
+ * @return optimizer name and the hyperparameters it uses, e.g. "adam (beta1 0.9, beta2 0.999)"
+ */
+static std::string optimizer_description(const nn::OptimizerSettings& optimizer) {
+	std::ostringstream details;
+	details << std::defaultfloat;
+	if (optimizer.state_count() == 1) details << "momentum " << optimizer.momentum;
+	else if (optimizer.state_count() == 2) details << "beta1 " << optimizer.beta1 << ", beta2 " << optimizer.beta2;
+	if (optimizer.weight_decay > 0) details << (details.tellp() > 0 ? ", " : "") << "weight decay " << optimizer.weight_decay;
+
+	const std::string text = details.str();
+	return std::string(nn::optimizer_name(optimizer.kind)) + (text.empty() ? "" : " (" + text + ")");
+}
+
+/**
+ * @return learning rate and its schedule, e.g. "0.5, cosine down to 0.01 after 10 warmup epochs"
+ */
+static std::string schedule_description(const Config& config) {
+	const nn::LearningRateSchedule& schedule = config.schedule;
+	std::ostringstream text;
+	text << std::defaultfloat << config.learning_rate;
+	if (schedule.kind == nn::ScheduleKind::Step) text << ", times " << schedule.step_factor << " every " << schedule.step_size << " epochs";
+	else if (schedule.kind == nn::ScheduleKind::Cosine) text << ", cosine down to " << schedule.minimum;
+	if (schedule.warmup > 0) text << (schedule.kind == nn::ScheduleKind::Constant ? ", " : " ") << "after " << schedule.warmup << " warmup epochs";
+	return text.str();
+}
+
+/**
+ * @return stop criteria in words, or an empty string if every epoch is trained
+ */
+static std::string stopping_description(const nn::StopCriteria& stopping) {
+	std::ostringstream text;
+	text << std::defaultfloat;
+	if (stopping.target_loss > 0) text << "at loss " << stopping.target_loss;
+	if (stopping.patience > 0) {
+		text << (text.tellp() > 0 ? ", or " : "") << "after " << stopping.patience << " epochs without improvement";
+		if (stopping.min_delta > 0) text << " over " << stopping.min_delta;
+	}
+	return text.str();
+}
+
+/**
+ * Asks for every setting on the console
+ * @return false if the input ended early
+ */
+static bool prompt_config(Config& config) {
+	std::string input_buffer;
+
+	std::cout << GRAY << std::string(61, '-') << CURSE << ORANGE 
+		<< "\nSimpleNeuralNetwork v1.0" << NCURSE << GRAY << " | " << BLUE << "By " << YELLOW << "Vladysla\n" 
+		<< GRAY << "A neural network learning " << GREEN << "XOR" << GRAY << " in " << PURPLE << CURSE << "real time" << ENDL
+		<< RED << "\033[2m" << "Note: Colors require a console with ANSI escape code support." << ENDL
+		<< GRAY << std::string(61, '-') << ENDL << ENDL;
+
+	std::cout << GREEN << "=== Neural Network Configuration ===" << ENDL;
+	std::cout << GRAY << "Please enter the following parameters:" << ENDL << ENDL;
+
+	std::cout << CYAN << "Enter a integer seed " << CURSE << GRAY << "(press \"Enter\" to generate a random one): " << NCURSE << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false;
+	try {
+		config.seed = string_to_number(input_buffer);
+	} catch (const std::exception&) {
+		config.seed = std::random_device{}();
+	}
+
+	std::cout << CYAN << "Enter number of epochs: " << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false; 
+	config.epochs = string_to_number(input_buffer);
+
+	std::cout << CYAN << "Enter display interval in epochs: " << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false;
+	config.print_frequency = string_to_number(input_buffer);
+	check_epochs(config);
+
+	std::cout << CYAN << "Enter learning rate: " << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false;
+	config.learning_rate = string_to_double(input_buffer);
+
+	std::cout << CYAN << "Enter number of hidden neurons " << CURSE << GRAY << "(comma-separated for several layers, e.g. 16,8): " << NCURSE << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false;
+	config.hidden_layers = string_to_layers(input_buffer);
+
+	std::cout << CYAN << "Enter dataset file " << CURSE << GRAY << "(press \"Enter\" to learn XOR): " << NCURSE << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false;
+	config.dataset_path = input_buffer;
+
+	std::cout << CYAN << "Enter minibatch size " << CURSE << GRAY << "(press \"Enter\" for the whole dataset): " << NCURSE << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false;
+	config.batch_size = input_buffer.empty() ? 0 : string_to_number(input_buffer);
+
+	std::cout << CYAN << "Enter checkpoint file " << CURSE << GRAY << "(press \"Enter\" to skip saving): " << NCURSE << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false;
+	config.checkpoint_path = input_buffer;
+
+	std::cout << CYAN << "Enter precision: double, float or mixed " << CURSE << GRAY << "(press \"Enter\" for double): " << NCURSE << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false;
+	if (input_buffer.empty()) input_buffer = "double";
+	check_precision(input_buffer);
+	config.precision = input_buffer;
+
+	std::cout << CYAN << "Enter training mode: sync or async " << CURSE << GRAY << "(press \"Enter\" for sync): " << NCURSE << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false;
+	config.asynchronous = check_mode(input_buffer.empty() ? "sync" : input_buffer);
+
+	std::cout << CYAN << "Enter optimizer: sgd, momentum, nesterov, adam or adamw " << CURSE << GRAY << "(press \"Enter\" for sgd): " << NCURSE << YELLOW;
+	if (!std::getline(std::cin, input_buffer)) return false;
+	config.optimizer.kind = nn::parse_optimizer(input_buffer.empty() ? "sgd" : input_buffer);
+	check_optimizer(config);
+
+	std::cout << GREEN << "Configuration completed successfully!" << ENDL;
+	return true;
+}
+
+/**
+ * Parses the flags of a command, on top of its --config file if one is given
+ */
+static Options command_options(int argc, char** argv) {
+	Options options;
+	options.Parse(argc, argv, 2);
+	if (options.Has("config")) {
+		options.Load(options.String("config"));
+		options.Parse(argc, argv, 2);
+	}
+	return options;
+}
+
+/**
+ * Reads the training settings from parsed flags; the ones a command doesn't take keep their defaults
+ */
+static Config options_config(const Options& options) {
+	Config config;
+	config.interactive = false;
+	config.seed = options.Has("seed") ? static_cast<int>(options.Number("seed", 0)) : static_cast<int>(std::random_device{}());
+	config.epochs = options.Number("epochs", 2000);
+	config.print_frequency = options.Number("print-every", std::max<size_t>(config.epochs / 10, 1));
+	config.learning_rate = options.Double("learning-rate", 0.5);
+	config.hidden_layers = string_to_layers(options.String("hidden", "4"));
+	config.activation = options.String("activation", "tanh");
+	config.dataset_path = options.String("dataset");
+	config.batch_size = options.Number("batch", 0);
+	config.checkpoint_path = options.String("checkpoint");
+	config.precision = options.String("precision", "double");
+	config.asynchronous = check_mode(options.String("mode", "sync"));
+	config.optimizer.kind = nn::parse_optimizer(options.String("optimizer", "sgd"));
+	config.optimizer.momentum = options.Double("momentum", config.optimizer.momentum);
+	config.optimizer.beta1 = options.Double("beta1", config.optimizer.beta1);
+	config.optimizer.beta2 = options.Double("beta2", config.optimizer.beta2);
+	config.optimizer.weight_decay = options.Double("weight-decay", config.optimizer.weight_decay);
+	config.schedule.kind = nn::parse_schedule(options.String("schedule", "constant"));
+	config.schedule.warmup = options.Number("warmup", config.schedule.warmup);
+	config.schedule.step_size = options.Number("step-size", config.schedule.step_size);
+	config.schedule.step_factor = options.Double("step-factor", config.schedule.step_factor);
+	config.schedule.minimum = options.Double("min-learning-rate", config.schedule.minimum);
+	config.stopping.target_loss = options.Double("target-loss", config.stopping.target_loss);
+	config.stopping.patience = options.Number("patience", config.stopping.patience);
+	config.stopping.min_delta = options.Double("min-delta", config.stopping.min_delta);
+	config.stopping.check_every = options.Number("check-every", config.stopping.check_every);
+	config.restore_best = options.Flag("restore-best");
+	config.tuning_cache = options.String("tuning-cache", config.tuning_cache);
+	config.autotune = options.Flag("autotune");
+	config.generic = options.Flag("generic");
+	config.show_weights = options.Flag("show-weights");
+	config.log_interval = options.Double("log-interval", 0.0);
+	config.profile = options.Flag("profile");
+	check_precision(config.precision);
+	check_optimizer(config);
+	nn::parse_activation(config.activation);
+	check_epochs(config);
+	return config;
+}
+
+/**
+ * Reads the settings of `train` from flags, and from the --config file if one is given
+ */
+static Config options_config(int argc, char** argv) {
+	const Options options = command_options(argc, argv);
+	options.Expect({ "config", "seed", "epochs", "print-every", "learning-rate", "hidden", "activation", "dataset", "batch",
+		"checkpoint", "precision", "mode", "optimizer", "momentum", "beta1", "beta2", "weight-decay", "schedule", "warmup", "step-size", "step-factor",
+		"min-learning-rate", "target-loss", "patience", "min-delta", "check-every", "restore-best", "tuning-cache", "autotune", "generic", "show-weights",
+		"log-interval", "profile" });
+	return options_config(options);
+}
+
+template <typename T>
+static void infer(const Options& options) {
+	const nn::MappedCheckpoint<T> model = nn::MappedCheckpoint<T>::Open(options.String("model"));
+
+	const std::string kind = options.String("emit", "probability");
+	nn::Prediction prediction;
+	if (kind == "probability") prediction = nn::Prediction::Probability;
+	else if (kind == "logit") prediction = nn::Prediction::Logit;
+	else if (kind == "class") prediction = nn::Prediction::Class;
+	else throw std::invalid_argument("Expected probability, logit or class for --emit. Received: " + kind);
+
+	const std::string input_path = options.String("input", "-");
+	const std::string output_path = options.String("output", "-");
+
+	std::FILE* output = output_path == "-" ? stdout : std::fopen(output_path.c_str(), "wb");
+	if (!output) throw std::invalid_argument("Cannot create file: " + output_path);
+
+	std::optional<nn::QuantizedNetwork<T>> quantized;
+	if (options.Flag("quantize")) quantized.emplace(model.parameters());
+
+	nn::Predictor<T> predictor(model.parameters(), options.Number("batch", 4096), prediction, quantized ? &*quantized : nullptr);
+	const auto start = std::chrono::steady_clock::now();
+
+	if (input_path != "-" && nn::is_dataset_file(input_path)) {
+		predictor.run(nn::Dataset<T>::Open(input_path), output);
+	} else {
+		std::FILE* input = input_path == "-" ? stdin : std::fopen(input_path.c_str(), "rb");
+		if (!input) throw std::invalid_argument("Cannot open file: " + input_path);
+		predictor.run(input, output);
+		if (input != stdin) std::fclose(input);
+	}
+
+	if (output != stdout) std::fclose(output);
+	else std::fflush(stdout);
+
+	if (options.Flag("stats")) {
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::fprintf(stderr, "%llu predictions in %.3f s (%.0f per second)\n",
+			static_cast<unsigned long long>(predictor.count()), elapsed.count(), predictor.count() / elapsed.count());
+		if (quantized) {
+			std::fprintf(stderr, "int8 weights: %zu bytes instead of %zu\n", quantized->size_bytes(), model.parameters().topology.parameter_count() * sizeof(T));
+		}
+	}
+}
+
+/**
+ * infer --model <checkpoint> [--input <file|->] [--output <file|->] [--batch N] [--emit probability|logit|class] [--quantize] [--stats]
+ * Input is text rows, or a dataset file; predictions go out as plain text, one row per line.
+ */
+static void run_inference(int argc, char** argv) {
+	Options options;
+	options.Parse(argc, argv, 2);
+	options.Expect({ "model", "input", "output", "batch", "emit", "quantize", "stats" });
+	if (!options.Has("model")) throw std::invalid_argument("infer needs --model <checkpoint>");
+
+	// stdio is all we use for the pipeline, so let it buffer without syncing to iostreams
+	std::ios::sync_with_stdio(false);
+
+	if (nn::checkpoint_scalar_bytes(options.String("model")) == sizeof(float)) infer<float>(options);
+	else infer<double>(options);
+}
+
+/**
+ * Trains every combination of seed, learning rate and hidden width at once and prints one row per model, best first
+ */
+template <typename T>
+static void sweep(const Options& options) {
+	const std::string dataset_path = options.String("dataset");
+	const nn::Dataset<T> dataset = dataset_path.empty() ? xor_dataset<T>() : nn::Dataset<T>::Open(dataset_path);
+
+	const std::vector<uint64_t> seeds = string_to_seeds(options.String("seeds", "1-16"));
+	const std::vector<double> learning_rates = string_to_doubles(options.String("learning-rates", "0.5"));
+	const std::vector<size_t> widths = string_to_layers(options.String("widths", "4"));
+	const nn::Activation activation = nn::parse_activation(options.String("activation", "tanh"));
+	const size_t epochs = options.Number("epochs", 2000);
+	const size_t lanes = options.Number("lanes", 64);
+	if (epochs == 0 || lanes == 0) throw std::invalid_argument("--epochs and --lanes must be positive");
+
+	std::vector<nn::SweepConfig> configs;
+	for (size_t width : widths) {
+		for (double learning_rate : learning_rates) {
+			for (uint64_t seed : seeds) configs.push_back(nn::SweepConfig{ { width }, seed, learning_rate });
+		}
+	}
+
+	std::cout << GRAY << "Sweep: " << configs.size() << " models (" << seeds.size() << " seeds x " << learning_rates.size() << " learning rates x "
+		<< widths.size() << " widths), " << epochs << " epochs, up to " << lanes << " models per block, "
+		<< ThreadPool::Global().Size() + 1 << " threads" << ENDL;
+
+	const auto start = std::chrono::steady_clock::now();
+	const std::vector<nn::SweepResult<T>> results = nn::sweep<T>(dataset, configs, activation, epochs, options.Number("batch", 0), options.Number("data-seed", 0), lanes);
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	std::cout << GRAY << "Trained in " << WHITE << elapsed.count() << GRAY << " s (" << WHITE
+		<< (size_t)(static_cast<double>(configs.size() * epochs) / elapsed.count()) << GRAY << " model-epochs/s)" << ENDL << ENDL;
+
+	std::vector<size_t> order(results.size());
+	std::iota(order.begin(), order.end(), size_t(0));
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return results[a].best_loss < results[b].best_loss; });
+	const size_t shown = std::min(results.size(), options.Number("top", results.size()));
+
+	std::cout << YELLOW << BOLD << std::setw(6) << "model" << std::setw(8) << "seed" << std::setw(16) << "learning rate" << std::setw(10) << "hidden"
+		<< std::setw(14) << "best loss" << std::setw(12) << "best epoch" << std::setw(14) << "final loss" << ENDL;
+	for (size_t r = 0; r < shown; ++r) {
+		const nn::SweepResult<T>& result = results[order[r]];
+		std::cout << GRAY << std::setw(6) << order[r] << std::setw(8) << result.config.seed << std::setw(16) << result.config.learning_rate
+			<< std::setw(10) << result.config.hidden[0] << GREEN << std::setw(14) << result.best_loss << WHITE << std::setw(12) << result.best_epoch
+			<< std::setw(14) << result.final_loss << ENDL;
+	}
+	if (shown < results.size()) std::cout << GRAY << "(" << results.size() - shown << " more)" << ENDL;
+
+	// every model, in sweep order, with its final weights and biases layer by layer
+	const std::string output_path = options.String("output");
+	if (!output_path.empty()) {
+		std::ofstream out(output_path);
+		if (!out) throw std::invalid_argument("Cannot create file: " + output_path);
+		out << std::setprecision(17) << "model,seed,learning_rate,hidden,best_loss,best_epoch,final_loss,weights\n";
+		for (size_t m = 0; m < results.size(); ++m) {
+			const nn::SweepResult<T>& result = results[m];
+			out << m << "," << result.config.seed << "," << result.config.learning_rate << "," << result.config.hidden[0] << ","
+				<< result.best_loss << "," << result.best_epoch << "," << result.final_loss << ",";
+			const char* separator = "";
+			for (const nn::Layer<T>& layer : result.weights.layers) {
+				for (T w : layer.weight.flat()) { out << separator << w; separator = " "; }
+				for (T b : layer.bias) out << " " << b;
+			}
+			out << "\n";
+		}
+		if (!out.flush()) throw std::runtime_error("Cannot write " + output_path);
+		std::cout << std::endl << GRAY << "Results: " << output_path << ENDL;
+	}
+
+	const std::string checkpoint_dir = options.String("checkpoint-dir");
+	if (!checkpoint_dir.empty()) {
+		for (size_t m = 0; m < results.size(); ++m) {
+			const std::string path = checkpoint_dir + "/sweep-" + std::to_string(m) + ".ckpt";
+			nn::write_checkpoint(path.c_str(), (path + ".tmp").c_str(), results[m].weights, results[m].config.seed, epochs);
+		}
+		std::cout << GRAY << "Checkpoints: " << checkpoint_dir << "/sweep-<model>.ckpt" << ENDL;
+	}
+}
+
+/**
+ * sweep [--seeds 1-16] [--learning-rates X[,X...]] [--widths N[,N...]] [--epochs N] [--dataset <file>] [--batch N]
+ *       [--activation A] [--precision double|float] [--lanes N] [--data-seed N] [--top N] [--output <csv>] [--checkpoint-dir <dir>]
+ */
+static void run_sweep(int argc, char** argv) {
+	Options options;
+	options.Parse(argc, argv, 2);
+	options.Expect({ "seeds", "learning-rates", "widths", "epochs", "dataset", "batch", "activation", "precision", "lanes", "data-seed", "top", "output", "checkpoint-dir" });
+
+	const std::string precision = options.String("precision", "double");
+	if (precision == "float") sweep<float>(options);
+	else if (precision == "double") sweep<double>(options);
+	else throw std::invalid_argument("Expected double or float precision for a sweep. Received: " + precision);
+}
+
+/**
+ * Process layout of `distributed`, on top of the training Config
+ */
+struct DistributedConfig {
+	size_t processes = 2;
+	nn::TransportKind transport = nn::TransportKind::SharedMemory;
+	size_t threads = 0;
+	bool overlap = true;
+	bool scaling = false;
+};
+
+/**
+ * What one rank hands back to the launcher
+ */
+struct RankReport {
+	double seconds = 0.0;
+	double best_loss = 0.0;
+	size_t best_loss_epoch = 0;
+	double final_loss = 0.0;
+	size_t epochs_trained = 0;
+	// epoch the final weights are at, earlier than epochs_trained if the best ones were restored
+	size_t final_epoch = 0;
+	nn::StopReason stop = nn::StopReason::None;
+	size_t samples = 0;
+	uint64_t fingerprint = 0;
+	nn::CommunicationStats communication;
+};
+
+/**
+ * Body of one rank: the same initial weights and minibatch order as every other rank, trained on its slice of each batch.
+ * The loss is all-reduced, so every rank sees the same one and its controller takes the same decisions
+ * (learning rate, which epochs to measure, when to stop, which weights to keep) without extra messages.
+ * Rank 0 prints progress (if verbose) and writes the checkpoint.
+ */
+template <typename T, typename Acc>
+static RankReport train_rank(const Config& config, const DistributedConfig& run, const nn::Dataset<T>& dataset, const nn::Topology& topology,
+	size_t rank, size_t ranks, nn::Transport& transport, bool verbose) {
+	// the cores are split between the ranks
+	ThreadPool::Configure(run.threads != 0 ? run.threads : std::max<size_t>(1, std::thread::hardware_concurrency() / ranks));
+
+	nn::MinibatchStream<T> stream(dataset, config.batch_size == 0 ? dataset.size() : config.batch_size, static_cast<uint64_t>(config.seed));
+	nn::Network<T> params(topology);
+	params.initialize([](size_t layer, T* weights, size_t count, double min, double max) { Random::Uniform(weights, count, min, max, layer); });
+	nn::DistributedTrainer<T, Acc> trainer(transport, rank, ranks, topology, stream.batch_size(), config.optimizer, run.overlap);
+
+	nn::LearningRateSchedule schedule = config.schedule;
+	schedule.base = config.learning_rate;
+	schedule.epochs = config.epochs;
+	nn::ConvergenceController<T, Acc> controller(topology, config.stopping, schedule, config.restore_best);
+
+	RankReport report;
+	const auto start = std::chrono::steady_clock::now();
+
+	for (size_t epoch = 1; epoch <= config.epochs; ++epoch) {
+		// the same on every rank: whether the loss is measured decides whether it is all-reduced
+		const bool reported = epoch % config.print_frequency == 0 || epoch == 1;
+		const bool measured = controller.needs_loss(epoch, reported);
+		const double learning_rate = controller.learning_rate(epoch);
+		if (measured) controller.stage(params, epoch);
+
+		Acc total_loss = Acc(0);
+		for (size_t b = 0; b < stream.batches_per_epoch(); ++b) {
+			const nn::Minibatch<T> batch = stream.next();
+			trainer.load_batch(batch.inputs, batch.targets);
+			total_loss += trainer.step(params, learning_rate, measured);
+		}
+		total_loss /= static_cast<Acc>(stream.samples_per_epoch());
+
+		if (measured && controller.record(epoch, total_loss)) controller.snapshot();
+		report.epochs_trained = epoch;
+
+		if (verbose && rank == 0 && reported) {
+			std::cout << GRAY << "Epoch " << ORANGE << epoch << ENDL;
+			std::cout << "  Loss: " << RED << total_loss << ENDL << ENDL;
+		}
+		if (controller.should_stop()) break;
+	}
+
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	report.samples = report.epochs_trained * stream.samples_per_epoch();
+	report.best_loss = static_cast<double>(controller.best_loss());
+	report.best_loss_epoch = controller.best_epoch();
+	report.final_loss = static_cast<double>(controller.last_loss());
+	report.stop = controller.reason();
+	report.final_epoch = controller.restore(params) ? controller.snapshot_epoch() - 1 : report.epochs_trained;
+	report.fingerprint = nn::weights_fingerprint(params);
+	report.communication = trainer.stats();
+
+	if (rank == 0 && !config.checkpoint_path.empty()) {
+		nn::write_checkpoint(config.checkpoint_path.c_str(), (config.checkpoint_path + ".tmp").c_str(), params, static_cast<uint64_t>(config.seed), report.final_epoch);
+	}
+	return report;
+}
+
+/**
+ * Trains with run.processes ranks, or with 1, 2, 4, ... up to run.processes of them in turn for a scaling report.
+ * The global minibatch stays the same however many ranks share it (strong scaling).
+ */
+template <typename T, typename Acc>
+static void distributed(const Config& config, const DistributedConfig& run) {
+	const bool builtin = config.dataset_path.empty();
+	const nn::Dataset<T> dataset = builtin ? xor_dataset<T>() : nn::Dataset<T>::Open(config.dataset_path);
+	const nn::Topology topology = nn::dense_topology(dataset.input_count(), config.hidden_layers, dataset.output_count(), nn::parse_activation(config.activation));
+	const size_t batch = config.batch_size == 0 ? dataset.size() : std::min(config.batch_size, dataset.size());
+	// checked here rather than in the ranks, which would only report that one of them failed; the scaling counts never exceed run.processes
+	if (batch < run.processes) {
+		throw std::invalid_argument("A minibatch of " + std::to_string(batch) + " samples can't give each of " + std::to_string(run.processes)
+			+ " processes one; use --batch (default: the whole dataset) of at least --processes");
+	}
+
+	if (!builtin) {
+		std::cout << GRAY << "Dataset: " << config.dataset_path << " (" << dataset.size() << " samples, " << dataset.input_count() << " inputs)" << ENDL;
+	}
+	std::cout << GRAY << "Minibatch: " << batch << " samples, " << dataset.size() / batch << " per epoch" << ENDL;
+	std::cout << GRAY << "Network: " << nn::to_string(topology) << " (" << config.activation << ", " << topology.parameter_count() << " parameters)" << ENDL << ENDL;
+
+	std::vector<size_t> counts;
+	if (run.scaling) {
+		for (size_t count = 1; count < run.processes; count *= 2) counts.push_back(count);
+	}
+	counts.push_back(run.processes);
+
+	struct Row {
+		size_t processes;
+		double samples_per_second;
+		double reduce_ms;
+		double waiting_ms;
+		double bytes;
+		double best_loss;
+		bool identical;
+	};
+	std::vector<Row> rows;
+
+	for (size_t count : counts) {
+		const std::vector<RankReport> reports = nn::run_ring<RankReport>(count, run.transport, [&](size_t rank, nn::Transport& transport) {
+			return train_rank<T, Acc>(config, run, dataset, topology, rank, count, transport, !run.scaling);
+		});
+
+		Row row{ count, 0.0, 0.0, 0.0, 0.0, reports[0].best_loss, true };
+		double seconds = 0.0;
+		for (const RankReport& report : reports) {
+			const double steps = static_cast<double>(std::max<uint64_t>(report.communication.steps, 1));
+			seconds = std::max(seconds, report.seconds);
+			row.reduce_ms += report.communication.reduce_seconds * 1e3 / steps / count;
+			row.waiting_ms += report.communication.waiting_seconds * 1e3 / steps / count;
+			row.bytes += report.communication.bytes_sent / steps / count;
+			row.identical = row.identical && report.fingerprint == reports[0].fingerprint;
+		}
+		row.samples_per_second = reports[0].samples / seconds;
+		rows.push_back(row);
+
+		if (run.scaling) continue;
+
+		std::cout << BOLD << CYAN << std::string(40, '-') << WHITE
+			<< "\nNeural Network Training Complete!\n" << CYAN << std::string(40, '-') << ENDL;
+		if (reports[0].stop != nn::StopReason::None) {
+			std::cout << YELLOW << "Stopped after epoch " << reports[0].epochs_trained << " of " << config.epochs << ": " << nn::stop_reason_name(reports[0].stop) << ENDL;
+		}
+		std::cout << GREEN << CURSE << "Best Loss: " << reports[0].best_loss << " at Epoch " << reports[0].best_loss_epoch << ENDL;
+		if (reports[0].final_epoch != reports[0].epochs_trained) {
+			std::cout << GRAY << "Restored the weights the best loss was measured on (after epoch " << reports[0].final_epoch << ")" << ENDL;
+		}
+		std::cout << ENDL;
+
+		std::cout << YELLOW << BOLD << "Distributed Training:" << ENDL;
+		std::cout << "   " << GRAY << "Throughput: " << WHITE << (size_t)row.samples_per_second << GRAY << " samples/s" << ENDL;
+		std::cout << "   " << GRAY << "All-reduce: " << WHITE << row.reduce_ms << GRAY << " ms per step, " << WHITE << row.waiting_ms
+			<< GRAY << " ms of it waited for after the backward pass, " << WHITE << (size_t)row.bytes << GRAY << " bytes sent per rank" << ENDL;
+		std::cout << "   " << GRAY << "Replicas identical: " << (row.identical ? GREEN : RED) << (row.identical ? "yes" : "no") << ENDL;
+		if (!config.checkpoint_path.empty()) std::cout << "   " << GRAY << "Checkpoint: " << config.checkpoint_path << ENDL;
+	}
+
+	if (!run.scaling) return;
+
+	// efficiency: throughput per process, relative to a single process
+	std::cout << YELLOW << BOLD << "Scaling (" << nn::transport_name(run.transport) << ", " << (run.overlap ? "overlapped" : "after backward")
+		<< ", " << config.epochs << " epochs):" << ENDL << std::setprecision(3);
+	std::cout << YELLOW << std::setw(10) << "processes" << std::setw(14) << "samples/s" << std::setw(10) << "speedup" << std::setw(12) << "efficiency"
+		<< std::setw(16) << "all-reduce ms" << std::setw(12) << "waited ms" << std::setw(14) << "bytes/step" << std::setw(14) << "best loss" << ENDL;
+	for (const Row& row : rows) {
+		const double speedup = row.samples_per_second / rows[0].samples_per_second;
+		std::cout << GRAY << std::setw(10) << row.processes << WHITE << std::setw(14) << (size_t)row.samples_per_second << std::setw(10) << speedup
+			<< GREEN << std::setw(11) << std::setprecision(1) << 100.0 * speedup / row.processes << "%" << std::setprecision(3) << WHITE << std::setw(16) << row.reduce_ms << std::setw(12) << row.waiting_ms
+			<< std::setw(14) << (size_t)row.bytes << GREEN << std::setw(14) << std::setprecision(8) << row.best_loss << std::setprecision(3)
+			<< (row.identical ? "" : " (replicas differ)") << ENDL;
+	}
+	std::cout << std::setprecision(8);
+}
+
+/**
+ * distributed [--processes N] [--transport shm|unix|tcp] [--threads N] [--overlap true|false] [--scaling]
+ * plus the model, optimizer, schedule and stopping flags of train
+ */
+static void run_distributed(int argc, char** argv) {
+	const Options options = command_options(argc, argv);
+	options.Expect({ "config", "seed", "epochs", "print-every", "learning-rate", "hidden", "activation", "dataset", "batch", "checkpoint", "precision",
+		"optimizer", "momentum", "beta1", "beta2", "weight-decay", "schedule", "warmup", "step-size", "step-factor", "min-learning-rate",
+		"target-loss", "patience", "min-delta", "check-every", "restore-best", "processes", "transport", "threads", "overlap", "scaling" });
+
+	const Config config = options_config(options);
+	DistributedConfig run;
+	run.processes = options.Number("processes", 2);
+	run.transport = nn::parse_transport(options.String("transport", "shm"));
+	run.threads = options.Number("threads", 0);
+	run.overlap = !options.Has("overlap") || options.Flag("overlap");
+	run.scaling = options.Flag("scaling");
+	if (run.processes == 0) throw std::invalid_argument("--processes must be positive");
+
+	std::cout << GRAY << "SIMD kernels: " << math::simd::kernels().name << ENDL;
+	std::cout << GRAY << "Precision: " << config.precision << ENDL;
+	std::cout << GRAY << "Optimizer: " << optimizer_description(config.optimizer) << ENDL;
+	std::cout << GRAY << "Learning rate: " << schedule_description(config) << ENDL;
+	const std::string stopping = stopping_description(config.stopping);
+	if (!stopping.empty()) std::cout << GRAY << "Early stopping: " << stopping << ENDL;
+	if (config.stopping.check_every > 1) std::cout << GRAY << "Loss measured every " << config.stopping.check_every << " epochs" << ENDL;
+	std::cout << GRAY << "Processes: " << run.processes << " over " << nn::transport_name(run.transport) << ", gradients reduced "
+		<< (run.overlap ? "during" : "after") << " the backward pass" << ENDL;
+
+	// every rank draws the same initial weights from the seed
+	Random::Init(config.seed);
+
+	if (config.precision == "float") distributed<float, float>(config, run);
+	else if (config.precision == "mixed") distributed<float, double>(config, run);
+	else distributed<double, double>(config, run);
+}
+
+/**
+ * Autotunes the kernel settings for one network shape on this machine, prints every timed candidate and stores the winner in the tuning cache
+ */
+template <typename T, typename Acc>
+static void tune(const Config& config, double min_time, size_t repetitions) {
+	const nn::Dataset<T> dataset = config.dataset_path.empty() ? xor_dataset<T>() : nn::Dataset<T>::Open(config.dataset_path);
+	const nn::Topology topology = nn::dense_topology(dataset.input_count(), config.hidden_layers, dataset.output_count(), nn::parse_activation(config.activation));
+	// the same batch size a train run would use
+	const size_t batch_size = std::clamp<size_t>(config.batch_size == 0 ? dataset.size() : config.batch_size, 1, dataset.size());
+
+	std::cout << GRAY << "CPU: " << nn::cpu_model() << ENDL;
+	std::cout << GRAY << "Shape: " << nn::tuning_shape(config.precision, topology, batch_size) << ENDL;
+	std::cout << GRAY << "Tuning cache: " << config.tuning_cache << ENDL << ENDL;
+
+	std::vector<nn::TuningTrial> trials;
+	const nn::TuningCache::Entry best = nn::autotune<T, Acc>(topology, batch_size, min_time, repetitions, &trials);
+
+	std::cout << YELLOW << BOLD << std::left << std::setw(22) << "Knob" << std::setw(88) << "Settings" << std::right << std::setw(12) << "us/step" << std::setw(10) << "vs first" << ENDL
+		<< std::setprecision(2);
+	for (const nn::TuningTrial& trial : trials) {
+		const bool winner = trial.step_ns == best.step_ns;
+		std::cout << (winner ? GREEN : GRAY) << std::left << std::setw(22) << trial.knob << std::setw(88) << nn::describe(trial.settings) << std::right
+			<< WHITE << std::setw(12) << trial.step_ns / 1e3 << std::setw(9) << trials.front().step_ns / trial.step_ns << "x" << ENDL;
+	}
+	std::cout << std::setprecision(8) << ENDL;
+
+	nn::TuningCache cache(config.tuning_cache);
+	cache.store(best);
+	cache.save();
+	std::cout << GREEN << "Best: " << nn::describe(best.settings) << ENDL;
+	std::cout << GRAY << "Saved to " << config.tuning_cache << " (" << cache.size() << (cache.size() == 1 ? " entry)" : " entries)") << ENDL;
+}
+
+/**
+ * tune [--hidden N[,N...]] [--activation A] [--dataset <file>] [--batch N] [--precision double|float|mixed] [--tuning-cache <file>] [--min-time X] [--repetitions N]
+ */
+static void run_tune(int argc, char** argv) {
+	const Options options = command_options(argc, argv);
+	options.Expect({ "config", "hidden", "activation", "dataset", "batch", "precision", "tuning-cache", "min-time", "repetitions" });
+
+	const Config config = options_config(options);
+	const double min_time = options.Double("min-time", 0.05);
+	const size_t repetitions = options.Number("repetitions", 3);
+	if (config.tuning_cache.empty()) throw std::invalid_argument("tune needs a --tuning-cache file");
+
+	if (config.precision == "float") tune<float, float>(config, min_time, repetitions);
+	else if (config.precision == "mixed") tune<float, double>(config, min_time, repetitions);
+	else tune<double, double>(config, min_time, repetitions);
+}
+
+static void print_usage() {
+	std::cout
+		<< "Usage:\n"
+		<< "  SimpleNeuralNetwork                  interactive training\n"
+		<< "  SimpleNeuralNetwork train [options]  training without prompts\n"
+		<< "      --config <file>  --seed N  --epochs N  --print-every N  --learning-rate X\n"
+		<< "      --hidden N[,N...]  --activation relu|tanh|sigmoid  --dataset <file>  --batch N\n"
+		<< "      --checkpoint <file>  --precision double|float|mixed\n"
+		<< "      --mode sync|async  --optimizer sgd|momentum|nesterov|adam|adamw  --momentum X\n"
+		<< "      --beta1 X  --beta2 X  --weight-decay X\n"
+		<< "      --schedule constant|step|cosine  --warmup N  --step-size N  --step-factor X  --min-learning-rate X\n"
+		<< "      --target-loss X  --patience N  --min-delta X  --check-every N  --restore-best\n"
+		<< "      --tuning-cache <file>  --autotune  --generic  --show-weights  --log-interval <seconds>  --profile\n"
+		<< "  SimpleNeuralNetwork sweep [options]  many models at once, one row of results per model\n"
+		<< "      --seeds N[-N][,...]  --learning-rates X[,X...]  --widths N[,N...]  --epochs N\n"
+		<< "      --dataset <file>  --batch N  --activation relu|tanh|sigmoid  --precision double|float\n"
+		<< "      --lanes N  --data-seed N  --top N  --output <csv>  --checkpoint-dir <dir>\n"
+		<< "  SimpleNeuralNetwork distributed [options]  data-parallel training across processes\n"
+		<< "      the train options except --mode, --tuning-cache, --autotune, --generic, --show-weights, --log-interval and --profile\n"
+		<< "      --processes N  --transport shm|unix|tcp  --threads N  --overlap true|false  --scaling\n"
+		<< "  SimpleNeuralNetwork tune [options]  measures the fastest kernel settings for a network on this CPU\n"
+		<< "      --hidden N[,N...]  --activation relu|tanh|sigmoid  --dataset <file>  --batch N  --precision double|float|mixed\n"
+		<< "      --tuning-cache <file>  --min-time <seconds>  --repetitions N\n"
+		<< "  SimpleNeuralNetwork infer --model <checkpoint> [options]\n"
+		<< "      --input <file|->  --output <file|->  --batch N  --emit probability|logit|class  --quantize  --stats\n";
+}
+
+int main(int argc, char** argv) {
+	const bool interactive = argc == 1;
+
+	try {
+
+#pragma region initialisation
+
+		std::cout << std::fixed << std::setprecision(8);
+
+		Config config;
+
+		if (interactive) {
+			if (!prompt_config(config)) return 1;
+		} else {
+			const std::string command = argv[1];
+			if (command == "infer") {
+				run_inference(argc, argv);
+				return 0;
+			}
+			if (command == "distributed") {
+				std::cout << std::fixed << std::setprecision(8);
+				run_distributed(argc, argv);
+				return 0;
+			}
+			if (command == "tune") {
+				run_tune(argc, argv);
+				return 0;
+			}
+			if (command == "sweep") {
+				std::cout << std::fixed << std::setprecision(8);
+				run_sweep(argc, argv);
+				return 0;
+			}
+			if (command != "train") {
+				print_usage();
+				return command == "help" || command == "--help" ? 0 : 1;
+			}
+			config = options_config(argc, argv);
+		}
+
+		std::cout << GRAY << "SIMD kernels: " << math::simd::kernels().name << ENDL;
+		std::cout << GRAY << "Activations: " << (math::activation_approximation == math::Approximation::Fast ? "fast" : "exact") << ENDL;
+		std::cout << GRAY << "Precision: " << config.precision << ENDL;
+		std::cout << GRAY << "Training: " << (config.asynchronous ? "asynchronous (Hogwild)" : "synchronous") << ENDL;
+		std::cout << GRAY << "Optimizer: " << optimizer_description(config.optimizer) << ENDL;
+		std::cout << GRAY << "Learning rate: " << schedule_description(config) << ENDL;
+		const std::string stopping = stopping_description(config.stopping);
+		if (!stopping.empty()) std::cout << GRAY << "Early stopping: " << stopping << ENDL;
+		if (config.stopping.check_every > 1) std::cout << GRAY << "Loss measured every " << config.stopping.check_every << " epochs" << ENDL;
+		std::cout << ENDL;
+
+		Random::Init(config.seed);
+
+#pragma endregion
+
+		if (config.precision == "float") train<float, float>(config);
+		else if (config.precision == "mixed") train<float, double>(config);
+		else train<double, double>(config);
 
 		std::cout << std::endl << GRAY << "Training session finished successfully." << ENDL;
-		std::cin.get(); std::cin.get();
+		if (interactive) {
+			std::cin.get(); std::cin.get();
+		}
 
 		return 0;
 	} catch (const std::exception& e) {
 		std::cerr << RED << "Error: " << e.what() << ENDL;
-		std::cin.get();
+		if (interactive) std::cin.get();
 
 		return 1;
 	} catch (...) {
 		std::cerr << RED << "Unknown error occurred" << ENDL;
-		std::cin.get();
+		if (interactive) std::cin.get();
 
 		return 1;
 	}
-}
\ No newline at end of file
+}
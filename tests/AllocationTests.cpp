@@ -0,0 +1,94 @@
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "Test.hpp"
+#include "../include/AllocationCounter.hpp"
+#include "../include/Dataset.hpp"
+#include "../include/FixedNetwork.hpp"
+#include "../include/ThreadPool.hpp"
+#include "../include/Trainer.hpp"
+
+/**
+ * AllocationTests
+ * Built into allocation_tests with COUNT_ALLOCATIONS, so the global operator new counts every call.
+ * Once a trainer is warm, its steps, with and without the loss, and the minibatch stream feeding them
+ * must not touch the heap; one allocation per step would be millions per run.
+ */
+
+/**
+ * @return in-memory dataset of seeded random inputs and 0 / 1 targets
+ */
+template <typename T>
+static nn::Dataset<T> random_dataset(const nn::Topology& topo, std::size_t samples) {
+	Xoshiro256 engine(21);
+	math::BasicMatrix<T> inputs(samples, topo.input), targets(samples, topo.output());
+	for (std::size_t n = 0; n < samples; ++n) {
+		for (std::size_t i = 0; i < topo.input; ++i) inputs(n, i) = static_cast<T>(2.0 * engine.Unit() - 1.0);
+		for (std::size_t o = 0; o < topo.output(); ++o) targets(n, o) = engine.Unit() < 0.5 ? T(0) : T(1);
+	}
+	return nn::Dataset<T>(std::move(inputs), std::move(targets));
+}
+
+/**
+ * Runs warm-up steps, then counts the allocations of the steps after them
+ * @param step draws a minibatch, loads it and takes one step with or without the loss
+ */
+template <typename Step>
+static void expect_allocation_free(const std::string& what, Step&& step) {
+	for (int i = 0; i < 3; ++i) step(i % 2 == 0);
+	const std::size_t before = AllocationCounter::Count();
+	for (int i = 0; i < 50; ++i) step(i % 2 == 0);
+	const std::size_t allocations = AllocationCounter::Count() - before;
+	test::expect(allocations == 0, what + ": " + std::to_string(allocations) + " heap allocations in 50 warm steps");
+}
+
+template <typename T, typename Acc>
+static void check_trainers(const std::string& precision) {
+	const nn::Topology topo = nn::dense_topology(4, { 16, 8 }, 1);
+	const nn::Dataset<T> dataset = random_dataset<T>(topo, 96);
+	nn::MinibatchStream<T> stream(dataset, 32, 5);
+	nn::Network<T> net(topo);
+	test::fill_uniform(net, 1);
+
+	nn::OptimizerSettings adam;
+	adam.kind = nn::OptimizerKind::Adam;
+	nn::DataParallelTrainer<T, Acc> data_parallel(topo, stream.batch_size(), ThreadPool::Global().Size() + 1, adam);
+	expect_allocation_free(precision + " DataParallelTrainer", [&](bool with_loss) {
+		const nn::Minibatch<T> batch = stream.next();
+		data_parallel.load_batch(batch.inputs, batch.targets);
+		data_parallel.step(net, 0.01, with_loss);
+	});
+
+	nn::HogwildTrainer<T, Acc> hogwild(topo, stream.batch_size(), ThreadPool::Global().Size() + 1);
+	expect_allocation_free(precision + " HogwildTrainer", [&](bool with_loss) {
+		const nn::Minibatch<T> batch = stream.next();
+		hogwild.load_batch(batch.inputs, batch.targets);
+		hogwild.step(net, 0.01, with_loss);
+	});
+
+	const nn::Topology tiny = nn::dense_topology(2, { 8 }, 1);
+	const nn::Dataset<T> tiny_dataset = random_dataset<T>(tiny, 64);
+	nn::MinibatchStream<T> tiny_stream(tiny_dataset, 16, 5);
+	nn::Network<T> tiny_net(tiny);
+	test::fill_uniform(tiny_net, 2);
+	std::unique_ptr<nn::FixedTrainer<T, Acc>> fixed = nn::make_fixed_trainer<T, Acc>(tiny, tiny_stream.batch_size(), adam);
+	test::expect(fixed != nullptr, "no fixed trainer for 2-8-1");
+	fixed->load(nn::NetworkView<T>(tiny_net));
+	expect_allocation_free(precision + " FixedTrainer", [&](bool with_loss) {
+		const nn::Minibatch<T> batch = tiny_stream.next();
+		fixed->load_batch(batch.inputs, batch.targets);
+		fixed->step(0.01, with_loss);
+	});
+}
+
+SNN_CHECK(allocation_free_steps) {
+	test::expect(AllocationCounter::Enabled(), "allocation_tests must be built with COUNT_ALLOCATIONS");
+	for (std::size_t threads : { 1, 3 }) {
+		ThreadPool::Configure(threads);
+		check_trainers<double, double>("double");
+		check_trainers<float, float>("float");
+		check_trainers<float, double>("mixed");
+	}
+	ThreadPool::Configure(0);
+}
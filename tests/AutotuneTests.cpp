@@ -0,0 +1,87 @@
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "Test.hpp"
+#include "../include/Autotune.hpp"
+
+/**
+ * AutotuneTests
+ * The tuning cache file must read back exactly the entries saved, skip its comments and reject
+ * malformed lines with the line number, so a damaged cache is never applied half read.
+ */
+
+static nn::TuningCache::Entry tuning_entry(const std::string& cpu, const std::string& shape, math::simd::Isa isa, std::size_t seed) {
+	nn::TuningCache::Entry entry;
+	entry.cpu = cpu;
+	entry.shape = shape;
+	entry.settings.isa = isa;
+	entry.settings.threads = seed + 1;
+	entry.settings.blocking = math::GemmBlocking{ 8 * (seed + 1), 16 * (seed + 2), 32 * (seed + 3) };
+	entry.settings.thresholds = math::ExecutionThresholds{ seed + 4, 1000 * (seed + 5), 100 * (seed + 6), 10000 * (seed + 7) };
+	entry.step_ns = 12345.0 * static_cast<double>(seed + 1);
+	return entry;
+}
+
+static bool same_entry(const nn::TuningCache::Entry& a, const nn::TuningCache::Entry& b) {
+	const nn::KernelSettings& x = a.settings;
+	const nn::KernelSettings& y = b.settings;
+	return a.cpu == b.cpu && a.shape == b.shape && a.step_ns == b.step_ns && x.isa == y.isa && x.threads == y.threads
+		&& x.blocking.mc == y.blocking.mc && x.blocking.kc == y.blocking.kc && x.blocking.nc == y.blocking.nc
+		&& x.thresholds.simd == y.thresholds.simd && x.thresholds.parallel == y.thresholds.parallel
+		&& x.thresholds.grain == y.thresholds.grain && x.thresholds.gemm_parallel == y.thresholds.gemm_parallel;
+}
+
+SNN_CHECK(tuning_cache) {
+	const std::string path = test::temp_path("tuning.tsv");
+	std::filesystem::remove(path);
+
+	nn::TuningCache cache(path);
+	test::expect(cache.size() == 0, "a missing cache file has entries");
+
+	const nn::TuningCache::Entry first = tuning_entry("Some CPU @ 2.50GHz x 8", "double 2-512-512-1 tanh b128", math::simd::Isa::Scalar, 0);
+	const nn::TuningCache::Entry second = tuning_entry("Some CPU @ 2.50GHz x 8", "float 4-16-1 relu b32", math::simd::detect_isa(), 1);
+	const nn::TuningCache::Entry replaced = tuning_entry("Some CPU @ 2.50GHz x 8", "double 2-512-512-1 tanh b128", math::simd::detect_isa(), 2);
+	cache.store(first);
+	cache.store(second);
+	cache.store(replaced);
+	test::expect(cache.size() == 2, "storing the same cpu and shape twice adds an entry");
+	cache.save();
+	test::expect(!std::filesystem::exists(path + ".tmp"), "temporary file left behind");
+
+	const nn::TuningCache loaded(path);
+	test::expect(loaded.size() == 2, "the saved cache reads back " + std::to_string(loaded.size()) + " entries");
+	const nn::TuningCache::Entry* found = loaded.find(replaced.cpu, replaced.shape);
+	test::expect(found && same_entry(*found, replaced), "the replaced entry changed on the round trip");
+	found = loaded.find(second.cpu, second.shape);
+	test::expect(found && same_entry(*found, second), "an entry changed on the round trip");
+	test::expect(!loaded.find("Other CPU x 4", second.shape), "an entry found for another cpu");
+
+	// comments and blank lines are skipped; anything else must be a whole, valid entry
+	const auto write = [&](const std::string& contents) {
+		std::ofstream(path, std::ios::trunc) << contents;
+	};
+	write("# header\n\ncpu\tshape\tscalar\t2\t8\t16\t32\t4\t1000\t100\t10000\t500\n");
+	test::expect(nn::TuningCache(path).size() == 1, "comments or blank lines are not skipped");
+	const char* malformed[] = {
+		"cpu\tshape\tscalar\t2\t8\t16\t32\t4\t1000\t100\t10000\n",
+		"cpu\tshape\tscalar\t2\t8\t16\t32\t4\t1000\t100\t10000\t500\textra\n",
+		"cpu\tshape\tmmx\t2\t8\t16\t32\t4\t1000\t100\t10000\t500\n",
+		"cpu\tshape\tscalar\tmany\t8\t16\t32\t4\t1000\t100\t10000\t500\n",
+		"cpu\tshape\tscalar\t0\t8\t16\t32\t4\t1000\t100\t10000\t500\n",
+		"cpu\tshape\tscalar\t2\t8\t0\t32\t4\t1000\t100\t10000\t500\n",
+	};
+	for (const char* line : malformed) {
+		write(std::string("# header\n") + line);
+		try {
+			nn::TuningCache rejected(path);
+			throw std::runtime_error("malformed line accepted: " + std::string(line));
+		}
+		catch (const std::invalid_argument& e) {
+			test::expect(std::string(e.what()).find(path + ":2:") == 0, "the error does not name the line: " + std::string(e.what()));
+		}
+	}
+	std::filesystem::remove(path);
+}
@@ -0,0 +1,149 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "../include/Checkpoint.hpp"
+
+/**
+ * CheckpointTests
+ * A checkpoint must map back to exactly the weights written, in aligned blocks, and version 1
+ * files written before multi-layer support must still load.
+ */
+
+SNN_CHECK(checkpoint_round_trip) {
+	nn::Topology topo = nn::dense_topology(5, { 7, 3 }, 2, nn::Activation::Relu);
+	topo.layers[1].activation = nn::Activation::Sigmoid;
+	nn::Network<float> net(topo);
+	test::fill_uniform(net, 3);
+	for (nn::Layer<float>& layer : net.layers) {
+		for (std::size_t i = 0; i < layer.bias.size(); ++i) layer.bias[i] = 0.25f * static_cast<float>(i) - 0.5f;
+	}
+
+	const std::string path = test::temp_path("checkpoint.bin");
+	const std::string tmp = path + ".tmp";
+	nn::write_checkpoint(path.c_str(), tmp.c_str(), net, 1234, 567);
+	test::expect(!std::filesystem::exists(tmp), "temporary file left behind");
+	{
+		const nn::MappedCheckpoint<float> loaded = nn::MappedCheckpoint<float>::Open(path);
+		test::expect(loaded.topology() == topo, "topology changed");
+		test::expect(loaded.seed() == 1234 && loaded.epoch() == 567, "seed or epoch changed");
+		test::expect(test::same_bits(test::flatten(loaded.parameters()), test::flatten(nn::NetworkView<float>(net))), "weights changed");
+		for (const nn::LayerView<float>& layer : loaded.parameters().layers) {
+			test::expect(reinterpret_cast<std::uintptr_t>(layer.weight.data()) % nn::CHECKPOINT_ALIGNMENT == 0, "weight block not aligned");
+			test::expect(reinterpret_cast<std::uintptr_t>(layer.bias.data()) % nn::CHECKPOINT_ALIGNMENT == 0, "bias block not aligned");
+		}
+	}
+
+	test::expect_throws<std::invalid_argument>([&] { nn::MappedCheckpoint<double>::Open(path); }, "float checkpoint opened as double");
+	std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+	test::expect_throws<std::invalid_argument>([&] { nn::MappedCheckpoint<float>::Open(path); }, "truncated checkpoint opened");
+	std::filesystem::remove(path);
+
+	// the background writer must report why a write failed, not just that it did
+	const std::string unwritable = test::temp_path("missing_directory") + "/checkpoint.bin";
+	nn::CheckpointWriter<float> writer(unwritable, topo, 1);
+	writer.submit(net, 1);
+	try {
+		writer.flush();
+		throw std::logic_error("a checkpoint was written into a missing directory");
+	}
+	catch (const std::runtime_error& e) {
+		const std::string message = e.what();
+		test::expect(message.find("Cannot write checkpoint " + unwritable + ": Cannot create") == 0, "the writer's error lost its cause: " + message);
+	}
+}
+
+/**
+ * Writes a version 1 file (one tanh hidden layer) by hand and reads it back
+ */
+SNN_CHECK(checkpoint_v1) {
+	const std::uint64_t input = 3, hidden = 5, output = 2;
+	const std::uint64_t sizes[4] = { hidden * input, hidden, output * hidden, output };
+
+	nn::CheckpointHeaderV1 header{};
+	std::memcpy(header.magic, nn::CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.version = 1;
+	header.scalar_bytes = sizeof(double);
+	header.input = input;
+	header.hidden = hidden;
+	header.output = output;
+	header.seed = 42;
+	header.epoch = 2000;
+
+	std::vector<char> file(sizeof(header));
+	std::vector<double> blocks[4];
+	std::uint64_t offset = sizeof(header);
+	for (std::size_t b = 0; b < 4; ++b) {
+		for (std::uint64_t i = 0; i < sizes[b]; ++i) blocks[b].push_back(0.125 * static_cast<double>(b + 1) - 0.01 * static_cast<double>(i));
+		offset = nn::checkpoint_align(offset);
+		header.offsets[b] = offset;
+		file.resize(offset + sizes[b] * sizeof(double));
+		std::memcpy(file.data() + offset, blocks[b].data(), sizes[b] * sizeof(double));
+		offset += sizes[b] * sizeof(double);
+	}
+	header.file_size = offset;
+	std::memcpy(file.data(), &header, sizeof(header));
+
+	const std::string path = test::temp_path("checkpoint_v1.bin");
+	std::ofstream(path, std::ios::binary).write(file.data(), static_cast<std::streamsize>(file.size()));
+	{
+		const nn::MappedCheckpoint<double> loaded = nn::MappedCheckpoint<double>::Open(path);
+		test::expect(loaded.topology() == nn::dense_topology(3, { 5 }, 2), "topology of a version 1 file");
+		test::expect(loaded.seed() == 42 && loaded.epoch() == 2000, "seed or epoch of a version 1 file");
+
+		const nn::NetworkView<double>& view = loaded.parameters();
+		const double* read[4] = { view.layers[0].weight.data(), view.layers[0].bias.data(), view.layers[1].weight.data(), view.layers[1].bias.data() };
+		for (std::size_t b = 0; b < 4; ++b) {
+			test::expect(std::memcmp(read[b], blocks[b].data(), sizes[b] * sizeof(double)) == 0, "block " + std::to_string(b) + " of a version 1 file");
+		}
+	}
+	std::filesystem::remove(path);
+}
+
+/**
+ * Forges headers whose block sizes wrap around 64 bits to fit a small file, with offsets laid out by
+ * the same wrapped arithmetic; both versions must reject them rather than map blocks past the end
+ */
+SNN_CHECK(checkpoint_forged_sizes) {
+	const std::uint64_t huge = std::uint64_t(1) << 61;
+	const std::string path = test::temp_path("checkpoint_forged.bin");
+	const auto write = [&](const void* header, std::size_t header_bytes, const void* table, std::size_t table_bytes, std::uint64_t file_size) {
+		std::vector<char> file(static_cast<std::size_t>(file_size));
+		std::memcpy(file.data(), header, header_bytes);
+		if (table_bytes > 0) std::memcpy(file.data() + header_bytes, table, table_bytes);
+		std::ofstream(path, std::ios::binary | std::ios::trunc).write(file.data(), static_cast<std::streamsize>(file.size()));
+	};
+
+	nn::CheckpointHeaderV1 v1{};
+	std::memcpy(v1.magic, nn::CHECKPOINT_MAGIC, sizeof(v1.magic));
+	v1.version = 1;
+	v1.scalar_bytes = sizeof(double);
+	v1.input = 1;
+	v1.hidden = huge;
+	v1.output = 1;
+	const std::uint64_t sizes[4] = { v1.hidden * v1.input, v1.hidden, v1.output * v1.hidden, v1.output };
+	std::uint64_t offset = sizeof(v1);
+	for (std::size_t b = 0; b < 4; ++b) {
+		offset = nn::checkpoint_align(offset);
+		v1.offsets[b] = offset;
+		offset += sizes[b] * sizeof(double);
+	}
+	v1.file_size = offset;
+	write(&v1, sizeof(v1), nullptr, 0, v1.file_size);
+	test::expect_throws<std::invalid_argument>([&] { nn::MappedCheckpoint<double>::Open(path); }, "a version 1 file with a wrapped size opened");
+
+	nn::Topology topo;
+	topo.input = 1;
+	topo.layers = { nn::LayerSpec{ huge, nn::Activation::Tanh }, nn::LayerSpec{ 1, nn::Activation::Identity } };
+	const nn::CheckpointHeader v2 = nn::checkpoint_header<double>(topo, 0, 0);
+	const nn::CheckpointLayer table[2] = { nn::checkpoint_layer<double>(topo, 0), nn::checkpoint_layer<double>(topo, 1) };
+	write(&v2, sizeof(v2), table, sizeof(table), v2.file_size);
+	test::expect_throws<std::invalid_argument>([&] { nn::MappedCheckpoint<double>::Open(path); }, "a version 2 file with a wrapped size opened");
+	std::filesystem::remove(path);
+}
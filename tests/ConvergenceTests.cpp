@@ -0,0 +1,108 @@
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+#include "Test.hpp"
+#include "../include/Convergence.hpp"
+
+/**
+ * ConvergenceTests
+ * Learning rate schedules at their corners, when the controller asks for the loss, its stop
+ * criteria, and which weights it keeps.
+ */
+
+static bool close(double a, double b) { return std::abs(a - b) <= 1e-12 * std::max(1.0, std::abs(b)); }
+
+SNN_CHECK(learning_rate_schedules) {
+	nn::LearningRateSchedule schedule;
+	schedule.base = 0.4;
+	schedule.epochs = 101;
+	test::expect(close(schedule.rate(1), 0.4) && close(schedule.rate(101), 0.4), "constant schedule");
+
+	schedule.warmup = 4;
+	test::expect(close(schedule.rate(1), 0.1) && close(schedule.rate(4), 0.4) && close(schedule.rate(5), 0.4), "linear warmup");
+
+	schedule.kind = nn::ScheduleKind::Step;
+	schedule.step_size = 10;
+	schedule.step_factor = 0.5;
+	test::expect(close(schedule.rate(14), 0.4) && close(schedule.rate(15), 0.2) && close(schedule.rate(35), 0.05), "step schedule");
+
+	schedule.kind = nn::ScheduleKind::Cosine;
+	schedule.minimum = 0.1;
+	test::expect(close(schedule.rate(5), 0.4), "cosine schedule starts at the base rate");
+	test::expect(close(schedule.rate(101), 0.1), "cosine schedule ends at the minimum");
+	test::expect(close(schedule.rate(53), 0.25), "cosine schedule is halfway at the middle");
+
+	schedule.minimum = 0.5;
+	test::expect_throws<std::invalid_argument>([&] { schedule.validate(); }, "minimum above the base rate accepted");
+}
+
+SNN_CHECK(loss_measurement) {
+	const nn::Topology topo = nn::dense_topology(2, { 3 }, 1);
+	nn::StopCriteria lazy;
+	nn::LearningRateSchedule schedule;
+
+	// nothing reads the loss but the printout
+	const nn::ConvergenceController<double> plain(topo, lazy, schedule, false);
+	test::expect(!plain.needs_loss(7, false) && plain.needs_loss(7, true), "loss measured without a reader");
+
+	nn::StopCriteria patient;
+	patient.patience = 5;
+	const nn::ConvergenceController<double> stopping(topo, patient, schedule, false);
+	test::expect(stopping.needs_loss(7, false), "patience without a loss every epoch");
+	const nn::ConvergenceController<double> keeping(topo, lazy, schedule, true);
+	test::expect(keeping.needs_loss(7, false), "best weights without a loss every epoch");
+
+	patient.check_every = 3;
+	const nn::ConvergenceController<double> sparse(topo, patient, schedule, false);
+	test::expect(!sparse.needs_loss(7, false) && sparse.needs_loss(9, false), "check interval ignored");
+}
+
+SNN_CHECK(stop_criteria) {
+	const nn::Topology topo = nn::dense_topology(2, { 3 }, 1);
+	nn::LearningRateSchedule schedule;
+
+	nn::StopCriteria target;
+	target.target_loss = 0.1;
+	nn::ConvergenceController<double> reaching(topo, target, schedule, false);
+	test::expect(reaching.record(1, 0.5) && !reaching.should_stop(), "stopped above the target");
+	reaching.record(2, 0.1);
+	test::expect(reaching.reason() == nn::StopReason::TargetLoss, "target loss not reached");
+
+	nn::StopCriteria patient;
+	patient.patience = 3;
+	patient.min_delta = 0.01;
+	nn::ConvergenceController<double> waiting(topo, patient, schedule, false);
+	waiting.record(1, 1.0);
+	waiting.record(2, 0.995);
+	waiting.record(3, 0.98);
+	test::expect(waiting.best_epoch() == 3 && !waiting.should_stop(), "improvement beyond min_delta not counted");
+	waiting.record(4, 0.975);
+	waiting.record(5, 0.99);
+	test::expect(!waiting.should_stop(), "stopped before patience ran out");
+	waiting.record(6, 0.979);
+	test::expect(waiting.reason() == nn::StopReason::Patience && waiting.best_loss() == 0.98, "patience");
+}
+
+SNN_CHECK(best_weights) {
+	const nn::Topology topo = nn::dense_topology(2, { 3 }, 1);
+	nn::Network<double> net(topo);
+	nn::ConvergenceController<double> controller(topo, nn::StopCriteria{}, nn::LearningRateSchedule{}, true);
+
+	// the loss recorded for an epoch pairs with the weights staged before it
+	const double losses[] = { 0.5, 0.2, 0.3 };
+	for (std::size_t epoch = 1; epoch <= 3; ++epoch) {
+		net.layers[0].bias[0] = static_cast<double>(epoch);
+		controller.stage(net, epoch);
+		net.layers[0].bias[0] = 10.0 * static_cast<double>(epoch);
+		if (controller.record(epoch, losses[epoch - 1])) controller.snapshot();
+	}
+
+	test::expect(controller.snapshot_epoch() == 2, "kept the wrong epoch");
+	test::expect(controller.restore(net) && net.layers[0].bias[0] == 2.0, "restored weights other than the ones measured");
+
+	nn::ConvergenceController<double> discarding(topo, nn::StopCriteria{}, nn::LearningRateSchedule{}, false);
+	discarding.stage(net, 1);
+	if (discarding.record(1, 0.1)) discarding.snapshot();
+	test::expect(!discarding.restore(net), "restored without keeping best weights");
+}
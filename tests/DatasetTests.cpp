@@ -0,0 +1,108 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "../include/Dataset.hpp"
+
+/**
+ * DatasetTests
+ * A dataset file must read back exactly what DatasetWriter wrote, and MinibatchStream must visit
+ * every sample at most once per epoch with its own targets.
+ */
+
+SNN_CHECK(dataset_format) {
+	const std::size_t samples = 37, inputs = 3, outputs = 2;
+	const std::string path = test::temp_path("dataset.bin");
+	{
+		nn::DatasetWriter<float> writer(path, inputs, outputs);
+		for (std::size_t i = 0; i < samples; ++i) {
+			const double x[inputs] = { static_cast<double>(i), i + 0.5, -static_cast<double>(i) };
+			const double y[outputs] = { static_cast<double>(i % 2), 1.0 };
+			writer.append(x, y);
+		}
+		writer.finish();
+	}
+
+	{
+		const nn::Dataset<float> data = nn::Dataset<float>::Open(path);
+		test::expect(data.size() == samples && data.input_count() == inputs && data.output_count() == outputs, "dataset shape");
+		test::expect(reinterpret_cast<std::uintptr_t>(data.inputs(0, 1).data()) % nn::DATASET_ALIGNMENT == 0, "inputs not aligned");
+		test::expect(reinterpret_cast<std::uintptr_t>(data.targets(0, 1).data()) % nn::DATASET_ALIGNMENT == 0, "targets not aligned");
+		for (std::size_t i = 0; i < samples; ++i) {
+			const math::BasicRowView<const float> x = data.inputs(i, 1);
+			const math::BasicRowView<const float> y = data.targets(i, 1);
+			test::expect(x[0] == float(i) && x[1] == float(i + 0.5) && x[2] == -float(i), "inputs of sample " + std::to_string(i));
+			test::expect(y[0] == float(i % 2) && y[1] == 1.0f, "targets of sample " + std::to_string(i));
+		}
+	}
+
+	test::expect_throws<std::invalid_argument>([&] { nn::Dataset<double>::Open(path); }, "float dataset opened as double");
+	std::filesystem::remove(path);
+}
+
+SNN_CHECK(dataset_corrupt_header) {
+	const std::string path = test::temp_path("dataset_corrupt.bin");
+	{
+		nn::DatasetWriter<float> writer(path, 3, 2);
+		const double x[3] = { 1.0, 2.0, 3.0 }, y[2] = { 0.0, 1.0 };
+		for (int i = 0; i < 37; ++i) writer.append(x, y);
+		writer.finish();
+	}
+	std::vector<char> contents(std::filesystem::file_size(path));
+	std::ifstream(path, std::ios::binary).read(contents.data(), static_cast<std::streamsize>(contents.size()));
+	nn::DatasetHeader original;
+	std::memcpy(&original, contents.data(), sizeof(original));
+
+	// each forged header must be rejected; the first two make samples x count x 4 wrap to 0 in 64 bits
+	const auto forged = [&](auto&& edit) {
+		nn::DatasetHeader header = original;
+		edit(header);
+		std::memcpy(contents.data(), &header, sizeof(header));
+		std::ofstream(path, std::ios::binary | std::ios::trunc).write(contents.data(), static_cast<std::streamsize>(contents.size()));
+		test::expect_throws<std::invalid_argument>([&] { nn::Dataset<float>::Open(path); }, "a forged header was accepted");
+	};
+	forged([](nn::DatasetHeader& h) { h.samples = std::uint64_t(1) << 62; });
+	forged([](nn::DatasetHeader& h) { h.input_count = std::uint64_t(1) << 62; });
+	forged([](nn::DatasetHeader& h) { h.output_count = std::uint64_t(1) << 62; });
+	forged([](nn::DatasetHeader& h) { h.samples += 1; });
+	forged([&](nn::DatasetHeader& h) { h.targets_offset += 64 * std::uint64_t(contents.size()); });
+	forged([](nn::DatasetHeader& h) { h.inputs_offset = h.targets_offset + 64; });
+	std::filesystem::remove(path);
+}
+
+SNN_CHECK(minibatch_stream) {
+	const std::size_t samples = 37, inputs = 3;
+	math::BasicMatrix<float> x(samples, inputs), y(samples, 1);
+	for (std::size_t i = 0; i < samples; ++i) {
+		for (std::size_t j = 0; j < inputs; ++j) x(i, j) = static_cast<float>(i);
+		y(i, 0) = static_cast<float>(i % 2);
+	}
+	const nn::Dataset<float> data(std::move(x), std::move(y));
+
+	nn::MinibatchStream<float> stream(data, 8, 99);
+	const std::size_t batches = stream.batches_per_epoch();
+	test::expect(batches == samples / 8, "batches per epoch");
+	std::vector<std::size_t> first_epoch;
+	for (int epoch = 0; epoch < 3; ++epoch) {
+		std::vector<bool> seen(samples, false);
+		std::vector<std::size_t> order;
+		for (std::size_t b = 0; b < batches; ++b) {
+			const nn::Minibatch<float> batch = stream.next();
+			for (std::size_t row = 0; row < batch.size; ++row) {
+				const std::size_t sample = static_cast<std::size_t>(batch.inputs[row * inputs]);
+				test::expect(sample < samples && !seen[sample], "sample drawn twice in one epoch");
+				seen[sample] = true;
+				order.push_back(sample);
+				test::expect(batch.targets[row] == float(sample % 2), "targets don't belong to their inputs");
+			}
+		}
+		if (epoch == 0) first_epoch = order;
+		else test::expect(order != first_epoch, "epoch " + std::to_string(epoch) + " repeats the order of epoch 0");
+	}
+}
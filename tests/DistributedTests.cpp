@@ -0,0 +1,72 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "../include/Distributed.hpp"
+
+/**
+ * DistributedTests
+ * ring_all_reduce across forked ranks, over every transport, for value counts that don't split
+ * evenly into one chunk per rank, including fewer values than ranks and none at all.
+ */
+
+/**
+ * What one rank saw after the all-reduce
+ */
+struct RingResult {
+	// values that weren't the exact sum
+	std::size_t wrong;
+	// hash of the reduced bits of inexact values, equal on every rank
+	std::uint64_t fingerprint;
+	std::size_t sent;
+};
+
+static std::uint64_t fingerprint(const double* values, std::size_t n) {
+	std::uint64_t hash = 14695981039346656037ull;
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+	for (std::size_t i = 0; i < n * sizeof(double); ++i) hash = (hash ^ bytes[i]) * 1099511628211ull;
+	return hash;
+}
+
+static void check_ring(nn::TransportKind kind, std::size_t ranks, std::size_t n) {
+	const std::string where = std::string(nn::transport_name(kind)) + ", " + std::to_string(ranks) + " ranks, n = " + std::to_string(n);
+
+	const std::vector<RingResult> results = nn::run_ring<RingResult>(ranks, kind, [&](std::size_t rank, nn::Transport& transport) {
+		std::vector<double> scratch(n / ranks + 1);
+
+		// small integers and halves sum exactly in any order
+		std::vector<double> exact(n);
+		for (std::size_t i = 0; i < n; ++i) exact[i] = 0.5 * static_cast<double>(i + 1) + static_cast<double>(rank);
+		RingResult result{ 0, 0, nn::ring_all_reduce(transport, rank, ranks, exact.data(), n, scratch.data()) };
+		for (std::size_t i = 0; i < n; ++i) {
+			const double expected = 0.5 * static_cast<double>((i + 1) * ranks) + static_cast<double>(ranks * (ranks - 1) / 2);
+			if (exact[i] != expected) ++result.wrong;
+		}
+
+		Xoshiro256 engine(100 + rank);
+		std::vector<double> inexact(n);
+		for (double& x : inexact) x = engine.Unit() / 3.0;
+		nn::ring_all_reduce(transport, rank, ranks, inexact.data(), n, scratch.data());
+		result.fingerprint = fingerprint(inexact.data(), n);
+		return result;
+	});
+
+	std::size_t sent = 0;
+	for (std::size_t rank = 0; rank < ranks; ++rank) {
+		test::expect(results[rank].wrong == 0, where + ": rank " + std::to_string(rank) + " has " + std::to_string(results[rank].wrong) + " wrong sums");
+		test::expect(results[rank].fingerprint == results[0].fingerprint, where + ": rank " + std::to_string(rank) + " reduced to other bits than rank 0");
+		sent += results[rank].sent;
+	}
+	// every value leaves each rank but one during the reduce-scatter, and again during the all-gather
+	test::expect(sent == 2 * (ranks - 1) * n * sizeof(double), where + ": " + std::to_string(sent) + " bytes sent in total");
+}
+
+SNN_CHECK(ring_all_reduce) {
+	for (nn::TransportKind kind : { nn::TransportKind::SharedMemory, nn::TransportKind::UnixSocket, nn::TransportKind::Tcp }) {
+		for (std::size_t ranks : { 1, 2, 3, 5 }) {
+			for (std::size_t n : { 0, 1, 2, 4, 7, 1001 }) check_ring(kind, ranks, n);
+		}
+	}
+}
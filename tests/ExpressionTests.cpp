@@ -0,0 +1,83 @@
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Test.hpp"
+#include "../include/Math.hpp"
+#include "../include/ThreadPool.hpp"
+
+/**
+ * ExpressionTests
+ * Lazy element-wise arithmetic must give what the same arithmetic gives one element at a time,
+ * whether it maps onto one SIMD kernel or becomes a fused (possibly threaded) loop, in every
+ * assignment mode, and when the destination is also an operand.
+ */
+
+// std::vector operands are only found through the math namespace, as in the program
+using namespace math;
+
+template <typename T>
+static void check_expressions(std::size_t n) {
+	const std::string where = std::string(sizeof(T) == sizeof(double) ? "double" : "float") + ", n = " + std::to_string(n) + ": ";
+	Xoshiro256 engine(41);
+	std::vector<T> a(n), b(n), c(n);
+	for (std::size_t i = 0; i < n; ++i) {
+		a[i] = static_cast<T>(engine.Unit() - 0.5);
+		b[i] = static_cast<T>(engine.Unit() - 0.5);
+		c[i] = static_cast<T>(engine.Unit() - 0.5);
+	}
+
+	const auto expect_each = [&](const std::vector<T>& actual, auto&& element, const char* what) {
+		test::expect(actual.size() == n, where + what + " has the wrong size");
+		for (std::size_t i = 0; i < n; ++i) {
+			if (actual[i] != element(i)) throw std::runtime_error(where + what + " differs at element " + std::to_string(i));
+		}
+	};
+
+	// single-kernel shapes
+	expect_each(a + b, [&](std::size_t i) { return a[i] + b[i]; }, "a + b");
+	expect_each(a - b, [&](std::size_t i) { return a[i] - b[i]; }, "a - b");
+	expect_each(a * 0.5, [&](std::size_t i) { return a[i] * T(0.5); }, "a * 0.5");
+	expect_each(0.5 * a * 4.0, [&](std::size_t i) { return a[i] * T(2); }, "a scaled twice");
+
+	// fused loops
+	expect_each(a + b * 2.0 - c, [&](std::size_t i) { return (a[i] + b[i] * T(2)) - c[i]; }, "a + b * 2 - c");
+	expect_each((a - b) * 3.0 + (c + a), [&](std::size_t i) { return (a[i] - b[i]) * T(3) + (c[i] + a[i]); }, "(a - b) * 3 + (c + a)");
+
+	std::vector<T> y = c;
+	y += a * 0.25;
+	expect_each(y, [&](std::size_t i) { return c[i] + a[i] * T(0.25); }, "y += a * 0.25");
+	y = c;
+	y -= a + b;
+	expect_each(y, [&](std::size_t i) { return c[i] - (a[i] + b[i]); }, "y -= a + b");
+
+	// the destination is an operand
+	math::BasicMatrix<T> m(n, 1);
+	std::copy(a.begin(), a.end(), m.data());
+	m = m + m * 2.0;
+	expect_each(std::vector<T>(m.data(), m.data() + n), [&](std::size_t i) { return a[i] + a[i] * T(2); }, "m = m + m * 2");
+
+	std::vector<T> reused(n);
+	const T* storage = reused.data();
+	math::assign(reused, a - c);
+	test::expect(reused.data() == storage, where + "assign() reallocated a vector of the right size");
+	expect_each(reused, [&](std::size_t i) { return a[i] - c[i]; }, "assign(reused, a - c)");
+}
+
+SNN_CHECK(expression_templates) {
+	static_assert(std::is_same_v<decltype(std::declval<math::BasicMatrix<float>&>() * 0.5)::value_type, float>, "float expressions must stay float");
+
+	// small operands run serially, large ones through the SIMD kernels and the thread pool
+	ThreadPool::Configure(3);
+	for (std::size_t n : { std::size_t(0), std::size_t(1), std::size_t(13), std::size_t(1000), std::size_t(300000) }) {
+		check_expressions<double>(n);
+		check_expressions<float>(n);
+	}
+	ThreadPool::Configure(0);
+
+	std::vector<double> a(3), b(4);
+	test::expect_throws<std::invalid_argument>([&] { std::vector<double> c = a + b; }, "operands of different shapes accepted");
+	test::expect_throws<std::invalid_argument>([&] { a += b * 2.0; }, "destination of a different size accepted");
+}
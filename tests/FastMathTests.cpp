@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Test.hpp"
+#include "../include/Simd.hpp"
+
+/**
+ * FastMathTests
+ * The *_fast kernels of every ISA against long double references, within the ULP bounds of the
+ * table in Simd.hpp, and their results on NaN, infinite and out-of-domain inputs.
+ */
+
+template <typename T>
+using FastKernel = void (*)(const T*, T*, std::size_t);
+
+template <typename T>
+using FastMember = FastKernel<T> math::simd::BasicKernels<T>::*;
+
+struct FastFunction {
+	const char* name;
+	FastMember<double> wide;
+	FastMember<float> narrow;
+	long double (*reference)(long double);
+	double max_ulp;
+	// domain of the accuracy check, open at both ends
+	double lo, hi;
+};
+
+static const FastFunction functions[] = {
+	{ "exp", &math::simd::BasicKernels<double>::exp_fast, &math::simd::BasicKernels<float>::exp_fast,
+		[](long double x) { return std::exp(x); }, 3.0, -708.0, 709.0 },
+	{ "log", &math::simd::BasicKernels<double>::log_fast, &math::simd::BasicKernels<float>::log_fast,
+		[](long double x) { return std::log(x); }, 2.0, 0.0, DBL_MAX },
+	{ "log1p", &math::simd::BasicKernels<double>::log1p_fast, &math::simd::BasicKernels<float>::log1p_fast,
+		[](long double x) { return std::log1p(x); }, 3.0, -1.0, DBL_MAX },
+	{ "tanh", &math::simd::BasicKernels<double>::tanh_fast, &math::simd::BasicKernels<float>::tanh_fast,
+		[](long double x) { return std::tanh(x); }, 6.0, -20.0, 20.0 },
+	{ "sigmoid", &math::simd::BasicKernels<double>::sigmoid_fast, &math::simd::BasicKernels<float>::sigmoid_fast,
+		[](long double x) { return 1.0L / (1.0L + std::exp(-x)); }, 3.0, -700.0, 700.0 },
+};
+
+/**
+ * Half the inputs uniform over the domain, half of magnitude 2^e with e uniform, so tiny arguments get checked too
+ */
+static std::vector<double> sample_inputs(const FastFunction& f, std::size_t count, Xoshiro256& engine) {
+	std::vector<double> inputs;
+	while (inputs.size() < count) {
+		double x;
+		if (inputs.size() % 2 == 0) x = f.lo + (f.hi - f.lo) * engine.Unit();
+		else x = (engine.Unit() < 0.5 ? -1.0 : 1.0) * std::ldexp(1.0 + engine.Unit(), static_cast<int>(engine.Unit() * 2040.0) - 1020);
+		if (x > f.lo && x < f.hi) inputs.push_back(x);
+	}
+	return inputs;
+}
+
+static double ulp_error(double actual, long double expected) {
+	const double nearest = std::fabs(static_cast<double>(expected));
+	const double ulp = std::nextafter(nearest, std::numeric_limits<double>::infinity()) - nearest;
+	return static_cast<double>(std::fabs(static_cast<long double>(actual) - expected) / ulp);
+}
+
+static void check_accuracy(math::simd::Isa isa) {
+	const math::simd::BasicKernels<double>& wide = math::simd::kernels_for<double>(isa);
+	const math::simd::BasicKernels<float>& narrow = math::simd::kernels_for<float>(isa);
+	Xoshiro256 engine(17);
+
+	for (const FastFunction& f : functions) {
+		const std::vector<double> inputs = sample_inputs(f, 200000, engine);
+		std::vector<double> outputs(inputs.size());
+		(wide.*f.wide)(inputs.data(), outputs.data(), inputs.size());
+
+		double worst = 0.0, worst_input = 0.0;
+		for (std::size_t i = 0; i < inputs.size(); ++i) {
+			const double error = ulp_error(outputs[i], f.reference(inputs[i]));
+			if (!(error <= worst)) {
+				worst = error;
+				worst_input = inputs[i];
+			}
+		}
+		test::expect(worst <= f.max_ulp, std::string(wide.name) + ": " + f.name + "_fast is off by " + std::to_string(worst)
+			+ " ULP at " + std::to_string(worst_input) + ", the table allows " + std::to_string(f.max_ulp));
+
+		// float data is widened to double, so each result must be the double one rounded to float
+		std::vector<float> x(1001), y(x.size());
+		const double lo = std::max(f.lo, -8.0), hi = std::min(f.hi, 8.0);
+		for (float& v : x) v = static_cast<float>(lo + (hi - lo) * (0.001 + 0.998 * engine.Unit()));
+		std::vector<double> x_wide(x.begin(), x.end()), y_wide(x.size());
+		(narrow.*f.narrow)(x.data(), y.data(), x.size());
+		(wide.*f.wide)(x_wide.data(), y_wide.data(), x.size());
+		for (std::size_t i = 0; i < x.size(); ++i) {
+			test::expect(y[i] == static_cast<float>(y_wide[i]), std::string(narrow.name) + ": float " + f.name + "_fast differs from the rounded double result");
+		}
+	}
+}
+
+SNN_CHECK(fast_math_accuracy) {
+	for (int isa = static_cast<int>(math::simd::Isa::Scalar); isa <= static_cast<int>(math::simd::detect_isa()); ++isa) {
+		check_accuracy(static_cast<math::simd::Isa>(isa));
+	}
+}
+
+template <typename T>
+static FastMember<T> member(const FastFunction& f) {
+	if constexpr (std::is_same_v<T, double>) return f.wide;
+	else return f.narrow;
+}
+
+/**
+ * Runs kernel on x placed at every position of a block of 11, so the vector body and the padded tail both see it
+ * @return the result for x, which must not depend on the position nor change the other lanes
+ */
+template <typename T>
+static T at_every_position(FastKernel<T> kernel, T x, const std::string& what) {
+	constexpr std::size_t n = 11;
+	const T filler = T(0.5);
+	T filler_result, result = T(0);
+	kernel(&filler, &filler_result, 1);
+	for (std::size_t p = 0; p < n; ++p) {
+		std::vector<T> in(n, filler), out(n);
+		in[p] = x;
+		kernel(in.data(), out.data(), n);
+		if (p == 0) result = out[p];
+		test::expect(std::isnan(result) ? std::isnan(out[p]) : out[p] == result, what + " depends on its position");
+		for (std::size_t i = 0; i < n; ++i) test::expect(i == p || out[i] == filler_result, what + " changes the lanes beside it");
+	}
+	return result;
+}
+
+template <typename T>
+static void check_special_values(math::simd::Isa isa) {
+	const math::simd::BasicKernels<T>& k = math::simd::kernels_for<T>(isa);
+	const math::simd::BasicKernels<T>& scalar = math::simd::kernels_for<T>(math::simd::Isa::Scalar);
+	const std::string where = std::string(k.name) + (std::is_same_v<T, float> ? " float: " : " double: ");
+	const T nan = std::numeric_limits<T>::quiet_NaN(), inf = std::numeric_limits<T>::infinity();
+	const T tiny = std::numeric_limits<T>::denorm_min();
+
+	const T specials[] = { nan, -nan, inf, -inf, T(0), -T(0), T(1), T(-1), T(-2), tiny, -tiny, std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest(), T(-708), T(709) };
+	for (const FastFunction& f : functions) {
+		const FastKernel<T> kernel = k.*member<T>(f), reference = scalar.*member<T>(f);
+		for (T x : specials) {
+			const std::string what = where + f.name + "(" + std::to_string(x) + ")";
+			const T y = at_every_position(kernel, x, what);
+			T expected;
+			reference(&x, &expected, 1);
+			test::expect(std::isnan(expected) ? std::isnan(y) : y == expected && std::signbit(y) == std::signbit(expected), what + " differs from the scalar kernel");
+		}
+		test::expect(std::isnan(at_every_position(kernel, nan, where + f.name + "(NaN)")), where + f.name + "(NaN) is not NaN");
+	}
+
+	const auto fast = [](FastKernel<T> kernel, T x) {
+		T y;
+		kernel(&x, &y, 1);
+		return y;
+	};
+	// exp clamps its input to [-708, 709]
+	test::expect(fast(k.exp_fast, inf) == fast(k.exp_fast, T(709)) && fast(k.exp_fast, -inf) == fast(k.exp_fast, T(-708)), where + "exp(+-inf) is not clamped");
+	test::expect(fast(k.exp_fast, T(0)) == T(1), where + "exp(0) is not 1");
+	test::expect(fast(k.log_fast, inf) == inf && fast(k.log_fast, T(0)) == -inf && fast(k.log_fast, -T(0)) == -inf, where + "log at 0 or inf");
+	test::expect(std::isnan(fast(k.log_fast, T(-1))) && std::isnan(fast(k.log_fast, -inf)), where + "log of a negative number is not NaN");
+	test::expect(fast(k.log_fast, tiny) == std::log(tiny), where + "log of a subnormal number does not fall back to std::log");
+	test::expect(fast(k.log1p_fast, inf) == inf && fast(k.log1p_fast, T(-1)) == -inf, where + "log1p at -1 or inf");
+	test::expect(std::isnan(fast(k.log1p_fast, T(-2))) && std::isnan(fast(k.log1p_fast, -inf)), where + "log1p below -1 is not NaN");
+	test::expect(fast(k.tanh_fast, inf) == T(1) && fast(k.tanh_fast, -inf) == T(-1), where + "tanh(+-inf) is not +-1");
+	test::expect(std::signbit(fast(k.tanh_fast, -T(0))) && fast(k.tanh_fast, -T(0)) == T(0), where + "tanh(-0) is not -0");
+	const T sigmoid_low = fast(k.sigmoid_fast, -inf);
+	test::expect(fast(k.sigmoid_fast, inf) == T(1) && sigmoid_low >= T(0) && sigmoid_low < std::numeric_limits<T>::min(), where + "sigmoid(+-inf) is not 1 and 0");
+}
+
+SNN_CHECK(fast_math_special_values) {
+	for (int isa = static_cast<int>(math::simd::Isa::Scalar); isa <= static_cast<int>(math::simd::detect_isa()); ++isa) {
+		check_special_values<double>(static_cast<math::simd::Isa>(isa));
+		check_special_values<float>(static_cast<math::simd::Isa>(isa));
+	}
+}
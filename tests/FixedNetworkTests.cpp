@@ -0,0 +1,75 @@
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "../include/FixedNetwork.hpp"
+#include "../include/ThreadPool.hpp"
+#include "../include/Trainer.hpp"
+
+/**
+ * FixedNetworkTests
+ * FixedTrainer fuses the passes of a compile-time sized network, so it must train the same weights
+ * as the generic DataParallelTrainer up to the order of its sums, for every hidden activation and
+ * optimizer it is built for.
+ */
+
+template <typename T>
+static void check_fixed_against_generic(nn::Activation activation, nn::OptimizerKind kind, double tolerance) {
+	const nn::Topology topo = nn::dense_topology(3, { 8 }, 1, activation);
+	const std::size_t batch = 12;
+	const std::string where = std::string(nn::activation_name(activation)) + " hidden layer, " + nn::optimizer_name(kind);
+
+	nn::OptimizerSettings settings;
+	settings.kind = kind;
+	settings.weight_decay = 0.001;
+
+	nn::Network<T> generic(topo);
+	test::fill_uniform(generic, 9);
+	std::unique_ptr<nn::FixedTrainer<T>> fixed = nn::make_fixed_trainer<T>(topo, batch, settings);
+	test::expect(fixed != nullptr, where + ": no fixed trainer for a built-in size");
+	fixed->load(nn::NetworkView<T>(generic));
+	nn::DataParallelTrainer<T> trainer(topo, batch, 1, settings);
+
+	Xoshiro256 engine(13);
+	std::vector<T> inputs(batch * topo.input), targets(batch);
+	for (T& x : inputs) x = static_cast<T>(2.0 * engine.Unit() - 1.0);
+	for (std::size_t i = 0; i < batch; ++i) targets[i] = inputs[i * topo.input] * inputs[i * topo.input + 2] > T(0) ? T(1) : T(0);
+	fixed->load_batch(inputs, targets);
+	trainer.load_batch(inputs, targets);
+
+	for (int step = 0; step < 25; ++step) {
+		const T fixed_loss = fixed->step(0.1);
+		const T generic_loss = trainer.step(generic, 0.1);
+		test::expect(std::abs(fixed_loss - generic_loss) <= tolerance * generic_loss, where + ": losses differ at step " + std::to_string(step));
+		for (std::size_t i = 0; i < batch; ++i) {
+			test::expect(std::abs(fixed->logit(i) - trainer.logit(i)) <= tolerance * (1 + std::abs(trainer.logit(i))), where + ": logits differ at step " + std::to_string(step));
+		}
+	}
+
+	nn::Network<T> stored(topo);
+	fixed->store(stored);
+	const std::vector<T> expected = test::flatten(nn::NetworkView<T>(generic)), actual = test::flatten(nn::NetworkView<T>(stored));
+	for (std::size_t i = 0; i < expected.size(); ++i) {
+		test::expect(std::abs(actual[i] - expected[i]) <= tolerance * (1 + std::abs(expected[i])), where + ": weight " + std::to_string(i) + " differs after training");
+	}
+}
+
+SNN_CHECK(fixed_network) {
+	ThreadPool::Configure(1);
+	for (nn::Activation activation : { nn::Activation::Relu, nn::Activation::Tanh, nn::Activation::Sigmoid }) {
+		for (nn::OptimizerKind kind : { nn::OptimizerKind::Sgd, nn::OptimizerKind::Nesterov, nn::OptimizerKind::Adam }) {
+			check_fixed_against_generic<double>(activation, kind, 1e-10);
+			check_fixed_against_generic<float>(activation, kind, 1e-4);
+		}
+	}
+	ThreadPool::Configure(0);
+
+	// sizes that aren't built in fall back to the generic engine
+	test::expect(nn::make_fixed_trainer<double>(nn::dense_topology(5, { 8 }, 1), 4) == nullptr, "a fixed trainer for 5 inputs");
+	test::expect(nn::make_fixed_trainer<double>(nn::dense_topology(2, { 6 }, 1), 4) == nullptr, "a fixed trainer for 6 hidden units");
+	test::expect(nn::make_fixed_trainer<double>(nn::dense_topology(2, { 4 }, 2), 4) == nullptr, "a fixed trainer for 2 outputs");
+	test::expect(nn::make_fixed_trainer<double>(nn::dense_topology(2, { 4, 4 }, 1), 4) == nullptr, "a fixed trainer for 2 hidden layers");
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "../include/Math.hpp"
+#include "../include/ThreadPool.hpp"
+
+/**
+ * GemmTests
+ * gemm against a naive triple loop, on every instruction set, for every transpose, for shapes that
+ * leave partial micro-tiles and cache blocks, with small blocking so one product spans many blocks,
+ * and threaded.
+ */
+
+struct GemmShape {
+	std::size_t m, n, k;
+};
+
+template <typename T>
+static void check_gemm(math::Transpose ta, math::Transpose tb, const GemmShape& shape, Xoshiro256& engine, const std::string& where) {
+	const bool at = ta == math::Transpose::Yes, bt = tb == math::Transpose::Yes;
+	// A is stored with two spare columns, so op(A) is read through a view whose stride isn't its width
+	const std::size_t a_rows = at ? shape.k : shape.m, a_cols = at ? shape.m : shape.k;
+	const std::size_t b_rows = bt ? shape.n : shape.k, b_cols = bt ? shape.k : shape.n;
+	math::BasicMatrix<T> a_storage(a_rows, a_cols + 2), b(b_rows, b_cols), c(shape.m, shape.n);
+	for (T& x : a_storage) x = static_cast<T>(2.0 * engine.Unit() - 1.0);
+	for (T& x : b) x = static_cast<T>(2.0 * engine.Unit() - 1.0);
+	for (T& x : c) x = static_cast<T>(2.0 * engine.Unit() - 1.0);
+	const math::BasicMatrixView<const T> a(a_storage.data(), a_rows, a_cols, a_storage.stride());
+
+	const T alpha = T(0.75), beta = T(0.5);
+	std::vector<long double> expected(shape.m * shape.n);
+	std::vector<long double> magnitude(shape.m * shape.n);
+	for (std::size_t i = 0; i < shape.m; ++i) {
+		for (std::size_t j = 0; j < shape.n; ++j) {
+			long double sum = 0, abs_sum = 0;
+			for (std::size_t p = 0; p < shape.k; ++p) {
+				const long double x = at ? a(p, i) : a(i, p);
+				const long double y = bt ? b(j, p) : b(p, j);
+				sum += x * y;
+				abs_sum += std::abs(x * y);
+			}
+			expected[i * shape.n + j] = alpha * sum + beta * static_cast<long double>(c(i, j));
+			magnitude[i * shape.n + j] = abs_sum + std::abs(static_cast<long double>(c(i, j)));
+		}
+	}
+
+	math::gemm<T>(ta, tb, alpha, a, b, beta, c);
+
+	const long double epsilon = std::numeric_limits<T>::epsilon();
+	for (std::size_t i = 0; i < shape.m; ++i) {
+		for (std::size_t j = 0; j < shape.n; ++j) {
+			const long double error = std::abs(static_cast<long double>(c(i, j)) - expected[i * shape.n + j]);
+			const long double bound = 2 * (shape.k + 2) * epsilon * magnitude[i * shape.n + j] + epsilon;
+			test::expect(error <= bound, where + ": element (" + std::to_string(i) + ", " + std::to_string(j) + ") off by " + std::to_string(static_cast<double>(error)));
+		}
+	}
+}
+
+template <typename T>
+static void check_gemm_all(const char* type) {
+	const GemmShape shapes[] = { { 1, 1, 1 }, { 3, 5, 7 }, { 17, 9, 33 }, { 40, 70, 100 }, { 97, 33, 260 } };
+	const math::Transpose transposes[] = { math::Transpose::No, math::Transpose::Yes };
+	Xoshiro256 engine(21);
+
+	for (int isa = static_cast<int>(math::simd::Isa::Scalar); isa <= static_cast<int>(math::simd::detect_isa()); ++isa) {
+		math::simd::set_isa(static_cast<math::simd::Isa>(isa));
+		for (const GemmShape& shape : shapes) {
+			for (math::Transpose ta : transposes) {
+				for (math::Transpose tb : transposes) {
+					const std::string where = std::string(type) + " gemm on " + math::simd::kernels<T>().name + ", "
+						+ std::to_string(shape.m) + "x" + std::to_string(shape.n) + "x" + std::to_string(shape.k)
+						+ (ta == math::Transpose::Yes ? " A^T" : "") + (tb == math::Transpose::Yes ? " B^T" : "");
+					check_gemm<T>(ta, tb, shape, engine, where);
+				}
+			}
+		}
+	}
+	math::simd::set_isa(math::simd::detect_isa());
+}
+
+SNN_CHECK(gemm_reference) {
+	check_gemm_all<double>("double");
+	check_gemm_all<float>("float");
+}
+
+SNN_CHECK(gemm_blocked_threaded) {
+	const math::GemmBlocking blocking = math::gemm_blocking;
+	const math::ExecutionThresholds thresholds = math::execution_thresholds;
+	ThreadPool::Configure(3);
+
+	// tiny blocks and a zero threading threshold: every product spans many row, column and depth blocks across threads
+	math::gemm_blocking = { 8, 16, 24 };
+	math::execution_thresholds.gemm_parallel = 0;
+	check_gemm_all<double>("double");
+	check_gemm_all<float>("float");
+
+	math::gemm_blocking = blocking;
+	math::execution_thresholds = thresholds;
+	ThreadPool::Configure(0);
+}
@@ -0,0 +1,39 @@
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+#include "Test.hpp"
+
+/**
+ * core_tests
+ * Runs the checks of the tests/...Tests.cpp files and reports PASS or FAIL for each; exits with 1 if any failed.
+ *
+ * Usage: core_tests [check...]   (every check without arguments; ctest runs one per test)
+ */
+int main(int argc, char** argv) {
+	std::vector<const test::Check*> selected;
+	for (int i = 1; i < argc; ++i) {
+		const test::Check* found = nullptr;
+		for (const test::Check& check : test::registry()) if (std::strcmp(check.name, argv[i]) == 0) found = &check;
+		if (!found) {
+			std::cerr << "Unknown check: " << argv[i] << std::endl;
+			return 1;
+		}
+		selected.push_back(found);
+	}
+	if (selected.empty()) for (const test::Check& check : test::registry()) selected.push_back(&check);
+
+	int failures = 0;
+	for (const test::Check* check : selected) {
+		try {
+			check->run();
+			std::cout << "PASS " << check->name << std::endl;
+		}
+		catch (const std::exception& e) {
+			std::cout << "FAIL " << check->name << ": " << e.what() << std::endl;
+			++failures;
+		}
+	}
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,100 @@
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "../include/Optimizer.hpp"
+
+/**
+ * OptimizerTests
+ * Optimizer::apply on every ISA against the textbook update rules, written out on the batch mean
+ * of the gradients in long double. The fused kernels fold the mean, the decay and Adam's bias
+ * correction into per-step constants, so only rounding may separate the two.
+ */
+
+/**
+ * Textbook state of one weight: the velocity for momentum, the two moments for Adam
+ */
+struct ReferenceWeight {
+	long double w = 0.0L, first = 0.0L, second = 0.0L;
+};
+
+static void reference_step(const nn::OptimizerSettings& s, ReferenceWeight& r, long double gradient, long double lr, std::uint64_t t) {
+	const long double g = s.kind == nn::OptimizerKind::AdamW ? gradient : gradient + s.weight_decay * r.w;
+	switch (s.kind) {
+	case nn::OptimizerKind::Momentum:
+		r.first = s.momentum * r.first + g;
+		r.w -= lr * r.first;
+		break;
+	case nn::OptimizerKind::Nesterov:
+		r.first = s.momentum * r.first + g;
+		r.w -= lr * (g + s.momentum * r.first);
+		break;
+	case nn::OptimizerKind::Adam:
+	case nn::OptimizerKind::AdamW: {
+		r.first = s.beta1 * r.first + (1.0L - s.beta1) * g;
+		r.second = s.beta2 * r.second + (1.0L - s.beta2) * g * g;
+		const long double first_hat = r.first / (1.0L - std::pow(static_cast<long double>(s.beta1), static_cast<long double>(t)));
+		const long double second_hat = r.second / (1.0L - std::pow(static_cast<long double>(s.beta2), static_cast<long double>(t)));
+		const long double decay = s.kind == nn::OptimizerKind::AdamW ? s.weight_decay * r.w : 0.0L;
+		r.w -= lr * (first_hat / (std::sqrt(second_hat) + s.epsilon) + decay);
+		break;
+	}
+	default:
+		r.w -= lr * g;
+		break;
+	}
+}
+
+template <typename T>
+static void check_optimizer(nn::OptimizerKind kind, double tolerance) {
+	const nn::Topology topo = nn::dense_topology(5, { 7 }, 3);
+	const std::size_t batch = 4;
+	const double lr = 0.05;
+
+	nn::OptimizerSettings settings;
+	settings.kind = kind;
+	settings.epsilon = 1e-3;
+	settings.weight_decay = 0.01;
+
+	for (int isa = static_cast<int>(math::simd::Isa::Scalar); isa <= static_cast<int>(math::simd::detect_isa()); ++isa) {
+		math::simd::set_isa(static_cast<math::simd::Isa>(isa));
+		const std::string where = std::string(nn::optimizer_name(kind)) + " on " + math::simd::kernels<T>().name;
+
+		nn::Network<T> net(topo);
+		test::fill_uniform(net, 3);
+		nn::BasicWorkspace<T> ws(topo, batch);
+		nn::Optimizer<T> optimizer(topo, settings);
+
+		std::vector<ReferenceWeight> reference;
+		for (T w : test::flatten(nn::NetworkView<T>(net))) reference.push_back({ w });
+
+		Xoshiro256 engine(5);
+		for (std::uint64_t t = 1; t <= 12; ++t) {
+			// summed gradients as the backward pass leaves them, in the order flatten lists the weights
+			std::vector<T> sums;
+			for (std::size_t l = 0; l < topo.depth(); ++l) {
+				for (T& g : ws.weight_gradients[l].flat()) sums.push_back(g = static_cast<T>(batch * (2.0 * engine.Unit() - 1.0)));
+				for (T& g : ws.bias_gradients[l]) sums.push_back(g = static_cast<T>(batch * (2.0 * engine.Unit() - 1.0)));
+			}
+			optimizer.apply(net, ws, lr, batch);
+			for (std::size_t i = 0; i < reference.size(); ++i) reference_step(settings, reference[i], static_cast<long double>(sums[i]) / batch, lr, t);
+
+			const std::vector<T> weights = test::flatten(nn::NetworkView<T>(net));
+			for (std::size_t i = 0; i < reference.size(); ++i) {
+				const long double error = std::fabs(static_cast<long double>(weights[i]) - reference[i].w);
+				test::expect(error <= tolerance * (1.0L + std::fabs(reference[i].w)), where + ": weight " + std::to_string(i) + " is off the textbook rule at step " + std::to_string(t));
+			}
+		}
+	}
+	math::simd::set_isa(math::simd::detect_isa());
+}
+
+SNN_CHECK(optimizer_steps) {
+	for (nn::OptimizerKind kind : { nn::OptimizerKind::Sgd, nn::OptimizerKind::Momentum, nn::OptimizerKind::Nesterov, nn::OptimizerKind::Adam, nn::OptimizerKind::AdamW }) {
+		check_optimizer<double>(kind, 1e-12);
+		check_optimizer<float>(kind, 1e-5);
+	}
+}
@@ -0,0 +1,33 @@
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+#include "Test.hpp"
+#include "../include/Quantize.hpp"
+
+/**
+ * QuantizeTests
+ * The int8 network must predict what the float network it was quantized from predicts.
+ */
+
+SNN_CHECK(int8_agreement) {
+	const nn::Topology topo = nn::dense_topology(16, { 64, 32 }, 1);
+	nn::Network<float> net(topo);
+	test::fill_uniform(net, 5);
+
+	const std::size_t samples = 1000;
+	Xoshiro256 engine(13);
+	math::BasicMatrix<float> inputs(samples, topo.input), targets(samples, 1);
+	for (std::size_t i = 0; i < samples; ++i) {
+		for (std::size_t j = 0; j < topo.input; ++j) inputs(i, j) = static_cast<float>(2.0 * engine.Unit() - 1.0);
+		targets(i, 0) = engine.Unit() < 0.5 ? 0.0f : 1.0f;
+	}
+	const nn::Dataset<float> data(std::move(inputs), std::move(targets));
+
+	const nn::QuantizedNetwork<float> quantized(net);
+	const nn::QuantizationReport report = nn::compare_quantized(net, quantized, data);
+	test::expect(report.max_difference < 0.05, "int8 probabilities differ by " + std::to_string(report.max_difference));
+	test::expect(report.mean_difference < 0.01, "int8 probabilities differ by " + std::to_string(report.mean_difference) + " on average");
+	test::expect(report.agreement > 0.97, "int8 network agrees on only " + std::to_string(report.agreement));
+	test::expect(std::abs(report.loss - report.quantized_loss) < 0.01, "int8 loss differs");
+}
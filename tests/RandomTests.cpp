@@ -0,0 +1,51 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "Test.hpp"
+#include "../include/Simd.hpp"
+
+/**
+ * RandomTests
+ * Philox has to reproduce the published known-answer vectors on every instruction set, or streams
+ * would differ between machines.
+ */
+
+/**
+ * Known-answer vectors of Philox4x32-10 from the Random123 distribution (kat_vectors)
+ */
+SNN_CHECK(philox_known_answers) {
+	struct Vector {
+		std::uint32_t counter[4];
+		std::uint32_t key[2];
+		std::uint32_t expected[4];
+	};
+	const Vector vectors[] = {
+		{ { 0x00000000, 0x00000000, 0x00000000, 0x00000000 }, { 0x00000000, 0x00000000 }, { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+		{ { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff }, { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+		{ { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 }, { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } },
+	};
+
+	// the vector's counter is the last of 16 blocks, so the wide kernels compute it in a full register
+	constexpr std::size_t BLOCKS = 16;
+	const math::simd::Isa best = math::simd::detect_isa();
+	for (const Vector& v : vectors) {
+		const std::uint64_t key = (std::uint64_t(v.key[1]) << 32) | v.key[0];
+		const std::uint64_t first = (std::uint64_t(v.counter[1]) << 32) | v.counter[0];
+		const std::uint64_t stream = (std::uint64_t(v.counter[3]) << 32) | v.counter[2];
+
+		std::uint64_t reference[2 * BLOCKS];
+		math::simd::kernels_for<double>(math::simd::Isa::Scalar).philox(key, stream, first - (BLOCKS - 1), BLOCKS, reference);
+
+		for (int isa = static_cast<int>(math::simd::Isa::Scalar); isa <= static_cast<int>(best); ++isa) {
+			std::uint64_t out[2 * BLOCKS];
+			math::simd::kernels_for<double>(static_cast<math::simd::Isa>(isa)).philox(key, stream, first - (BLOCKS - 1), BLOCKS, out);
+
+			const std::uint64_t* last = out + 2 * (BLOCKS - 1);
+			const std::uint32_t words[4] = { std::uint32_t(last[0]), std::uint32_t(last[0] >> 32), std::uint32_t(last[1]), std::uint32_t(last[1] >> 32) };
+			test::expect(std::memcmp(words, v.expected, sizeof(words)) == 0, "known answer mismatch on instruction set " + std::to_string(isa));
+			test::expect(std::memcmp(out, reference, sizeof(out)) == 0, "instruction set " + std::to_string(isa) + " disagrees with the scalar kernel");
+		}
+	}
+}
@@ -0,0 +1,98 @@
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "../include/Simd.hpp"
+
+/**
+ * SimdTests
+ * Every vector kernel against its scalar version, for lengths around each register width and
+ * unaligned pointers. Element-wise add, sub and scale must match exactly; kernels that may fuse
+ * a multiply-add or reorder a sum must match within their rounding.
+ */
+
+template <typename T>
+static std::vector<T> random_values(std::size_t n, Xoshiro256& engine) {
+	std::vector<T> values(n);
+	for (T& x : values) x = static_cast<T>(4.0 * engine.Unit() - 2.0);
+	return values;
+}
+
+template <typename T>
+static void expect_close(T actual, T expected, double scale, const std::string& what) {
+	const double bound = 4.0 * std::numeric_limits<T>::epsilon() * scale;
+	test::expect(std::abs(static_cast<double>(actual) - static_cast<double>(expected)) <= bound, what);
+}
+
+template <typename T>
+static void check_kernels(math::simd::Isa isa) {
+	const math::simd::BasicKernels<T>& scalar = math::simd::kernels_for<T>(math::simd::Isa::Scalar);
+	const math::simd::BasicKernels<T>& vector = math::simd::kernels_for<T>(isa);
+	Xoshiro256 engine(31);
+
+	std::vector<std::size_t> lengths;
+	for (std::size_t n = 0; n <= 70; ++n) lengths.push_back(n);
+	lengths.push_back(1001);
+
+	for (std::size_t n : lengths) {
+		const std::string where = std::string(vector.name) + ", n = " + std::to_string(n) + ": ";
+		// one past an aligned start, so no kernel can rely on alignment
+		const std::vector<T> a_storage = random_values<T>(n + 1, engine), b_storage = random_values<T>(n + 1, engine), y_storage = random_values<T>(n + 1, engine);
+		const T* a = a_storage.data() + 1;
+		const T* b = b_storage.data() + 1;
+
+		double abs_dot = 0.0;
+		for (std::size_t i = 0; i < n; ++i) abs_dot += std::abs(static_cast<double>(a[i]) * b[i]);
+		expect_close(vector.dot(a, b, n), scalar.dot(a, b, n), static_cast<double>(n) * abs_dot, where + "dot");
+		test::expect(std::abs(vector.dot_wide(a, b, n) - scalar.dot_wide(a, b, n)) <= 1e-14 * (1.0 + abs_dot), where + "dot_wide");
+
+		std::vector<T> expected(n + 1), actual(n + 1);
+		scalar.add(a, b, expected.data() + 1, n);
+		vector.add(a, b, actual.data() + 1, n);
+		test::expect(test::same_bits(expected, actual), where + "add");
+		scalar.sub(a, b, expected.data() + 1, n);
+		vector.sub(a, b, actual.data() + 1, n);
+		test::expect(test::same_bits(expected, actual), where + "sub");
+		scalar.scale(a, T(0.3), expected.data() + 1, n);
+		vector.scale(a, T(0.3), actual.data() + 1, n);
+		test::expect(test::same_bits(expected, actual), where + "scale");
+
+		expected = y_storage;
+		actual = y_storage;
+		scalar.axpy(T(-0.7), a, expected.data() + 1, n);
+		vector.axpy(T(-0.7), a, actual.data() + 1, n);
+		for (std::size_t i = 1; i <= n; ++i) expect_close(actual[i], expected[i], std::abs(y_storage[i]) + std::abs(a[i - 1]), where + "axpy");
+
+		expected = y_storage;
+		actual = y_storage;
+		scalar.mul_add(a, b, expected.data() + 1, n);
+		vector.mul_add(a, b, actual.data() + 1, n);
+		for (std::size_t i = 1; i <= n; ++i) expect_close(actual[i], expected[i], std::abs(y_storage[i]) + std::abs(a[i - 1] * b[i - 1]), where + "mul_add");
+	}
+
+	// gemv over a strided matrix, rows and columns around the register widths
+	for (std::size_t rows : { std::size_t(1), std::size_t(5), std::size_t(17) }) {
+		for (std::size_t cols : { std::size_t(1), std::size_t(7), std::size_t(16), std::size_t(37) }) {
+			const std::size_t stride = cols + 3;
+			const std::vector<T> matrix = random_values<T>(rows * stride, engine), x = random_values<T>(cols, engine);
+			std::vector<T> expected(rows), actual(rows);
+			scalar.gemv(matrix.data(), rows, cols, stride, x.data(), expected.data());
+			vector.gemv(matrix.data(), rows, cols, stride, x.data(), actual.data());
+			for (std::size_t r = 0; r < rows; ++r) {
+				double abs_sum = 0.0;
+				for (std::size_t c = 0; c < cols; ++c) abs_sum += std::abs(static_cast<double>(matrix[r * stride + c]) * x[c]);
+				expect_close(actual[r], expected[r], static_cast<double>(cols) * abs_sum, std::string(vector.name) + ": gemv " + std::to_string(rows) + "x" + std::to_string(cols));
+			}
+		}
+	}
+}
+
+SNN_CHECK(simd_kernels) {
+	for (int isa = static_cast<int>(math::simd::Isa::SSE2); isa <= static_cast<int>(math::simd::detect_isa()); ++isa) {
+		check_kernels<double>(static_cast<math::simd::Isa>(isa));
+		check_kernels<float>(static_cast<math::simd::Isa>(isa));
+	}
+}
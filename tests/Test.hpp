@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../include/Network.hpp"
+#include "../include/Random.hpp"
+
+/**
+ * Test.hpp
+ * Minimal harness of the ctest checks. A check is a function declared with SNN_CHECK(name) in any
+ * of the tests/...Tests.cpp files; it fails by throwing, usually through expect(). tests/Main.cpp runs
+ * the checks named on its command line, and CMakeLists.txt registers every name as its own test.
+ */
+namespace test {
+
+    using CheckFunction = void (*)();
+
+    struct Check {
+        const char* name;
+        CheckFunction run;
+    };
+
+    inline std::vector<Check>& registry() {
+        static std::vector<Check> checks;
+        return checks;
+    }
+
+    inline bool add(const char* name, CheckFunction run) {
+        registry().push_back({ name, run });
+        return true;
+    }
+
+    inline void expect(bool condition, const std::string& what) {
+        if (!condition) throw std::runtime_error(what);
+    }
+
+    /**
+     * Expects fn() to throw an E
+     */
+    template <typename E, typename F>
+    inline void expect_throws(F&& fn, const std::string& what) {
+        try {
+            fn();
+        }
+        catch (const E&) {
+            return;
+        }
+        throw std::runtime_error(what);
+    }
+
+    /**
+     * @return path of a scratch file in the system's temporary directory
+     */
+    inline std::string temp_path(const std::string& name) {
+        return (std::filesystem::temp_directory_path() / ("snn_tests_" + name)).string();
+    }
+
+    /**
+     * Fills every layer of net with seeded Xavier weights and zero biases
+     */
+    template <typename T>
+    inline void fill_uniform(nn::Network<T>& net, std::uint64_t seed) {
+        Xoshiro256 engine(seed);
+        net.initialize([&](std::size_t, T* weights, std::size_t count, double min, double max) {
+            for (std::size_t i = 0; i < count; ++i) weights[i] = static_cast<T>(min + (max - min) * engine.Unit());
+        });
+    }
+
+    /**
+     * @return every weight and bias of net, layer by layer
+     */
+    template <typename T>
+    inline std::vector<T> flatten(const nn::NetworkView<T>& net) {
+        std::vector<T> values;
+        for (const nn::LayerView<T>& layer : net.layers) {
+            values.insert(values.end(), layer.weight.data(), layer.weight.data() + layer.weight.rows() * layer.weight.cols());
+            values.insert(values.end(), layer.bias.begin(), layer.bias.end());
+        }
+        return values;
+    }
+
+    template <typename T>
+    inline bool same_bits(const std::vector<T>& a, const std::vector<T>& b) {
+        return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+    }
+
+}
+
+#define SNN_CHECK(name) \
+    static void name(); \
+    static const bool name##_registered = test::add(#name, name); \
+    static void name()
@@ -0,0 +1,58 @@
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Test.hpp"
+#include "../include/ThreadPool.hpp"
+#include "../include/Trainer.hpp"
+
+/**
+ * TrainerTests
+ * DataParallelTrainer sums its shard gradients in a tree fixed by the shard count alone, so the
+ * weights it trains must be the same bits on any number of threads.
+ */
+
+/**
+ * Trains with a fixed shard count on pool_threads threads, returns the final weights followed by every step's loss
+ */
+template <typename T>
+static std::vector<T> train_data_parallel(std::size_t pool_threads) {
+	ThreadPool::Configure(pool_threads);
+
+	const nn::Topology topo = nn::dense_topology(8, { 32, 16 }, 1);
+	const std::size_t batch = 96;
+	nn::Network<T> net(topo);
+	test::fill_uniform(net, 7);
+
+	Xoshiro256 engine(11);
+	std::vector<T> inputs(batch * topo.input), targets(batch);
+	for (T& x : inputs) x = static_cast<T>(2.0 * engine.Unit() - 1.0);
+	for (std::size_t i = 0; i < batch; ++i) targets[i] = inputs[i * topo.input] * inputs[i * topo.input + 1] > T(0) ? T(1) : T(0);
+
+	nn::OptimizerSettings settings;
+	settings.kind = nn::OptimizerKind::Adam;
+	nn::DataParallelTrainer<T> trainer(topo, batch, 6, settings);
+	trainer.load_batch(inputs, targets);
+
+	std::vector<T> losses;
+	for (int step = 0; step < 20; ++step) losses.push_back(trainer.step(net, 0.01));
+
+	std::vector<T> result = test::flatten(nn::NetworkView<T>(net));
+	result.insert(result.end(), losses.begin(), losses.end());
+	return result;
+}
+
+template <typename T>
+static void check_reduce_reproducible() {
+	const std::vector<T> single = train_data_parallel<T>(1);
+	test::expect(test::same_bits(single, train_data_parallel<T>(1)), "two single-threaded runs differ");
+	for (std::size_t threads : { 2, 3, 6 }) {
+		test::expect(test::same_bits(single, train_data_parallel<T>(threads)), "a run on " + std::to_string(threads) + " threads differs from the single-threaded one");
+	}
+	ThreadPool::Configure(0);
+}
+
+SNN_CHECK(reduce_reproducible) {
+	check_reduce_reproducible<double>();
+	check_reduce_reproducible<float>();
+}
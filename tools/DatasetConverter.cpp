@@ -0,0 +1,121 @@
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../include/Dataset.hpp"
+
+/**
+ * DatasetConverter
+ * Converts a CSV file into the binary dataset format of Dataset.hpp, one line at a time,
+ * so the CSV may be far larger than memory.
+ *
+ * Usage: DatasetConverter <input.csv> <output.bin> [--outputs N] [--precision double|float]
+ * Every line is one sample: input values followed by N target values (default 1), separated
+ * by commas, semicolons or whitespace. A first line that isn't numeric is skipped as a header.
+ */
+
+static bool parse_row(const std::string& line, std::vector<double>& values) {
+	values.clear();
+	const char* cursor = line.c_str();
+
+	while (true) {
+		while (*cursor == ',' || *cursor == ';' || std::isspace(static_cast<unsigned char>(*cursor))) ++cursor;
+		if (*cursor == '\0') return true;
+
+		char* end;
+		errno = 0;
+		const double value = std::strtod(cursor, &end);
+		if (end == cursor || errno == ERANGE) return false;
+		values.push_back(value);
+		cursor = end;
+	}
+}
+
+template <typename T>
+static size_t convert(std::ifstream& csv, const std::string& output_path, size_t output_count) {
+	std::string line;
+	std::vector<double> values;
+	size_t line_number = 0;
+	size_t columns = 0;
+
+	// the first non-empty line fixes the column count, or is skipped as a header
+	while (columns == 0 && std::getline(csv, line)) {
+		++line_number;
+		if (!parse_row(line, values)) {
+			if (line_number == 1) continue;
+			throw std::invalid_argument("Line " + std::to_string(line_number) + " is not numeric");
+		}
+		columns = values.size();
+	}
+	if (columns == 0) throw std::invalid_argument("CSV file has no samples");
+	if (columns <= output_count) {
+		throw std::invalid_argument("Samples have " + std::to_string(columns) + " columns, need more than the "
+			+ std::to_string(output_count) + " target columns");
+	}
+
+	nn::DatasetWriter<T> writer(output_path, columns - output_count, output_count);
+	while (true) {
+		if (!values.empty()) {
+			if (values.size() != columns) {
+				throw std::invalid_argument("Line " + std::to_string(line_number) + " has " + std::to_string(values.size())
+					+ " columns, expected " + std::to_string(columns));
+			}
+			writer.append(values.data(), values.data() + columns - output_count);
+		}
+
+		if (!std::getline(csv, line)) break;
+		++line_number;
+		if (!parse_row(line, values)) throw std::invalid_argument("Line " + std::to_string(line_number) + " is not numeric");
+	}
+
+	const size_t samples = writer.size();
+	writer.finish();
+	return samples;
+}
+
+int main(int argc, char** argv) {
+	try {
+		if (argc < 3) {
+			std::cerr << "Usage: " << argv[0] << " <input.csv> <output.bin> [--outputs N] [--precision double|float]" << std::endl;
+			return 1;
+		}
+
+		const std::string input_path = argv[1];
+		const std::string output_path = argv[2];
+		size_t output_count = 1;
+		std::string precision = "double";
+
+		for (int i = 3; i < argc; ++i) {
+			const std::string flag = argv[i];
+			if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + flag);
+			const std::string value = argv[++i];
+
+			if (flag == "--outputs") {
+				output_count = std::strtoul(value.c_str(), nullptr, 10);
+				if (output_count == 0) throw std::invalid_argument("Expected a positive number of outputs. Received: " + value);
+			}
+			else if (flag == "--precision") {
+				if (value != "double" && value != "float") throw std::invalid_argument("Expected double or float precision. Received: " + value);
+				precision = value;
+			}
+			else throw std::invalid_argument("Unknown option: " + flag);
+		}
+
+		std::ifstream csv(input_path);
+		if (!csv) throw std::invalid_argument("Cannot open file: " + input_path);
+
+		const size_t samples = precision == "float"
+			? convert<float>(csv, output_path, output_count)
+			: convert<double>(csv, output_path, output_count);
+
+		std::cout << "Wrote " << samples << " samples to " << output_path << " (" << precision << ")" << std::endl;
+		return 0;
+	} catch (const std::exception& e) {
+		std::cerr << "Error: " << e.what() << std::endl;
+		return 1;
+	}
+}